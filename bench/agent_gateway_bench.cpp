@@ -0,0 +1,260 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <agent_gateway/agent_gateway.hpp>
+#include <event_loop/io_event_loop.hpp>
+#include <packet_stream/packet_stream.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+/*
+    AgentGateway against an in-process lockstep server over loopback: the
+    server accepts every hello and game request and answers each ClientInput
+    with the session's next frame, so a step completes as soon as every
+    session has had its round trip. Reports steps/s and the allocations of
+    the whole process per step: the stepping thread, the gateway's receive
+    workers and the server, whose sends serialize every frame they answer
+    with. The stepping thread's own share is a separate counter.
+
+    agent_gateway_bench [--sessions N] [--bullets N] [--seconds S] [--step-threads N]
+                        [--io-workers N] [--port P] [--json]
+*/
+namespace {
+    constexpr uint16_t DEFAULT_PORT = 47400;
+
+    // Distinct frames the server cycles through
+    constexpr uint32_t SERVER_FRAME_COUNT = 64;
+
+    constexpr uint64_t WARMUP_STEPS = 100;
+
+    struct Options {
+        size_t      sessions        = 64;
+        uint32_t    bullets         = 200;
+        double      seconds         = 3.0;
+        size_t      step_threads    = 1;
+        size_t      io_workers      = 2;
+        uint16_t    port            = DEFAULT_PORT;
+    };
+
+    Options parse_options(int argc, char** argv) {
+        Options options;
+
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            const std::string arg = argv[i];
+
+            if (arg == "--sessions")            { options.sessions = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));      }
+            else if (arg == "--bullets")        { options.bullets = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));      }
+            else if (arg == "--seconds")        { options.seconds = std::strtod(argv[++i], nullptr);                                  }
+            else if (arg == "--step-threads")   { options.step_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));   }
+            else if (arg == "--io-workers")     { options.io_workers = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));     }
+            else if (arg == "--port")           { options.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));         }
+        }
+
+        return options;
+    }
+
+    /*
+        Accepts sessions until stopped and plays the server side of an agent
+        game: every input is answered with the frame after the one it was for
+    */
+    class LockstepServer {
+    public:
+        LockstepServer(uint16_t port, size_t workers, uint32_t bullets)
+            : m_listener(port)
+            , m_loop(workers)
+            , m_running(false)
+            , m_next_id(1)
+        {
+            BenchFrameGenerator generator(7);
+
+            for (uint32_t tick = 0; tick < SERVER_FRAME_COUNT; tick++)
+            {
+                m_frames.push_back(make_packet(generator.make(bullets, tick)));
+            }
+        }
+
+        ~LockstepServer() {
+            stop();
+        }
+
+        bool start() {
+            if (!m_listener.initialize())
+            {
+                return false;
+            }
+
+            m_loop.start();
+            m_running = true;
+            m_accept_thread = std::thread(&LockstepServer::accept_loop, this);
+
+            return true;
+        }
+
+        void stop() {
+            if (!m_running)
+            {
+                return;
+            }
+
+            m_running = false;
+            m_listener.abort();
+            m_accept_thread.join();
+
+            for (auto& stream : m_streams)
+            {
+                stream->stop();
+            }
+
+            m_streams.clear();
+            m_loop.stop();
+        }
+
+    private:
+        void accept_loop() {
+            while (m_running)
+            {
+                auto accepted = m_listener.accept_client();
+
+                if (!accepted.has_value())
+                {
+                    continue;
+                }
+
+                auto stream = std::make_unique<PacketStreamServer>(std::make_shared<ClientConnection>(std::move(accepted.value())));
+                auto* target = stream.get();
+
+                stream->on<ClientHello>([this, target](const PacketHeader&, const ClientHello&) {
+                    target->send_packet(make_packet(ServerAccept { m_next_id.fetch_add(1), 0, 0 }));
+                });
+
+                stream->on<ClientGameRequest>([this, target](const PacketHeader&, const ClientGameRequest&) {
+                    ServerGameResponse response = {};
+
+                    response.accepted = Accepted::Accepted;
+                    response.session_id = m_next_id.fetch_add(1);
+
+                    target->send_packet(make_packet(response));
+                    target->send_packet(m_frames[0]);
+                });
+
+                stream->on<ClientInput>([this, target](const PacketHeader&, const ClientInput& input) {
+                    target->send_packet(m_frames[(input.frame_timestamp + 1) % SERVER_FRAME_COUNT]);
+                });
+
+                stream->start(m_loop);
+                m_streams.push_back(std::move(stream));
+            }
+        }
+
+        ServerSocket                                        m_listener;
+        IoEventLoop                                         m_loop;
+        std::atomic<bool>                                   m_running;
+        std::thread                                         m_accept_thread;
+        std::vector<std::unique_ptr<PacketStreamServer>>    m_streams;     // Accept thread only until stop()
+        std::vector<Packet>                                 m_frames;
+        std::atomic<uint32_t>                               m_next_id;
+    };
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    LockstepServer server(options.port, options.io_workers, options.bullets);
+
+    if (!server.start())
+    {
+        std::fprintf(stderr, "agent_gateway_bench: failed to listen on port %u\n", options.port);
+        return 1;
+    }
+
+    AgentGatewayOptions gateway_options;
+
+    gateway_options.server_port     = options.port;
+    gateway_options.session_count   = options.sessions;
+    gateway_options.io_workers      = options.io_workers;
+    gateway_options.step_threads    = options.step_threads;
+    gateway_options.frame_timeout   = std::chrono::milliseconds(1000);
+
+    AgentGateway gateway(gateway_options);
+
+    if (gateway.connect() != options.sessions)
+    {
+        std::fprintf(stderr, "agent_gateway_bench: only %zu of %zu sessions got a game\n",
+                     static_cast<size_t>(gateway.stats().live_sessions), options.sessions);
+        return 1;
+    }
+
+    // Held arrows and buttons change now and then, like a policy's output
+    std::vector<uint32_t> actions(options.sessions);
+    std::vector<std::vector<uint32_t>> action_table(16, std::vector<uint32_t>(options.sessions));
+
+    for (size_t row = 0; row < action_table.size(); row++)
+    {
+        for (size_t i = 0; i < options.sessions; i++)
+        {
+            action_table[row][i] = static_cast<uint32_t>((row * 2654435761u + i * 40503u) >> 7) & 0xFFFFu;
+        }
+    }
+
+    for (uint64_t step = 0; step < WARMUP_STEPS; step++)
+    {
+        gateway.step(action_table[step % action_table.size()].data());
+    }
+
+    const auto warm = gateway.stats();
+    const auto measure_ns = static_cast<uint64_t>(options.seconds * 1e9);
+
+    uint64_t steps = 0;
+    uint64_t fresh = 0;
+
+    const auto allocs_before = bench_alloc_count();
+    const auto thread_allocs_before = bench_thread_alloc_count();
+    const auto start = bench_now_ns();
+
+    while (bench_now_ns() - start < measure_ns)
+    {
+        fresh += gateway.step(action_table[steps % action_table.size()].data());
+        steps++;
+    }
+
+    const auto elapsed = static_cast<double>(bench_now_ns() - start);
+    const auto allocs = bench_alloc_count() - allocs_before;
+    const auto thread_allocs = bench_thread_alloc_count() - thread_allocs_before;
+    const auto stats = gateway.stats();
+
+    gateway.close();
+    server.stop();
+
+    BenchResult result;
+
+    result.name             = "step_" + std::to_string(options.sessions) + "_sessions";
+    result.iterations       = steps;
+    result.total_ns         = elapsed;
+    result.bytes_per_op     = options.sessions * gateway.observation_size() * sizeof(float);
+    result.allocs_per_op    = steps > 0 ? static_cast<double>(allocs) / static_cast<double>(steps) : 0.0;
+
+    result.counters.emplace_back("sessions",            static_cast<double>(options.sessions));
+    result.counters.emplace_back("bullets",             options.bullets);
+    result.counters.emplace_back("step_threads",        static_cast<double>(options.step_threads));
+    result.counters.emplace_back("io_workers",          static_cast<double>(options.io_workers));
+    result.counters.emplace_back("env_steps_per_sec",   static_cast<double>(steps * options.sessions) / (elapsed / 1e9));
+    result.counters.emplace_back("fresh_ratio",         steps > 0 ? static_cast<double>(fresh) / static_cast<double>(steps * options.sessions) : 0.0);
+    result.counters.emplace_back("stale_observations",  static_cast<double>(stats.stale_observations - warm.stale_observations));
+    result.counters.emplace_back("send_failures",       static_cast<double>(stats.send_failures));
+    result.counters.emplace_back("step_thread_allocs_per_step", steps > 0 ? static_cast<double>(thread_allocs) / static_cast<double>(steps) : 0.0);
+    result.counters.emplace_back("gateway_steps_per_sec", stats.steps_per_second);
+
+    BenchReporter reporter("agent_gateway");
+
+    reporter.add(std::move(result));
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <thread>
+#include <queue>
+#include <async_channel.hpp>
+#include "bench_util.hpp"
+
+namespace {
+    constexpr uint64_t ITEM_COUNT = 1'000'000;
+    constexpr size_t BATCH_SIZE = 64;
+    constexpr size_t BOUNDED_CAPACITY = 1024;
+
+    /*
+        The channel as it was before bounded capacity and batching were added,
+        kept here as the baseline (minus the debug prints).
+    */
+    template <typename T>
+    class LegacyChannel {
+    public:
+        void send(T item) {
+            std::lock_guard lock(m_mtx);
+            m_queue.push(std::move(item));
+            m_cv.notify_one();
+        }
+
+        std::optional<T> recv() {
+            std::unique_lock lock(m_mtx);
+
+            m_cv.wait(lock, [this] {
+                return !m_queue.empty() || m_closed;
+            });
+
+            if (m_queue.empty())
+            {
+                return std::nullopt;
+            }
+
+            auto item = std::move(m_queue.front());
+            m_queue.pop();
+
+            return item;
+        }
+
+        void close() {
+            std::lock_guard lock(m_mtx);
+            m_closed = true;
+            m_cv.notify_all();
+        }
+
+    private:
+        std::queue<T>           m_queue;
+        std::mutex              m_mtx;
+        std::condition_variable m_cv;
+        bool                    m_closed = false;
+    };
+
+    template <typename Producer, typename Consumer>
+    BenchResult run_pair(const std::string& name, Producer producer, Consumer consumer) {
+        const auto start = bench_now_ns();
+
+        std::thread producer_thread(producer);
+        const uint64_t checksum = consumer();
+        producer_thread.join();
+
+        const auto end = bench_now_ns();
+
+        bench_do_not_optimize(checksum);
+
+        BenchResult result;
+        result.name         = name;
+        result.iterations   = ITEM_COUNT;
+        result.total_ns     = static_cast<double>(end - start);
+        result.bytes_per_op = sizeof(uint64_t);
+
+        return result;
+    }
+
+    BenchResult bench_legacy() {
+        LegacyChannel<uint64_t> ch;
+
+        return run_pair("legacy_unbounded", [&ch] {
+            for (uint64_t i = 0; i < ITEM_COUNT; i++)
+            {
+                ch.send(i);
+            }
+
+            ch.close();
+        }, [&ch] {
+            uint64_t sum = 0;
+
+            while (auto item = ch.recv())
+            {
+                sum += item.value();
+            }
+
+            return sum;
+        });
+    }
+
+    BenchResult bench_single(const std::string& name, const ChannelOptions& options) {
+        auto [tx, rx] = channel<uint64_t>(options);
+
+        return run_pair(name, [&tx = tx] {
+            for (uint64_t i = 0; i < ITEM_COUNT; i++)
+            {
+                tx.send(i);
+            }
+
+            tx.close();
+        }, [&rx = rx] {
+            uint64_t sum = 0;
+
+            while (auto item = rx.recv())
+            {
+                sum += item.value();
+            }
+
+            return sum;
+        });
+    }
+
+    BenchResult bench_batch(const std::string& name, const ChannelOptions& options) {
+        auto [tx, rx] = channel<uint64_t>(options);
+
+        return run_pair(name, [&tx = tx] {
+            std::vector<uint64_t> batch(BATCH_SIZE);
+
+            for (uint64_t i = 0; i < ITEM_COUNT; i += BATCH_SIZE)
+            {
+                const auto count = std::min<uint64_t>(BATCH_SIZE, ITEM_COUNT - i);
+
+                for (uint64_t j = 0; j < count; j++)
+                {
+                    batch[j] = i + j;
+                }
+
+                tx.send_batch(batch.begin(), batch.begin() + count);
+            }
+
+            tx.close();
+        }, [&rx = rx] {
+            uint64_t sum = 0;
+            std::vector<uint64_t> batch;
+
+            batch.reserve(BATCH_SIZE);
+
+            while (rx.recv_batch(batch, BATCH_SIZE) > 0)
+            {
+                for (auto item : batch)
+                {
+                    sum += item;
+                }
+
+                batch.clear();
+            }
+
+            return sum;
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("async_channel");
+
+    ChannelOptions unbounded;
+    ChannelOptions bounded { BOUNDED_CAPACITY, ChannelPolicy::Block, false };
+    ChannelOptions lock_free { BOUNDED_CAPACITY, ChannelPolicy::Block, true };
+
+    reporter.add(bench_legacy());
+    reporter.add(bench_single("unbounded", unbounded));
+    reporter.add(bench_single("bounded_block", bounded));
+    reporter.add(bench_single("bounded_lock_free", lock_free));
+    reporter.add(bench_batch("batch_unbounded", unbounded));
+    reporter.add(bench_batch("batch_bounded_block", bounded));
+    reporter.add(bench_batch("batch_lock_free", lock_free));
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/*
+    Counts every global allocation of the process, and of each thread.
+    Include from exactly one translation unit of a bench executable,
+    it replaces the global operator new/delete.
+*/
+inline std::atomic<uint64_t> g_bench_alloc_count{ 0 };
+inline thread_local uint64_t t_bench_thread_alloc_count = 0;
+
+uint64_t bench_alloc_count() {
+    return g_bench_alloc_count.load(std::memory_order_relaxed);
+}
+
+// Allocations made by the calling thread
+inline uint64_t bench_thread_alloc_count() {
+    return t_bench_thread_alloc_count;
+}
+
+void* operator new(std::size_t size) {
+    g_bench_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    t_bench_thread_alloc_count++;
+
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <cstdint>
+#include <packet_template/frame.hpp>
+
+/*
+    Synthetic frames shaped like a running stage: bullets are fired in rings
+    from a few emitters and move at constant speed, so consecutive frames
+    share most of their enum bytes, radii and velocities like real traffic does.
+*/
+class BenchFrameGenerator {
+public:
+    explicit BenchFrameGenerator(uint32_t seed = 1)
+        : m_rng(seed)
+    {}
+
+    FrameSnapshot make(uint32_t bullet_count, uint32_t tick) {
+        FrameSnapshot frame = {};
+
+        frame.client_id     = 1;
+        frame.opponent_id   = 2;
+        frame.timestamp     = tick;
+        frame.score         = tick * 10;
+        frame.mode          = GameMode::Single;
+        frame.difficulty    = GameDifficulty::Hard;
+        frame.state         = GameState::Playing;
+
+        frame.stage.id          = 1;
+        frame.stage.state       = StageState::Main;
+        frame.stage.timestamp   = tick;
+
+        PlayerSnapshot player = {};
+
+        player.state    = PlayerState::Visible;
+        player.pos      = { 240.0f + std::sin(tick * 0.05f) * 40.0f, 560.0f };
+        player.radius   = 3.0f;
+        player.lives    = 3;
+        player.bombs    = 2;
+        player.power    = 128;
+
+        frame.player_vector.push_back(player);
+        frame.player_count = 1;
+
+        EnemySnapshot enemy = {};
+
+        enemy.state     = EnemyState::Visible;
+        enemy.pos       = { 240.0f, 120.0f };
+        enemy.radius    = 16.0f;
+        enemy.health    = 500;
+
+        frame.enemy_vector.assign(4, enemy);
+        frame.enemy_count = 4;
+
+        std::uniform_int_distribution<int> jitter(0, 3);
+
+        frame.bullet_vector.reserve(bullet_count);
+
+        for (uint32_t i = 0; i < bullet_count; i++)
+        {
+            // 64 bullets per ring, rings spawned every 8 ticks
+            const auto ring = i / 64;
+            const auto angle = static_cast<float>(i % 64) * (6.2831853f / 64.0f);
+            const auto age = static_cast<float>((tick + ring * 8) % 240);
+            const auto speed = 1.5f + static_cast<float>(ring % 3) * 0.5f;
+
+            BulletSnapshot bullet = {};
+
+            bullet.id               = i;
+            bullet.vel              = { std::cos(angle) * speed, std::sin(angle) * speed };
+            bullet.pos              = { 240.0f + bullet.vel.x * age, 120.0f + bullet.vel.y * age };
+            bullet.radius           = ring % 2 == 0 ? 4.0f : 8.0f;
+            bullet.angle            = angle;
+            bullet.damage           = 1;
+            bullet.name             = static_cast<BulletName>(1 + (ring % 4) * 8 + jitter(m_rng) % 2);
+            bullet.state            = BulletState::Visible;
+            bullet.flight_pattern   = static_cast<uint8_t>(ring % 3);
+            bullet.owner            = 1;
+
+            frame.bullet_vector.push_back(bullet);
+        }
+
+        frame.bullet_count = bullet_count;
+
+        return frame;
+    }
+
+private:
+    std::mt19937 m_rng;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+    Minimal benchmark helpers shared by the bench executables.
+    Every result is printed as a human readable table and, with --json,
+    as one JSON document so runs can be diffed over time.
+*/
+struct BenchResult {
+    std::string name;
+    uint64_t    iterations      = 0;
+    double      total_ns        = 0.0;
+    uint64_t    bytes_per_op    = 0;
+    double      allocs_per_op   = 0.0;
+
+    // Extra named figures of a suite (compression ratio, percentiles, ...)
+    std::vector<std::pair<std::string, double>> counters;
+
+    double ns_per_op() const {
+        return iterations > 0 ? total_ns / static_cast<double>(iterations) : 0.0;
+    }
+
+    double ops_per_sec() const {
+        return total_ns > 0.0 ? static_cast<double>(iterations) * 1e9 / total_ns : 0.0;
+    }
+
+    double bytes_per_sec() const {
+        return ops_per_sec() * static_cast<double>(bytes_per_op);
+    }
+};
+
+inline uint64_t bench_now_ns() {
+    using namespace std::chrono;
+
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps the optimizer from discarding a benchmarked value
+template <typename T>
+inline void bench_do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Defined by bench_alloc.hpp, a bench calling bench_run() includes it once
+uint64_t bench_alloc_count();
+
+// Shortest timed run of bench_run(), doubling calibration passes stop at a tenth of it
+constexpr uint64_t BENCH_MIN_RUN_NS = 200'000'000;
+constexpr uint64_t BENCH_MIN_ITERATIONS = 8;
+
+/*
+    Calls body(i) for long enough to fill BENCH_MIN_RUN_NS, after doubling
+    calibration passes, and reports the timed pass with its allocations
+*/
+template <typename Body>
+BenchResult bench_run(const std::string& name, size_t bytes_per_op, Body body) {
+    uint64_t iterations = 1;
+    uint64_t elapsed = 0;
+
+    while (true)
+    {
+        const auto start = bench_now_ns();
+
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            body(i);
+        }
+
+        elapsed = bench_now_ns() - start;
+
+        if (elapsed * 10 >= BENCH_MIN_RUN_NS || iterations >= (uint64_t(1) << 30))
+        {
+            break;
+        }
+
+        iterations *= 2;
+    }
+
+    if (elapsed < BENCH_MIN_RUN_NS)
+    {
+        iterations = iterations * BENCH_MIN_RUN_NS / std::max<uint64_t>(elapsed, 1);
+    }
+
+    iterations = std::max(iterations, BENCH_MIN_ITERATIONS);
+
+    const auto allocs_before = bench_alloc_count();
+    const auto start = bench_now_ns();
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        body(i);
+    }
+
+    const auto end = bench_now_ns();
+    const auto allocs = bench_alloc_count() - allocs_before;
+
+    BenchResult result;
+
+    result.name             = name;
+    result.iterations       = iterations;
+    result.total_ns         = static_cast<double>(end - start);
+    result.bytes_per_op     = bytes_per_op;
+    result.allocs_per_op    = static_cast<double>(allocs) / static_cast<double>(iterations);
+
+    return result;
+}
+
+/*
+    bench_run() for bodies feeding a background thread: times bursts of
+    burst_size calls only, sleeping pause between them so the thread drains
+*/
+template <typename Body>
+BenchResult bench_run_bursts(const std::string& name, uint64_t bursts, uint64_t burst_size,
+                             std::chrono::milliseconds pause, Body body) {
+    uint64_t total_ns = 0;
+    uint64_t allocs = 0;
+
+    for (uint64_t burst = 0; burst < bursts; burst++)
+    {
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+
+        for (uint64_t i = 0; i < burst_size; i++)
+        {
+            body(burst * burst_size + i);
+        }
+
+        total_ns += bench_now_ns() - start;
+        allocs += bench_alloc_count() - allocs_before;
+
+        std::this_thread::sleep_for(pause);
+    }
+
+    BenchResult result;
+
+    result.name             = name;
+    result.iterations       = bursts * burst_size;
+    result.total_ns         = static_cast<double>(total_ns);
+    result.allocs_per_op    = static_cast<double>(allocs) / static_cast<double>(std::max<uint64_t>(result.iterations, 1));
+
+    return result;
+}
+
+class BenchReporter {
+public:
+    explicit BenchReporter(std::string suite)
+        : m_suite(std::move(suite))
+    {}
+
+    void add(BenchResult result) {
+        m_results.push_back(std::move(result));
+    }
+
+    void print_table(std::ostream& out = std::cout) const {
+        out << "[" << m_suite << "]" << "\n";
+
+        for (const auto& r : m_results)
+        {
+            out << "  " << r.name
+                << "  ns/op="   << r.ns_per_op()
+                << "  ops/s="   << r.ops_per_sec();
+
+            if (r.bytes_per_op > 0)
+            {
+                out << "  MB/s=" << r.bytes_per_sec() / 1e6;
+            }
+
+            out << "  allocs/op=" << r.allocs_per_op;
+
+            for (const auto& [name, value] : r.counters)
+            {
+                out << "  " << name << "=" << value;
+            }
+
+            out << "\n";
+        }
+    }
+
+    void print_json(std::ostream& out = std::cout) const {
+        out << "{\"suite\":\"" << m_suite << "\",\"results\":[";
+
+        for (size_t i = 0; i < m_results.size(); i++)
+        {
+            const auto& r = m_results[i];
+
+            out << (i > 0 ? "," : "")
+                << "{\"name\":\""       << r.name           << "\""
+                << ",\"iterations\":"   << r.iterations
+                << ",\"ns_per_op\":"    << r.ns_per_op()
+                << ",\"ops_per_sec\":"  << r.ops_per_sec()
+                << ",\"bytes_per_op\":" << r.bytes_per_op
+                << ",\"bytes_per_sec\":"<< r.bytes_per_sec()
+                << ",\"allocs_per_op\":"<< r.allocs_per_op;
+
+            for (const auto& [name, value] : r.counters)
+            {
+                out << ",\"" << name << "\":" << value;
+            }
+
+            out << "}";
+        }
+
+        out << "]}" << "\n";
+    }
+
+    // Prints JSON when --json is among the arguments, the table otherwise
+    void report(int argc, char** argv) const {
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::string(argv[i]) == "--json")
+            {
+                print_json();
+                return;
+            }
+        }
+
+        print_table();
+    }
+
+private:
+    std::string                 m_suite;
+    std::vector<BenchResult>    m_results;
+};
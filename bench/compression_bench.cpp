@@ -0,0 +1,124 @@
+#include <vector>
+#include <string>
+#include <packet_serializer/frame_serializer.hpp>
+#include <compression/payload_compression.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+
+namespace {
+    constexpr uint32_t TRAINING_FRAMES = 64;
+    constexpr uint32_t MEASURED_FRAMES = 64;
+    constexpr uint32_t BULLET_COUNTS[] = { 0, 100, 1000, 10000 };
+
+    std::vector<std::vector<std::byte>> record_frames(uint32_t bullet_count, uint32_t first_tick, uint32_t count) {
+        BenchFrameGenerator generator(bullet_count + 1);
+        std::vector<std::vector<std::byte>> frames;
+
+        for (uint32_t tick = first_tick; tick < first_tick + count; tick++)
+        {
+            frames.push_back(serialize_frame(generator.make(bullet_count, tick)).value());
+        }
+
+        return frames;
+    }
+
+    /*
+        One op = compressing (and then decompressing) one serialized FrameSnapshot.
+        ratio is raw bytes / compressed bytes over all measured frames.
+    */
+    void bench_codec(BenchReporter& reporter, const std::string& name, uint32_t bullet_count,
+                     const std::vector<std::vector<std::byte>>& frames, const CompressionOptions& options) {
+        std::vector<std::vector<std::byte>> compressed(frames.size());
+        uint64_t raw_bytes = 0;
+        uint64_t compressed_bytes = 0;
+
+        const auto compress_start = bench_now_ns();
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            auto bytes = compress_payload(frames[i], options);
+
+            compressed[i] = bytes.has_value() ? std::move(bytes.value()) : frames[i];
+        }
+
+        const auto compress_end = bench_now_ns();
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            raw_bytes += frames[i].size();
+            compressed_bytes += compressed[i].size();
+        }
+
+        const auto decompress_start = bench_now_ns();
+        size_t restored = 0;
+
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            if (compressed[i].size() == frames[i].size())
+            {
+                continue;
+            }
+
+            const auto bytes = decompress_payload(compressed[i], options);
+
+            restored += bytes.has_value() && bytes.value() == frames[i] ? 1 : 0;
+        }
+
+        const auto decompress_end = bench_now_ns();
+
+        bench_do_not_optimize(restored);
+
+        const auto ratio = compressed_bytes > 0 ? static_cast<double>(raw_bytes) / static_cast<double>(compressed_bytes) : 0.0;
+        const auto bytes_per_op = raw_bytes / frames.size();
+        const auto label = name + "/bullets_" + std::to_string(bullet_count);
+
+        BenchResult compress;
+
+        compress.name           = label + "/compress";
+        compress.iterations     = frames.size();
+        compress.total_ns       = static_cast<double>(compress_end - compress_start);
+        compress.bytes_per_op   = bytes_per_op;
+        compress.counters       = {
+            { "ratio", ratio },
+            { "compressed_bytes_per_op", static_cast<double>(compressed_bytes) / static_cast<double>(frames.size()) }
+        };
+
+        BenchResult decompress;
+
+        decompress.name         = label + "/decompress";
+        decompress.iterations   = frames.size();
+        decompress.total_ns     = static_cast<double>(decompress_end - decompress_start);
+        decompress.bytes_per_op = bytes_per_op;
+        decompress.counters     = { { "verified", static_cast<double>(restored) } };
+
+        reporter.add(std::move(compress));
+        reporter.add(std::move(decompress));
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("compression");
+
+    for (const auto bullet_count : BULLET_COUNTS)
+    {
+        // Train on earlier frames of the same session, measure on later ones
+        const auto training = record_frames(bullet_count, 0, TRAINING_FRAMES);
+        const auto frames = record_frames(bullet_count, TRAINING_FRAMES, MEASURED_FRAMES);
+
+        CompressionOptions plain;
+
+        plain.enabled   = true;
+        plain.threshold = 0;
+
+        CompressionOptions trained = plain;
+
+        trained.dictionary = std::make_shared<const LzDictionary>(train_lz_dictionary(training));
+
+        bench_codec(reporter, "lz", bullet_count, frames, plain);
+        bench_codec(reporter, "lz_dictionary", bullet_count, frames, trained);
+    }
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <event_loop/io_event_loop.hpp>
+#include <metrics/latency_histogram.hpp>
+#include <packet_stream/packet_stream.hpp>
+#include <packet_stream/packet_stream_awaitable.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+
+/*
+    The C++20 coroutine front-end over loopback: N server sessions and N
+    client sessions are coroutines sharing one IoEventLoop. Every client
+    sends a ClientInput and co_awaits the frame its server session answers
+    with, so the round trip covers send(), next_packet(), next_frame() and
+    two resumptions on the loop workers. Built as C++20, the library stays
+    C++17.
+
+    coroutine_bench [--sessions N] [--round-trips N] [--workers N] [--bullets N] [--port P] [--json]
+*/
+namespace {
+    constexpr uint16_t DEFAULT_PORT = 47500;
+
+    // Upper bound for the whole run, sessions still waiting then are reported as stalled
+    constexpr auto RUN_TIMEOUT = std::chrono::seconds(60);
+
+    struct Options {
+        size_t      sessions    = 64;
+        uint32_t    round_trips = 500;
+        size_t      workers     = 2;
+        uint32_t    bullets     = 200;
+        uint16_t    port        = DEFAULT_PORT;
+    };
+
+    Options parse_options(int argc, char** argv) {
+        Options options;
+
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            const std::string arg = argv[i];
+
+            if (arg == "--sessions")            { options.sessions = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));  }
+            else if (arg == "--round-trips")    { options.round_trips = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+            else if (arg == "--workers")        { options.workers = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));   }
+            else if (arg == "--bullets")        { options.bullets = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));  }
+            else if (arg == "--port")           { options.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));     }
+        }
+
+        return options;
+    }
+
+    /*
+        One server/client pair, the awaitable views install the streams'
+        receive callbacks so they are created before the streams start
+    */
+    struct SessionPair {
+        std::unique_ptr<PacketStreamServer>                     server;
+        std::unique_ptr<PacketStreamClient>                     client;
+        std::unique_ptr<AwaitableStream<PacketStreamServer>>    server_io;
+        std::unique_ptr<AwaitableStream<PacketStreamClient>>    client_io;
+
+        LatencyHistogram                                        round_trip;     // Client session only
+        uint32_t                                                completed = 0;  // Client session only
+    };
+
+    // Answers every ClientInput with a frame until the client goes away
+    SessionTask server_session(AwaitableStream<PacketStreamServer>& io, const Packet& frame) {
+        while (auto packet = co_await io.next_packet())
+        {
+            if (packet->header.payload_type == PayloadType::ClientInput)
+            {
+                co_await io.send(frame);
+            }
+        }
+    }
+
+    SessionTask client_session(SessionPair& pair, uint32_t round_trips, std::atomic<size_t>& finished) {
+        auto& io = *pair.client_io;
+
+        for (uint32_t i = 0; i < round_trips; i++)
+        {
+            ClientInput input = {};
+
+            input.client_id = 1;
+            input.frame_timestamp = i;
+
+            const auto start = bench_now_ns();
+
+            if (!co_await io.send(make_packet(input)))
+            {
+                break;
+            }
+
+            if (!(co_await io.next_frame()).has_value())
+            {
+                break;
+            }
+
+            pair.round_trip.record(bench_now_ns() - start);
+            pair.completed++;
+        }
+
+        finished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    ServerSocket listener(options.port);
+
+    if (!listener.initialize())
+    {
+        std::fprintf(stderr, "coroutine_bench: failed to listen on port %u\n", options.port);
+        return 1;
+    }
+
+    IoEventLoop loop(options.workers);
+    loop.start();
+
+    BenchFrameGenerator generator(11);
+
+    const auto frame = make_packet(generator.make(options.bullets, 1));
+
+    std::vector<std::unique_ptr<SessionPair>> pairs;
+
+    for (size_t i = 0; i < options.sessions; i++)
+    {
+        auto socket = std::make_shared<ClientSocket>("127.0.0.1", options.port);
+
+        if (!socket->connect_to_server())
+        {
+            std::fprintf(stderr, "coroutine_bench: failed to connect session %zu\n", i);
+            return 1;
+        }
+
+        auto connection = listener.accept_client();
+
+        if (!connection.has_value())
+        {
+            std::fprintf(stderr, "coroutine_bench: failed to accept session %zu\n", i);
+            return 1;
+        }
+
+        auto pair = std::make_unique<SessionPair>();
+
+        pair->server = std::make_unique<PacketStreamServer>(std::make_shared<ClientConnection>(std::move(connection.value())));
+        pair->client = std::make_unique<PacketStreamClient>(socket);
+        pair->server_io = std::make_unique<AwaitableStream<PacketStreamServer>>(*pair->server, loop);
+        pair->client_io = std::make_unique<AwaitableStream<PacketStreamClient>>(*pair->client, loop);
+
+        pair->server->start(loop);
+        pair->client->start(loop);
+
+        spawn_session(loop, server_session(*pair->server_io, frame));
+
+        pairs.push_back(std::move(pair));
+    }
+
+    std::atomic<size_t> finished { 0 };
+
+    const auto start = bench_now_ns();
+
+    for (auto& pair : pairs)
+    {
+        spawn_session(loop, client_session(*pair, options.round_trips, finished));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + RUN_TIMEOUT;
+
+    while (finished.load(std::memory_order_acquire) < pairs.size() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto elapsed = static_cast<double>(bench_now_ns() - start);
+    const auto stalled = pairs.size() - finished.load(std::memory_order_acquire);
+
+    // Closing the clients ends the server sessions, stopping the loop runs what they have left
+    for (auto& pair : pairs)
+    {
+        pair->client->stop();
+        pair->server->stop();
+    }
+
+    loop.stop();
+
+    LatencyHistogram round_trip;
+    uint64_t completed = 0;
+
+    for (const auto& pair : pairs)
+    {
+        round_trip.merge(pair->round_trip);
+        completed += pair->completed;
+    }
+
+    BenchResult result;
+
+    result.name         = "round_trip_" + std::to_string(options.sessions) + "_sessions";
+    result.iterations   = completed;
+    result.total_ns     = elapsed;
+    result.bytes_per_op = 0;
+
+    result.counters.emplace_back("sessions",        static_cast<double>(options.sessions));
+    result.counters.emplace_back("workers",         static_cast<double>(options.workers));
+    result.counters.emplace_back("bullets",         options.bullets);
+    result.counters.emplace_back("round_trips_per_sec", static_cast<double>(completed) / (elapsed / 1e9));
+    result.counters.emplace_back("p50_us",          round_trip.percentile(50.0) / 1e3);
+    result.counters.emplace_back("p99_us",          round_trip.percentile(99.0) / 1e3);
+    result.counters.emplace_back("max_us",          round_trip.max() / 1e3);
+    result.counters.emplace_back("stalled_sessions", static_cast<double>(stalled));
+
+    BenchReporter reporter("coroutine");
+
+    reporter.add(std::move(result));
+    reporter.report(argc, argv);
+
+    return stalled == 0 ? 0 : 1;
+}
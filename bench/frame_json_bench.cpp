@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <frame_export/frame_json.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+/*
+    FrameJsonWriter against the std::ostringstream frame_to_json_str it
+    replaced (kept below as the baseline), frames parameterized by bullet
+    count, plus a JSON lines session written to a temporary file.
+*/
+namespace {
+    constexpr uint32_t FRAME_BULLET_COUNTS[] = { 0, 100, 1'000, 10'000 };
+    constexpr uint32_t SESSION_FRAMES = 64;
+
+    // The previous implementation: one stream insertion per token, every field printed as a float
+    template <typename T>
+    float f(T value) {
+        return static_cast<float>(value);
+    }
+
+    template <typename T>
+    void legacy_entity_head(std::ostringstream& oss, const char* prefix, uint32_t i, const T& entity) {
+        oss << "\"" << prefix << i << "\":{"
+            << "\"id\":" << f(entity.id) << "," << "\"name\":" << f(entity.name) << ","
+            << "\"state\":" << f(entity.state) << ",";
+    }
+
+    template <typename T>
+    void legacy_entity_motion(std::ostringstream& oss, const T& entity) {
+        oss << "\"pos\":{" << "\"x\":" << f(entity.pos.x) << "," << "\"y\":" << f(entity.pos.y) << "},"
+            << "\"vel\":{" << "\"x\":" << f(entity.vel.x) << "," << "\"y\":" << f(entity.vel.y) << "},"
+            << "\"radius\":" << f(entity.radius) << "," << "\"angle\":" << f(entity.angle) << ",";
+    }
+
+    std::string legacy_frame_to_json_str(const FrameSnapshot& frame) {
+        std::ostringstream oss;
+
+        oss << "{\"frame\":{"
+            << "\"client_id\":" << f(frame.client_id) << "," << "\"opponent_id\":" << f(frame.opponent_id) << ","
+            << "\"timestamp\":" << f(frame.timestamp) << "," << "\"score\":" << f(frame.score) << ","
+            << "\"mode\":" << f(frame.mode) << "," << "\"difficulty\":" << f(frame.difficulty) << ","
+            << "\"state\":" << f(frame.state) << "},"
+            << "\"stage\":{"
+            << "\"id\":" << f(frame.stage.id) << "," << "\"name\":" << f(frame.stage.name) << ","
+            << "\"state\":" << f(frame.stage.state) << "," << "\"next_stage\":" << f(frame.stage.next_stage) << ","
+            << "\"timestamp\":" << f(frame.stage.timestamp) << "},";
+
+        oss << "\"player_count\":" << frame.player_count << ",";
+
+        for (uint32_t i = 0; i < frame.player_count; i++)
+        {
+            const auto& player = frame.player_vector[i];
+
+            legacy_entity_head(oss, "player_", i, player);
+            oss << "\"attack_pattern\":" << f(player.attack_pattern) << ",";
+            legacy_entity_motion(oss, player);
+            oss << "\"current_spell\":" << f(player.current_spell) << "," << "\"lives\":" << f(player.lives) << ","
+                << "\"bombs\":" << f(player.bombs) << "," << "\"power\":" << f(player.power) << "},";
+        }
+
+        oss << "\"enemy_count\":" << frame.enemy_count << ",";
+
+        for (uint32_t i = 0; i < frame.enemy_count; i++)
+        {
+            const auto& enemy = frame.enemy_vector[i];
+
+            legacy_entity_head(oss, "enemy_", i, enemy);
+            oss << "\"attack_pattern\":" << f(enemy.attack_pattern) << ",";
+            legacy_entity_motion(oss, enemy);
+            oss << "\"health\":" << f(enemy.health) << "},";
+        }
+
+        oss << "\"boss_count\":" << frame.boss_count << ",";
+
+        for (uint32_t i = 0; i < frame.boss_count; i++)
+        {
+            const auto& boss = frame.boss_vector[i];
+
+            legacy_entity_head(oss, "boss_", i, boss);
+            oss << "\"attack_pattern\":" << f(boss.attack_pattern) << ",";
+            legacy_entity_motion(oss, boss);
+            oss << "\"health\":" << f(boss.health) << "," << "\"current_spell\":" << f(boss.current_spell) << ","
+                << "\"phase\":" << f(boss.phase) << "},";
+        }
+
+        oss << "\"bullet_count\":" << frame.bullet_count << ",";
+
+        for (uint32_t i = 0; i < frame.bullet_count; i++)
+        {
+            const auto& bullet = frame.bullet_vector[i];
+
+            legacy_entity_head(oss, "bullet_", i, bullet);
+            oss << "\"flight_pattern\":" << f(bullet.flight_pattern) << "," << "\"owner\":" << f(bullet.owner) << ",";
+            legacy_entity_motion(oss, bullet);
+            oss << "\"damage\":" << f(bullet.damage) << "},";
+        }
+
+        oss << "\"item_count\":" << frame.item_count;
+
+        for (uint32_t i = 0; i < frame.item_count; i++)
+        {
+            const auto& item = frame.item_vector[i];
+
+            oss << ",";
+            legacy_entity_head(oss, "item_", i, item);
+            oss << "\"flight_pattern\":" << f(item.flight_pattern) << ",";
+            legacy_entity_motion(oss, item);
+            oss << "\"score\":" << f(item.score) << "}";
+        }
+
+        oss << "}";
+
+        return oss.str();
+    }
+
+    void add_frame_benchmarks(BenchReporter& reporter) {
+        BenchFrameGenerator generator(3);
+        FrameJsonWriter writer;
+
+        for (const auto bullets : FRAME_BULLET_COUNTS)
+        {
+            const auto frame = generator.make(bullets, 120);
+            const auto suffix = "_" + std::to_string(bullets);
+
+            const auto legacy_bytes = legacy_frame_to_json_str(frame).size();
+            const auto bytes = writer.write(frame).size();
+
+            auto legacy = bench_run("legacy_frame_to_json_str" + suffix, legacy_bytes, [&](uint64_t) {
+                bench_do_not_optimize(legacy_frame_to_json_str(frame));
+            });
+
+            auto streamed = bench_run("frame_json_writer" + suffix, bytes, [&](uint64_t) {
+                bench_do_not_optimize(writer.write(frame));
+            });
+
+            auto copied = bench_run("frame_to_json_str" + suffix, bytes, [&](uint64_t) {
+                bench_do_not_optimize(frame_to_json_str(frame));
+            });
+
+            const auto speedup = (legacy.total_ns / static_cast<double>(legacy.iterations))
+                               / (streamed.total_ns / static_cast<double>(streamed.iterations));
+
+            legacy.counters.emplace_back("bullets", bullets);
+            streamed.counters.emplace_back("bullets", bullets);
+            streamed.counters.emplace_back("speedup_vs_legacy", speedup);
+            copied.counters.emplace_back("bullets", bullets);
+
+            reporter.add(std::move(legacy));
+            reporter.add(std::move(streamed));
+            reporter.add(std::move(copied));
+        }
+    }
+
+    void add_session_benchmark(BenchReporter& reporter) {
+        BenchFrameGenerator generator(4);
+        std::vector<FrameSnapshot> frames;
+
+        for (uint32_t tick = 0; tick < SESSION_FRAMES; tick++)
+        {
+            frames.push_back(generator.make(1'000, tick));
+        }
+
+        const auto path = (std::filesystem::temp_directory_path() / "frame_json_bench.jsonl").string();
+
+        FrameJsonLinesWriter lines;
+
+        if (!lines.open(path))
+        {
+            std::fprintf(stderr, "frame_json_bench: failed to open %s, skipping the JSON lines case\n", path.c_str());
+            return;
+        }
+
+        FrameJsonWriter writer;
+        size_t session_bytes = 0;
+
+        for (const auto& frame : frames)
+        {
+            session_bytes += writer.write(frame).size() + 1;
+        }
+
+        auto result = bench_run("json_lines_session_1000", session_bytes, [&](uint64_t) {
+            lines.open(path);
+
+            for (const auto& frame : frames)
+            {
+                lines.write(frame);
+            }
+
+            lines.flush();
+        });
+
+        result.counters.emplace_back("frames", SESSION_FRAMES);
+
+        reporter.add(std::move(result));
+
+        lines.close();
+        std::filesystem::remove(path);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("frame_json");
+
+    add_frame_benchmarks(reporter);
+    add_session_benchmark(reporter);
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
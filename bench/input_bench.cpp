@@ -0,0 +1,119 @@
+#include <vector>
+#include <string>
+#include <packet_serializer/input_serializer.hpp>
+#include "bench_util.hpp"
+#include "bench_alloc.hpp"
+
+namespace {
+    /*
+        The byte-per-bitset encoder as it was before the packed format,
+        kept here as the baseline
+    */
+    template <size_t N>
+    void legacy_serialize_bitset(const std::bitset<N>& bits, std::vector<std::byte>& out) {
+        constexpr size_t byte_size = (N + 7) / 8;
+
+        for (size_t i = 0; i < byte_size; i++)
+        {
+            uint8_t byte = 0;
+
+            for (size_t b = 0; b < 8; b++)
+            {
+                size_t bit_index = i * 8 + b;
+
+                if (bit_index < N && bits[bit_index])
+                {
+                    byte |= (1 << b);
+                }
+            }
+
+            out.push_back(static_cast<std::byte>(byte));
+        }
+    }
+
+    void legacy_serialize_uint32_t(uint32_t value, std::vector<std::byte>& out) {
+        for (size_t i = 0; i < sizeof(uint32_t); i++)
+        {
+            out.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
+        }
+    }
+
+    std::vector<std::byte> legacy_serialize_client_input(const ClientInput& payload) {
+        std::vector<std::byte> buffer;
+
+        buffer.reserve(32);
+
+        legacy_serialize_uint32_t(payload.client_id,       buffer);
+        legacy_serialize_uint32_t(payload.frame_timestamp, buffer);
+
+        legacy_serialize_bitset(payload.game_input.held,            buffer);
+        legacy_serialize_bitset(payload.game_input.pressed,         buffer);
+        legacy_serialize_bitset(payload.game_input.released,        buffer);
+        legacy_serialize_bitset(payload.game_input.arrows.held,     buffer);
+        legacy_serialize_bitset(payload.game_input.arrows.pressed,  buffer);
+        legacy_serialize_bitset(payload.game_input.arrows.released, buffer);
+
+        return buffer;
+    }
+
+    std::vector<ClientInput> make_inputs() {
+        std::vector<ClientInput> inputs(256);
+
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i].client_id = 7;
+            inputs[i].frame_timestamp = static_cast<uint32_t>(i);
+            inputs[i].game_input.held = std::bitset<static_cast<size_t>(GameAction::Count)>(i * 13);
+            inputs[i].game_input.pressed = std::bitset<static_cast<size_t>(GameAction::Count)>(i * 7);
+            inputs[i].game_input.arrows.held = std::bitset<static_cast<size_t>(Arrow::Count)>(i);
+        }
+
+        return inputs;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("client_input");
+
+    const auto inputs = make_inputs();
+    const auto mask = inputs.size() - 1;
+
+    std::vector<std::vector<std::byte>> legacy_bytes;
+    std::vector<ClientInputBytes> packed_bytes;
+
+    for (const auto& input : inputs)
+    {
+        legacy_bytes.push_back(legacy_serialize_client_input(input));
+        packed_bytes.push_back(encode_client_input(input));
+    }
+
+    reporter.add(bench_run("legacy_encode", CLIENT_INPUT_LEGACY_WIRE_SIZE, [&](uint64_t i) {
+        bench_do_not_optimize(legacy_serialize_client_input(inputs[i & mask]));
+    }));
+
+    reporter.add(bench_run("packed_encode_vector", CLIENT_INPUT_WIRE_SIZE, [&](uint64_t i) {
+        bench_do_not_optimize(serialize_client_input(inputs[i & mask]));
+    }));
+
+    reporter.add(bench_run("packed_encode_stack", CLIENT_INPUT_WIRE_SIZE, [&](uint64_t i) {
+        const auto bytes = encode_client_input(inputs[i & mask]);
+
+        bench_do_not_optimize(bytes);
+    }));
+
+    reporter.add(bench_run("legacy_decode", CLIENT_INPUT_LEGACY_WIRE_SIZE, [&](uint64_t i) {
+        const auto& bytes = legacy_bytes[i & mask];
+
+        bench_do_not_optimize(decode_client_input(bytes.data(), bytes.size()));
+    }));
+
+    reporter.add(bench_run("packed_decode", CLIENT_INPUT_WIRE_SIZE, [&](uint64_t i) {
+        const auto& bytes = packed_bytes[i & mask];
+
+        bench_do_not_optimize(decode_client_input(bytes.data(), bytes.size()));
+    }));
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <random>
+#include <string>
+#include <packet_serializer/input_serializer.hpp>
+#include <input_window/input_window.hpp>
+#include "bench_util.hpp"
+#include "bench_alloc.hpp"
+
+namespace {
+    constexpr uint32_t TICKS = 200'000;
+
+    /*
+        The server consumes tick t - PLAYOUT_DELAY, so only the windows of the next
+        PLAYOUT_DELAY ticks can still fill it in, larger windows only help longer delays
+    */
+    constexpr uint32_t PLAYOUT_DELAY = 3;
+
+    // Bytes of a compact header with a sequence number (see header.hpp)
+    constexpr size_t HEADER_BYTES = 4;
+
+    struct LossModel {
+        std::string name;
+        double      loss;           // Chance to lose a packet in the good state
+        double      burst_enter;    // Chance to enter a loss burst
+        double      burst_exit;     // Chance to leave a loss burst (every packet is lost inside)
+    };
+
+    ClientInput make_input(std::mt19937& rng, const ClientInput& previous, uint32_t tick) {
+        ClientInput input = previous;
+
+        input.frame_timestamp = tick;
+
+        // Players hold keys for a while, the state changes every few ticks
+        if (rng() % 8 == 0)
+        {
+            input.game_input.held = std::bitset<static_cast<size_t>(GameAction::Count)>(rng());
+            input.game_input.arrows.held = std::bitset<static_cast<size_t>(Arrow::Count)>(rng());
+        }
+
+        return input;
+    }
+
+    BenchResult simulate(const LossModel& model, size_t window_size) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+        InputWindowBuilder builder(1, window_size);
+        InputTimeline timeline;
+        ClientInput input = {};
+
+        uint64_t wire_bytes = 0;
+        uint64_t lost_packets = 0;
+        uint64_t missed_ticks = 0;
+        bool in_burst = false;
+
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+
+        for (uint32_t tick = 1; tick <= TICKS; tick++)
+        {
+            input = make_input(rng, input, tick);
+
+            // Plain ClientInput packets when the window holds a single input
+            std::vector<std::byte> bytes = window_size == 1
+                ? serialize_client_input(input)
+                : serialize_client_input_window(builder.push(input)).value();
+
+            wire_bytes += HEADER_BYTES + bytes.size();
+
+            in_burst = in_burst ? chance(rng) >= model.burst_exit : chance(rng) < model.burst_enter;
+
+            if (in_burst || chance(rng) < model.loss)
+            {
+                lost_packets++;
+            }
+            else if (window_size == 1)
+            {
+                timeline.insert(deserialize_client_input(bytes).value());
+            }
+            else
+            {
+                timeline.merge(deserialize_client_input_window(bytes).value());
+            }
+
+            if (tick > PLAYOUT_DELAY && !timeline.take(tick - PLAYOUT_DELAY).has_value())
+            {
+                missed_ticks++;
+            }
+        }
+
+        const auto end = bench_now_ns();
+        const auto allocs = bench_alloc_count() - allocs_before;
+        const auto played = static_cast<double>(TICKS - PLAYOUT_DELAY);
+
+        BenchResult result;
+
+        result.name         = model.name + "/window_" + std::to_string(window_size);
+        result.iterations   = TICKS;
+        result.total_ns     = static_cast<double>(end - start);
+        result.bytes_per_op = wire_bytes / TICKS;
+        result.allocs_per_op = static_cast<double>(allocs) / TICKS;
+        result.counters     = {
+            { "packet_loss",    static_cast<double>(lost_packets) / TICKS },
+            { "tick_loss",      static_cast<double>(missed_ticks) / played },
+            { "recovered",      static_cast<double>(timeline.stats().recovered) },
+            { "bytes_per_tick", static_cast<double>(wire_bytes) / TICKS }
+        };
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("input_window");
+
+    const LossModel models[] = {
+        { "loss_0",         0.00, 0.0,  1.0 },
+        { "loss_1",         0.01, 0.0,  1.0 },
+        { "loss_5",         0.05, 0.0,  1.0 },
+        { "loss_20",        0.20, 0.0,  1.0 },
+        { "burst_1_of_4",   0.01, 0.01, 0.25 }
+    };
+
+    for (const auto& model : models)
+    {
+        for (const size_t window_size : { 1, 2, 4, 8 })
+        {
+            reporter.add(simulate(model, window_size));
+        }
+    }
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <condition_variable>
+#include <cstdio>
+#include <iomanip>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <logger/logger.hpp>
+#include "bench_util.hpp"
+#include "bench_alloc.hpp"
+
+namespace {
+    // Records per burst stay below the ring capacity so nothing is dropped
+    constexpr uint64_t BURST_SIZE = LOG_THREAD_RING_CAPACITY / 2;
+    constexpr uint64_t BURSTS = 2'000;
+
+    // Only the caller side is timed, the pause lets the logger thread drain the ring
+    constexpr auto BURST_PAUSE = std::chrono::milliseconds(2);
+
+    /*
+        The mutex and ostringstream based logger as it was before the
+        binary rings, kept here as the baseline (the caller side only)
+    */
+    std::mutex              legacy_mutex;
+    std::queue<std::string> legacy_queue;
+
+    void legacy_async_log(LogLevel log_level, const std::string& message) {
+        using namespace std::chrono;
+
+        auto now = system_clock::now();
+        auto time_t_now = system_clock::to_time_t(now);
+        auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
+
+        std::tm buff;
+        localtime_r(&time_t_now, &buff);
+
+        std::ostringstream oss;
+
+        oss << std::put_time(&buff, "[%Y-%m-%d %H:%M:%S");
+        oss << '.' << std::setw(3) << std::setfill('0') << ms.count();
+        oss << ']';
+
+        std::lock_guard<std::mutex> lock(legacy_mutex);
+        legacy_queue.push(oss.str() + " [" + std::to_string(static_cast<int>(log_level)) + "] " + message);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("logger");
+
+    const std::string log_path = "logger_bench.log";
+    const std::string message = "client 42 connected from 127.0.0.1:5000";
+
+    reporter.add(bench_run_bursts("legacy_mutex_ostringstream", BURSTS, BURST_SIZE, BURST_PAUSE, [&](uint64_t i) {
+        legacy_async_log(LogLevel::Info, message);
+
+        if ((i & (BURST_SIZE - 1)) == BURST_SIZE - 1)
+        {
+            std::lock_guard<std::mutex> lock(legacy_mutex);
+            legacy_queue = {};
+        }
+    }));
+
+    start_async_logger(log_path);
+
+    reporter.add(bench_run_bursts("async_log_string", BURSTS, BURST_SIZE, BURST_PAUSE, [&](uint64_t) {
+        async_log(LogLevel::Info, message);
+    }));
+
+    reporter.add(bench_run_bursts("ASYNC_LOG_args", BURSTS, BURST_SIZE, BURST_PAUSE, [&](uint64_t i) {
+        ASYNC_LOG(LogLevel::Info, "client {} connected from {}:{} ({} ms)", i, "127.0.0.1", 5000, 1.5);
+    }));
+
+    reporter.add(bench_run_bursts("ASYNC_LOG_no_args", BURSTS, BURST_SIZE, BURST_PAUSE, [&](uint64_t) {
+        ASYNC_LOG(LogLevel::Debug, "tick");
+    }));
+
+    stop_async_logger();
+    std::remove(log_path.c_str());
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,356 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <event_loop/io_event_loop.hpp>
+#include <metrics/latency_histogram.hpp>
+#include <metrics/stream_metrics.hpp>
+#include <packet_serializer/packet_serializer.hpp>
+#include <packet_stream/packet_stream.hpp>
+#include <trace/trace.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+
+/*
+    End-to-end PacketStream baseline over loopback: N server/client stream
+    pairs, a ticker sending every client a frame per tick and every client
+    answering each frame with a ClientInput, like a player reacting to what
+    it sees. Reports frame (down) and input (up) one-way latency, the
+    frame-to-input round trip, packets/s, CPU per stream and thread count.
+    --metrics attaches StreamMetrics to every stream and writes their
+    Prometheus export to FILE once the run is over, --trace records the
+    measured ticks as Chrome trace-event JSON.
+
+    loopback_bench [--streams N] [--bullets N] [--seconds S] [--rate HZ] [--event-loop WORKERS] [--port P]
+                   [--metrics FILE] [--trace FILE] [--json]
+*/
+namespace {
+    constexpr uint16_t DEFAULT_PORT = 47200;
+
+    // Ticks a frame may be in flight before its send time is overwritten
+    constexpr uint32_t SEND_TIME_SLOTS = 1024;
+
+    struct Options {
+        size_t      streams     = 8;
+        uint32_t    bullets     = 500;
+        double      seconds     = 5.0;
+        double      rate        = 60.0;
+        size_t      event_loop  = 0;    // 0 = a receive thread per stream
+        uint16_t    port        = DEFAULT_PORT;
+        std::string metrics_path;           // Empty = no metrics attached
+        std::string trace_path;             // Empty = not traced
+    };
+
+    Options parse_options(int argc, char** argv) {
+        Options options;
+
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            const std::string arg = argv[i];
+
+            if (arg == "--streams")         { options.streams = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));   }
+            else if (arg == "--bullets")    { options.bullets = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));  }
+            else if (arg == "--seconds")    { options.seconds = std::strtod(argv[++i], nullptr);                              }
+            else if (arg == "--rate")       { options.rate = std::max(1.0, std::strtod(argv[++i], nullptr));                  }
+            else if (arg == "--event-loop") { options.event_loop = std::strtoul(argv[++i], nullptr, 10);                      }
+            else if (arg == "--port")       { options.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));     }
+            else if (arg == "--metrics")    { options.metrics_path = argv[++i];                                               }
+            else if (arg == "--trace")      { options.trace_path = argv[++i];                                                 }
+        }
+
+        return options;
+    }
+
+    size_t process_thread_count() {
+#ifdef __linux__
+        std::ifstream status("/proc/self/status");
+        std::string line;
+
+        while (std::getline(status, line))
+        {
+            if (line.rfind("Threads:", 0) == 0)
+            {
+                return std::strtoul(line.c_str() + 8, nullptr, 10);
+            }
+        }
+#endif
+        return 0;
+    }
+
+    /*
+        One server/client pair. Frame send times are written by the ticker and
+        input send times by the client's receive side, each histogram has a
+        single writer: the receive side of the stream it is measured on.
+    */
+    struct StreamPair {
+        std::unique_ptr<PacketStreamServer>         server;
+        std::unique_ptr<PacketStreamClient>         client;
+
+        std::unique_ptr<std::atomic<uint64_t>[]>    frame_sent_at;
+        std::unique_ptr<std::atomic<uint64_t>[]>    input_sent_at;
+
+        LatencyHistogram                            down;           // Client receive side
+        LatencyHistogram                            up;             // Server receive side
+        LatencyHistogram                            round_trip;     // Server receive side
+
+        // Past the warm-up ticks
+        std::atomic<uint64_t>                       frames_received{0};
+        std::atomic<uint64_t>                       inputs_received{0};
+    };
+
+    void bind_handlers(StreamPair& pair, uint32_t warmup_ticks) {
+        pair.client->on<FrameSnapshot>([&pair, warmup_ticks](const PacketHeader&, const FrameSnapshot& frame) {
+            const auto now = bench_now_ns();
+            const auto slot = frame.timestamp % SEND_TIME_SLOTS;
+
+            if (frame.timestamp >= warmup_ticks)
+            {
+                pair.down.record(now - pair.frame_sent_at[slot].load(std::memory_order_acquire));
+                pair.frames_received.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            ClientInput input = {};
+
+            input.client_id = 1;
+            input.frame_timestamp = frame.timestamp;
+
+            pair.input_sent_at[slot].store(bench_now_ns(), std::memory_order_release);
+            pair.client->send_packet(make_packet(input));
+        });
+
+        pair.server->on<ClientInput>([&pair, warmup_ticks](const PacketHeader&, const ClientInput& input) {
+            const auto now = bench_now_ns();
+            const auto slot = input.frame_timestamp % SEND_TIME_SLOTS;
+
+            if (input.frame_timestamp >= warmup_ticks)
+            {
+                pair.up.record(now - pair.input_sent_at[slot].load(std::memory_order_acquire));
+                pair.round_trip.record(now - pair.frame_sent_at[slot].load(std::memory_order_acquire));
+                pair.inputs_received.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    BenchResult make_latency_result(const std::string& name, const LatencyHistogram& histogram,
+                                    double elapsed_ns, uint64_t bytes_per_op) {
+        BenchResult result;
+
+        result.name         = name;
+        result.iterations   = histogram.count();
+        result.total_ns     = elapsed_ns;
+        result.bytes_per_op = bytes_per_op;
+
+        result.counters.emplace_back("p50_us",  histogram.percentile(50.0) / 1e3);
+        result.counters.emplace_back("p99_us",  histogram.percentile(99.0) / 1e3);
+        result.counters.emplace_back("p999_us", histogram.percentile(99.9) / 1e3);
+        result.counters.emplace_back("max_us",  histogram.max() / 1e3);
+        result.counters.emplace_back("mean_us", histogram.mean() / 1e3);
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    ServerSocket listener(options.port);
+
+    if (!listener.initialize())
+    {
+        std::fprintf(stderr, "loopback_bench: failed to listen on port %u\n", options.port);
+        return 1;
+    }
+
+    std::unique_ptr<IoEventLoop> loop;
+
+    if (options.event_loop > 0)
+    {
+        loop = std::make_unique<IoEventLoop>(options.event_loop);
+        loop->start();
+    }
+
+    const auto warmup_ticks = static_cast<uint32_t>(options.rate / 2.0);
+    std::vector<std::unique_ptr<StreamPair>> pairs;
+
+    for (size_t i = 0; i < options.streams; i++)
+    {
+        auto socket = std::make_shared<ClientSocket>("127.0.0.1", options.port);
+
+        if (!socket->connect_to_server())
+        {
+            std::fprintf(stderr, "loopback_bench: failed to connect stream %zu\n", i);
+            return 1;
+        }
+
+        auto connection = listener.accept_client();
+
+        if (!connection.has_value())
+        {
+            std::fprintf(stderr, "loopback_bench: failed to accept stream %zu\n", i);
+            return 1;
+        }
+
+        auto pair = std::make_unique<StreamPair>();
+
+        pair->server = std::make_unique<PacketStreamServer>(std::make_shared<ClientConnection>(std::move(connection.value())));
+        pair->client = std::make_unique<PacketStreamClient>(socket);
+        pair->frame_sent_at = std::make_unique<std::atomic<uint64_t>[]>(SEND_TIME_SLOTS);
+        pair->input_sent_at = std::make_unique<std::atomic<uint64_t>[]>(SEND_TIME_SLOTS);
+
+        bind_handlers(*pair, warmup_ticks);
+
+        if (!options.metrics_path.empty())
+        {
+            pair->server->set_metrics(MetricsRegistry::global().create_stream("server-" + std::to_string(i)));
+            pair->client->set_metrics(MetricsRegistry::global().create_stream("client-" + std::to_string(i)));
+        }
+
+        if (loop)
+        {
+            pair->server->start(*loop);
+            pair->client->start(*loop);
+        }
+        else
+        {
+            pair->server->start();
+            pair->client->start();
+        }
+
+        pairs.push_back(std::move(pair));
+    }
+
+    // Ticker
+    BenchFrameGenerator generator(5);
+
+    const auto tick_ns = static_cast<uint64_t>(1e9 / options.rate);
+    const auto ticks = static_cast<uint32_t>(options.seconds * options.rate) + warmup_ticks;
+
+    uint64_t frame_bytes = 0;
+    uint64_t measure_start = 0;
+    std::clock_t cpu_start = 0;
+
+    const auto start = bench_now_ns();
+
+    trace_set_thread_name("ticker");
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+        const auto due = start + tick * tick_ns;
+        const auto now = bench_now_ns();
+
+        if (due > now)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+        }
+
+        if (tick == warmup_ticks)
+        {
+            measure_start = bench_now_ns();
+            cpu_start = std::clock();
+
+            if (!options.trace_path.empty())
+            {
+                trace_start();
+            }
+        }
+
+        TRACE_ZONE("tick", "bench");
+
+        const auto packet = make_packet(generator.make(options.bullets, tick));
+
+        if (frame_bytes == 0)
+        {
+            frame_bytes = serialize_frame(std::get<FrameSnapshot>(packet.payload)).value().size();
+        }
+
+        for (auto& pair : pairs)
+        {
+            pair->frame_sent_at[tick % SEND_TIME_SLOTS].store(bench_now_ns(), std::memory_order_release);
+            pair->server->send_packet(packet);
+        }
+    }
+
+    // Let the last round trips land
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const auto measure_end = bench_now_ns();
+    const auto cpu_end = std::clock();
+
+    trace_stop();
+    const auto threads = process_thread_count();
+
+    for (auto& pair : pairs)
+    {
+        pair->server->stop();
+    }
+
+    for (auto& pair : pairs)
+    {
+        pair->client->stop();
+    }
+
+    if (loop)
+    {
+        loop->stop();
+    }
+
+    LatencyHistogram down;
+    LatencyHistogram up;
+    LatencyHistogram round_trip;
+    uint64_t packets = 0;
+    const uint64_t expected = static_cast<uint64_t>(ticks - warmup_ticks) * pairs.size() * 2;
+
+    for (const auto& pair : pairs)
+    {
+        down.merge(pair->down);
+        up.merge(pair->up);
+        round_trip.merge(pair->round_trip);
+        packets += pair->frames_received.load() + pair->inputs_received.load();
+    }
+
+    const auto elapsed = static_cast<double>(measure_end - measure_start);
+    const auto cpu_seconds = static_cast<double>(cpu_end - cpu_start) / CLOCKS_PER_SEC;
+    const auto wall_seconds = elapsed / 1e9;
+
+    BenchReporter reporter("packet_stream_loopback");
+
+    reporter.add(make_latency_result("frame_down", down, elapsed, frame_bytes));
+    reporter.add(make_latency_result("input_up", up, elapsed, CLIENT_INPUT_WIRE_SIZE));
+    reporter.add(make_latency_result("frame_to_input_round_trip", round_trip, elapsed, 0));
+
+    BenchResult totals;
+
+    totals.name         = "totals";
+    totals.iterations   = packets;
+    totals.total_ns     = elapsed;
+
+    totals.counters.emplace_back("streams",                 static_cast<double>(pairs.size()));
+    totals.counters.emplace_back("bullets",                 options.bullets);
+    totals.counters.emplace_back("rate_hz",                 options.rate);
+    totals.counters.emplace_back("event_loop_workers",      static_cast<double>(options.event_loop));
+    totals.counters.emplace_back("packets_per_sec",         static_cast<double>(packets) / wall_seconds);
+    totals.counters.emplace_back("packets_lost",            static_cast<double>(expected - std::min(expected, packets)));
+    totals.counters.emplace_back("cpu_percent_per_stream",  cpu_seconds / wall_seconds * 100.0 / static_cast<double>(pairs.size()));
+    totals.counters.emplace_back("threads",                 static_cast<double>(threads));
+
+    reporter.add(std::move(totals));
+    reporter.report(argc, argv);
+
+    if (!options.metrics_path.empty())
+    {
+        std::ofstream(options.metrics_path) << MetricsRegistry::global().export_text();
+    }
+
+    if (!options.trace_path.empty() && !trace_write_chrome_json(options.trace_path))
+    {
+        std::fprintf(stderr, "loopback_bench: failed to write %s\n", options.trace_path.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <observation/observation_builder.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+/*
+    ObservationBuilder on frames parameterized by bullet count, with the
+    grid over the whole field and centered on the player, plus a batch of
+    frames built on one thread and on every hardware thread.
+*/
+namespace {
+    constexpr uint32_t FRAME_BULLET_COUNTS[] = { 0, 1'000, 10'000, 50'000 };
+    constexpr uint32_t BATCH_FRAMES = 256;
+    constexpr uint32_t BATCH_BULLETS = 2'000;
+
+    void add_frame_benchmarks(BenchReporter& reporter, bool player_centered) {
+        BenchFrameGenerator generator(5);
+
+        ObservationOptions options;
+        options.player_centered = player_centered;
+
+        ObservationBuilder builder(options);
+        std::vector<float> observation(builder.observation_size());
+
+        for (const auto bullets : FRAME_BULLET_COUNTS)
+        {
+            const auto frame = generator.make(bullets, 120);
+            const auto name = std::string(player_centered ? "build_centered_" : "build_field_") + std::to_string(bullets);
+
+            auto result = bench_run(name, observation.size() * sizeof(float), [&](uint64_t) {
+                builder.build(frame, observation.data());
+                bench_do_not_optimize(observation.data());
+            });
+
+            result.counters.emplace_back("bullets", bullets);
+
+            reporter.add(std::move(result));
+        }
+    }
+
+    void add_batch_benchmarks(BenchReporter& reporter) {
+        BenchFrameGenerator generator(6);
+        std::vector<FrameSnapshot> frames;
+
+        for (uint32_t tick = 0; tick < BATCH_FRAMES; tick++)
+        {
+            frames.push_back(generator.make(BATCH_BULLETS, tick));
+        }
+
+        const ObservationBuilder builder;
+        std::vector<float> batch(frames.size() * builder.observation_size());
+
+        std::vector<size_t> thread_counts = { 1 };
+
+        if (std::thread::hardware_concurrency() > 1)
+        {
+            thread_counts.push_back(std::thread::hardware_concurrency());
+        }
+
+        for (const auto threads : thread_counts)
+        {
+            auto result = bench_run("build_batch_" + std::to_string(BATCH_FRAMES) + "_threads_" + std::to_string(threads),
+                              batch.size() * sizeof(float), [&](uint64_t) {
+                builder.build_batch(frames, batch.data(), threads);
+                bench_do_not_optimize(batch.data());
+            });
+
+            result.counters.emplace_back("frames", BATCH_FRAMES);
+            result.counters.emplace_back("bullets", BATCH_BULLETS);
+            result.counters.emplace_back("threads", static_cast<double>(threads));
+
+            reporter.add(std::move(result));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("observation");
+
+    add_frame_benchmarks(reporter, false);
+    add_frame_benchmarks(reporter, true);
+    add_batch_benchmarks(reporter);
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
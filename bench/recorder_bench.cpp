@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <recorder/session_recorder.hpp>
+#include "bench_util.hpp"
+#include "bench_alloc.hpp"
+
+namespace {
+    constexpr uint64_t PACKETS = 200'000;
+
+    /*
+        Caller side cost of record() copying a payload into the recorder's
+        ring, plus how fast the writer thread gets them to disk. The ring
+        holds the whole run so the figure does not depend on the disk.
+    */
+    BenchResult record_packets(const std::string& name, size_t payload_size) {
+        const std::string path = "recorder_bench.bhr";
+        const auto record_size = (SESSION_RECORD_HEADER_SIZE + payload_size + SESSION_RECORDER_CHUNK_SIZE - 1)
+                               / SESSION_RECORDER_CHUNK_SIZE * SESSION_RECORDER_CHUNK_SIZE;
+
+        const std::vector<std::byte> payload(payload_size, std::byte{ 0x5A });
+
+        SessionRecorder recorder(PACKETS * record_size);
+        recorder.start(path);
+
+        PacketHeader header = {};
+
+        header.magic_number = PACKET_MAGIC_NUMBER;
+        header.payload_type = PayloadType::FrameSnapshot;
+
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+
+        for (uint64_t i = 0; i < PACKETS; i++)
+        {
+            header.sequence_number = static_cast<uint32_t>(i);
+            recorder.record(1, RecordDirection::Sent, header, payload.data(), payload.size());
+        }
+
+        const auto end = bench_now_ns();
+        const auto allocs = bench_alloc_count() - allocs_before;
+
+        recorder.stop();
+
+        const auto written_end = bench_now_ns();
+        const auto stats = recorder.stats();
+
+        std::remove(path.c_str());
+
+        BenchResult result;
+
+        result.name             = name;
+        result.iterations       = PACKETS;
+        result.total_ns         = static_cast<double>(end - start);
+        result.bytes_per_op     = payload_size + SESSION_RECORD_HEADER_SIZE;
+        result.allocs_per_op    = static_cast<double>(allocs) / static_cast<double>(PACKETS);
+
+        result.counters.emplace_back("dropped", static_cast<double>(stats.dropped));
+        result.counters.emplace_back("written_MB", static_cast<double>(stats.bytes_written) / 1e6);
+        result.counters.emplace_back("disk_MB/s", static_cast<double>(stats.bytes_written) * 1e3 / static_cast<double>(written_end - start));
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("session_recorder");
+
+    reporter.add(record_packets("record_input_16B", 16));
+    reporter.add(record_packets("record_small_256B", 256));
+    reporter.add(record_packets("record_frame_4KB", 4096));
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <packet_serializer/frame_serializer.hpp>
+#include <recorder/replay_reader.hpp>
+#include <recorder/session_recorder.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+namespace {
+    constexpr uint32_t FRAMES = 20'000;
+    constexpr uint32_t STREAMS = 4;
+    constexpr size_t BULLETS_PER_FRAME = 150;
+    constexpr uint64_t SEEKS = 1'000'000;
+
+    // The writer keeps up with the generator, record() is retried if it ever falls behind
+    constexpr size_t RECORDING_RING_SIZE = 64 * 1024 * 1024;
+
+    // The recording is written right before it is read, so it comes from the page cache
+    void write_recording(const std::string& path) {
+        BenchFrameGenerator generator(7);
+        SessionRecorder recorder(RECORDING_RING_SIZE);
+
+        recorder.start(path);
+
+        PacketHeader header = {};
+
+        header.magic_number = PACKET_MAGIC_NUMBER;
+        header.payload_type = PayloadType::FrameSnapshot;
+
+        for (uint32_t tick = 0; tick < FRAMES; tick++)
+        {
+            auto bytes = serialize_frame(generator.make(BULLETS_PER_FRAME, tick)).value();
+
+            for (uint32_t stream = 0; stream < STREAMS; stream++)
+            {
+                header.sequence_number = tick;
+
+                while (!recorder.record(stream, RecordDirection::Sent, header, bytes.data(), bytes.size()))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        recorder.stop();
+    }
+
+    BenchResult make_result(const std::string& name, uint64_t iterations, uint64_t elapsed_ns, uint64_t bytes, uint64_t allocs) {
+        BenchResult result;
+
+        result.name             = name;
+        result.iterations       = iterations;
+        result.total_ns         = static_cast<double>(elapsed_ns);
+        result.bytes_per_op     = iterations > 0 ? bytes / iterations : 0;
+        result.allocs_per_op    = iterations > 0 ? static_cast<double>(allocs) / static_cast<double>(iterations) : 0.0;
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("replay_reader");
+
+    const std::string path = "replay_bench.bhr";
+
+    write_recording(path);
+
+    ReplayReader reader;
+
+    if (!reader.open(path))
+    {
+        std::fprintf(stderr, "replay_bench: failed to open %s\n", path.c_str());
+        return 1;
+    }
+
+    // Every record, touching every payload byte
+    {
+        uint64_t records = 0;
+        uint64_t bytes = 0;
+        uint64_t checksum = 0;
+
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+        auto cursor = reader.records();
+
+        while (const auto record = cursor.next())
+        {
+            for (size_t i = 0; i + sizeof(uint64_t) <= record->payload_size(); i += sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, record->payload + i, sizeof(word));
+                checksum += word;
+            }
+
+            records++;
+            bytes += SESSION_RECORD_HEADER_SIZE + record->payload_size();
+        }
+
+        const auto end = bench_now_ns();
+        const auto allocs = bench_alloc_count() - allocs_before;
+
+        bench_do_not_optimize(checksum);
+        reporter.add(make_result("scan_records", records, end - start, bytes, allocs));
+    }
+
+    // Random seeks through the footer index
+    {
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<uint32_t> stream_dist(0, STREAMS - 1);
+        std::uniform_int_distribution<uint32_t> tick_dist(0, FRAMES - 1);
+
+        uint64_t found = 0;
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+
+        for (uint64_t i = 0; i < SEEKS; i++)
+        {
+            found += reader.seek_frame(stream_dist(rng), tick_dist(rng)).has_value() ? 1 : 0;
+        }
+
+        const auto end = bench_now_ns();
+        const auto allocs = bench_alloc_count() - allocs_before;
+
+        auto result = make_result("seek_frame", SEEKS, end - start, 0, allocs);
+
+        result.counters.emplace_back("index_entries", static_cast<double>(reader.index().size()));
+        result.counters.emplace_back("found", static_cast<double>(found));
+        reporter.add(std::move(result));
+    }
+
+    // Decoding one stream's frames straight from the mapping
+    {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+
+        const auto allocs_before = bench_alloc_count();
+        const auto start = bench_now_ns();
+        auto cursor = reader.frames(0);
+
+        while (const auto record = cursor.next())
+        {
+            const auto frame = record->frame();
+
+            bench_do_not_optimize(frame);
+            frames++;
+            bytes += record->payload_size();
+        }
+
+        const auto end = bench_now_ns();
+        const auto allocs = bench_alloc_count() - allocs_before;
+
+        reporter.add(make_result("decode_stream_frames", frames, end - start, bytes, allocs));
+    }
+
+    reader.close();
+    std::remove(path.c_str());
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
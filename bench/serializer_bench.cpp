@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <packet_serializer/packet_serializer.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+/*
+    Every serialize_* / deserialize_* pair of library/packet_serializer,
+    frames parameterized by bullet count. Each case runs for at least
+    BENCH_MIN_RUN_NS so the 50k bullet frames get as stable a figure as a
+    header.
+*/
+namespace {
+    constexpr uint32_t FRAME_BULLET_COUNTS[] = { 0, 10, 100, 1'000, 10'000, 50'000 };
+
+    // Benchmarks a serializer returning the bytes and the matching deserializer
+    template <typename T, typename Serialize, typename Deserialize>
+    void add_pair(BenchReporter& reporter, const std::string& name, const T& value,
+                  Serialize serialize, Deserialize deserialize) {
+        const auto bytes = serialize(value);
+
+        reporter.add(bench_run("serialize_" + name, bytes.size(), [&](uint64_t) {
+            bench_do_not_optimize(serialize(value));
+        }));
+
+        reporter.add(bench_run("deserialize_" + name, bytes.size(), [&](uint64_t) {
+            bench_do_not_optimize(deserialize(bytes));
+        }));
+    }
+
+    ClientHello make_client_hello() {
+        ClientHello hello = {};
+
+        hello.client_name_size = 6;
+        std::memcpy(hello.client_name, "player", 6);
+
+        return hello;
+    }
+
+    ServerGameResponse make_server_game_response() {
+        ServerGameResponse response = {};
+
+        response.accepted = Accepted::Rejected;
+        response.session_id = 42;
+        response.reason_size = 18;
+        std::memcpy(response.reason, "the lobby is full.", 18);
+
+        return response;
+    }
+
+    ServerReconnectResponse make_server_reconnect_response() {
+        ServerReconnectResponse response = {};
+
+        response.accepted = Accepted::Rejected;
+        response.reason_size = 17;
+        std::memcpy(response.reason, "session not found", 17);
+
+        return response;
+    }
+
+    ClientInput make_client_input(uint32_t tick) {
+        ClientInput input = {};
+
+        input.client_id = 7;
+        input.frame_timestamp = tick;
+        input.game_input.held = std::bitset<static_cast<size_t>(GameAction::Count)>(tick * 13);
+        input.game_input.arrows.held = std::bitset<static_cast<size_t>(Arrow::Count)>(tick);
+
+        return input;
+    }
+
+    // A held direction for most of the window, like the stream sends it
+    ClientInputWindow make_client_input_window() {
+        ClientInputWindow window;
+
+        window.client_id = 7;
+
+        for (uint32_t tick = 0; tick < 8; tick++)
+        {
+            window.inputs.push_back(make_client_input(tick < 6 ? 0 : 1));
+            window.inputs.back().frame_timestamp = 100 + tick;
+        }
+
+        return window;
+    }
+
+    void add_header_benchmarks(BenchReporter& reporter) {
+        PacketHeader header = {};
+
+        header.magic_number     = PACKET_MAGIC_NUMBER;
+        header.sequence_number  = 1'000;
+        header.payload_size     = 1'200;
+        header.payload_type     = PayloadType::FrameSnapshot;
+
+        add_pair(reporter, "packet_header", header, serialize_packet_header, deserialize_packet_header);
+
+        for (const bool with_sequence : { false, true })
+        {
+            const auto name = std::string("compact_header") + (with_sequence ? "_with_sequence" : "");
+            const auto bytes = serialize_compact_header(header, with_sequence);
+
+            reporter.add(bench_run("serialize_" + name, bytes.size(), [&](uint64_t) {
+                bench_do_not_optimize(serialize_compact_header(header, with_sequence));
+            }));
+
+            reporter.add(bench_run("deserialize_" + name, bytes.size(), [&](uint64_t) {
+                PacketHeader decoded;
+                size_t header_size = 0;
+
+                bench_do_not_optimize(deserialize_compact_header(bytes.data(), bytes.size(), header.sequence_number - 1,
+                                                                 decoded, header_size));
+                bench_do_not_optimize(decoded);
+            }));
+        }
+    }
+
+    void add_bundle_benchmarks(BenchReporter& reporter) {
+        const auto input_bytes = serialize_client_input(make_client_input(1));
+        const auto window_bytes = serialize_client_input_window(make_client_input_window()).value();
+
+        std::vector<std::byte> bundle;
+
+        append_bundle_entry(bundle, PayloadType::ClientInput, input_bytes);
+        append_bundle_entry(bundle, PayloadType::ClientInputWindow, window_bytes);
+
+        reporter.add(bench_run("serialize_bundle", bundle.size(), [&](uint64_t) {
+            std::vector<std::byte> out;
+
+            append_bundle_entry(out, PayloadType::ClientInput, input_bytes);
+            append_bundle_entry(out, PayloadType::ClientInputWindow, window_bytes);
+            bench_do_not_optimize(out);
+        }));
+
+        reporter.add(bench_run("deserialize_bundle", bundle.size(), [&](uint64_t) {
+            bench_do_not_optimize(deserialize_bundle(bundle));
+        }));
+    }
+
+    void add_frame_benchmarks(BenchReporter& reporter) {
+        BenchFrameGenerator generator(3);
+
+        for (const auto bullets : FRAME_BULLET_COUNTS)
+        {
+            const auto frame = generator.make(bullets, 120);
+            const auto bytes = serialize_frame(frame).value();
+            const auto suffix = "_frame_" + std::to_string(bullets);
+
+            auto serialize = bench_run("serialize" + suffix, bytes.size(), [&](uint64_t) {
+                bench_do_not_optimize(serialize_frame(frame));
+            });
+
+            auto deserialize = bench_run("deserialize" + suffix, bytes.size(), [&](uint64_t) {
+                bench_do_not_optimize(deserialize_frame(bytes));
+            });
+
+            serialize.counters.emplace_back("bullets", bullets);
+            deserialize.counters.emplace_back("bullets", bullets);
+
+            reporter.add(std::move(serialize));
+            reporter.add(std::move(deserialize));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("packet_serializer");
+
+    add_header_benchmarks(reporter);
+
+    add_pair(reporter, "client_hello",              make_client_hello(),                        serialize_client_hello,                 deserialize_client_hello);
+    add_pair(reporter, "server_accept",             ServerAccept { 7, 0, 0 },                   serialize_server_accept,                deserialize_server_accept);
+    add_pair(reporter, "client_goodbye",            ClientGoodbye { GoodByeReasonCode::NormalExit },    serialize_client_goodbye,   deserialize_client_goodbye);
+    add_pair(reporter, "server_goodbye",            ServerGoodbye { GoodByeReasonCode::Timeout },       serialize_server_goodbye,   deserialize_server_goodbye);
+    add_pair(reporter, "client_game_request",       ClientGameRequest { GameMode::Single, GameVariant::Default, GameDifficulty::Hard, 0 },
+                                                                                                serialize_client_game_request,          deserialize_client_game_request);
+    add_pair(reporter, "server_game_response",      make_server_game_response(),                serialize_server_game_response,         deserialize_server_game_response);
+    add_pair(reporter, "client_reconnect_request",  ClientReconnectRequest { 7, 42 },           serialize_client_reconnect_request,     deserialize_client_reconnect_request);
+    add_pair(reporter, "server_reconnect_response", make_server_reconnect_response(),           serialize_server_reconnect_response,    deserialize_server_reconnect_response);
+    add_pair(reporter, "client_input",              make_client_input(5),                       serialize_client_input,                 deserialize_client_input);
+
+    add_pair(reporter, "client_input_window", make_client_input_window(),
+        [](const ClientInputWindow& window) { return serialize_client_input_window(window).value(); },
+        deserialize_client_input_window);
+
+    add_bundle_benchmarks(reporter);
+    add_frame_benchmarks(reporter);
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <spatial_index/bullet_grid.hpp>
+#include "bench_util.hpp"
+#include "bench_frames.hpp"
+#include "bench_alloc.hpp"
+
+/*
+    BulletGrid per tick on frames parameterized by bullet count: the rebuild
+    alone, a rebuild plus hit and graze queries for a few players and a boss,
+    nearest-16 for the players, and the same hit and graze counts done by
+    testing every bullet against every hitbox for comparison. The grid's
+    counts are checked against those first, a mismatch fails the run.
+*/
+namespace {
+    constexpr uint32_t FRAME_BULLET_COUNTS[] = { 1'000, 10'000, 50'000 };
+    constexpr uint32_t PLAYER_COUNT = 8;
+    constexpr float GRAZE_RANGE = 16.0f;
+    constexpr size_t NEAREST_COUNT = 16;
+
+    // Players spread over the lower field like a versus match, the frame's own player first
+    std::vector<PlayerSnapshot> make_players(const FrameSnapshot& frame) {
+        std::vector<PlayerSnapshot> players = frame.player_vector;
+
+        for (uint32_t i = 1; i < PLAYER_COUNT; i++)
+        {
+            auto player = players[0];
+
+            player.pos = { 30.0f + static_cast<float>(i) * 55.0f, 240.0f + static_cast<float>(i % 4) * 100.0f };
+            players.push_back(player);
+        }
+
+        return players;
+    }
+
+    std::vector<BossSnapshot> make_bosses() {
+        BossSnapshot boss = {};
+
+        boss.state  = BossState::Visible;
+        boss.pos    = { 240.0f, 120.0f };
+        boss.radius = 24.0f;
+
+        return { boss };
+    }
+
+    template <typename Entity>
+    void brute_force(const std::vector<BulletSnapshot>& bullets, const std::vector<Entity>& entities,
+                     std::vector<CircleQueryResult>& results) {
+        results.assign(entities.size(), CircleQueryResult {});
+
+        for (size_t e = 0; e < entities.size(); e++)
+        {
+            const auto& entity = entities[e];
+            auto& result = results[e];
+
+            for (const auto& bullet : bullets)
+            {
+                const float dx = bullet.pos.x - entity.pos.x;
+                const float dy = bullet.pos.y - entity.pos.y;
+                const float reach = bullet.radius + entity.radius;
+                const float distance = dx * dx + dy * dy;
+
+                result.hits += distance <= reach * reach ? 1 : 0;
+                result.grazes += distance > reach * reach && distance <= (reach + GRAZE_RANGE) * (reach + GRAZE_RANGE) ? 1 : 0;
+            }
+        }
+    }
+
+    bool same_counts(const std::vector<CircleQueryResult>& grid, const std::vector<CircleQueryResult>& expected) {
+        return grid.size() == expected.size()
+            && std::equal(grid.begin(), grid.end(), expected.begin(), [](const auto& a, const auto& b) {
+                return a.hits == b.hits && a.grazes == b.grazes;
+            });
+    }
+
+    // Returns false when the grid's hit and graze counts differ from brute_force() on a frame
+    bool add_frame_benchmarks(BenchReporter& reporter) {
+        BenchFrameGenerator generator(9);
+
+        const auto bosses = make_bosses();
+
+        BulletGrid grid;
+        std::vector<CircleQueryResult> player_results;
+        std::vector<CircleQueryResult> boss_results;
+        std::vector<BulletNeighbor> neighbors;
+
+        for (const auto bullets : FRAME_BULLET_COUNTS)
+        {
+            const auto frame = generator.make(bullets, 120);
+            const auto players = make_players(frame);
+            const auto suffix = "_" + std::to_string(bullets);
+            const auto bytes = bullets * sizeof(BulletSnapshot);
+
+            // Warm the grid's buffers so the runs measure the steady state
+            grid.build(frame.bullet_vector);
+            grid.query_hitboxes(players, GRAZE_RANGE, player_results);
+            grid.query_hitboxes(bosses, GRAZE_RANGE, boss_results);
+            grid.nearest(players, NEAREST_COUNT, 128.0f, neighbors);
+
+            std::vector<CircleQueryResult> expected_players;
+            std::vector<CircleQueryResult> expected_bosses;
+
+            brute_force(frame.bullet_vector, players, expected_players);
+            brute_force(frame.bullet_vector, bosses, expected_bosses);
+
+            if (!same_counts(player_results, expected_players) || !same_counts(boss_results, expected_bosses))
+            {
+                std::fprintf(stderr, "spatial_index_bench: grid hits or grazes differ from brute force with %u bullets\n", bullets);
+                return false;
+            }
+
+            std::vector<BenchResult> results;
+
+            results.push_back(bench_run("build" + suffix, bytes, [&](uint64_t) {
+                grid.build(frame.bullet_vector);
+                bench_do_not_optimize(&grid);
+            }));
+
+            results.push_back(bench_run("tick" + suffix, bytes, [&](uint64_t) {
+                grid.build(frame.bullet_vector);
+                grid.query_hitboxes(players, GRAZE_RANGE, player_results);
+                grid.query_hitboxes(bosses, GRAZE_RANGE, boss_results);
+                bench_do_not_optimize(player_results.data());
+                bench_do_not_optimize(boss_results.data());
+            }));
+
+            results.push_back(bench_run("nearest_" + std::to_string(NEAREST_COUNT) + suffix, 0, [&](uint64_t) {
+                grid.nearest(players, NEAREST_COUNT, 128.0f, neighbors);
+                bench_do_not_optimize(neighbors.data());
+            }));
+
+            results.push_back(bench_run("brute_force" + suffix, bytes, [&](uint64_t) {
+                brute_force(frame.bullet_vector, players, player_results);
+                brute_force(frame.bullet_vector, bosses, boss_results);
+                bench_do_not_optimize(player_results.data());
+                bench_do_not_optimize(boss_results.data());
+            }));
+
+            const double brute_ns = results.back().total_ns / static_cast<double>(results.back().iterations);
+            const double tick_ns = results[1].total_ns / static_cast<double>(results[1].iterations);
+
+            results[1].counters.emplace_back("speedup", tick_ns > 0.0 ? brute_ns / tick_ns : 0.0);
+
+            for (auto& result : results)
+            {
+                result.counters.emplace_back("bullets", bullets);
+                result.counters.emplace_back("hitboxes", static_cast<double>(players.size() + bosses.size()));
+
+                reporter.add(std::move(result));
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchReporter reporter("spatial_index");
+
+    if (!add_frame_benchmarks(reporter))
+    {
+        return 1;
+    }
+
+    reporter.report(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../event_loop/io_event_loop.hpp"
+#include "../observation/observation_builder.hpp"
+
+struct AgentGatewayOptions {
+    std::string                 server_address  = "127.0.0.1";
+    uint16_t                    server_port     = 0;
+
+    size_t                      session_count   = 64;
+    size_t                      io_workers      = 2;    // IoEventLoop workers receiving for every session
+    size_t                      step_threads    = 1;    // Threads sharing each step's scatter and gather, the caller included
+
+    // Every session asks for a GameMode::Agent game
+    GameVariant                 variant         = GameVariant::Default;
+    GameDifficulty              difficulty      = GameDifficulty::Normal;
+
+    ObservationOptions          observation;
+
+    std::chrono::milliseconds   connect_timeout { 5000 };   // For the whole handshake of every session
+    std::chrono::milliseconds   frame_timeout   { 100 };    // step() waits this long for the next frames, 0 does not wait
+};
+
+struct AgentGatewayStats {
+    uint64_t    steps               = 0;
+    uint64_t    actions_sent        = 0;
+    uint64_t    send_failures       = 0;
+    uint64_t    frames_received     = 0;
+    uint64_t    stale_observations  = 0;    // Rows gathered without a frame newer than the previous step's
+    uint64_t    live_sessions       = 0;
+
+    double      steps_per_second    = 0.0;  // Since the first step
+    double      mean_step_ns        = 0.0;  // Scatter, wait and gather
+};
+
+/*
+    Runs many GameMode::Agent sessions for a batched learner.
+
+    Every session is a PacketStreamClient received on one shared IoEventLoop,
+    so hundreds of sessions need io_workers threads rather than one each.
+    Frames are kept as the latest per session; each step scatters one action
+    per session as a ClientInput and gathers every session's latest frame
+    into one contiguous observation batch (see ObservationBuilder), split
+    over step_threads threads. Once the sessions have seen their largest
+    frames the stepping threads allocate nothing and received frames are
+    decoded into reused ones; the event loop's task queue still allocates
+    a block now and then (agent_gateway_bench counts the whole process).
+
+        AgentGatewayOptions options;
+        options.server_port = 7777;
+        options.session_count = 256;
+
+        AgentGateway gateway(options);
+        gateway.connect();
+
+        std::vector<uint32_t> actions(gateway.session_count());
+
+        while (training)
+        {
+            gateway.step(actions.data());
+            policy(gateway.observations(), gateway.scores(), actions.data());
+        }
+
+        gateway.close();
+*/
+class AgentGateway {
+public:
+    explicit AgentGateway(AgentGatewayOptions options);
+    ~AgentGateway();
+
+    // Delete copy constructor and copy assignment operator
+    AgentGateway(const AgentGateway&) = delete;
+    AgentGateway& operator=(const AgentGateway&) = delete;
+
+    // Connects every session and plays ClientHello and ClientGameRequest, returns the sessions that got a game
+    size_t connect();
+
+    // Says goodbye and disconnects every session
+    void close();
+
+    size_t session_count() const;
+    size_t observation_size() const;
+
+    /*
+        send_actions(), wait_frames(frame_timeout) and gather() in one go.
+        Returns the sessions whose observation comes from a new frame.
+    */
+    size_t step(const uint32_t* actions);
+
+    // Sends actions[i], a pack_game_input() word, as session i's ClientInput
+    void send_actions(const uint32_t* actions);
+
+    // Waits until every live session has a frame gather() has not used yet, false on timeout
+    bool wait_frames(std::chrono::milliseconds timeout);
+
+    // Rebuilds the batch from the latest frames, returns the sessions that had a new one
+    size_t gather();
+
+    /*
+        Batch of the last gather(), row i belongs to session i:
+        observations()  session_count() x observation_size() floats, zero until a session's first frame
+        scores()        FrameSnapshot::score
+        timestamps()    FrameSnapshot::timestamp, also sent back as the ClientInput's frame_timestamp
+        fresh()         1 where the row was built from a new frame
+        alive()         1 while the session is connected and in a game
+    */
+    const float* observations() const;
+    const uint32_t* scores() const;
+    const uint32_t* timestamps() const;
+    const uint8_t* fresh() const;
+    const uint8_t* alive() const;
+
+    // Thread safe
+    AgentGatewayStats stats() const;
+
+    const AgentGatewayOptions& options() const;
+
+private:
+    struct Session;
+
+    enum class StepTask : uint8_t {
+        Scatter,
+        Gather
+    };
+
+    void run_step_task(StepTask task);
+    void run_shard(StepTask task, size_t shard);
+    void step_worker(size_t shard);
+    void on_frame_pending();
+    void on_session_closed(Session& session);
+
+    AgentGatewayOptions                     m_options;
+    std::unique_ptr<IoEventLoop>            m_loop;
+    std::vector<std::unique_ptr<Session>>   m_sessions;
+
+    // One builder per shard, they keep their own scratch
+    std::vector<ObservationBuilder>         m_builders;
+    size_t                                  m_observation_size;
+
+    std::vector<float>                      m_observations;
+    std::vector<uint32_t>                   m_scores;
+    std::vector<uint32_t>                   m_timestamps;
+    std::vector<uint8_t>                    m_fresh;
+    std::vector<uint8_t>                    m_alive;
+
+    // Step workers, woken once per task
+    std::vector<std::thread>                m_step_workers;
+    std::mutex                              m_step_mutex;
+    std::condition_variable                 m_step_cv;
+    std::condition_variable                 m_step_done_cv;
+    uint64_t                                m_step_generation;
+    size_t                                  m_step_remaining;
+    StepTask                                m_step_task;
+    bool                                    m_step_stopping;
+    const uint32_t*                         m_step_actions;
+    std::vector<size_t>                     m_shard_fresh;
+
+    // Sessions holding a frame gather() has not used yet, against the live ones
+    std::atomic<size_t>                     m_pending_frames;
+    std::atomic<size_t>                     m_live_sessions;
+    std::mutex                              m_frame_wait_mutex;
+    std::condition_variable                 m_frame_wait_cv;
+
+    std::atomic<uint64_t>                   m_steps;
+    std::atomic<uint64_t>                   m_actions_sent;
+    std::atomic<uint64_t>                   m_send_failures;
+    std::atomic<uint64_t>                   m_frames_received;
+    std::atomic<uint64_t>                   m_stale_observations;
+    std::atomic<uint64_t>                   m_first_step_ns;
+    std::atomic<uint64_t>                   m_last_step_ns;
+    std::atomic<uint64_t>                   m_total_step_ns;
+
+    bool                                    m_connected;
+};
@@ -2,25 +2,52 @@
 
 #pragma once
 
-#include <iostream>
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
+#include <vector>
 #include <mutex>
+#include <thread>
 #include <condition_variable>
+#include "ring_queue/spsc_ring_queue.hpp"
 
 template <typename T>
 class AsyncChannel;
 
+/*
+    What a bounded channel does when the sender finds it full
+*/
+enum class ChannelPolicy : uint8_t {
+    Block,              // Wait until the receiver makes room
+    DropNewest,         // Reject the new item, send() returns false
+    OverwriteOldest     // Discard the oldest queued item to make room
+};
+
+struct ChannelOptions {
+    size_t          capacity    = 0;                    // 0 means unbounded (lock-free rings round it up to a power of two)
+    ChannelPolicy   policy      = ChannelPolicy::Block;
+
+    /*
+        Use a lock-free SPSC ring instead of the mutex-guarded deque.
+        Only honored for bounded channels of trivially copyable T with the
+        Block or DropNewest policy, otherwise the deque is used. In this mode
+        each end must only be used from one thread at a time.
+    */
+    bool            lock_free   = false;
+};
+
 // The interface to create channel
 template <typename T>
-std::pair<AsyncChannel<T>, AsyncChannel<T>> channel() {
-    auto state = std::make_shared<typename AsyncChannel<T>::AsyncChannelState>();
+std::pair<AsyncChannel<T>, AsyncChannel<T>> channel(const ChannelOptions& options = {}) {
+    auto state = std::make_shared<typename AsyncChannel<T>::AsyncChannelState>(options);
 
     AsyncChannel<T> sender(state, true);
     AsyncChannel<T> receiver(std::move(state), false);
 
-    std::cerr << "[AsyncChannel] DEBUG: AsyncChannel has been established" << "\n";
-
     return {
         std::move(sender),
         std::move(receiver)
@@ -40,59 +67,97 @@ public:
     AsyncChannel& operator = (AsyncChannel const&) = delete;
     AsyncChannel& operator = (AsyncChannel&&) = default;
 
+    /*
+        Sender
+    */
+    // Applies the channel policy when the channel is full
     bool send(T item) {
-        bool success = true;
-
         if (!is_sender_ || state_ == nullptr)
         {
-            success = false;
+            return false;
         }
-        else
+
+        return state_->push(std::move(item), state_->policy == ChannelPolicy::Block);
+    }
+
+    // Never blocks, returns false when the channel is full or closed
+    bool try_send(T item) {
+        if (!is_sender_ || state_ == nullptr)
         {
-            std::lock_guard lock(state_->mtx);
+            return false;
+        }
 
-            if (state_->closed)
-            {
-                success = false;
-            }
-            else
-            {
-                state_->queue.push(std::move(item));
-                state_->cv.notify_one();
-            }
+        return state_->push(std::move(item), false);
+    }
+
+    /*
+        Moves the items of [first, last) into the channel with a single lock
+        acquisition per contiguous run of free slots, returns the number of items sent.
+    */
+    template <typename Iterator>
+    size_t send_batch(Iterator first, Iterator last) {
+        if (!is_sender_ || state_ == nullptr)
+        {
+            return 0;
         }
 
-        return success;
+        return state_->push_batch(first, last);
     }
 
+    /*
+        Receiver
+    */
+    // Blocks until an item arrives, returns std::nullopt once the channel is closed and empty
     std::optional<T> recv() {
-        bool success = true;
-        std::optional<T> item = std::nullopt;
+        if (is_sender_ || state_ == nullptr)
+        {
+            return std::nullopt;
+        }
 
+        return state_->pop(std::nullopt);
+    }
+
+    std::optional<T> try_recv() {
         if (is_sender_ || state_ == nullptr)
         {
-            success = false;
+            return std::nullopt;
         }
-        else
+
+        return state_->try_pop();
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> recv_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return recv_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    template <typename Clock, typename Duration>
+    std::optional<T> recv_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+        if (is_sender_ || state_ == nullptr)
         {
-            std::unique_lock lock(state_->mtx);
+            return std::nullopt;
+        }
 
-            state_->cv.wait(lock, [this] {
-                return !state_->queue.empty() || state_->closed;
-            });
+        const auto remaining = deadline - Clock::now();
 
-            if (state_->queue.empty())
-            {
-                success = false;
-            }
-            else
-            {
-                item = std::move(state_->queue.front());
-                state_->queue.pop();
-            }
+        return state_->pop(
+            std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(remaining)
+        );
+    }
+
+    /*
+        Blocks until at least one item is available, then moves up to
+        max_count items into out under a single lock acquisition.
+        Returns 0 once the channel is closed and empty.
+    */
+    size_t recv_batch(std::vector<T>& out, size_t max_count) {
+        if (is_sender_ || state_ == nullptr || max_count == 0)
+        {
+            return 0;
         }
 
-        return success ? item : std::nullopt;
+        return state_->pop_batch(out, max_count);
     }
 
     bool closed() {
@@ -112,9 +177,9 @@ public:
 
             if (!state_->closed) {
                 state_->closed = true;
-                state_->cv.notify_all();
-
-                std::cerr << "[AsyncChannel] DEBUG: AsyncChannel has been closed" << "\n";
+                state_->closed_flag.store(true, std::memory_order_release);
+                state_->not_empty.notify_all();
+                state_->not_full.notify_all();
             }
         }
     }
@@ -122,11 +187,362 @@ public:
     ~AsyncChannel() { close(); }
 
 private:
-    using AsyncChannelState = struct {
-        std::queue<T> queue;
-        std::mutex mtx;
-        std::condition_variable cv;
-        bool closed = false;
+    /*
+        Shared state of a sender/receiver pair.
+
+        The deque path guards everything with mtx. The lock-free path moves
+        items through an SPSC ring and only takes mtx to sleep or wake up,
+        the *_waiting flags tell the other side whether a notify is needed.
+    */
+    struct AsyncChannelState {
+        explicit AsyncChannelState(const ChannelOptions& options)
+            : capacity(options.capacity)
+            , policy(options.policy)
+        {
+            const bool ring_allowed = std::is_trivially_copyable_v<T>
+                && options.capacity > 0
+                && options.policy != ChannelPolicy::OverwriteOldest;
+
+            if (options.lock_free && ring_allowed)
+            {
+                ring = std::make_unique<SpscRingQueue<T>>(options.capacity);
+            }
+        }
+
+        bool full() const {
+            return capacity > 0 && queue.size() >= capacity;
+        }
+
+        /*
+            Push
+        */
+        bool push(T&& item, bool block) {
+            if (ring)
+            {
+                return push_ring(std::move(item), block);
+            }
+
+            std::unique_lock lock(mtx);
+
+            if (block && capacity > 0)
+            {
+                not_full.wait(lock, [this] {
+                    return !full() || closed;
+                });
+            }
+
+            if (closed)
+            {
+                return false;
+            }
+
+            if (full())
+            {
+                if (policy != ChannelPolicy::OverwriteOldest)
+                {
+                    return false;
+                }
+
+                queue.pop_front();
+            }
+
+            queue.push_back(std::move(item));
+            not_empty.notify_one();
+
+            return true;
+        }
+
+        template <typename Iterator>
+        size_t push_batch(Iterator first, Iterator last) {
+            size_t sent = 0;
+
+            if (ring)
+            {
+                for (; first != last; ++first, ++sent)
+                {
+                    if (!push_ring(std::move(*first), policy == ChannelPolicy::Block))
+                    {
+                        break;
+                    }
+                }
+
+                return sent;
+            }
+
+            std::unique_lock lock(mtx);
+
+            while (first != last && !closed)
+            {
+                if (full())
+                {
+                    if (policy == ChannelPolicy::DropNewest)
+                    {
+                        break;
+                    }
+
+                    if (policy == ChannelPolicy::Block)
+                    {
+                        // Let the receiver drain what we have so far before waiting
+                        not_empty.notify_one();
+                        not_full.wait(lock, [this] {
+                            return !full() || closed;
+                        });
+
+                        continue;
+                    }
+
+                    queue.pop_front();
+                }
+
+                queue.push_back(std::move(*first));
+                ++first;
+                ++sent;
+            }
+
+            if (sent > 0)
+            {
+                not_empty.notify_one();
+            }
+
+            return sent;
+        }
+
+        bool push_ring(T&& item, bool block) {
+            while (true)
+            {
+                if (closed_flag.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+
+                if (ring->try_push(std::move(item)))
+                {
+                    wake(recv_waiting, not_empty);
+                    return true;
+                }
+
+                if (!block)
+                {
+                    return false;
+                }
+
+                if (spin_until([this] { return ring->size_approx() < ring->capacity(); }))
+                {
+                    continue;
+                }
+
+                // Announce the wait before re-checking under the lock
+                send_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                std::unique_lock lock(mtx);
+
+                not_full.wait(lock, [this] {
+                    return ring->size_approx() < ring->capacity() || closed;
+                });
+
+                send_waiting.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        /*
+            Pop
+        */
+        std::optional<T> try_pop() {
+            if (ring)
+            {
+                auto item = ring->try_pop();
+
+                if (item.has_value())
+                {
+                    wake(send_waiting, not_full);
+                }
+
+                return item;
+            }
+
+            std::lock_guard lock(mtx);
+
+            return pop_locked();
+        }
+
+        std::optional<T> pop(std::optional<std::chrono::steady_clock::time_point> deadline) {
+            if (ring)
+            {
+                return pop_ring(deadline);
+            }
+
+            std::unique_lock lock(mtx);
+
+            const auto ready = [this] {
+                return !queue.empty() || closed;
+            };
+
+            if (deadline.has_value())
+            {
+                not_empty.wait_until(lock, deadline.value(), ready);
+            }
+            else
+            {
+                not_empty.wait(lock, ready);
+            }
+
+            return pop_locked();
+        }
+
+        std::optional<T> pop_ring(std::optional<std::chrono::steady_clock::time_point> deadline) {
+            while (true)
+            {
+                auto item = try_pop();
+
+                if (item.has_value() || closed_flag.load(std::memory_order_acquire))
+                {
+                    // Items pushed right before close() are still delivered
+                    return item.has_value() ? std::move(item) : try_pop();
+                }
+
+                if (spin_until([this] { return !ring->empty(); }))
+                {
+                    continue;
+                }
+
+                recv_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                std::unique_lock lock(mtx);
+
+                const auto ready = [this] {
+                    return !ring->empty() || closed;
+                };
+
+                bool timed_out = false;
+
+                if (deadline.has_value())
+                {
+                    timed_out = !not_empty.wait_until(lock, deadline.value(), ready);
+                }
+                else
+                {
+                    not_empty.wait(lock, ready);
+                }
+
+                recv_waiting.store(false, std::memory_order_relaxed);
+
+                if (timed_out)
+                {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        size_t pop_batch(std::vector<T>& out, size_t max_count) {
+            if (ring)
+            {
+                auto first = pop_ring(std::nullopt);
+
+                if (!first.has_value())
+                {
+                    return 0;
+                }
+
+                out.push_back(std::move(first.value()));
+
+                const auto count = 1 + ring->drain([&out](T&& item) {
+                    out.push_back(std::move(item));
+                }, max_count - 1);
+
+                wake(send_waiting, not_full);
+
+                return count;
+            }
+
+            std::unique_lock lock(mtx);
+
+            not_empty.wait(lock, [this] {
+                return !queue.empty() || closed;
+            });
+
+            size_t count = 0;
+
+            while (count < max_count && !queue.empty())
+            {
+                out.push_back(std::move(queue.front()));
+                queue.pop_front();
+                count++;
+            }
+
+            if (count > 0 && capacity > 0)
+            {
+                not_full.notify_all();
+            }
+
+            return count;
+        }
+
+        std::optional<T> pop_locked() {
+            if (queue.empty())
+            {
+                return std::nullopt;
+            }
+
+            std::optional<T> item(std::move(queue.front()));
+            queue.pop_front();
+
+            if (capacity > 0)
+            {
+                not_full.notify_one();
+            }
+
+            return item;
+        }
+
+        /*
+            Lock-free path: yield a few times before going to sleep, the other
+            side usually catches up within a time slice
+        */
+        template <typename Predicate>
+        bool spin_until(Predicate predicate) {
+            for (int i = 0; i < RING_SPIN_COUNT; i++)
+            {
+                if (predicate())
+                {
+                    return true;
+                }
+
+                std::this_thread::yield();
+            }
+
+            return false;
+        }
+
+        // Lock-free path: only take the mutex when the other side announced a wait
+        void wake(std::atomic<bool>& waiting, std::condition_variable& cv) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (waiting.load(std::memory_order_relaxed))
+            {
+                std::lock_guard lock(mtx);
+                cv.notify_one();
+            }
+        }
+
+        static constexpr int                RING_SPIN_COUNT = 16;
+
+        const size_t                        capacity;
+        const ChannelPolicy                 policy;
+
+        std::deque<T>                       queue;
+        std::unique_ptr<SpscRingQueue<T>>   ring;
+
+        std::mutex                          mtx;
+        std::condition_variable             not_empty;
+        std::condition_variable             not_full;
+        bool                                closed = false;
+
+        // Lock-free path only
+        std::atomic<bool>                   closed_flag{false};
+        std::atomic<bool>                   recv_waiting{false};
+        std::atomic<bool>                   send_waiting{false};
     };
 
     std::shared_ptr<AsyncChannelState> state_;
@@ -136,5 +552,5 @@ private:
         : state_{std::move(state)}
         , is_sender_{is_sender} {}
 
-    friend std::pair<AsyncChannel<T>, AsyncChannel<T>> channel<T>();
+    friend std::pair<AsyncChannel<T>, AsyncChannel<T>> channel<T>(const ChannelOptions&);
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+
+/*
+    Built-in LZ77 block codec (LZ4 style sequences)
+    [token][literal length ext...][literals][u16 offset][match length ext...]
+
+    A token holds the literal length in its high nibble and (match length - 4)
+    in its low nibble, 15 means more length bytes follow (255 = keep reading).
+    The last sequence only carries literals.
+    Offsets may reach back into a dictionary that both sides share, which is
+    what makes small, repetitive payloads such as frames compress well.
+*/
+constexpr size_t LZ_MIN_MATCH                   = 4;
+constexpr size_t LZ_MAX_OFFSET                  = 0xFFFF;
+constexpr size_t LZ_MAX_DICTIONARY_SIZE         = LZ_MAX_OFFSET;
+constexpr size_t LZ_DEFAULT_DICTIONARY_SIZE     = 16 * 1024;
+constexpr uint32_t LZ_HASH_BITS                 = 14;
+
+class LzDictionary {
+public:
+    LzDictionary();
+
+    // Keeps the last LZ_MAX_DICTIONARY_SIZE bytes of content
+    explicit LzDictionary(std::vector<std::byte> content);
+
+    const std::vector<std::byte>& content() const;
+
+    // Stable identifier of the content, 0 for an empty dictionary
+    uint32_t id() const;
+    bool empty() const;
+
+    // Match positions of the content, used to prime the compressor
+    const std::vector<int32_t>& hash_table() const;
+
+private:
+    std::vector<std::byte>  m_content;
+    std::vector<int32_t>    m_hash_table;
+    uint32_t                m_id;
+};
+
+/*
+    Builds a dictionary out of the byte runs that show up in the most samples
+    (e.g. serialized frames recorded from a session)
+*/
+LzDictionary train_lz_dictionary(const std::vector<std::vector<std::byte>>& samples,
+                                 size_t max_size = LZ_DEFAULT_DICTIONARY_SIZE);
+
+// Worst case size of an LZ block for size input bytes
+constexpr size_t lz_compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+/*
+    Largest size an LZ block of size bytes can decode to: a length byte adds
+    at most 255 bytes of output, matches into the dictionary included
+*/
+constexpr size_t lz_decompress_bound(size_t size, size_t dictionary_size) {
+    return size * 255 + dictionary_size;
+}
+
+/*
+    Compressor
+*/
+std::vector<std::byte> lz_compress(const std::byte* data, size_t size, const LzDictionary& dictionary);
+
+/*
+    Decompressor
+    Returns std::nullopt unless the block decodes to exactly decompressed_size bytes,
+    sizes above lz_decompress_bound() are rejected before anything is allocated
+*/
+std::optional<std::vector<std::byte>> lz_decompress(const std::byte* data, size_t size, size_t decompressed_size,
+                                                    const LzDictionary& dictionary);
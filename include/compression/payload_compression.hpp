@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include "lz_codec.hpp"
+
+// Payloads below this size are sent as they are
+constexpr size_t DEFAULT_COMPRESSION_THRESHOLD = 512;
+
+// Upper bound a compressed payload may claim to expand to
+constexpr size_t MAX_DECOMPRESSED_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+struct CompressionOptions {
+    bool                                    enabled     = false;
+    size_t                                  threshold   = DEFAULT_COMPRESSION_THRESHOLD;
+
+    // Must be the same on both ends, payloads compressed with another dictionary are rejected
+    std::shared_ptr<const LzDictionary>     dictionary;
+};
+
+// LzDictionary::id() of options.dictionary, 0 without one. Exchanged in the handshake.
+uint32_t compression_dictionary_id(const CompressionOptions& options);
+
+/*
+    Compressed payload
+    [varint decompressed size][u32 dictionary id][LZ block]
+
+    Returns std::nullopt when the payload is below the threshold
+    or does not get smaller, the caller then sends it as it is.
+*/
+std::optional<std::vector<std::byte>> compress_payload(const std::vector<std::byte>& payload,
+                                                       const CompressionOptions& options);
+
+std::optional<std::vector<std::byte>> decompress_payload(const std::vector<std::byte>& payload,
+                                                         const CompressionOptions& options);
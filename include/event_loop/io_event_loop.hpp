@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../async_channel.hpp"
+#include "../socket/socket.hpp"
+
+/*
+    A small readiness-based event loop shared by many streams.
+
+    One poller thread waits on every registered socket with poll()/WSAPoll(),
+    readable sockets are handed to a pool of worker threads which run the
+    registered callback (typically PacketStream*::pump()). A socket is not
+    polled again until its callback has returned, so a callback never runs
+    concurrently with itself. post() runs arbitrary tasks on the same workers,
+    which is what the coroutine layer uses to resume suspended sessions.
+
+    The poll set also holds a wakeup channel (a self-pipe, a loopback UDP
+    socket on Windows) signalled by add_reader(), by a callback returning
+    and by stop(), so the poller picks up changes without a timeout.
+*/
+class IoEventLoop {
+public:
+    // Returning false from the callback unregisters the socket
+    using ReadableCallback = std::function<bool()>;
+    using Task = std::function<void()>;
+
+    explicit IoEventLoop(size_t worker_count = 1);
+    ~IoEventLoop();
+
+    // Delete copy constructor and copy assignment operator
+    IoEventLoop(const IoEventLoop&) = delete;
+    IoEventLoop& operator=(const IoEventLoop&) = delete;
+
+    void start();
+    void stop();
+    bool is_running() const;
+
+    uint64_t add_reader(SOCKET sock, ReadableCallback on_readable);
+
+    /*
+        Unregisters the socket and waits until a running callback has returned.
+        NOTE: Do not call it from inside the callback being removed.
+    */
+    void remove_reader(uint64_t reader_id);
+
+    // Returns false (and drops the task) when the loop is not running
+    bool post(Task task);
+
+    size_t worker_count() const;
+
+private:
+    struct Reader {
+        SOCKET              sock;
+        ReadableCallback    on_readable;
+        bool                in_flight;
+    };
+
+    void poll_loop();
+    void worker_loop();
+    void finish_callback(uint64_t reader_id, bool keep);
+    void wake_poller();
+
+    const size_t                            m_worker_count;
+    std::atomic<bool>                       m_running;
+
+    std::thread                             m_poll_thread;
+    std::vector<std::thread>                m_worker_threads;
+
+    // Task queue (any thread -> workers)
+    std::optional<AsyncChannel<Task>>       m_task_sender;
+    std::optional<AsyncChannel<Task>>       m_task_receiver;
+
+    // Registered sockets
+    std::mutex                              m_reader_mutex;
+    std::condition_variable                 m_reader_cv;
+    std::unordered_map<uint64_t, Reader>    m_readers;
+    uint64_t                                m_next_reader_id;   // Starts at 1, 0 marks the wakeup channel in the poll set
+
+    // Wakes the poller when the poll set changes or the loop stops
+    SOCKET                                  m_wakeup_read;
+    SOCKET                                  m_wakeup_write;
+    std::atomic<bool>                       m_wakeup_pending;
+};
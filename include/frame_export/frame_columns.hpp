@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../packet_template/frame.hpp"
+
+/*
+    Writes a stream of frames as columns, one .npy file per field:
+
+        <directory>/frames.timestamp.npy        one row per frame
+        <directory>/frames.bullet_offsets.npy   frame_count + 1 rows, uint64
+        <directory>/bullets.pos_x.npy           one row per bullet of every frame
+        ...
+
+    The bullets of frame i are rows [bullet_offsets[i], bullet_offsets[i + 1])
+    of every bullets.* column, likewise for players, enemies, bosses and items.
+    Enums are written as their underlying integers. Every file can be opened
+    with numpy.load(path, mmap_mode="r") and nothing is kept in memory beyond
+    a small staging buffer per column, so a stream may hold millions of frames.
+*/
+class FrameColumnWriter {
+public:
+    FrameColumnWriter();
+    ~FrameColumnWriter();
+
+    // Delete copy constructor and copy assignment operator
+    FrameColumnWriter(const FrameColumnWriter&) = delete;
+    FrameColumnWriter& operator=(const FrameColumnWriter&) = delete;
+
+    // Creates directory if needed, existing columns are overwritten
+    bool open(const std::string& directory);
+
+    // Completes every column, false if any of them failed to write
+    bool close();
+    bool is_open() const;
+
+    void write(const FrameSnapshot& frame);
+
+    uint64_t frames_written() const;
+
+private:
+    struct Columns;
+
+    std::unique_ptr<Columns>    m_columns;
+    uint64_t                    m_frames_written;
+};
+
+struct FrameColumnExportJob {
+    std::string recording_path;     // A SessionRecorder file
+    std::string output_directory;   // Gets a stream_<id> directory per recorded stream
+};
+
+struct FrameColumnExportResult {
+    bool        succeeded       = false;
+    uint64_t    streams         = 0;
+    uint64_t    frames          = 0;
+    uint64_t    skipped_frames  = 0;    // Frame records that failed to decode
+    std::string error;
+};
+
+// Exports every frame stream of one recording in timestamp order, the frames sent in bundles included
+FrameColumnExportResult export_recording_columns(const FrameColumnExportJob& job);
+
+// Runs the jobs on up to thread_count threads, results are in job order
+std::vector<FrameColumnExportResult> export_recordings_columns(const std::vector<FrameColumnExportJob>& jobs, size_t thread_count);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "../packet_template/frame.hpp"
+
+/*
+    FrameSnapshot as JSON, one object per frame:
+
+        {"frame":{"client_id":1,...},"stage":{...},
+         "players":[{...}],"enemies":[...],"bosses":[...],"bullets":[...],"items":[...]}
+
+    Numbers go through std::to_chars: integers are exact and floats use the
+    shortest text that reads back to the same value (non-finite floats are
+    written as null). The output buffer is kept between frames, so once it
+    has grown to the largest frame seen, writing allocates nothing.
+*/
+class FrameJsonWriter {
+public:
+    FrameJsonWriter();
+
+    // Delete copy constructor and copy assignment operator
+    FrameJsonWriter(const FrameJsonWriter&) = delete;
+    FrameJsonWriter& operator=(const FrameJsonWriter&) = delete;
+
+    // The JSON of frame, valid until the next write()
+    std::string_view write(const FrameSnapshot& frame);
+
+private:
+    char* reserve(size_t bytes);
+
+    std::unique_ptr<char[]>     m_buffer;
+    size_t                      m_capacity;
+};
+
+/*
+    JSON lines: one frame object per line, for whole sessions
+
+        FrameJsonLinesWriter writer;
+        writer.open("session.jsonl");
+
+        while (auto frame = stream.poll_frame())
+        {
+            writer.write(frame.value());
+        }
+*/
+class FrameJsonLinesWriter {
+public:
+    FrameJsonLinesWriter() = default;
+
+    // Delete copy constructor and copy assignment operator
+    FrameJsonLinesWriter(const FrameJsonLinesWriter&) = delete;
+    FrameJsonLinesWriter& operator=(const FrameJsonLinesWriter&) = delete;
+
+    // Truncates the file
+    bool open(const std::string& file_path);
+    void close();
+    bool is_open() const;
+
+    bool write(const FrameSnapshot& frame);
+    bool flush();
+
+    uint64_t frames_written() const;
+
+private:
+    std::ofstream       m_file;
+    FrameJsonWriter     m_writer;
+    uint64_t            m_frames_written = 0;
+};
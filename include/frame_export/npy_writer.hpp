@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Bytes a column stages before they are written to its file
+constexpr size_t NPY_WRITER_STAGING_SIZE = 64 * 1024;
+
+/*
+    Streams a one dimensional NumPy array (.npy, format 1.0) to a file.
+
+    The header is written with room for any length and patched by close(),
+    so the column never has to be held in memory. The data starts at a
+    64 byte aligned offset, as numpy.load(path, mmap_mode="r") expects.
+
+        NpyWriter writer;
+        writer.open("bullets.pos_x.npy", npy_descr<float>(), sizeof(float));
+        writer.append(xs.data(), xs.size());
+        writer.close();
+*/
+class NpyWriter {
+public:
+    NpyWriter();
+    ~NpyWriter();
+
+    // Delete copy constructor and copy assignment operator
+    NpyWriter(const NpyWriter&) = delete;
+    NpyWriter& operator=(const NpyWriter&) = delete;
+
+    // descr is a NumPy type string ("<f4", "|u1", ...), item_size its width in bytes
+    bool open(const std::string& file_path, const std::string& descr, size_t item_size);
+
+    // Writes the final length into the header
+    bool close();
+    bool is_open() const;
+
+    void append(const void* items, size_t count);
+
+    // Room for count more items in the staging buffer, commit() them once written
+    std::byte* prepare(size_t count);
+    void commit(size_t count);
+
+    uint64_t length() const;
+
+private:
+    bool write_header();
+    void flush_staging();
+
+    std::ofstream           m_file;
+    std::string             m_descr;
+    size_t                  m_item_size;
+    uint64_t                m_length;
+    std::vector<std::byte>  m_staging;
+    size_t                  m_staged;
+    bool                    m_failed;
+};
+
+// NumPy type string of kind ('u', 'i' or 'f') and item_size in the host byte order, e.g. "<f4"
+std::string npy_descr(char kind, size_t item_size);
+
+template <typename T>
+std::string npy_descr() {
+    static_assert(std::is_arithmetic_v<T>, "Only numbers have a NumPy type string here");
+
+    return npy_descr(std::is_floating_point_v<T> ? 'f' : (std::is_signed_v<T> ? 'i' : 'u'), sizeof(T));
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include "../packet_template/input.hpp"
+
+// Inputs a client repeats in every window, covers up to window_size - 1 lost packets in a row
+constexpr size_t DEFAULT_INPUT_WINDOW_SIZE = 8;
+
+// Number of ticks an input timeline keeps around
+constexpr size_t DEFAULT_INPUT_TIMELINE_CAPACITY = 256;
+
+/*
+    Client side
+    Remembers the latest inputs and builds the ClientInputWindow to send every tick.
+*/
+class InputWindowBuilder {
+public:
+    explicit InputWindowBuilder(uint32_t client_id, size_t window_size = DEFAULT_INPUT_WINDOW_SIZE);
+
+    /*
+        Adds the input of the current tick and returns the window to send.
+        Inputs that are not newer than the last one are ignored.
+    */
+    const ClientInputWindow& push(const ClientInput& input);
+
+    const ClientInputWindow& window() const;
+    void reset();
+
+private:
+    size_t              m_window_size;
+    ClientInputWindow   m_window;
+};
+
+struct InputTimelineStats {
+    uint64_t added      = 0;    // Inputs that were new to the timeline
+    uint64_t recovered  = 0;    // New inputs that only arrived as part of a later window
+    uint64_t duplicates = 0;    // Inputs the timeline already had
+    uint64_t stale      = 0;    // Inputs that arrived after their tick had been taken
+};
+
+/*
+    Server side
+    The per-client input timeline, keyed by frame_timestamp. Windows are merged
+    into it and the game loop takes one input per tick.
+    Not thread safe, it is meant to be owned by the thread running the client's game loop.
+*/
+class InputTimeline {
+public:
+    explicit InputTimeline(size_t capacity = DEFAULT_INPUT_TIMELINE_CAPACITY);
+
+    // Returns the number of inputs of the window that were new
+    size_t merge(const ClientInputWindow& window);
+    bool insert(const ClientInput& input);
+
+    /*
+        Removes and returns the input of frame_timestamp.
+        Anything older is given up on, even when nothing was found.
+    */
+    std::optional<ClientInput> take(uint32_t frame_timestamp);
+
+    bool contains(uint32_t frame_timestamp) const;
+    std::optional<uint32_t> latest_timestamp() const;
+
+    const InputTimelineStats& stats() const;
+
+private:
+    enum class InsertResult {
+        Added,
+        Duplicate,
+        Stale
+    };
+
+    struct Slot {
+        bool        occupied = false;
+        ClientInput input = {};
+    };
+
+    InsertResult insert_input(const ClientInput& input);
+    bool is_stale(uint32_t frame_timestamp) const;
+
+    std::vector<Slot>       m_slots;
+
+    uint32_t                m_taken_before;     // Ticks before this one have been consumed
+    std::optional<uint32_t> m_latest;
+
+    InputTimelineStats      m_stats;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../event_loop/io_event_loop.hpp"
+#include "../metrics/latency_histogram.hpp"
+
+/*
+    Request/response steps of a simulated client's lifecycle:
+    Connect         TCP connect
+    Hello           ClientHello -> ServerAccept
+    GameRequest     ClientGameRequest -> ServerGameResponse
+    Reconnect       ClientReconnectRequest -> ServerReconnectResponse (after a scripted drop)
+*/
+enum class SwarmPhase : uint8_t {
+    Connect,
+    Hello,
+    GameRequest,
+    Reconnect,
+    Count
+};
+
+constexpr size_t SWARM_PHASE_COUNT = static_cast<size_t>(SwarmPhase::Count);
+
+const char* swarm_phase_name(SwarmPhase phase);
+
+struct SwarmOptions {
+    std::string                 server_address          = "127.0.0.1";
+    uint16_t                    server_port             = 0;
+
+    size_t                      client_count            = 100;
+    size_t                      scheduler_threads       = 2;    // Threads driving the clients' timers
+    size_t                      io_workers              = 2;    // IoEventLoop workers receiving for every client
+
+    double                      input_rate_hz           = 60.0;
+    double                      jitter                  = 0.1;  // Timers move by up to this fraction of their interval
+
+    std::chrono::milliseconds   ramp_up                 { 1000 };   // Client starts are spread over this
+    std::chrono::milliseconds   session_duration        { 10000 };  // Playing time before the session ends
+    std::chrono::milliseconds   reconnect_delay         { 500 };    // Pause between a session's end and the next connect
+    std::chrono::milliseconds   response_timeout        { 5000 };
+
+    // Chance that a session ends with a dropped connection and a reconnect rather than a goodbye
+    double                      reconnect_probability   = 0.25;
+
+    uint32_t                    seed                    = 1;
+};
+
+struct SwarmPhaseStats {
+    uint64_t            attempts    = 0;
+    uint64_t            succeeded   = 0;
+    uint64_t            failed      = 0;    // Could not connect or send
+    uint64_t            timed_out   = 0;
+    uint64_t            rejected    = 0;
+    uint64_t            dropped     = 0;    // The server closed the connection while waiting
+    LatencyHistogram    latency;            // Nanoseconds, successful attempts only
+};
+
+struct SwarmStats {
+    std::array<SwarmPhaseStats, SWARM_PHASE_COUNT>  phases;
+
+    uint64_t    inputs_sent         = 0;
+    uint64_t    frames_received     = 0;    // Frames the server pushed, counted and discarded
+    uint64_t    sessions_completed  = 0;    // Sessions that ended in a goodbye
+    uint64_t    sessions_dropped    = 0;    // Sessions the server closed while playing
+    uint64_t    scripted_drops      = 0;    // Connections the swarm dropped to exercise reconnects
+    uint64_t    connected_clients   = 0;
+};
+
+/*
+    Simulates many game clients over a small, fixed number of threads.
+
+    Every client is a timer-driven state machine: connect, ClientHello,
+    ClientGameRequest, then ClientInput at input_rate_hz until its session
+    ends, either with a ClientGoodbye and a fresh session or with a dropped
+    connection and a ClientReconnectRequest. All timers run on
+    scheduler_threads threads and every connection is received on one
+    shared IoEventLoop, so thousands of clients need no thread of their own.
+
+        SwarmOptions options;
+        options.server_port = 7777;
+        options.client_count = 5000;
+
+        ClientSwarm swarm(options);
+        swarm.start();
+        ...
+        const auto stats = swarm.stats();
+        swarm.stop();
+*/
+class ClientSwarm {
+public:
+    explicit ClientSwarm(SwarmOptions options);
+    ~ClientSwarm();
+
+    // Delete copy constructor and copy assignment operator
+    ClientSwarm(const ClientSwarm&) = delete;
+    ClientSwarm& operator=(const ClientSwarm&) = delete;
+
+    void start();
+
+    // Disconnects every client and joins the scheduler threads
+    void stop();
+    bool is_running() const;
+
+    // Thread safe, totals since start()
+    SwarmStats stats() const;
+
+    const SwarmOptions& options() const;
+
+private:
+    struct Scheduler;
+
+    void scheduler_loop(Scheduler& scheduler);
+
+    SwarmOptions                            m_options;
+    std::unique_ptr<IoEventLoop>            m_loop;
+    std::vector<std::unique_ptr<Scheduler>> m_schedulers;
+    std::atomic<bool>                       m_running;
+    std::atomic<uint64_t>                   m_connected;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "logger.hpp"
+
+/*
+    Library diagnostics
+
+        LOG_ERROR("[PacketStreamServer] Invalid payload type: {}", type);
+
+    - Levels below SHARED_LOG_LEVEL are compiled out, the arguments are
+      still type checked but no code is emitted for the call
+    - Every call site lets LOG_RATE_LIMIT_BURST messages through per
+      LOG_RATE_LIMIT_WINDOW_MS, the rest are counted and reported with
+      the next message the site is allowed to log
+    - Messages go to the async logger. While it is not running, Warning
+      and above are written to stderr and the rest are discarded
+*/
+#define SHARED_LOG_LEVEL_DEBUG      0
+#define SHARED_LOG_LEVEL_INFO       1
+#define SHARED_LOG_LEVEL_WARNING    2
+#define SHARED_LOG_LEVEL_ERROR      3
+#define SHARED_LOG_LEVEL_CRITICAL   4
+
+#ifndef SHARED_LOG_LEVEL
+    #ifdef NDEBUG
+        #define SHARED_LOG_LEVEL SHARED_LOG_LEVEL_INFO
+    #else
+        #define SHARED_LOG_LEVEL SHARED_LOG_LEVEL_DEBUG
+    #endif
+#endif
+
+static_assert(static_cast<int>(LogLevel::Debug) == SHARED_LOG_LEVEL_DEBUG &&
+              static_cast<int>(LogLevel::Critical) == SHARED_LOG_LEVEL_CRITICAL,
+              "SHARED_LOG_LEVEL_* must follow LogLevel");
+
+constexpr uint32_t LOG_RATE_LIMIT_BURST = 10;
+constexpr uint64_t LOG_RATE_LIMIT_WINDOW_MS = 1000;
+
+/*
+    Per call site budget, lock-free and shared by every thread
+    that reaches the site (the counts are approximate under contention)
+*/
+class LogRateLimiter {
+public:
+    constexpr LogRateLimiter() = default;
+
+    // On success suppressed receives the number of messages dropped since the last one
+    bool allow(uint64_t& suppressed);
+
+private:
+    std::atomic<uint64_t> m_window_start{0};
+    std::atomic<uint32_t> m_count{0};
+    std::atomic<uint64_t> m_suppressed{0};
+};
+
+// Site of the "messages were suppressed" note for a level
+const LogSite& log_suppressed_site(LogLevel level);
+
+template <typename... Args>
+void log_diagnostic(const LogSite& site, LogRateLimiter& limiter, const Args&... args) {
+    uint64_t suppressed = 0;
+
+    if (!limiter.allow(suppressed))
+    {
+        return;
+    }
+
+    if (is_async_logger_running())
+    {
+        if (suppressed > 0)
+        {
+            log_record(log_suppressed_site(site.level), suppressed, site.file, site.line);
+        }
+
+        log_record(site, args...);
+    }
+    else if (site.level >= LogLevel::Warning)
+    {
+        if (suppressed > 0)
+        {
+            log_record_to_stderr(log_suppressed_site(site.level), suppressed, site.file, site.line);
+        }
+
+        log_record_to_stderr(site, args...);
+    }
+}
+
+#define SHARED_LOG(level, format, ...)                                                          \
+    do {                                                                                        \
+        if constexpr (static_cast<int>(level) >= SHARED_LOG_LEVEL)                              \
+        {                                                                                       \
+            static constexpr LogSite shared_log_site_ { level, format, __FILE__, __LINE__ };    \
+            static LogRateLimiter shared_log_limiter_;                                          \
+            log_diagnostic(shared_log_site_, shared_log_limiter_, ##__VA_ARGS__);               \
+        }                                                                                       \
+    } while (0)
+
+#define LOG_DEBUG(format, ...)      SHARED_LOG(LogLevel::Debug,     format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...)       SHARED_LOG(LogLevel::Info,      format, ##__VA_ARGS__)
+#define LOG_WARNING(format, ...)    SHARED_LOG(LogLevel::Warning,   format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...)      SHARED_LOG(LogLevel::Error,     format, ##__VA_ARGS__)
+#define LOG_CRITICAL(format, ...)   SHARED_LOG(LogLevel::Critical,  format, ##__VA_ARGS__)
@@ -1,6 +1,20 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <type_traits>
+#include "../ring_queue/spsc_ring_queue.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define LOGGER_HAS_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define LOGGER_HAS_RDTSC 1
+#endif
 
 enum class LogLevel {
     Debug,      // Debugging information
@@ -11,5 +25,236 @@ enum class LogLevel {
 };
 
 void start_async_logger(const std::string& log_file_path);
+
+/*
+    Logs a preformatted message. Messages up to LOG_TEXT_CAPACITY bytes go
+    through the thread's ring like ASYNC_LOG, longer ones are copied into a
+    mutex guarded overflow list so they are written whole.
+*/
 void async_log(LogLevel log_level, const std::string& message);
-void stop_async_logger();
\ No newline at end of file
+
+void stop_async_logger();
+
+bool is_async_logger_running();
+
+/*
+    Binary logging
+
+    A call site logs a pointer to its static LogSite plus the raw arguments
+    into a lock-free ring owned by the calling thread. Formatting ('{}' is
+    replaced by the next argument) and timestamp rendering happen on the
+    logger thread. When a ring is full the record is dropped and counted
+    instead of blocking the caller. String arguments share LOG_TEXT_CAPACITY
+    bytes per record, a cut one ends with "..." and is counted too.
+
+        ASYNC_LOG(LogLevel::Info, "client {} connected from {}", id, address);
+*/
+constexpr size_t LOG_MAX_ARGS = 8;
+constexpr size_t LOG_TEXT_CAPACITY = 256;           // String arguments of one record, cut beyond
+constexpr size_t LOG_THREAD_RING_CAPACITY = 256;    // Records per thread
+
+struct LogSite {
+    LogLevel    level;
+    const char* format;
+    const char* file;
+    int         line;
+};
+
+enum class LogArgType : uint8_t {
+    Int,
+    UInt,
+    Double,
+    Bool,
+    Char,
+    String,
+    Pointer,
+    Overflow    // Internal: an async_log() message held by the logger thread, in p
+};
+
+struct LogArg {
+    LogArgType type;
+
+    union {
+        int64_t     i;
+        uint64_t    u;
+        double      d;
+        const void* p;
+
+        struct {
+            uint16_t offset;
+            uint16_t size;
+        } text;
+    };
+};
+
+// Internal: counts a string argument cut to fit LOG_TEXT_CAPACITY, reported by the logger thread
+void log_text_cut();
+
+struct LogRecord {
+    const LogSite*  site;
+    uint64_t        timestamp;      // log_now_ticks() of the call
+    uint32_t        thread_index;
+    uint16_t        text_used;
+    uint8_t         arg_count;
+
+    LogArg          args[LOG_MAX_ARGS];
+    char            text[LOG_TEXT_CAPACITY];
+
+    template <typename... Args>
+    LogRecord(const LogSite& log_site, uint64_t ticks, uint32_t thread, const Args&... values)
+        : site(&log_site)
+        , timestamp(ticks)
+        , thread_index(thread)
+        , text_used(0)
+        , arg_count(0)
+    {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+
+        (add(values), ...);
+    }
+
+    std::string_view text_of(const LogArg& arg) const {
+        return std::string_view(text + arg.text.offset, arg.text.size);
+    }
+
+private:
+    void add_text(std::string_view value) {
+        static constexpr std::string_view cut_mark = "...";
+
+        auto& arg = args[arg_count++];
+        const auto room = LOG_TEXT_CAPACITY - text_used;
+        auto size = value.size();
+
+        if (size > room)
+        {
+            log_text_cut();
+            size = room > cut_mark.size() ? room - cut_mark.size() : 0;
+        }
+
+        arg.type        = LogArgType::String;
+        arg.text.offset = text_used;
+
+        std::memcpy(text + text_used, value.data(), size);
+
+        if (size < value.size())
+        {
+            const auto mark = cut_mark.size() < room - size ? cut_mark.size() : room - size;
+
+            std::memcpy(text + text_used + size, cut_mark.data(), mark);
+            size += mark;
+        }
+
+        arg.text.size   = static_cast<uint16_t>(size);
+        text_used       = static_cast<uint16_t>(text_used + size);
+    }
+
+    template <typename T>
+    void add(const T& value) {
+        if constexpr (std::is_enum_v<T>)
+        {
+            add(static_cast<std::underlying_type_t<T>>(value));
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            args[arg_count].type = LogArgType::Bool;
+            args[arg_count++].u = value ? 1 : 0;
+        }
+        else if constexpr (std::is_same_v<T, char>)
+        {
+            args[arg_count].type = LogArgType::Char;
+            args[arg_count++].u = static_cast<uint8_t>(value);
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            args[arg_count].type = LogArgType::Int;
+            args[arg_count++].i = value;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            args[arg_count].type = LogArgType::UInt;
+            args[arg_count++].u = value;
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            args[arg_count].type = LogArgType::Double;
+            args[arg_count++].d = static_cast<double>(value);
+        }
+        else if constexpr (std::is_array_v<T>)
+        {
+            add_text(std::string_view(value));
+        }
+        else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>)
+        {
+            add_text(value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+        }
+        else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+        {
+            add_text(std::string_view(value));
+        }
+        else if constexpr (std::is_pointer_v<T>)
+        {
+            args[arg_count].type = LogArgType::Pointer;
+            args[arg_count++].p = static_cast<const void*>(value);
+        }
+        else
+        {
+            static_assert(std::is_arithmetic_v<T>, "Unsupported log argument type");
+        }
+    }
+};
+
+/*
+    Internal: the ring of the calling thread (nullptr while the logger is stopped)
+    and the bookkeeping for records that did not fit
+*/
+struct LogThreadRing {
+    SpscRingQueue<LogRecord>*   ring;
+    uint32_t                    thread_index;
+};
+
+LogThreadRing log_thread_ring();
+void log_record_dropped();
+
+/*
+    Raw timestamp of a record: the TSC where there is one, steady_clock
+    nanoseconds otherwise. Reading the wall clock costs more than the rest
+    of a call, so the logger thread converts ticks to wall-clock time.
+*/
+inline uint64_t log_now_ticks() {
+#ifdef LOGGER_HAS_RDTSC
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+template <typename... Args>
+void log_record(const LogSite& site, const Args&... args) {
+    const auto target = log_thread_ring();
+
+    if (target.ring == nullptr)
+    {
+        return;
+    }
+
+    if (!target.ring->try_emplace(site, log_now_ticks(), target.thread_index, args...))
+    {
+        log_record_dropped();
+    }
+}
+
+// Formats and writes a record right away, for when the logger is not running
+void log_write_to_stderr(const LogRecord& record);
+
+template <typename... Args>
+void log_record_to_stderr(const LogSite& site, const Args&... args) {
+    log_write_to_stderr(LogRecord(site, log_now_ticks(), 0, args...));
+}
+
+#define ASYNC_LOG(level, format, ...)                                           \
+    do {                                                                        \
+        static constexpr LogSite async_log_site_ { level, format, __FILE__, __LINE__ }; \
+        log_record(async_log_site_, ##__VA_ARGS__);                             \
+    } while (0)
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Log-linear (HDR style) histogram of non-negative integer values, meant for
+    latencies in nanoseconds. Every power of two is split into
+    2^LATENCY_HISTOGRAM_PRECISION_BITS buckets, so a percentile is reported
+    with less than 1% relative error whatever the magnitude, in a fixed
+    amount of memory. Values at or above 2^LATENCY_HISTOGRAM_RANGE_BITS are
+    counted in the last bucket.
+
+    Not thread safe: give every thread its own histogram and merge() them.
+*/
+constexpr uint32_t LATENCY_HISTOGRAM_PRECISION_BITS = 7;
+constexpr uint32_t LATENCY_HISTOGRAM_RANGE_BITS = 40;     // ~18 minutes in nanoseconds
+
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void record(uint64_t value, uint64_t count);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t min() const;
+    uint64_t max() const;
+    double mean() const;
+
+    /*
+        Smallest value that percent% of the recorded values are not above
+        (percent in [0, 100]), reported as the top of its bucket
+    */
+    uint64_t percentile(double percent) const;
+
+private:
+    std::vector<uint64_t>   m_counts;
+    uint64_t                m_total;
+    uint64_t                m_min;
+    uint64_t                m_max;
+    double                  m_sum;
+};
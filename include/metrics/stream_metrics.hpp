@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../packet_template/header.hpp"
+#include "../ring_queue/ring_queue_common.hpp"
+
+/*
+    Histogram that any number of threads may record into, every update is a
+    relaxed atomic add. Buckets are powers of two: bucket i counts values
+    below 2^(i + 8), values from 2^(ATOMIC_HISTOGRAM_BUCKET_COUNT + 7) up
+    land in the overflow bucket. For nanoseconds that is 256 ns to ~4.3 s.
+*/
+constexpr size_t ATOMIC_HISTOGRAM_BUCKET_COUNT = 25;
+
+struct AtomicHistogramSnapshot {
+    std::array<uint64_t, ATOMIC_HISTOGRAM_BUCKET_COUNT + 1> buckets = {};   // Last one is the overflow
+    uint64_t count  = 0;
+    uint64_t sum    = 0;
+
+    void merge(const AtomicHistogramSnapshot& other);
+};
+
+class AtomicHistogram {
+public:
+    AtomicHistogram();
+
+    void record(uint64_t value);
+    AtomicHistogramSnapshot snapshot() const;
+
+    // Exclusive upper bound of bucket index
+    static uint64_t bucket_limit(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, ATOMIC_HISTOGRAM_BUCKET_COUNT + 1>    m_buckets;
+    std::atomic<uint64_t>                                                   m_count;
+    std::atomic<uint64_t>                                                   m_sum;
+};
+
+// The durations a stream measures, in nanoseconds
+enum class StreamTiming : uint8_t {
+    Serialize,      // Packet into payload bytes
+    Deserialize,    // Payload bytes decoded and dispatched, typed handlers included
+    SendBlocked,    // Inside the socket send
+    Count
+};
+
+constexpr size_t STREAM_TIMING_COUNT = static_cast<size_t>(StreamTiming::Count);
+
+struct StreamMetricsSnapshot {
+    std::string name;
+
+    std::array<uint64_t, PAYLOAD_TYPE_COUNT> packets_in     = {};
+    std::array<uint64_t, PAYLOAD_TYPE_COUNT> bytes_in       = {};   // Header included, as on the wire
+    std::array<uint64_t, PAYLOAD_TYPE_COUNT> packets_out    = {};
+    std::array<uint64_t, PAYLOAD_TYPE_COUNT> bytes_out      = {};
+
+    uint64_t resync_skipped_bytes   = 0;    // Bytes skipped looking for the next header
+    uint64_t discarded_packets      = 0;    // Malformed, undecompressable or of an unknown type
+    uint64_t send_failures          = 0;
+    uint64_t dropped_frames         = 0;    // Replaced by a newer frame before they were polled
+    uint64_t dropped_packets        = 0;    // Received while the packet queue was full
+
+    uint64_t packet_queue_depth     = 0;
+    uint64_t frame_queue_depth      = 0;
+
+    std::array<AtomicHistogramSnapshot, STREAM_TIMING_COUNT> timings;
+
+    // Adds the counters and histograms of other, gauges are left alone
+    void merge(const StreamMetricsSnapshot& other);
+};
+
+/*
+    Counters of one PacketStreamClient/PacketStreamServer, attached with
+    set_metrics(). The receive side and the senders update it with relaxed
+    atomics, the two directions live on separate cache lines.
+*/
+class StreamMetrics {
+public:
+    explicit StreamMetrics(std::string name);
+
+    // Delete copy constructor and copy assignment operator
+    StreamMetrics(const StreamMetrics&) = delete;
+    StreamMetrics& operator=(const StreamMetrics&) = delete;
+
+    const std::string& name() const;
+
+    // Send side
+    void on_sent(PayloadType payload_type, size_t wire_bytes);
+    void on_send_failed();
+
+    // Receive side
+    void on_received(PayloadType payload_type, size_t wire_bytes);
+    void on_resync_skipped(size_t bytes);
+    void on_discarded();
+    void on_frames_dropped(size_t count);
+    void on_packet_dropped();
+
+    void set_packet_queue_depth(size_t depth);
+    void set_frame_queue_depth(size_t depth);
+
+    void record_timing(StreamTiming timing, uint64_t nanoseconds);
+
+    StreamMetricsSnapshot snapshot() const;
+
+private:
+    struct alignas(RING_QUEUE_CACHE_LINE_SIZE) DirectionCounters {
+        std::array<std::atomic<uint64_t>, PAYLOAD_TYPE_COUNT> packets;
+        std::array<std::atomic<uint64_t>, PAYLOAD_TYPE_COUNT> bytes;
+
+        DirectionCounters();
+    };
+
+    std::string                                         m_name;
+
+    DirectionCounters                                   m_in;
+    DirectionCounters                                   m_out;
+
+    alignas(RING_QUEUE_CACHE_LINE_SIZE)
+    std::atomic<uint64_t>                               m_resync_skipped_bytes;
+    std::atomic<uint64_t>                               m_discarded_packets;
+    std::atomic<uint64_t>                               m_send_failures;
+    std::atomic<uint64_t>                               m_dropped_frames;
+    std::atomic<uint64_t>                               m_dropped_packets;
+    std::atomic<uint64_t>                               m_packet_queue_depth;
+    std::atomic<uint64_t>                               m_frame_queue_depth;
+
+    std::array<AtomicHistogram, STREAM_TIMING_COUNT>    m_timings;
+};
+
+/*
+    Records the time from its construction to its destruction as timing,
+    does nothing when metrics is null (the stream has no metrics attached)
+*/
+class StreamMetricsTimer {
+public:
+    StreamMetricsTimer(StreamMetrics* metrics, StreamTiming timing)
+        : m_metrics(metrics)
+        , m_timing(timing)
+        , m_start(metrics != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    {}
+
+    ~StreamMetricsTimer() {
+        if (m_metrics != nullptr)
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+
+            m_metrics->record_timing(m_timing, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    // Delete copy constructor and copy assignment operator
+    StreamMetricsTimer(const StreamMetricsTimer&) = delete;
+    StreamMetricsTimer& operator=(const StreamMetricsTimer&) = delete;
+
+private:
+    StreamMetrics*                          m_metrics;
+    StreamTiming                            m_timing;
+    std::chrono::steady_clock::time_point   m_start;
+};
+
+/*
+    Owns the StreamMetrics of every stream and exports them.
+    A stream's metrics are kept until the stream lets go of them, its
+    counters are then folded into the stream="closed" series so totals
+    summed over streams never go backwards.
+
+        auto metrics = MetricsRegistry::global().create_stream("client-42");
+        stream.set_metrics(metrics);
+        ...
+        http_response.body = MetricsRegistry::global().export_text();
+*/
+class MetricsRegistry {
+public:
+    MetricsRegistry();
+
+    // Delete copy constructor and copy assignment operator
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    static MetricsRegistry& global();
+
+    std::shared_ptr<StreamMetrics> create_stream(std::string name);
+
+    // Live streams followed by the closed streams' totals
+    std::vector<StreamMetricsSnapshot> snapshot();
+
+    // Prometheus text exposition format (version 0.0.4)
+    std::string export_text();
+
+private:
+    void retire_released();
+
+    std::mutex                                      m_mutex;
+    std::vector<std::shared_ptr<StreamMetrics>>     m_streams;
+    StreamMetricsSnapshot                           m_closed;
+    uint64_t                                        m_created;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "../packet_template/frame.hpp"
+
+/*
+    Grid channels of an observation, in layout order
+*/
+enum class ObservationChannel : uint8_t {
+    BulletDensity,      // Bullets covering the cell
+    BulletOccupancy,    // 1 where any bullet covers the cell
+    BulletVelocityX,    // Mean velocity of the bullets covering the cell
+    BulletVelocityY,
+    Enemies,            // 1 where an enemy or a boss covers the cell
+    Items,              // 1 where an item covers the cell
+    Player,             // 1 where the observed player covers the cell
+    Count
+};
+
+constexpr size_t OBSERVATION_CHANNEL_COUNT = static_cast<size_t>(ObservationChannel::Count);
+
+/*
+    Per nearest bullet: offset from the player (dx, dy), velocity (vx, vy),
+    radius and 1 (0 for the padding when the frame has fewer bullets)
+*/
+constexpr size_t OBSERVATION_BULLET_FEATURE_COUNT = 6;
+
+struct ObservationOptions {
+    uint32_t    grid_width          = 64;
+    uint32_t    grid_height         = 64;
+
+    // World area the grid covers when it is not player centered
+    float       field_width         = 480.0f;
+    float       field_height        = 640.0f;
+
+    // Centers a view_width x view_height window on the observed player
+    bool        player_centered     = true;
+    float       view_width          = 256.0f;
+    float       view_height         = 256.0f;
+
+    // Index into FrameSnapshot::player_vector of the player being observed
+    uint32_t    player_index        = 0;
+
+    // Nearest bullets listed after the grid, closest first
+    uint32_t    nearest_bullets     = 16;
+};
+
+/*
+    Turns a FrameSnapshot into a fixed-shape float observation:
+
+        [OBSERVATION_CHANNEL_COUNT][grid_height][grid_width]    grid, row-major
+        [nearest_bullets][OBSERVATION_BULLET_FEATURE_COUNT]     nearest bullets
+
+    Bullets are splatted as discs of their radius: every cell whose center
+    lies inside a bullet is covered, and a bullet smaller than a cell
+    covers the cell it is in. Positions are transformed, culled and
+    measured four bullets at a time with SSE2 where available, and the
+    covered spans of each grid row are filled four cells at a time.
+
+        ObservationBuilder builder(options);
+        std::vector<float> batch(frames.size() * builder.observation_size());
+
+        builder.build_batch(frames, batch.data(), 8);
+*/
+class ObservationBuilder {
+public:
+    explicit ObservationBuilder(ObservationOptions options = {});
+
+    const ObservationOptions& options() const;
+
+    // Floats in each part of an observation
+    size_t grid_size() const;
+    size_t feature_size() const;
+    size_t observation_size() const;
+
+    // Writes observation_size() floats to out, reuses the builder's scratch (not thread safe)
+    void build(const FrameSnapshot& frame, float* out);
+
+    /*
+        Writes frames.size() observations back to back into out,
+        spread over up to thread_count threads with their own scratch
+    */
+    void build_batch(const std::vector<FrameSnapshot>& frames, float* out, size_t thread_count) const;
+
+private:
+    // Bullets of a frame in structure-of-arrays form
+    struct Scratch {
+        std::vector<float>      x;
+        std::vector<float>      y;
+        std::vector<float>      vx;
+        std::vector<float>      vy;
+        std::vector<float>      radius;
+        std::vector<float>      distance;   // Squared, to the player
+        std::vector<uint32_t>   visible;
+        std::vector<uint32_t>   order;
+    };
+
+    void build(const FrameSnapshot& frame, float* out, Scratch& scratch) const;
+
+    ObservationOptions  m_options;
+    Scratch             m_scratch;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include "../packet_template/header.hpp"
+
+/*
+    Bundle payload (PayloadType::Bundle)
+    A sequence of entries, each one a 3 byte sub-header followed by the
+    serialized payload:
+
+        [uint8_t payload_type][uint16_t payload_size][payload bytes...]
+
+    All entries share the PacketHeader (and sequence number) of the bundle.
+    Bundles can not be nested.
+*/
+constexpr size_t BUNDLE_ENTRY_HEADER_SIZE = 3;
+constexpr size_t MAX_BUNDLE_ENTRY_SIZE = 0xFFFF;
+
+// Bundles are flushed before they grow past this size
+constexpr size_t MAX_BUNDLE_SIZE = 64 * 1024;
+
+// Location of one entry inside a bundle payload
+struct BundleEntry {
+    PayloadType payload_type;
+    size_t      offset;
+    size_t      size;
+};
+
+/*
+    Serializer
+    Returns false (and leaves the bundle untouched) if the payload can't be bundled
+*/
+bool append_bundle_entry(std::vector<std::byte>& bundle, PayloadType payload_type, const std::vector<std::byte>& payload);
+
+/*
+    Deserializer
+    Validates the whole bundle up front, a single malformed entry rejects the bundle
+*/
+std::optional<std::vector<BundleEntry>> deserialize_bundle(const std::vector<std::byte>& bundle);
+std::optional<std::vector<BundleEntry>> deserialize_bundle(const std::byte* bundle, size_t size);
@@ -10,7 +10,20 @@
 */
 std::optional<std::vector<std::byte>> serialize_frame(const FrameSnapshot& frame);
 
+// Where FrameSnapshot::timestamp sits in a serialized frame
+constexpr size_t FRAME_SNAPSHOT_TIMESTAMP_OFFSET = sizeof(uint32_t) * 2;
+
 /*
     Deserializer
+    Returns std::nullopt when an object count runs past the end of the bytes
+*/
+std::optional<FrameSnapshot> deserialize_frame(const std::byte* data, size_t size);
+std::optional<FrameSnapshot> deserialize_frame(const std::vector<std::byte>& bytes);
+
+/*
+    Decodes into an existing frame, whose vectors keep their capacity, so a
+    frame reused for every payload stops allocating once it has seen the
+    largest one. frame is left partly written when false is returned.
 */
-std::optional<FrameSnapshot> deserialize_frame(const std::vector<std::byte>& bytes);
\ No newline at end of file
+bool deserialize_frame_into(const std::byte* data, size_t size, FrameSnapshot& frame);
+bool deserialize_frame_into(const std::vector<std::byte>& bytes, FrameSnapshot& frame);
\ No newline at end of file
@@ -10,7 +10,27 @@
 */
 std::vector<std::byte> serialize_packet_header(const PacketHeader& header);
 
+// with_sequence keeps the low 16 bits of header.sequence_number on the wire
+std::vector<std::byte> serialize_compact_header(const PacketHeader& header, bool with_sequence);
+
+// Allocation-free variant, writes up to COMPACT_HEADER_MAX_SIZE bytes to out and returns how many
+size_t encode_compact_header(const PacketHeader& header, bool with_sequence, std::byte* out);
+
 /*
     Deserializer
 */
-std::optional<PacketHeader> deserialize_packet_header(const std::vector<std::byte>& buffer);
\ No newline at end of file
+std::optional<PacketHeader> deserialize_packet_header(const std::vector<std::byte>& buffer);
+
+enum class CompactHeaderStatus {
+    Complete,
+    Incomplete,     // More bytes are needed
+    Invalid         // Not a compact header, the stream has to resynchronize
+};
+
+/*
+    Reads a compact header from data. header_size receives the number of bytes the
+    header used. The full sequence number is rebuilt from last_sequence, a header
+    without a sequence number is taken as last_sequence + 1.
+*/
+CompactHeaderStatus deserialize_compact_header(const std::byte* data, size_t size, uint32_t last_sequence,
+                                               PacketHeader& header, size_t& header_size);
\ No newline at end of file
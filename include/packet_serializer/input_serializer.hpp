@@ -1,16 +1,50 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <cstddef>
 #include <optional>
 #include <packet_template/input.hpp>
 
+/*
+    ClientInput wire format (12 bytes, little endian)
+    [u32 client_id][u32 frame_timestamp][u32 packed game input bits]
+
+    The older 14-byte form (one byte per bitset) is still accepted when decoding.
+*/
+constexpr size_t CLIENT_INPUT_WIRE_SIZE = 12;
+constexpr size_t CLIENT_INPUT_LEGACY_WIRE_SIZE = 14;
+
+using ClientInputBytes = std::array<std::byte, CLIENT_INPUT_WIRE_SIZE>;
+
+/*
+    ClientInputWindow wire format
+    [u32 client_id][u8 input count]
+    [u32 frame_timestamp][u32 packed game input]                    oldest input
+    [varint timestamp delta][varint packed game input ^ previous]   every following input
+
+    Inputs rarely change between ticks, so a repeated input costs about two bytes.
+*/
+constexpr size_t CLIENT_INPUT_WINDOW_FIXED_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+
+// The 32-bit word the game input bitsets are packed into
+uint32_t pack_game_input(const GameInput& input);
+GameInput unpack_game_input(uint32_t word);
+
 /*
     Serializer
 */
 std::vector<std::byte> serialize_client_input(const ClientInput& payload);
 
+// Allocation-free variant, the result lives on the caller's stack
+ClientInputBytes encode_client_input(const ClientInput& payload);
+
+// Returns std::nullopt if the window holds more than MAX_INPUT_WINDOW_SIZE inputs or is out of order
+std::optional<std::vector<std::byte>> serialize_client_input_window(const ClientInputWindow& payload);
+
 /*
     Deserializer
 */
 std::optional<ClientInput> deserialize_client_input(const std::vector<std::byte>& buffer);
+std::optional<ClientInput> decode_client_input(const std::byte* data, size_t size);
+std::optional<ClientInputWindow> deserialize_client_input_window(const std::vector<std::byte>& buffer);
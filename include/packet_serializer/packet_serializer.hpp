@@ -4,4 +4,5 @@
 #include "greeting_serializer.hpp"
 #include "game_serializer.hpp"
 #include "frame_serializer.hpp"
-#include "input_serializer.hpp"
\ No newline at end of file
+#include "input_serializer.hpp"
+#include "bundle_serializer.hpp"
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include "packet_serializer.hpp"
+
+/*
+    Compile-time mapping from a payload struct to its PayloadType
+    and deserializer. Used to bind typed handlers without going
+    through the PacketPayload variant.
+*/
+template <typename T>
+struct PayloadTraits;
+
+#define DEFINE_PAYLOAD_TRAITS(TYPE, DESERIALIZER)                                   \
+    template <>                                                                     \
+    struct PayloadTraits<TYPE> {                                                    \
+        static constexpr PayloadType type = PayloadType::TYPE;                      \
+                                                                                    \
+        static std::optional<TYPE> deserialize(const std::vector<std::byte>& bytes) { \
+            return DESERIALIZER(bytes);                                             \
+        }                                                                           \
+    };
+
+DEFINE_PAYLOAD_TRAITS(ClientHello,              deserialize_client_hello)
+DEFINE_PAYLOAD_TRAITS(ServerAccept,             deserialize_server_accept)
+DEFINE_PAYLOAD_TRAITS(ClientGoodbye,            deserialize_client_goodbye)
+DEFINE_PAYLOAD_TRAITS(ServerGoodbye,            deserialize_server_goodbye)
+DEFINE_PAYLOAD_TRAITS(ClientGameRequest,        deserialize_client_game_request)
+DEFINE_PAYLOAD_TRAITS(ServerGameResponse,       deserialize_server_game_response)
+DEFINE_PAYLOAD_TRAITS(ClientReconnectRequest,   deserialize_client_reconnect_request)
+DEFINE_PAYLOAD_TRAITS(ServerReconnectResponse,  deserialize_server_reconnect_response)
+DEFINE_PAYLOAD_TRAITS(ClientInput,              deserialize_client_input)
+DEFINE_PAYLOAD_TRAITS(FrameSnapshot,            deserialize_frame)
+DEFINE_PAYLOAD_TRAITS(ClientInputWindow,        deserialize_client_input_window)
+
+#undef DEFINE_PAYLOAD_TRAITS
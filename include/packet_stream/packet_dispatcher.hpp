@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "../packet_template/packet_template.hpp"
+#include "../packet_serializer/payload_traits.hpp"
+
+/*
+    Per-PayloadType handler table.
+
+    on<T>() binds a handler for payload type T, the decoder is picked at
+    compile time through PayloadTraits<T>. Payloads with a handler are decoded
+    straight into a T on the receiving thread and handed to the handler by
+    reference, they are never wrapped into a Packet or queued.
+
+    A slot holds a plain function pointer instantiated for T and the handler
+    type, plus the handler itself, so a dispatch is one indirect call with no
+    std::function in between.
+*/
+class PacketDispatcher {
+public:
+    template <typename T, typename Handler>
+    void on(Handler&& handler) {
+        using Stored = std::decay_t<Handler>;
+
+        static_assert(
+            std::is_invocable_v<Stored&, const PacketHeader&, const T&>,
+            "Handler must be callable as handler(const PacketHeader&, const T&)"
+        );
+
+        auto& slot = m_handlers[slot_index(PayloadTraits<T>::type)];
+
+        slot.context = std::make_shared<Stored>(std::forward<Handler>(handler));
+        slot.thunk = &invoke<T, Stored>;
+    }
+
+    /*
+        Binds a handler(const PacketHeader&, const std::vector<std::byte>&) that is
+        handed the serialized payload and decodes it itself, e.g. into an object it
+        reuses. It returns false when the payload does not decode.
+    */
+    template <typename Handler>
+    void on_payload(PayloadType type, Handler&& handler) {
+        using Stored = std::decay_t<Handler>;
+
+        static_assert(
+            std::is_invocable_r_v<bool, Stored&, const PacketHeader&, const std::vector<std::byte>&>,
+            "Handler must be callable as bool handler(const PacketHeader&, const std::vector<std::byte>&)"
+        );
+
+        auto& slot = m_handlers[slot_index(type)];
+
+        slot.context = std::make_shared<Stored>(std::forward<Handler>(handler));
+        slot.thunk = &invoke_payload<Stored>;
+    }
+
+    template <typename T>
+    void remove() {
+        m_handlers[slot_index(PayloadTraits<T>::type)] = HandlerSlot {};
+    }
+
+    bool has_handler(PayloadType type) const;
+
+    /*
+        Returns true when a handler exists for the payload type, in which case the
+        payload is consumed (even if it failed to decode and the handler was skipped)
+    */
+    bool dispatch(const PacketHeader& header, const std::vector<std::byte>& bytes);
+
+private:
+    // Decodes the payload and calls the handler stored in context, false when it does not decode
+    using HandlerThunk = bool (*)(void* context, const PacketHeader& header, const std::vector<std::byte>& bytes);
+
+    struct HandlerSlot {
+        HandlerThunk            thunk = nullptr;
+        std::shared_ptr<void>   context;    // Owns the handler
+    };
+
+    template <typename T, typename Handler>
+    static bool invoke(void* context, const PacketHeader& header, const std::vector<std::byte>& bytes) {
+        const auto payload = PayloadTraits<T>::deserialize(bytes);
+
+        if (!payload.has_value())
+        {
+            return false;
+        }
+
+        (*static_cast<Handler*>(context))(header, payload.value());
+
+        return true;
+    }
+
+    template <typename Handler>
+    static bool invoke_payload(void* context, const PacketHeader& header, const std::vector<std::byte>& bytes) {
+        return (*static_cast<Handler*>(context))(header, bytes);
+    }
+
+    static constexpr size_t slot_index(PayloadType type) {
+        return static_cast<size_t>(type);
+    }
+
+    std::array<HandlerSlot, PAYLOAD_TYPE_COUNT> m_handlers;
+};
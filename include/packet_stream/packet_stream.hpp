@@ -2,14 +2,58 @@
 
 #include <thread>
 #include <mutex>
-#include <queue>
+#include <deque>
 #include <vector>
 #include <atomic>
 #include <optional>
 #include <memory>
+#include <functional>
 
 #include "../socket/socket.hpp"
 #include "../packet_template/packet_template.hpp"
+#include "../ring_queue/spsc_ring_queue.hpp"
+#include "../event_loop/io_event_loop.hpp"
+#include "../compression/payload_compression.hpp"
+#include "../recorder/session_recorder.hpp"
+#include "../metrics/stream_metrics.hpp"
+#include "packet_dispatcher.hpp"
+
+/*
+    Capacity of the per-stream general packet queue (rounded up to a power of two).
+    Inputs received while it is full are dropped, logged and counted in
+    StreamMetrics. Control packets (accept, goodbye, game and reconnect
+    messages) are never dropped, they wait in a PacketOverflow instead.
+*/
+constexpr size_t PACKET_QUEUE_CAPACITY = 256;
+
+/*
+    Packets the full packet queue could not take. Once it holds one, every
+    later packet goes there too so the order holds, and the consumer takes
+    from it after the ring is empty. Inputs beyond PACKET_QUEUE_CAPACITY
+    are dropped, control packets always fit.
+*/
+struct PacketOverflow {
+    std::mutex              mutex;
+    std::deque<Packet>      packets;
+    std::atomic<bool>       pending { false };
+};
+
+// Wire features a stream offers during the handshake unless set_wire_capabilities() says otherwise
+constexpr uint32_t DEFAULT_WIRE_CAPABILITIES = static_cast<uint32_t>(WireCapability::CompactHeader)
+                                             | static_cast<uint32_t>(WireCapability::Compression);
+
+// What the receive side just did, reported through the receive callback
+enum class StreamEvent : uint8_t {
+    Packet,     // A packet has been queued for poll_packet()
+    Frame,      // A frame has been queued for poll_frame()
+    Closed      // The receive side has stopped (EOF, error or stop())
+};
+
+/*
+    Invoked on the receive thread (or the event loop worker) right after a
+    packet/frame has been queued. Keep it short, it runs on the hot path.
+*/
+using StreamReceiveCallback = std::function<void(StreamEvent)>;
 
 class PacketStreamClient {
 public:
@@ -20,28 +64,127 @@ public:
     PacketStreamClient(const PacketStreamClient&) = delete;
     PacketStreamClient& operator=(const PacketStreamClient&) = delete;
 
+    // Receives on a dedicated thread
     void start();
+
+    // Receives on the workers of a shared event loop instead of a dedicated thread
+    void start(IoEventLoop& loop);
+
+    /*
+        NOTE: When the stream runs on an event loop, do not call stop()
+        from inside its receive callback.
+    */
     void stop();
+
+    // On an event loop this also turns false once the peer has closed the connection
     bool is_running() const;
 
+    // Must be set before start()
+    void set_receive_callback(StreamReceiveCallback callback);
+
+    /*
+        Binds a handler(const PacketHeader&, const T&) that runs on the receive
+        thread for every T payload, those payloads bypass the packet queue.
+        Must be registered before start().
+    */
+    template <typename T, typename Handler>
+    void on(Handler&& handler) {
+        m_dispatcher.on<T>(std::forward<Handler>(handler));
+    }
+
+    // Like on<T>() for a handler that decodes the payload itself, see PacketDispatcher::on_payload
+    template <typename Handler>
+    void on_payload(PayloadType type, Handler&& handler) {
+        m_dispatcher.on_payload(type, std::forward<Handler>(handler));
+    }
+
     // Returns the latest frame
     std::optional<FrameSnapshot> poll_frame();
     std::optional<Packet> poll_packet();
 
+    // Moves up to max_count queued packets into out, returns the number of packets moved
+    size_t poll_packets(std::vector<Packet>& out, size_t max_count);
+
     bool send_packet(const Packet& packet);
 
+    /*
+        send_packet(make_packet(input)) without allocating: the header and
+        payload are encoded on the stack. Falls back to send_packet() while
+        a recorder is set or the input would be compressed.
+    */
+    bool send_input(const ClientInput& input);
+
+    /*
+        Tick bundling: queue_packet() serializes the packet into a pending bundle
+        and flush() sends everything queued so far as one Bundle packet
+        (a lone packet is sent as is). Queuing the packet that ends a tick
+        (ClientInput, ClientInputWindow or FrameSnapshot) flushes on its own,
+        flush() is only needed for ticks that end without one.
+        Ordering against packets sent directly with send_packet() is not kept.
+    */
+    bool queue_packet(const Packet& packet);
+    bool flush();
+
+    /*
+        Wire features (WireCapability bits) this side offers in the ClientHello/ServerAccept
+        handshake, the current format is always kept for anything not agreed on.
+        Must be set before start().
+    */
+    void set_wire_capabilities(uint32_t capabilities);
+
+    /*
+        Compresses outgoing payloads above options.threshold once the peer has agreed
+        to WireCapability::Compression. The dictionary id is exchanged in the handshake
+        and compression is only agreed on when both sides use the same dictionary.
+        Incoming compressed payloads are always accepted as long as they use the same
+        dictionary. Must be set before start().
+    */
+    void set_compression(CompressionOptions options);
+
+    /*
+        Records every packet sent and received (after decompression) under stream_id.
+        Must be set before start().
+    */
+    void set_recorder(std::shared_ptr<SessionRecorder> recorder, uint32_t stream_id);
+
+    /*
+        Counts traffic, queue depths and serialize/deserialize/send times into metrics
+        (see MetricsRegistry::create_stream). Must be set before start().
+    */
+    void set_metrics(std::shared_ptr<StreamMetrics> metrics);
+
+    // Features agreed with the peer, 0 until the handshake has been seen
+    uint32_t wire_capabilities() const;
+
     // Returns std::exception_ptr if there is an exception in the receive thread
     std::exception_ptr get_recv_exception() const;
 
 private:
     void receive_loop();
+    bool pump();
+    bool consume_received(const std::byte* data, ssize_t bytes_read);
     void process_buffer();
+    void handle_payload(const PacketHeader& header, const std::vector<std::byte>& payload);
+    void negotiate(const std::vector<std::byte>& handshake_bytes);
+    void notify(StreamEvent event);
+
+    std::optional<std::vector<std::byte>> serialize_payload(const Packet& packet);
+    bool send_payload(PayloadType payload_type, std::vector<std::byte>&& payload_bytes);
 
     std::shared_ptr<ClientSocket>   m_socket;
     std::atomic<bool>               m_running;
     std::thread                     m_recv_thread;
+
+    // Event loop mode
+    IoEventLoop*                    m_loop;
+    uint64_t                        m_reader_id;
+
+    StreamReceiveCallback           m_receive_callback;
+    PacketDispatcher                m_dispatcher;
     
     std::vector<std::byte>          m_buffer;
+    std::vector<std::byte>          m_payload;          // Receive side only, reused for every payload
+    std::vector<std::byte>          m_entry_payload;    // Receive side only, reused for every bundle entry
 
     /*
         Packet Queue (Frame Snapshot Only)
@@ -53,12 +196,41 @@ private:
     std::mutex                      m_frame_mutex;
     std::deque<FrameSnapshot>       m_frame_queue;
 
-    // Packet queue (General)
-    std::mutex                      m_packet_mutex;
-    std::queue<Packet>              m_packet_queue;
+    /*
+        Packet queue (General)
+        The receive thread is the only producer and the polling thread is the
+        only consumer, so a lock-free SPSC ring is enough here.
+    */
+    SpscRingQueue<Packet>           m_packet_queue;
+    PacketOverflow                  m_packet_overflow;
+
+    // Queue handoffs seen by each side, pair up the trace flows of a packet or frame
+    uint64_t                        m_pushed_frames;    // Guarded by m_frame_mutex
+    uint64_t                        m_pushed_packets;   // Receive side only
+    uint64_t                        m_polled_packets;   // Polling side only
 
     std::atomic<uint32_t>           m_send_sequence;
 
+    // Pending tick bundle
+    std::mutex                      m_bundle_mutex;
+    std::vector<std::byte>          m_bundle;
+    size_t                          m_bundle_count;
+
+    // Wire format negotiation (see WireCapability)
+    uint32_t                        m_capabilities;
+    std::atomic<uint32_t>           m_wire_capabilities;
+    std::atomic<bool>               m_compact_send;
+    std::atomic<bool>               m_compress_send;
+    CompressionOptions              m_compression;
+    bool                            m_compact_receive;  // Receive side only
+    bool                            m_wire_synced;      // Receive side only
+    uint32_t                        m_recv_sequence;    // Receive side only
+
+    std::shared_ptr<SessionRecorder> m_recorder;
+    uint32_t                        m_recorder_stream_id;
+
+    std::shared_ptr<StreamMetrics>  m_metrics;
+
     std::exception_ptr              m_recv_thread_exception;
 };
 
@@ -71,31 +243,148 @@ public:
     PacketStreamServer(const PacketStreamServer&) = delete;
     PacketStreamServer& operator=(const PacketStreamServer&) = delete;
 
+    // Receives on a dedicated thread
     void start();
+
+    // Receives on the workers of a shared event loop instead of a dedicated thread
+    void start(IoEventLoop& loop);
+
+    /*
+        NOTE: When the stream runs on an event loop, do not call stop()
+        from inside its receive callback.
+    */
     void stop();
+
+    // On an event loop this also turns false once the peer has closed the connection
     bool is_running() const;
 
+    // Must be set before start()
+    void set_receive_callback(StreamReceiveCallback callback);
+
+    /*
+        Binds a handler(const PacketHeader&, const T&) that runs on the receive
+        thread for every T payload, those payloads bypass the packet queue.
+        Must be registered before start().
+    */
+    template <typename T, typename Handler>
+    void on(Handler&& handler) {
+        m_dispatcher.on<T>(std::forward<Handler>(handler));
+    }
+
+    // Like on<T>() for a handler that decodes the payload itself, see PacketDispatcher::on_payload
+    template <typename Handler>
+    void on_payload(PayloadType type, Handler&& handler) {
+        m_dispatcher.on_payload(type, std::forward<Handler>(handler));
+    }
+
     std::optional<Packet> poll_packet();
+
+    // Moves up to max_count queued packets into out, returns the number of packets moved
+    size_t poll_packets(std::vector<Packet>& out, size_t max_count);
+
     bool send_packet(const Packet& packet);
 
+    /*
+        Tick bundling: queue_packet() serializes the packet into a pending bundle
+        and flush() sends everything queued so far as one Bundle packet
+        (a lone packet is sent as is). Queuing the packet that ends a tick
+        (ClientInput, ClientInputWindow or FrameSnapshot) flushes on its own,
+        flush() is only needed for ticks that end without one.
+        Ordering against packets sent directly with send_packet() is not kept.
+    */
+    bool queue_packet(const Packet& packet);
+    bool flush();
+
+    /*
+        Wire features (WireCapability bits) this side offers in the ClientHello/ServerAccept
+        handshake, the current format is always kept for anything not agreed on.
+        Must be set before start().
+    */
+    void set_wire_capabilities(uint32_t capabilities);
+
+    /*
+        Compresses outgoing payloads above options.threshold once the peer has agreed
+        to WireCapability::Compression. The dictionary id is exchanged in the handshake
+        and compression is only agreed on when both sides use the same dictionary.
+        Incoming compressed payloads are always accepted as long as they use the same
+        dictionary. Must be set before start().
+    */
+    void set_compression(CompressionOptions options);
+
+    /*
+        Records every packet sent and received (after decompression) under stream_id.
+        Must be set before start().
+    */
+    void set_recorder(std::shared_ptr<SessionRecorder> recorder, uint32_t stream_id);
+
+    /*
+        Counts traffic, queue depths and serialize/deserialize/send times into metrics
+        (see MetricsRegistry::create_stream). Must be set before start().
+    */
+    void set_metrics(std::shared_ptr<StreamMetrics> metrics);
+
+    // Features agreed with the peer, 0 until the handshake has been seen
+    uint32_t wire_capabilities() const;
+
     // Returns std::exception_ptr if there is an exception in the receive thread
     std::exception_ptr get_recv_exception() const;
 
 private:
     void receive_loop();
+    bool pump();
+    void consume_received(const std::byte* data, ssize_t bytes_read);
     void process_buffer();
+    void handle_payload(const PacketHeader& header, const std::vector<std::byte>& payload);
+    void negotiate(const std::vector<std::byte>& handshake_bytes);
+    void notify(StreamEvent event);
+
+    std::optional<std::vector<std::byte>> serialize_payload(const Packet& packet);
+    bool send_payload(PayloadType payload_type, std::vector<std::byte>&& payload_bytes);
 
     std::shared_ptr<ClientConnection>   m_connection;
     std::atomic<bool>                   m_running;
     std::thread                         m_recv_thread;
 
+    // Event loop mode
+    IoEventLoop*                        m_loop;
+    uint64_t                            m_reader_id;
+
+    StreamReceiveCallback               m_receive_callback;
+    PacketDispatcher                    m_dispatcher;
+
     std::vector<std::byte>              m_buffer;
+    std::vector<std::byte>              m_payload;          // Receive side only, reused for every payload
+    std::vector<std::byte>              m_entry_payload;    // Receive side only, reused for every bundle entry
 
-    // Packet queue
-    std::mutex                          m_packet_mutex;
-    std::queue<Packet>                  m_packet_queue;
+    // Packet queue (receive thread -> polling thread)
+    SpscRingQueue<Packet>               m_packet_queue;
+    PacketOverflow                      m_packet_overflow;
+
+    // Queue handoffs seen by each side, pair up the trace flows of a packet
+    uint64_t                            m_pushed_packets;   // Receive side only
+    uint64_t                            m_polled_packets;   // Polling side only
 
     std::atomic<uint32_t>               m_send_sequence;
 
+    // Pending tick bundle
+    std::mutex                          m_bundle_mutex;
+    std::vector<std::byte>              m_bundle;
+    size_t                              m_bundle_count;
+
+    // Wire format negotiation (see WireCapability)
+    uint32_t                            m_capabilities;
+    std::atomic<uint32_t>               m_wire_capabilities;
+    std::atomic<bool>                   m_compact_send;
+    std::atomic<bool>                   m_compress_send;
+    CompressionOptions                  m_compression;
+    bool                                m_compact_receive;  // Receive side only
+    bool                                m_wire_synced;      // Receive side only
+    uint32_t                            m_recv_sequence;    // Receive side only
+
+    std::shared_ptr<SessionRecorder>    m_recorder;
+    uint32_t                            m_recorder_stream_id;
+
+    std::shared_ptr<StreamMetrics>      m_metrics;
+
     std::exception_ptr                  m_recv_thread_exception;
 };
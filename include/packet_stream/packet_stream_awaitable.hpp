@@ -0,0 +1,288 @@
+#pragma once
+
+/*
+    C++20 coroutine front-end for PacketStreamClient / PacketStreamServer.
+
+    The library itself is built as C++17, this header is only usable from
+    translation units compiled with coroutine support.
+
+    Usage:
+        SessionTask session(PacketStreamServer& stream, IoEventLoop& loop) {
+            AwaitableStream<PacketStreamServer> io(stream, loop);
+            stream.start(loop);
+
+            while (auto packet = co_await io.next_packet())
+            {
+                co_await io.send(make_packet(ServerAccept { 1 }));
+            }
+        }
+
+        spawn_session(loop, session(stream, loop));
+
+    Sessions are resumed on the event loop workers, so thousands of them can
+    share a handful of threads. Stop the streams before stopping the loop,
+    a session suspended on a stopped loop is never resumed.
+*/
+
+#if !defined(__cpp_impl_coroutine)
+    #error "packet_stream_awaitable.hpp requires C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "../logger/log_macros.hpp"
+#include "packet_stream.hpp"
+
+/*
+    Fire-and-forget coroutine type for a session.
+    The coroutine starts suspended and begins running once handed to spawn_session().
+*/
+class SessionTask {
+public:
+    struct promise_type {
+        SessionTask get_return_object() {
+            return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            try
+            {
+                std::rethrow_exception(std::current_exception());
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR("[SessionTask] Session threw an exception: {}", e.what());
+            }
+            catch (...)
+            {
+                LOG_ERROR("[SessionTask] Session threw an unknown exception");
+            }
+        }
+    };
+
+    SessionTask(SessionTask&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {}
+
+    SessionTask& operator=(SessionTask&& other) = delete;
+    SessionTask(const SessionTask&) = delete;
+    SessionTask& operator=(const SessionTask&) = delete;
+
+    // A task that was never spawned still owns its frame
+    ~SessionTask() {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+private:
+    explicit SessionTask(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> m_handle;
+
+    friend bool spawn_session(IoEventLoop& loop, SessionTask task);
+};
+
+// Schedules the session on the loop, returns false when the loop is not running
+inline bool spawn_session(IoEventLoop& loop, SessionTask task) {
+    auto handle = std::exchange(task.m_handle, {});
+
+    const auto posted = loop.post([handle]() {
+        handle.resume();
+    });
+
+    if (!posted)
+    {
+        handle.destroy();
+    }
+
+    return posted;
+}
+
+/*
+    Awaitable view over one stream.
+    It installs the stream's receive callback, so construct it before the
+    stream is started and keep it alive until the stream has been stopped.
+    Only one coroutine may await a given stream at a time.
+*/
+template <typename Stream>
+class AwaitableStream {
+public:
+    AwaitableStream(Stream& stream, IoEventLoop& loop)
+        : m_stream(stream)
+        , m_loop(loop)
+        , m_waiting_for(StreamEvent::Packet)
+        , m_closed(false)
+    {
+        m_stream.set_receive_callback([this](StreamEvent event) {
+            on_event(event);
+        });
+    }
+
+    AwaitableStream(const AwaitableStream&) = delete;
+    AwaitableStream& operator=(const AwaitableStream&) = delete;
+
+    // Resolves to std::nullopt once the stream is closed
+    auto next_packet() {
+        struct PacketAwaiter {
+            AwaitableStream&        self;
+            std::optional<Packet>   result;
+
+            bool await_ready() {
+                result = self.m_stream.poll_packet();
+                return result.has_value() || self.m_closed;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return self.suspend(handle, StreamEvent::Packet, [this]() {
+                    result = self.m_stream.poll_packet();
+                    return result.has_value();
+                });
+            }
+
+            std::optional<Packet> await_resume() {
+                if (!result.has_value())
+                {
+                    result = self.m_stream.poll_packet();
+                }
+
+                return std::move(result);
+            }
+        };
+
+        return PacketAwaiter { *this, std::nullopt };
+    }
+
+    // Resolves to the latest frame, or std::nullopt once the stream is closed
+    auto next_frame() requires requires (Stream& s) { s.poll_frame(); } {
+        struct FrameAwaiter {
+            AwaitableStream&                self;
+            std::optional<FrameSnapshot>    result;
+
+            bool await_ready() {
+                result = self.m_stream.poll_frame();
+                return result.has_value() || self.m_closed;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return self.suspend(handle, StreamEvent::Frame, [this]() {
+                    result = self.m_stream.poll_frame();
+                    return result.has_value();
+                });
+            }
+
+            std::optional<FrameSnapshot> await_resume() {
+                if (!result.has_value())
+                {
+                    result = self.m_stream.poll_frame();
+                }
+
+                return std::move(result);
+            }
+        };
+
+        return FrameAwaiter { *this, std::nullopt };
+    }
+
+    // Sends on a loop worker so the session never blocks in send()
+    auto send(Packet packet) {
+        struct SendAwaiter {
+            AwaitableStream&    self;
+            Packet              packet;
+            bool                result;
+
+            bool await_ready() {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                const auto posted = self.m_loop.post([this, handle]() {
+                    result = self.m_stream.send_packet(packet);
+                    handle.resume();
+                });
+
+                if (!posted)
+                {
+                    // The loop is gone, send inline and carry on
+                    result = self.m_stream.send_packet(packet);
+                }
+
+                return posted;
+            }
+
+            bool await_resume() {
+                return result;
+            }
+        };
+
+        return SendAwaiter { *this, std::move(packet), false };
+    }
+
+    bool closed() const {
+        return m_closed;
+    }
+
+private:
+    // Returns false (don't suspend) when ready() succeeds or the stream is closed
+    template <typename Ready>
+    bool suspend(std::coroutine_handle<> handle, StreamEvent waiting_for, Ready ready) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Re-check under the lock, the event may have fired since await_ready()
+        if (ready() || m_closed)
+        {
+            return false;
+        }
+
+        m_waiter = handle;
+        m_waiting_for = waiting_for;
+
+        return true;
+    }
+
+    void on_event(StreamEvent event) {
+        std::coroutine_handle<> waiter;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (event == StreamEvent::Closed)
+            {
+                m_closed = true;
+            }
+
+            if (m_waiter && (event == m_waiting_for || event == StreamEvent::Closed))
+            {
+                waiter = std::exchange(m_waiter, {});
+            }
+        }
+
+        if (waiter)
+        {
+            m_loop.post([waiter]() {
+                waiter.resume();
+            });
+        }
+    }
+
+    Stream&                     m_stream;
+    IoEventLoop&                m_loop;
+
+    std::mutex                  m_mutex;
+    std::coroutine_handle<>     m_waiter;
+    StreamEvent                 m_waiting_for;
+    std::atomic<bool>           m_closed;
+};
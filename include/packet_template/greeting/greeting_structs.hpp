@@ -11,9 +11,11 @@ constexpr uint32_t MAX_CLIENT_NAME_SIZE = 32;
 struct ClientHello {
     uint32_t client_name_size;
     char client_name[MAX_CLIENT_NAME_SIZE];
+    uint32_t capabilities;      // WireCapability bits, filled in by the stream
+    uint32_t dictionary_id;     // LzDictionary::id() of the compression dictionary, filled in by the stream
 };
 
-constexpr size_t CLIENT_HELLO_SIZE = 36;
+constexpr size_t CLIENT_HELLO_SIZE = 44;
 static_assert(sizeof(ClientHello) == CLIENT_HELLO_SIZE);
 
 /*
@@ -21,8 +23,13 @@ static_assert(sizeof(ClientHello) == CLIENT_HELLO_SIZE);
 */
 struct ServerAccept {
     uint32_t assigned_client_id;
+    uint32_t capabilities;      // WireCapability bits both sides support, filled in by the stream
+    uint32_t dictionary_id;     // LzDictionary::id() of the compression dictionary, filled in by the stream
 };
 
+constexpr size_t SERVER_ACCEPT_SIZE = 12;
+static_assert(sizeof(ServerAccept) == SERVER_ACCEPT_SIZE);
+
 /*
     Goodbye
 */
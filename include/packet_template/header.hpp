@@ -22,11 +22,16 @@ enum class PayloadType : uint32_t {
     ServerReconnectResponse,
     ClientInput,
     FrameSnapshot,
+    Bundle,             // Several small payloads under one header (see bundle_serializer.hpp)
+    ClientInputWindow,  // The last few inputs of a client, sent redundantly
     // Chat,
     // Info,
     // Error
 };
 
+// Number of PayloadType values, keep it in sync with the last enumerator
+constexpr size_t PAYLOAD_TYPE_COUNT = static_cast<size_t>(PayloadType::ClientInputWindow) + 1;
+
 /*
     Packet header (8bytes)
 */
@@ -38,4 +43,46 @@ struct PacketHeader {
 };
 
 constexpr size_t PACKET_HEADER_SIZE = 16;
-static_assert(sizeof(PacketHeader) == PACKET_HEADER_SIZE);
\ No newline at end of file
+static_assert(sizeof(PacketHeader) == PACKET_HEADER_SIZE);
+
+/*
+    Optional wire features, advertised in ClientHello and confirmed in ServerAccept.
+    A feature is used only when both sides list it.
+*/
+enum class WireCapability : uint32_t {
+    None            = 0,
+    CompactHeader   = 1u << 0,
+    Compression     = 1u << 1
+};
+
+constexpr bool has_wire_capability(uint32_t capabilities, WireCapability capability) {
+    return (capabilities & static_cast<uint32_t>(capability)) != 0;
+}
+
+/*
+    Set in the payload_type field on the wire when the payload has been compressed
+    (WireCapability::Compression, see payload_compression.hpp)
+*/
+constexpr uint32_t PAYLOAD_COMPRESSED_FLAG = 0x80000000;
+
+constexpr bool is_payload_compressed(const PacketHeader& header) {
+    return (static_cast<uint32_t>(header.payload_type) & PAYLOAD_COMPRESSED_FLAG) != 0;
+}
+
+/*
+    Compact header (WireCapability::CompactHeader)
+    [u8 flags | payload_type][varint payload_size][u16 sequence, optional]
+
+    The top bit of the first byte is always clear while the first byte of a full
+    header (the low byte of PACKET_MAGIC_NUMBER) has it set, so both formats can
+    share a stream. Every COMPACT_SYNC_INTERVAL-th packet is still sent with a full
+    header so that the receiver can resynchronize on the magic number.
+*/
+constexpr uint8_t   COMPACT_HEADER_SEQUENCE_FLAG    = 0x40;
+constexpr uint8_t   COMPACT_HEADER_COMPRESSED_FLAG  = 0x20;
+constexpr uint8_t   COMPACT_HEADER_TYPE_MASK        = 0x1F;
+constexpr size_t    COMPACT_HEADER_MAX_SIZE         = 1 + 5 + 2;
+constexpr uint32_t  COMPACT_SYNC_INTERVAL           = 64;
+
+static_assert((PACKET_MAGIC_NUMBER & 0x80) != 0);
+static_assert(PAYLOAD_TYPE_COUNT <= COMPACT_HEADER_TYPE_MASK + 1);
\ No newline at end of file
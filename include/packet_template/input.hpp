@@ -1,12 +1,13 @@
 #pragma once
 
+#include <vector>
 #include "./input/input_snapshot.hpp"
 
 /*
     ClientInput has an std::bitset member, so its size is environment-dependent.
-    Therefore, the serializer/deserializer is designed to convert std::bitset
-    to an environment-independent intermediate representation of std::vector type
-    before converting it to payload.
+    Therefore, the serializer/deserializer packs every bitset into one
+    environment-independent 32-bit word before converting it to payload
+    (see input_serializer.hpp).
 */
 
 /*
@@ -18,4 +19,16 @@ struct ClientInput {
     GameInput   game_input;
 };
 
-constexpr size_t CLIENT_INPUT_SIZE = sizeof(ClientInput);
\ No newline at end of file
+constexpr size_t CLIENT_INPUT_SIZE = sizeof(ClientInput);
+
+/*
+    Input window
+    Carries the latest inputs of a client (oldest first, strictly increasing
+    frame_timestamp) so that the server can fill in inputs whose own packet was lost.
+*/
+constexpr size_t MAX_INPUT_WINDOW_SIZE = 32;
+
+struct ClientInputWindow {
+    uint32_t                    client_id;
+    std::vector<ClientInput>    inputs;
+};
\ No newline at end of file
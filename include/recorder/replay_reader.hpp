@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include "../packet_template/frame.hpp"
+#include "session_format.hpp"
+
+/*
+    One record of a recording. The payload points into the mapped file,
+    nothing is copied and it stays valid for as long as the reader is open.
+*/
+struct ReplayRecord {
+    uint64_t            offset;     // Of the record header in the file
+    SessionRecordHeader header;
+    const std::byte*    payload;
+
+    size_t payload_size() const {
+        return header.header.payload_size;
+    }
+
+    // Decodes the payload straight from the mapping (FrameSnapshot records only)
+    std::optional<FrameSnapshot> frame() const;
+};
+
+class ReplayReader;
+
+// Walks every record in file order
+class ReplayCursor {
+public:
+    ReplayCursor(const ReplayReader& reader, uint64_t offset);
+
+    // std::nullopt at the end of the records or at a damaged record
+    std::optional<ReplayRecord> next();
+    uint64_t offset() const;
+
+private:
+    const ReplayReader* m_reader;
+    uint64_t            m_offset;
+};
+
+// Walks the frames of one stream in FrameSnapshot::timestamp order through the index (see frame_at)
+class ReplayFrameCursor {
+public:
+    ReplayFrameCursor(const ReplayReader& reader, size_t first, size_t last);
+
+    std::optional<ReplayRecord> next();
+
+    // Frames left to visit
+    size_t remaining() const;
+
+private:
+    const ReplayReader* m_reader;
+    size_t              m_next;
+    size_t              m_last;
+};
+
+/*
+    Reads a file written by SessionRecorder through a read-only memory mapping,
+    so files larger than memory are paged in by the OS as they are read.
+
+    The reader does not change once open() has returned: any number of threads
+    may read through it at the same time, each with its own cursors.
+
+        ReplayReader reader;
+        reader.open("match.bhr");
+
+        auto frames = reader.frames(client_id, start_timestamp);
+
+        while (auto record = frames.next())
+        {
+            auto frame = record->frame();
+        }
+*/
+class ReplayReader {
+public:
+    ReplayReader();
+    ~ReplayReader();
+
+    // Delete copy constructor and copy assignment operator
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    bool open(const std::string& file_path);
+    void close();
+    bool is_open() const;
+
+    const SessionFileHeader& file_header() const;
+
+    // False when the file had no valid footer and the index was rebuilt by scanning
+    bool has_footer_index() const;
+
+    // Every frame, bundled ones included, sorted by stream and timestamp (see session_index_less)
+    const std::vector<SessionIndexEntry>& index() const;
+
+    /*
+        First frame of stream_id whose timestamp is not older than frame_timestamp,
+        a binary search over the index
+    */
+    std::optional<SessionIndexEntry> seek_frame(uint32_t stream_id, uint32_t frame_timestamp) const;
+
+    // Bounds checked, std::nullopt unless a whole record starts at offset
+    std::optional<ReplayRecord> record_at(uint64_t offset) const;
+
+    /*
+        The frame an index entry points at, as a FrameSnapshot record. A frame
+        carried in a Bundle keeps the bundle's record header and offset, with
+        the payload narrowed down to the frame.
+    */
+    std::optional<ReplayRecord> frame_at(const SessionIndexEntry& index_entry) const;
+
+    ReplayCursor records() const;
+    ReplayFrameCursor frames(uint32_t stream_id, uint32_t from_timestamp = 0) const;
+
+    // Where the records end (the index starts there when there is one)
+    uint64_t records_end() const;
+    uint64_t file_size() const;
+
+private:
+    bool load_footer_index();
+    void rebuild_index();
+
+    const std::byte*                m_data;
+    uint64_t                        m_size;
+    uint64_t                        m_records_end;
+
+    SessionFileHeader               m_file_header;
+    std::vector<SessionIndexEntry>  m_index;
+    bool                            m_footer_index;
+
+#ifdef _WIN32
+    void*                           m_file_handle;
+    void*                           m_mapping_handle;
+#else
+    int                             m_fd;
+#endif
+};
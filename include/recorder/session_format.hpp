@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "../packet_template/header.hpp"
+
+/*
+    Session recording file (native byte order, like the wire header)
+
+    [SessionFileHeader]
+    [SessionRecordHeader][payload] ... (append only)
+    [SessionIndexEntry] ...
+    [SessionFileFooter]
+
+    Every record holds the logical packet: the full PacketHeader and the
+    payload as the serializers produced it, whatever compact header or
+    compression the wire used. Bundles are kept as a single Bundle record.
+
+    The index and footer are written when the recording stops. They list
+    every frame (each frame is a full keyframe) sorted by stream and
+    FrameSnapshot::timestamp, both FrameSnapshot records and the
+    FrameSnapshot entries of Bundle records. A file without them, e.g.
+    after a crash, is still readable, the reader rebuilds the index by
+    scanning.
+*/
+constexpr uint32_t SESSION_FILE_MAGIC = 0x52524842;     // "BHRR"
+constexpr uint32_t SESSION_INDEX_MAGIC = 0x49524842;    // "BHRI"
+constexpr uint32_t SESSION_FILE_VERSION = 2;
+
+struct SessionFileHeader {
+    uint32_t magic_number;
+    uint32_t version;
+    uint64_t start_time_ns;     // system_clock time the recording started at
+};
+
+constexpr size_t SESSION_FILE_HEADER_SIZE = 16;
+static_assert(sizeof(SessionFileHeader) == SESSION_FILE_HEADER_SIZE);
+
+enum class RecordDirection : uint8_t {
+    Sent,
+    Received
+};
+
+struct SessionRecordHeader {
+    uint64_t        timestamp_ns;   // steady_clock time since the recording started
+    uint32_t        stream_id;      // Chosen by whoever attached the recorder to the stream
+    RecordDirection direction;
+    uint8_t         reserved[3];
+    PacketHeader    header;         // header.payload_size bytes of payload follow
+};
+
+constexpr size_t SESSION_RECORD_HEADER_SIZE = 32;
+static_assert(sizeof(SessionRecordHeader) == SESSION_RECORD_HEADER_SIZE);
+static_assert(std::is_trivially_copyable_v<SessionRecordHeader>);
+
+struct SessionIndexEntry {
+    uint32_t stream_id;
+    uint32_t frame_timestamp;   // FrameSnapshot::timestamp
+    uint64_t offset;            // Of the record header in the file
+    uint32_t payload_offset;    // Of the frame in the record payload, past the entry header in a Bundle
+    uint32_t payload_size;      // Of the frame
+};
+
+constexpr size_t SESSION_INDEX_ENTRY_SIZE = 24;
+static_assert(sizeof(SessionIndexEntry) == SESSION_INDEX_ENTRY_SIZE);
+
+struct SessionFileFooter {
+    uint64_t index_offset;      // Also where the records end
+    uint64_t entry_count;
+    uint32_t magic_number;
+    uint32_t version;
+};
+
+constexpr size_t SESSION_FILE_FOOTER_SIZE = 24;
+static_assert(sizeof(SessionFileFooter) == SESSION_FILE_FOOTER_SIZE);
+
+// Order of the index entries
+inline bool session_index_less(const SessionIndexEntry& lhs, const SessionIndexEntry& rhs) {
+    if (lhs.stream_id != rhs.stream_id)
+    {
+        return lhs.stream_id < rhs.stream_id;
+    }
+
+    if (lhs.frame_timestamp != rhs.frame_timestamp)
+    {
+        return lhs.frame_timestamp < rhs.frame_timestamp;
+    }
+
+    return lhs.offset != rhs.offset ? lhs.offset < rhs.offset
+                                    : lhs.payload_offset < rhs.payload_offset;
+}
+
+/*
+    Appends an entry for every frame of the record at offset: the record itself
+    when it is a FrameSnapshot, each FrameSnapshot entry when it is a Bundle.
+    Frames too short to hold a timestamp and malformed bundles are skipped.
+*/
+void index_session_record(const SessionRecordHeader& record_header, uint64_t offset, const std::byte* payload,
+                          std::vector<SessionIndexEntry>& index);
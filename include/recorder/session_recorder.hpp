@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ring_queue/ring_queue_common.hpp"
+#include "session_format.hpp"
+
+// Bytes of records that may wait for the writer thread, recording drops packets beyond it
+constexpr size_t SESSION_RECORDER_RING_SIZE = 16 * 1024 * 1024;
+
+// Records take whole chunks of the ring, each chunk has a commit word
+constexpr size_t SESSION_RECORDER_CHUNK_SIZE = 64;
+
+// The writer thread writes once this much has been collected, or when it goes idle
+constexpr size_t SESSION_RECORDER_BATCH_SIZE = 1024 * 1024;
+
+struct SessionRecorderStats {
+    uint64_t recorded       = 0;    // Packets handed to the writer thread
+    uint64_t dropped        = 0;    // Packets lost to a full queue
+    uint64_t bytes_written  = 0;    // File size so far
+};
+
+/*
+    Appends the traffic of any number of streams to one recording file.
+
+    record() is called on the streams' hot paths: it reserves room in a
+    preallocated lock-free byte ring, copies the record there in its file
+    layout and commits it. A background thread turns the ring into large
+    sequential writes. Nothing is allocated per packet.
+
+        auto recorder = std::make_shared<SessionRecorder>();
+        recorder->start("match.bhr");
+        stream.set_recorder(recorder, client_id);
+*/
+class SessionRecorder {
+public:
+    explicit SessionRecorder(size_t ring_size = SESSION_RECORDER_RING_SIZE);
+    ~SessionRecorder();
+
+    // Delete copy constructor and copy assignment operator
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // Creates (truncates) the file, resets the stats and starts the writer thread
+    bool start(const std::string& file_path);
+
+    /*
+        Waits for the record() calls in progress, then writes everything
+        recorded and the frame index and closes the file. Nothing recorded
+        for this file can end up in the next one.
+    */
+    void stop();
+    bool is_running() const;
+
+    /*
+        Thread safe, never blocks, copies size bytes of payload. Returns false
+        when the packet was not recorded (the recorder is stopped or the ring is full).
+    */
+    bool record(uint32_t stream_id, RecordDirection direction, const PacketHeader& header,
+                const std::byte* payload, size_t size);
+
+    SessionRecorderStats stats() const;
+
+private:
+    void writer_loop();
+    size_t drain_ring();
+    void append_entry(const SessionRecordHeader& record_header, const std::byte* payload);
+    void write_batch();
+    void write_index();
+
+    /*
+        Byte ring (multi-producer / single-consumer). Producers claim whole
+        chunks with a CAS on m_tail, write the record and publish it through
+        the commit word of its first chunk. The writer thread walks m_head,
+        clears the commit words it has consumed and hands the chunks back.
+        A record never wraps, the chunks left before the end become padding.
+    */
+    const size_t                                m_ring_size;
+    std::unique_ptr<std::byte[]>                m_ring;
+    std::unique_ptr<std::atomic<uint32_t>[]>    m_commits;
+
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t>   m_head;
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t>   m_tail;
+
+    std::atomic<bool>       m_running;
+    std::atomic<uint32_t>   m_recording;    // record() calls in progress
+    std::atomic<bool>       m_writing;      // Cleared once no record() call can commit any more
+    std::thread             m_writer_thread;
+    uint64_t                m_start_ns;     // Published by m_running
+
+    // Writer thread only
+    std::ofstream           m_file;
+    std::vector<std::byte>  m_batch;
+    uint64_t                m_file_size;
+    std::vector<SessionIndexEntry> m_index;
+
+    std::atomic<uint64_t>   m_recorded;
+    std::atomic<uint64_t>   m_dropped;
+    std::atomic<uint64_t>   m_bytes_written;
+};
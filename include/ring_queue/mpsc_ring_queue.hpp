@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <new>
+#include <optional>
+#include <utility>
+#include <cstddef>
+#include "ring_queue_common.hpp"
+
+/*
+    Bounded multi-producer / single-consumer lock-free ring queue.
+
+    Every slot carries a sequence number (D. Vyukov's bounded queue): producers
+    claim a slot with a CAS on m_tail and publish it by bumping the slot
+    sequence, the single consumer walks m_head and only reads slots whose
+    sequence says they are published. Producers never touch m_head, and the
+    consumer never touches m_tail.
+
+    NOTE: Any number of threads may push, exactly one thread may pop at a time.
+*/
+template <typename T>
+class MpscRingQueue {
+public:
+    explicit MpscRingQueue(size_t capacity)
+        : m_capacity(ring_queue_round_up_capacity(capacity))
+        , m_mask(m_capacity - 1)
+        , m_slots(std::make_unique<Slot[]>(m_capacity))
+        , m_head(0)
+        , m_tail(0)
+    {
+        for (size_t i = 0; i < m_capacity; i++)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpscRingQueue() {
+        drain([](T&&) {});
+    }
+
+    // Delete copy/move, the slots are shared between threads
+    MpscRingQueue(const MpscRingQueue&) = delete;
+    MpscRingQueue& operator=(const MpscRingQueue&) = delete;
+
+    /*
+        Producer side
+    */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        while (true)
+        {
+            slot = &m_slots[tail & m_mask];
+
+            const auto sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(tail);
+
+            if (diff == 0)
+            {
+                // The slot is free, try to claim it
+                if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The consumer has not released this slot yet, the queue is full
+                return false;
+            }
+            else
+            {
+                // Another producer claimed the slot, reload and retry
+                tail = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (slot_ptr(*slot)) T(std::forward<Args>(args)...);
+        slot->sequence.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // The item is only moved from when the push succeeds
+    bool try_push(T&& item) {
+        return try_emplace(std::move(item));
+    }
+
+    bool try_push(const T& item) {
+        return try_emplace(item);
+    }
+
+    /*
+        Consumer side
+    */
+    std::optional<T> try_pop() {
+        std::optional<T> result;
+
+        drain([&result](T&& item) {
+            result.emplace(std::move(item));
+        }, 1);
+
+        return result;
+    }
+
+    /*
+        Batch drain: consumes published items in order until max_count is
+        reached or an unpublished slot is found, then publishes the new head once.
+    */
+    template <typename F>
+    size_t drain(F&& callback, size_t max_count = std::numeric_limits<size_t>::max()) {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        size_t count = 0;
+
+        while (count < max_count)
+        {
+            Slot& slot = m_slots[(head + count) & m_mask];
+
+            if (slot.sequence.load(std::memory_order_acquire) != head + count + 1)
+            {
+                break;
+            }
+
+            T* item = slot_ptr(slot);
+            callback(std::move(*item));
+            item->~T();
+
+            // Hand the slot back to the producers for the next lap
+            slot.sequence.store(head + count + m_capacity, std::memory_order_release);
+            count++;
+        }
+
+        if (count > 0)
+        {
+            m_head.store(head + count, std::memory_order_relaxed);
+        }
+
+        return count;
+    }
+
+    /*
+        Observers (approximate while producers are running)
+    */
+    bool empty() const {
+        const auto head = m_head.load(std::memory_order_relaxed);
+
+        return m_slots[head & m_mask].sequence.load(std::memory_order_acquire) != head + 1;
+    }
+
+    size_t size_approx() const {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto head = m_head.load(std::memory_order_relaxed);
+
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static T* slot_ptr(Slot& slot) {
+        return std::launder(reinterpret_cast<T*>(slot.storage));
+    }
+
+    const size_t                                    m_capacity;
+    const size_t                                    m_mask;
+    std::unique_ptr<Slot[]>                         m_slots;
+
+    // Consumer cache line
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+
+    // Producer cache line (contended by the producers only)
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+};
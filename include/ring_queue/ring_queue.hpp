@@ -0,0 +1,4 @@
+#pragma once
+
+#include "spsc_ring_queue.hpp"
+#include "mpsc_ring_queue.hpp"
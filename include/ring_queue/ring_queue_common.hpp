@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+    Shared constants for the bounded lock-free ring queues.
+    64 bytes is the cache line size of every x86-64 and most ARM64 targets,
+    we don't rely on std::hardware_destructive_interference_size since it is
+    not available (or warns) on every toolchain we build with.
+*/
+constexpr size_t RING_QUEUE_CACHE_LINE_SIZE = 64;
+
+// Rounds the capacity up so that indices can be wrapped with a mask
+constexpr size_t ring_queue_round_up_capacity(size_t capacity) {
+    size_t rounded = 2;
+
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    return rounded;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <new>
+#include <optional>
+#include <utility>
+#include <cstddef>
+#include "ring_queue_common.hpp"
+
+/*
+    Bounded single-producer / single-consumer lock-free ring queue.
+
+    The producer owns m_tail and the consumer owns m_head, each index lives on
+    its own cache line together with a cached copy of the other side's index,
+    so neither side touches the opposite cache line unless its cached view says
+    the queue is full (producer) or empty (consumer).
+
+    NOTE: Exactly one thread may push and exactly one thread may pop at a time.
+*/
+template <typename T>
+class SpscRingQueue {
+public:
+    explicit SpscRingQueue(size_t capacity)
+        : m_capacity(ring_queue_round_up_capacity(capacity))
+        , m_mask(m_capacity - 1)
+        , m_slots(std::make_unique<Slot[]>(m_capacity))
+        , m_head(0)
+        , m_cached_tail(0)
+        , m_tail(0)
+        , m_cached_head(0)
+    {}
+
+    ~SpscRingQueue() {
+        drain([](T&&) {});
+    }
+
+    // Delete copy/move, the indices are shared between two threads
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+
+    /*
+        Producer side
+    */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_cached_head == m_capacity)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+
+            if (tail - m_cached_head == m_capacity)
+            {
+                return false;
+            }
+        }
+
+        new (slot_ptr(tail)) T(std::forward<Args>(args)...);
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // The item is only moved from when the push succeeds
+    bool try_push(T&& item) {
+        return try_emplace(std::move(item));
+    }
+
+    bool try_push(const T& item) {
+        return try_emplace(item);
+    }
+
+    /*
+        Consumer side
+    */
+    std::optional<T> try_pop() {
+        const auto head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_cached_tail)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+            if (head == m_cached_tail)
+            {
+                return std::nullopt;
+            }
+        }
+
+        T* item = slot_ptr(head);
+        std::optional<T> result(std::move(*item));
+        item->~T();
+
+        m_head.store(head + 1, std::memory_order_release);
+
+        return result;
+    }
+
+    /*
+        Batch drain: hands up to max_count items to the callback and publishes
+        the new head once for the whole batch instead of once per item.
+    */
+    template <typename F>
+    size_t drain(F&& callback, size_t max_count = std::numeric_limits<size_t>::max()) {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+        size_t available = m_cached_tail - head;
+        size_t count = available < max_count ? available : max_count;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            T* item = slot_ptr(head + i);
+            callback(std::move(*item));
+            item->~T();
+        }
+
+        if (count > 0)
+        {
+            m_head.store(head + count, std::memory_order_release);
+        }
+
+        return count;
+    }
+
+    /*
+        Observers (approximate when called from a third thread)
+    */
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t size_approx() const {
+        const auto tail = m_tail.load(std::memory_order_acquire);
+        const auto head = m_head.load(std::memory_order_acquire);
+
+        return tail - head;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+private:
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    T* slot_ptr(size_t index) {
+        return std::launder(reinterpret_cast<T*>(m_slots[index & m_mask].storage));
+    }
+
+    const size_t                                    m_capacity;
+    const size_t                                    m_mask;
+    std::unique_ptr<Slot[]>                         m_slots;
+
+    // Consumer cache line
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+    size_t                                          m_cached_tail;
+
+    // Producer cache line
+    alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+    size_t                                          m_cached_head;
+};
@@ -55,8 +55,14 @@ public:
     void abort();
     void disconnect();
 
+    SOCKET native_handle() const;
+
     ssize_t send_data(const std::vector<std::byte>& data);
+    ssize_t send_data(const std::byte* data, size_t size);
     ssize_t recv_data(std::byte* buffer, size_t size);
+
+    // Returns SOCKET_RECV_TIMEOUT immediately instead of waiting when no data is available
+    ssize_t recv_data_nowait(std::byte* buffer, size_t size);
     std::optional<std::vector<std::byte>> recv_exact(size_t size);
 
 private:
@@ -83,8 +89,14 @@ public:
     void abort();
     void disconnect();
 
+    SOCKET native_handle() const;
+
     ssize_t send_data(const std::vector<std::byte>& data);
+    ssize_t send_data(const std::byte* data, size_t size);
     ssize_t recv_data(std::byte* buffer, size_t size);
+
+    // Returns SOCKET_RECV_TIMEOUT immediately instead of waiting when no data is available
+    ssize_t recv_data_nowait(std::byte* buffer, size_t size);
     std::optional<std::vector<std::byte>> recv_exact(size_t size);
     
 private:
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "../packet_template/frame.hpp"
+
+// No bullet, pads results that found fewer bullets than asked for
+constexpr uint32_t BULLET_GRID_NONE = std::numeric_limits<uint32_t>::max();
+
+struct BulletGridOptions {
+    // World area the cells cover, bullets outside it are kept in the border cells
+    float   origin_x    = 0.0f;
+    float   origin_y    = 0.0f;
+    float   width       = 480.0f;
+    float   height      = 640.0f;
+
+    float   cell_size   = 16.0f;
+};
+
+// Bullets around one circle, see BulletGrid::query_circle()
+struct CircleQueryResult {
+    uint32_t    hits        = 0;                    // Bullets overlapping the circle
+    uint32_t    grazes      = 0;                    // Bullets within graze_range of its edge but not overlapping
+    uint32_t    closest     = BULLET_GRID_NONE;     // Bullet with the smallest gap among those two
+    float       gap         = std::numeric_limits<float>::infinity();  // Its edge to edge distance, negative when overlapping
+};
+
+struct BulletHitPair {
+    uint32_t    target;     // Index of the circle (player, boss, ...) that was hit
+    uint32_t    bullet;     // Index into the bullet vector the grid was built from
+};
+
+struct BulletNeighbor {
+    uint32_t    bullet      = BULLET_GRID_NONE;
+    float       distance    = std::numeric_limits<float>::infinity();  // Center to center
+};
+
+/*
+    Uniform grid over the bullets of a frame, for collision and graze tests.
+
+    build() sorts the bullets by cell (a counting sort, O(n)) into
+    structure-of-arrays buffers that are reused from tick to tick, so a
+    rebuild allocates nothing once the grid has seen its largest frame.
+    The cells of a grid row are contiguous in that order, so a query
+    tests one run of bullets per row it covers, four at a time with SSE2
+    where available.
+
+        BulletGrid grid;
+        std::vector<CircleQueryResult> results;
+
+        grid.build(frame.bullet_vector);
+        grid.query_hitboxes(frame.player_vector, 16.0f, results);
+
+    Bullet indices in results refer to the vector given to build().
+*/
+class BulletGrid {
+public:
+    explicit BulletGrid(BulletGridOptions options = {});
+
+    const BulletGridOptions& options() const;
+
+    void build(const std::vector<BulletSnapshot>& bullets);
+
+    // Bullets in the last build()
+    size_t size() const;
+
+    // Counts the bullets overlapping the circle and those within graze_range of its edge
+    CircleQueryResult query_circle(float x, float y, float radius, float graze_range) const;
+
+    bool any_hit(float x, float y, float radius) const;
+
+    // Appends a { target, bullet } pair for every bullet overlapping the circle, returns how many
+    size_t collect_hits(float x, float y, float radius, uint32_t target, std::vector<BulletHitPair>& out) const;
+
+    // Writes up to k bullets within max_distance of (x, y) to out, closest first, returns how many
+    size_t nearest(float x, float y, size_t k, float max_distance, BulletNeighbor* out) const;
+
+    /*
+        Batch forms over anything with pos and radius (PlayerSnapshot, BossSnapshot, ...):
+        one result per entity, hit pairs for every entity, and k neighbors per entity
+        padded with BULLET_GRID_NONE
+    */
+    template <typename Entity>
+    void query_hitboxes(const std::vector<Entity>& entities, float graze_range, std::vector<CircleQueryResult>& results) const {
+        results.resize(entities.size());
+
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            results[i] = query_circle(entities[i].pos.x, entities[i].pos.y, entities[i].radius, graze_range);
+        }
+    }
+
+    template <typename Entity>
+    size_t collect_hits(const std::vector<Entity>& entities, std::vector<BulletHitPair>& out) const {
+        size_t count = 0;
+
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            count += collect_hits(entities[i].pos.x, entities[i].pos.y, entities[i].radius, static_cast<uint32_t>(i), out);
+        }
+
+        return count;
+    }
+
+    template <typename Entity>
+    void nearest(const std::vector<Entity>& entities, size_t k, float max_distance, std::vector<BulletNeighbor>& out) const {
+        out.assign(entities.size() * k, BulletNeighbor {});
+
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            nearest(entities[i].pos.x, entities[i].pos.y, k, max_distance, out.data() + i * k);
+        }
+    }
+
+private:
+    int cell_column(float x) const;
+    int cell_row(float y) const;
+
+    // Calls span(begin, end) with the sorted bullet range of every grid row the box covers
+    template <typename SpanFunction>
+    void for_each_span(float x0, float y0, float x1, float y1, SpanFunction&& span) const;
+
+    BulletGridOptions       m_options;
+    int                     m_columns;
+    int                     m_rows;
+    float                   m_inverse_cell_size;
+    float                   m_max_radius;
+
+    // Bullets sorted by cell
+    std::vector<float>      m_x;
+    std::vector<float>      m_y;
+    std::vector<float>      m_radius;
+    std::vector<uint32_t>   m_index;
+
+    // Bullets of cell c are [m_cell_start[c], m_cell_start[c + 1]), cells are row-major
+    std::vector<uint32_t>   m_cell_start;
+
+    // Build scratch
+    std::vector<uint32_t>   m_bullet_cell;
+    std::vector<uint32_t>   m_cursor;
+};
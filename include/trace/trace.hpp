@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+/*
+    Scoped trace zones for timeline profiling
+
+        TRACE_ZONE("process_buffer", "receive");
+        TRACE_UNIQUE_LOCK(lock, m_bundle_mutex, "bundle lock");
+
+        trace_start();
+        ...
+        trace_stop();
+        trace_write_chrome_json("trace.json");     // chrome://tracing or ui.perfetto.dev
+
+    - SHARED_TRACING=0 compiles every macro out
+    - Otherwise a zone costs one relaxed load until trace_start(), then
+      two clock reads and a store into the calling thread's own buffer
+    - A full thread buffer drops its newer events, see trace_dropped_events()
+    - TRACE_FLOW_BEGIN/TRACE_FLOW_END with the same id draw an arrow between
+      the zones they are in, e.g. a packet handed from the receive thread to
+      the thread that polls it
+*/
+#ifndef SHARED_TRACING
+    #define SHARED_TRACING 1
+#endif
+
+// Events each thread can hold per session
+constexpr size_t TRACE_DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+struct TraceSite {
+    const char* name;
+    const char* category;
+};
+
+enum class TraceEventType : uint8_t {
+    Zone,
+    Instant,
+    FlowBegin,
+    FlowEnd
+};
+
+struct TraceEvent {
+    const TraceSite*    site;
+    uint64_t            start_ns;
+    uint64_t            duration_ns;    // Zone only
+    uint64_t            id;             // Flows only
+    TraceEventType      type;
+};
+
+// Starts a session, the events of the previous one are discarded
+void trace_start(size_t events_per_thread = TRACE_DEFAULT_EVENTS_PER_THREAD);
+
+// Stops recording, the events are kept for export
+void trace_stop();
+
+// Names the calling thread's track in the timeline
+void trace_set_thread_name(const std::string& name);
+
+// Events lost to full thread buffers this session
+uint64_t trace_dropped_events();
+
+// Chrome trace-event JSON of the current session
+std::string trace_export_chrome_json();
+bool trace_write_chrome_json(const std::string& path);
+
+/*
+    Internal
+*/
+extern std::atomic<bool> trace_recording;
+
+void trace_record(const TraceSite& site, TraceEventType type, uint64_t start_ns, uint64_t duration_ns, uint64_t id);
+
+inline bool trace_enabled() {
+    return trace_recording.load(std::memory_order_relaxed);
+}
+
+inline uint64_t trace_now_ns() {
+    using namespace std::chrono;
+
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+class TraceZone {
+public:
+    explicit TraceZone(const TraceSite& site)
+        : m_site(site)
+        , m_start(trace_enabled() ? trace_now_ns() : 0)
+    {}
+
+    ~TraceZone() {
+        if (m_start != 0)
+        {
+            trace_record(m_site, TraceEventType::Zone, m_start, trace_now_ns() - m_start, 0);
+        }
+    }
+
+    // Delete copy constructor and copy assignment operator
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const TraceSite&    m_site;
+    uint64_t            m_start;
+};
+
+inline void trace_mark(const TraceSite& site, TraceEventType type, uint64_t id) {
+    if (trace_enabled())
+    {
+        trace_record(site, type, trace_now_ns(), 0, id);
+    }
+}
+
+// Flow id of the index-th item an owner (a queue, a stream) hands over
+inline uint64_t trace_flow_id(const void* owner, uint64_t index) {
+    return (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(owner)) * 0x9E3779B97F4A7C15ull) ^ index;
+}
+
+// Time spent waiting for the mutex shows up as a zone named site
+template <typename Mutex>
+std::unique_lock<Mutex> trace_lock(const TraceSite& site, Mutex& mutex) {
+    TraceZone zone(site);
+
+    return std::unique_lock<Mutex>(mutex);
+}
+
+#define SHARED_TRACE_CONCAT_INNER(a, b) a##b
+#define SHARED_TRACE_CONCAT(a, b)       SHARED_TRACE_CONCAT_INNER(a, b)
+#define SHARED_TRACE_SITE               SHARED_TRACE_CONCAT(shared_trace_site_, __LINE__)
+
+#if SHARED_TRACING
+    #define TRACE_ZONE(name, category)                                                          \
+        static constexpr TraceSite SHARED_TRACE_SITE { name, category };                        \
+        TraceZone SHARED_TRACE_CONCAT(shared_trace_zone_, __LINE__)(SHARED_TRACE_SITE)
+
+    #define TRACE_MARK(name, category, type, id)                                                \
+        do {                                                                                    \
+            static constexpr TraceSite shared_trace_site_ { name, category };                   \
+            trace_mark(shared_trace_site_, type, id);                                           \
+        } while (0)
+
+    #define TRACE_UNIQUE_LOCK(variable, mutex, name)                                            \
+        static constexpr TraceSite SHARED_TRACE_SITE { name, "lock" };                          \
+        auto variable = trace_lock(SHARED_TRACE_SITE, mutex)
+#else
+    #define TRACE_ZONE(name, category)              do {} while (0)
+    #define TRACE_MARK(name, category, type, id)    do {} while (0)
+    #define TRACE_UNIQUE_LOCK(variable, mutex, name) \
+        std::unique_lock<std::remove_reference_t<decltype(mutex)>> variable(mutex)
+#endif
+
+#define TRACE_INSTANT(name, category)           TRACE_MARK(name, category, TraceEventType::Instant, 0)
+#define TRACE_FLOW_BEGIN(name, category, id)    TRACE_MARK(name, category, TraceEventType::FlowBegin, id)
+#define TRACE_FLOW_END(name, category, id)      TRACE_MARK(name, category, TraceEventType::FlowEnd, id)
@@ -0,0 +1,661 @@
+#include <algorithm>
+#include <agent_gateway/agent_gateway.hpp>
+#include <logger/log_macros.hpp>
+#include <packet_serializer/frame_serializer.hpp>
+#include <packet_serializer/input_serializer.hpp>
+#include <packet_stream/packet_stream.hpp>
+#include <trace/trace.hpp>
+
+namespace {
+    // How often connect() looks at the pending handshakes
+    constexpr auto HANDSHAKE_POLL_INTERVAL = std::chrono::milliseconds(1);
+
+    uint64_t now_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Handshake progress, owned by the thread calling connect()
+    enum class SessionState : uint8_t {
+        Idle,
+        AwaitAccept,
+        AwaitGameResponse,
+        Playing,
+        Failed
+    };
+
+    // What the receive side saw, written by the event loop worker
+    enum class Response : uint8_t {
+        None,
+        Accepted,
+        Rejected
+    };
+}
+
+/*
+    One agent session. The receive side only writes the response fields and,
+    under state_mutex, incoming and the flags next to it, plus decoded which
+    only the receive side uses; current belongs to whichever step thread owns
+    the session's shard.
+*/
+struct AgentGateway::Session {
+    uint32_t                            index               = 0;
+    SessionState                        state               = SessionState::Idle;
+
+    std::shared_ptr<ClientSocket>       socket;
+    std::unique_ptr<PacketStreamClient> stream;
+
+    uint32_t                            client_id           = 0;
+    uint32_t                            session_id          = 0;
+
+    std::atomic<Response>               response            { Response::None };
+    std::atomic<uint32_t>               response_value      { 0 };
+
+    std::mutex                          state_mutex;
+    FrameSnapshot                       incoming            = {};       // Latest frame received
+    bool                                has_incoming        = false;    // incoming has not been gathered yet
+    bool                                closed              = false;
+    bool                                live                = false;    // Counted in m_live_sessions
+
+    FrameSnapshot                       current             = {};       // Frame of the session's batch row
+    FrameSnapshot                       decoded             = {};       // Receive side's decode target
+};
+
+AgentGateway::AgentGateway(AgentGatewayOptions options)
+    : m_options(std::move(options))
+    , m_observation_size(0)
+    , m_step_generation(0)
+    , m_step_remaining(0)
+    , m_step_task(StepTask::Scatter)
+    , m_step_stopping(false)
+    , m_step_actions(nullptr)
+    , m_pending_frames(0)
+    , m_live_sessions(0)
+    , m_steps(0)
+    , m_actions_sent(0)
+    , m_send_failures(0)
+    , m_frames_received(0)
+    , m_stale_observations(0)
+    , m_first_step_ns(0)
+    , m_last_step_ns(0)
+    , m_total_step_ns(0)
+    , m_connected(false)
+{
+    const auto session_count = m_options.session_count;
+    const auto shard_count = std::clamp<size_t>(m_options.step_threads, 1, std::max<size_t>(session_count, 1));
+
+    m_builders.assign(shard_count, ObservationBuilder(m_options.observation));
+    m_shard_fresh.assign(shard_count, 0);
+    m_observation_size = m_builders.front().observation_size();
+
+    m_observations.assign(session_count * m_observation_size, 0.0f);
+    m_scores.assign(session_count, 0);
+    m_timestamps.assign(session_count, 0);
+    m_fresh.assign(session_count, 0);
+    m_alive.assign(session_count, 0);
+
+    for (size_t i = 0; i < session_count; i++)
+    {
+        m_sessions.push_back(std::make_unique<Session>());
+        m_sessions.back()->index = static_cast<uint32_t>(i);
+    }
+}
+
+AgentGateway::~AgentGateway() {
+    close();
+}
+
+size_t AgentGateway::connect() {
+    if (m_connected)
+    {
+        return m_live_sessions.load();
+    }
+
+    m_loop = std::make_unique<IoEventLoop>(std::max<size_t>(1, m_options.io_workers));
+    m_loop->start();
+
+    for (size_t shard = 1; shard < m_builders.size(); shard++)
+    {
+        m_step_workers.emplace_back(&AgentGateway::step_worker, this, shard);
+    }
+
+    m_connected = true;
+
+    /* Connect and say hello */
+    for (auto& session_ptr : m_sessions)
+    {
+        auto& session = *session_ptr;
+        auto* target = &session;
+
+        session.socket = std::make_shared<ClientSocket>(m_options.server_address, m_options.server_port);
+
+        if (!session.socket->connect_to_server())
+        {
+            LOG_WARNING("[AgentGateway] Session {} failed to connect", session.index);
+
+            session.socket.reset();
+            session.state = SessionState::Failed;
+
+            continue;
+        }
+
+        session.stream = std::make_unique<PacketStreamClient>(session.socket);
+
+        session.stream->on<ServerAccept>([target](const PacketHeader&, const ServerAccept& accept) {
+            target->response_value.store(accept.assigned_client_id, std::memory_order_relaxed);
+            target->response.store(Response::Accepted, std::memory_order_release);
+        });
+
+        session.stream->on<ServerGameResponse>([target](const PacketHeader&, const ServerGameResponse& response) {
+            target->response_value.store(response.session_id, std::memory_order_relaxed);
+            target->response.store(response.accepted == Accepted::Accepted ? Response::Accepted : Response::Rejected,
+                                   std::memory_order_release);
+        });
+
+        // The server ends the game, the session is done just as if the connection had closed
+        session.stream->on<ServerGoodbye>([this, target](const PacketHeader&, const ServerGoodbye&) {
+            on_session_closed(*target);
+        });
+
+        // Never asked for, kept out of the stream's packet queue which nothing polls
+        session.stream->on<ServerReconnectResponse>([](const PacketHeader&, const ServerReconnectResponse&) {});
+
+        /*
+            Decoded into the session's own frame and swapped with incoming, the three
+            frames keep their capacity so steady traffic does not allocate here
+        */
+        session.stream->on_payload(PayloadType::FrameSnapshot, [this, target](const PacketHeader&, const std::vector<std::byte>& bytes) {
+            if (!deserialize_frame_into(bytes, target->decoded))
+            {
+                return false;
+            }
+
+            bool was_pending = false;
+
+            {
+                std::lock_guard<std::mutex> lock(target->state_mutex);
+
+                std::swap(target->incoming, target->decoded);
+                was_pending = target->has_incoming;
+                target->has_incoming = true;
+            }
+
+            m_frames_received.fetch_add(1, std::memory_order_relaxed);
+
+            if (!was_pending)
+            {
+                on_frame_pending();
+            }
+
+            return true;
+        });
+
+        session.stream->set_receive_callback([this, target](StreamEvent event) {
+            if (event == StreamEvent::Closed)
+            {
+                on_session_closed(*target);
+            }
+        });
+
+        session.stream->start(*m_loop);
+
+        ClientHello hello = {};
+        const auto name = "agent-" + std::to_string(session.index);
+
+        hello.client_name_size = static_cast<uint32_t>(std::min<size_t>(name.size(), MAX_CLIENT_NAME_SIZE));
+        std::copy_n(name.data(), hello.client_name_size, hello.client_name);
+
+        session.response.store(Response::None, std::memory_order_relaxed);
+        session.state = session.stream->send_packet(make_packet(hello)) ? SessionState::AwaitAccept : SessionState::Failed;
+    }
+
+    /* Play the handshakes until every session is in a game or has failed */
+    const auto deadline = std::chrono::steady_clock::now() + m_options.connect_timeout;
+
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        size_t pending = 0;
+
+        for (auto& session_ptr : m_sessions)
+        {
+            auto& session = *session_ptr;
+
+            if (session.state != SessionState::AwaitAccept && session.state != SessionState::AwaitGameResponse)
+            {
+                continue;
+            }
+
+            const auto response = session.response.load(std::memory_order_acquire);
+            bool closed = false;
+
+            {
+                std::lock_guard<std::mutex> lock(session.state_mutex);
+                closed = session.closed;
+            }
+
+            if (response == Response::Rejected || (response == Response::None && closed))
+            {
+                session.state = SessionState::Failed;
+                continue;
+            }
+
+            if (response == Response::None)
+            {
+                pending++;
+                continue;
+            }
+
+            if (session.state == SessionState::AwaitAccept)
+            {
+                session.client_id = session.response_value.load(std::memory_order_relaxed);
+                session.response.store(Response::None, std::memory_order_relaxed);
+
+                const ClientGameRequest request { GameMode::Agent, m_options.variant, m_options.difficulty, 0 };
+
+                session.state = session.stream->send_packet(make_packet(request)) ? SessionState::AwaitGameResponse : SessionState::Failed;
+                pending += session.state == SessionState::AwaitGameResponse ? 1 : 0;
+
+                continue;
+            }
+
+            session.session_id = session.response_value.load(std::memory_order_relaxed);
+            session.state = SessionState::Failed;
+
+            std::lock_guard<std::mutex> lock(session.state_mutex);
+
+            if (!session.closed)
+            {
+                session.state = SessionState::Playing;
+                session.live = true;
+                m_live_sessions.fetch_add(1);
+            }
+        }
+
+        if (pending == 0)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(HANDSHAKE_POLL_INTERVAL);
+    }
+
+    /* Sessions without a game are dropped */
+    for (auto& session_ptr : m_sessions)
+    {
+        auto& session = *session_ptr;
+
+        if (session.state != SessionState::Playing)
+        {
+            session.state = SessionState::Failed;
+
+            if (session.stream)
+            {
+                session.stream->stop();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(session.state_mutex);
+        m_alive[session.index] = session.live ? 1 : 0;
+    }
+
+    const auto live = m_live_sessions.load();
+
+    LOG_INFO("[AgentGateway] {} of {} sessions are in a game, {} IO workers, {} step threads",
+             live, m_sessions.size(), m_loop->worker_count(), m_builders.size());
+
+    return live;
+}
+
+void AgentGateway::close() {
+    if (!m_connected)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_step_mutex);
+        m_step_stopping = true;
+    }
+
+    m_step_cv.notify_all();
+
+    for (auto& worker : m_step_workers)
+    {
+        worker.join();
+    }
+
+    m_step_workers.clear();
+    m_step_stopping = false;
+
+    for (auto& session_ptr : m_sessions)
+    {
+        auto& session = *session_ptr;
+
+        if (!session.stream)
+        {
+            continue;
+        }
+
+        if (session.state == SessionState::Playing)
+        {
+            session.stream->send_packet(make_packet(ClientGoodbye { GoodByeReasonCode::NormalExit }));
+        }
+
+        session.stream->stop();
+        session.stream.reset();
+        session.socket.reset();
+        session.state = SessionState::Idle;
+
+        std::lock_guard<std::mutex> lock(session.state_mutex);
+
+        session.has_incoming = false;
+        session.closed = false;
+        session.live = false;
+    }
+
+    m_loop->stop();
+    m_loop.reset();
+
+    m_pending_frames.store(0);
+    m_live_sessions.store(0);
+    std::fill(m_alive.begin(), m_alive.end(), 0);
+
+    m_connected = false;
+}
+
+size_t AgentGateway::session_count() const {
+    return m_sessions.size();
+}
+
+size_t AgentGateway::observation_size() const {
+    return m_observation_size;
+}
+
+size_t AgentGateway::step(const uint32_t* actions) {
+    TRACE_ZONE("agent step", "agent");
+
+    const auto start = now_ns();
+    uint64_t unset = 0;
+
+    m_first_step_ns.compare_exchange_strong(unset, start, std::memory_order_relaxed);
+
+    send_actions(actions);
+
+    if (m_options.frame_timeout.count() > 0)
+    {
+        wait_frames(m_options.frame_timeout);
+    }
+
+    const auto fresh_count = gather();
+    const auto end = now_ns();
+
+    m_total_step_ns.fetch_add(end - start, std::memory_order_relaxed);
+    m_last_step_ns.store(end, std::memory_order_relaxed);
+    m_steps.fetch_add(1, std::memory_order_relaxed);
+
+    return fresh_count;
+}
+
+void AgentGateway::send_actions(const uint32_t* actions) {
+    TRACE_ZONE("send_actions", "agent");
+
+    m_step_actions = actions;
+    run_step_task(StepTask::Scatter);
+    m_step_actions = nullptr;
+}
+
+bool AgentGateway::wait_frames(std::chrono::milliseconds timeout) {
+    TRACE_ZONE("wait_frames", "agent");
+
+    std::unique_lock<std::mutex> lock(m_frame_wait_mutex);
+
+    return m_frame_wait_cv.wait_for(lock, timeout, [this]() {
+        return m_pending_frames.load() >= m_live_sessions.load();
+    });
+}
+
+size_t AgentGateway::gather() {
+    TRACE_ZONE("gather", "agent");
+
+    run_step_task(StepTask::Gather);
+
+    size_t fresh_count = 0;
+
+    for (const auto count : m_shard_fresh)
+    {
+        fresh_count += count;
+    }
+
+    return fresh_count;
+}
+
+const float* AgentGateway::observations() const {
+    return m_observations.data();
+}
+
+const uint32_t* AgentGateway::scores() const {
+    return m_scores.data();
+}
+
+const uint32_t* AgentGateway::timestamps() const {
+    return m_timestamps.data();
+}
+
+const uint8_t* AgentGateway::fresh() const {
+    return m_fresh.data();
+}
+
+const uint8_t* AgentGateway::alive() const {
+    return m_alive.data();
+}
+
+AgentGatewayStats AgentGateway::stats() const {
+    AgentGatewayStats stats;
+
+    stats.steps                 = m_steps.load(std::memory_order_relaxed);
+    stats.actions_sent          = m_actions_sent.load(std::memory_order_relaxed);
+    stats.send_failures         = m_send_failures.load(std::memory_order_relaxed);
+    stats.frames_received       = m_frames_received.load(std::memory_order_relaxed);
+    stats.stale_observations    = m_stale_observations.load(std::memory_order_relaxed);
+    stats.live_sessions         = m_live_sessions.load(std::memory_order_relaxed);
+
+    const auto first = m_first_step_ns.load(std::memory_order_relaxed);
+    const auto last = m_last_step_ns.load(std::memory_order_relaxed);
+
+    if (stats.steps > 0 && last > first)
+    {
+        stats.steps_per_second = static_cast<double>(stats.steps) * 1e9 / static_cast<double>(last - first);
+        stats.mean_step_ns = static_cast<double>(m_total_step_ns.load(std::memory_order_relaxed)) / static_cast<double>(stats.steps);
+    }
+
+    return stats;
+}
+
+const AgentGatewayOptions& AgentGateway::options() const {
+    return m_options;
+}
+
+void AgentGateway::run_step_task(StepTask task) {
+    if (!m_step_workers.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_step_mutex);
+
+            m_step_task = task;
+            m_step_remaining = m_step_workers.size();
+            m_step_generation++;
+        }
+
+        m_step_cv.notify_all();
+    }
+
+    run_shard(task, 0);
+
+    if (!m_step_workers.empty())
+    {
+        std::unique_lock<std::mutex> lock(m_step_mutex);
+
+        m_step_done_cv.wait(lock, [this]() {
+            return m_step_remaining == 0;
+        });
+    }
+}
+
+void AgentGateway::run_shard(StepTask task, size_t shard) {
+    const auto shard_count = m_builders.size();
+    const auto begin = m_sessions.size() * shard / shard_count;
+    const auto end = m_sessions.size() * (shard + 1) / shard_count;
+
+    if (task == StepTask::Scatter)
+    {
+        uint64_t sent = 0;
+        uint64_t failed = 0;
+
+        for (auto i = begin; i < end; i++)
+        {
+            auto& session = *m_sessions[i];
+
+            if (!m_alive[i])
+            {
+                continue;
+            }
+
+            ClientInput input = {};
+
+            input.client_id = session.client_id;
+            input.frame_timestamp = m_timestamps[i];
+            input.game_input = unpack_game_input(m_step_actions[i]);
+
+            if (session.stream->send_input(input))
+            {
+                sent++;
+            }
+            else
+            {
+                failed++;
+            }
+        }
+
+        m_actions_sent.fetch_add(sent, std::memory_order_relaxed);
+        m_send_failures.fetch_add(failed, std::memory_order_relaxed);
+
+        return;
+    }
+
+    auto& builder = m_builders[shard];
+    size_t fresh_count = 0;
+    uint64_t stale = 0;
+
+    for (auto i = begin; i < end; i++)
+    {
+        auto& session = *m_sessions[i];
+        bool fresh = false;
+        bool live = false;
+
+        {
+            std::lock_guard<std::mutex> lock(session.state_mutex);
+
+            if (session.has_incoming)
+            {
+                std::swap(session.incoming, session.current);
+                session.has_incoming = false;
+                fresh = true;
+            }
+
+            live = session.live;
+        }
+
+        if (fresh)
+        {
+            m_pending_frames.fetch_sub(1);
+
+            // Rows without a new frame keep the observation of the last one
+            builder.build(session.current, m_observations.data() + i * m_observation_size);
+
+            m_scores[i] = session.current.score;
+            m_timestamps[i] = session.current.timestamp;
+            fresh_count++;
+        }
+        else if (live)
+        {
+            stale++;
+        }
+
+        m_fresh[i] = fresh ? 1 : 0;
+        m_alive[i] = live ? 1 : 0;
+    }
+
+    m_shard_fresh[shard] = fresh_count;
+    m_stale_observations.fetch_add(stale, std::memory_order_relaxed);
+}
+
+void AgentGateway::step_worker(size_t shard) {
+    trace_set_thread_name("AgentGateway step " + std::to_string(shard));
+
+    uint64_t seen_generation = 0;
+
+    while (true)
+    {
+        StepTask task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_step_mutex);
+
+            m_step_cv.wait(lock, [&]() {
+                return m_step_stopping || m_step_generation != seen_generation;
+            });
+
+            if (m_step_stopping)
+            {
+                return;
+            }
+
+            seen_generation = m_step_generation;
+            task = m_step_task;
+        }
+
+        run_shard(task, shard);
+
+        std::lock_guard<std::mutex> lock(m_step_mutex);
+
+        if (--m_step_remaining == 0)
+        {
+            m_step_done_cv.notify_one();
+        }
+    }
+}
+
+void AgentGateway::on_frame_pending() {
+    if (m_pending_frames.fetch_add(1) + 1 >= m_live_sessions.load())
+    {
+        // Taking the lock orders the update before a waiter's predicate check
+        {
+            std::lock_guard<std::mutex> lock(m_frame_wait_mutex);
+        }
+
+        m_frame_wait_cv.notify_all();
+    }
+}
+
+void AgentGateway::on_session_closed(Session& session) {
+    {
+        std::lock_guard<std::mutex> lock(session.state_mutex);
+
+        session.closed = true;
+
+        if (!session.live)
+        {
+            return;
+        }
+
+        session.live = false;
+        m_live_sessions.fetch_sub(1);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_frame_wait_mutex);
+    }
+
+    m_frame_wait_cv.notify_all();
+}
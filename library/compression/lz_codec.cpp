@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <compression/lz_codec.hpp>
+
+namespace {
+    constexpr size_t HASH_TABLE_SIZE = size_t(1) << LZ_HASH_BITS;
+
+    // Bytes at the end of the input that are always emitted as literals
+    constexpr size_t LAST_LITERALS = 5;
+
+    // Length of the byte runs the trainer counts
+    constexpr size_t TRAIN_SEGMENT_SIZE = 16;
+    constexpr size_t TRAIN_STRIDE = 4;
+
+    uint32_t read_u32(const std::byte* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+
+        return value;
+    }
+
+    uint32_t hash_u32(uint32_t value) {
+        return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+    }
+
+    uint32_t fnv1a(const std::byte* data, size_t size) {
+        uint32_t hash = 2166136261u;
+
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= std::to_integer<uint8_t>(data[i]);
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    void write_length(std::vector<std::byte>& out, size_t length) {
+        while (length >= 255)
+        {
+            out.push_back(std::byte{ 255 });
+            length -= 255;
+        }
+
+        out.push_back(static_cast<std::byte>(length));
+    }
+
+    bool read_length(const std::byte*& ip, const std::byte* end, size_t& length) {
+        uint8_t byte = 0;
+
+        do
+        {
+            if (ip >= end)
+            {
+                return false;
+            }
+
+            byte = std::to_integer<uint8_t>(*ip++);
+            length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+    void write_sequence(std::vector<std::byte>& out, const std::byte* literals, size_t literal_length,
+                        size_t offset, size_t match_length) {
+        const auto literal_nibble = std::min<size_t>(literal_length, 15);
+        const auto match_nibble = match_length > 0 ? std::min<size_t>(match_length - LZ_MIN_MATCH, 15) : 0;
+
+        out.push_back(static_cast<std::byte>((literal_nibble << 4) | match_nibble));
+
+        if (literal_nibble == 15)
+        {
+            write_length(out, literal_length - 15);
+        }
+
+        out.insert(out.end(), literals, literals + literal_length);
+
+        if (match_length == 0)
+        {
+            return;
+        }
+
+        out.push_back(static_cast<std::byte>(offset & 0xFF));
+        out.push_back(static_cast<std::byte>(offset >> 8));
+
+        if (match_nibble == 15)
+        {
+            write_length(out, match_length - LZ_MIN_MATCH - 15);
+        }
+    }
+}
+
+/*
+    Dictionary
+*/
+LzDictionary::LzDictionary()
+    : m_id(0)
+{}
+
+LzDictionary::LzDictionary(std::vector<std::byte> content)
+    : m_content(std::move(content))
+    , m_id(0)
+{
+    if (m_content.size() > LZ_MAX_DICTIONARY_SIZE)
+    {
+        m_content.erase(m_content.begin(), m_content.end() - LZ_MAX_DICTIONARY_SIZE);
+    }
+
+    if (m_content.empty())
+    {
+        return;
+    }
+
+    m_id = std::max<uint32_t>(fnv1a(m_content.data(), m_content.size()), 1);
+    m_hash_table.assign(HASH_TABLE_SIZE, -1);
+
+    for (size_t pos = 0; pos + LZ_MIN_MATCH <= m_content.size(); pos++)
+    {
+        m_hash_table[hash_u32(read_u32(m_content.data() + pos))] = static_cast<int32_t>(pos);
+    }
+}
+
+const std::vector<std::byte>& LzDictionary::content() const {
+    return m_content;
+}
+
+uint32_t LzDictionary::id() const {
+    return m_id;
+}
+
+bool LzDictionary::empty() const {
+    return m_content.empty();
+}
+
+const std::vector<int32_t>& LzDictionary::hash_table() const {
+    return m_hash_table;
+}
+
+/*
+    Trainer
+*/
+LzDictionary train_lz_dictionary(const std::vector<std::vector<std::byte>>& samples, size_t max_size) {
+    struct Segment {
+        uint32_t    sample_count = 0;
+        size_t      last_sample = SIZE_MAX;
+        size_t      sample = 0;
+        size_t      offset = 0;
+    };
+
+    max_size = std::min(max_size, LZ_MAX_DICTIONARY_SIZE);
+
+    // Count in how many samples every segment appears
+    std::unordered_map<uint32_t, Segment> segments;
+
+    for (size_t s = 0; s < samples.size(); s++)
+    {
+        const auto& sample = samples[s];
+
+        for (size_t offset = 0; offset + TRAIN_SEGMENT_SIZE <= sample.size(); offset += TRAIN_STRIDE)
+        {
+            auto& segment = segments[fnv1a(sample.data() + offset, TRAIN_SEGMENT_SIZE)];
+
+            if (segment.last_sample == s)
+            {
+                continue;
+            }
+
+            if (segment.sample_count == 0)
+            {
+                segment.sample = s;
+                segment.offset = offset;
+            }
+
+            segment.sample_count++;
+            segment.last_sample = s;
+        }
+    }
+
+    std::vector<const Segment*> ranked;
+
+    ranked.reserve(segments.size());
+
+    for (const auto& [hash, segment] : segments)
+    {
+        if (segment.sample_count > 1)
+        {
+            ranked.push_back(&segment);
+        }
+    }
+
+    std::sort(ranked.begin(), ranked.end(), [](const Segment* lhs, const Segment* rhs) {
+        if (lhs->sample_count != rhs->sample_count)
+        {
+            return lhs->sample_count > rhs->sample_count;
+        }
+
+        return lhs->sample != rhs->sample ? lhs->sample < rhs->sample : lhs->offset < rhs->offset;
+    });
+
+    // Segments taken from overlapping places of a sample would only repeat each other
+    std::vector<std::vector<bool>> covered(samples.size());
+    std::vector<const Segment*> chosen;
+    size_t total_size = 0;
+
+    for (const auto* segment : ranked)
+    {
+        if (total_size + TRAIN_SEGMENT_SIZE > max_size)
+        {
+            break;
+        }
+
+        auto& sample_covered = covered[segment->sample];
+
+        if (sample_covered.empty())
+        {
+            sample_covered.assign(samples[segment->sample].size(), false);
+        }
+
+        const auto first = sample_covered.begin() + segment->offset;
+        const auto last = first + TRAIN_SEGMENT_SIZE;
+
+        if (std::find(first, last, true) != last)
+        {
+            continue;
+        }
+
+        std::fill(first, last, true);
+        chosen.push_back(segment);
+        total_size += TRAIN_SEGMENT_SIZE;
+    }
+
+    // The most common segments go last so that they get the shortest offsets
+    std::vector<std::byte> content;
+
+    content.reserve(total_size);
+
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+    {
+        const auto* data = samples[(*it)->sample].data() + (*it)->offset;
+
+        content.insert(content.end(), data, data + TRAIN_SEGMENT_SIZE);
+    }
+
+    return LzDictionary(std::move(content));
+}
+
+/*
+    Compressor
+*/
+std::vector<std::byte> lz_compress(const std::byte* data, size_t size, const LzDictionary& dictionary) {
+    std::vector<std::byte> out;
+
+    out.reserve(lz_compress_bound(size));
+
+    if (size < LZ_MIN_MATCH + LAST_LITERALS)
+    {
+        write_sequence(out, data, size, 0, 0);
+
+        return out;
+    }
+
+    // The dictionary is laid out right before the input so offsets can reach into it
+    thread_local std::vector<std::byte> window;
+    thread_local std::vector<int32_t> table;
+
+    const auto& dictionary_content = dictionary.content();
+    const auto base = dictionary_content.size();
+
+    window.resize(base + size);
+    std::memcpy(window.data() + base, data, size);
+
+    if (dictionary.empty())
+    {
+        table.assign(HASH_TABLE_SIZE, -1);
+    }
+    else
+    {
+        std::memcpy(window.data(), dictionary_content.data(), base);
+        table = dictionary.hash_table();
+    }
+
+    const auto* w = window.data();
+    const auto end = base + size;
+    const auto match_limit = end - LAST_LITERALS;
+
+    size_t anchor = base;
+    size_t ip = base;
+
+    while (ip + LZ_MIN_MATCH <= match_limit)
+    {
+        const auto sequence = read_u32(w + ip);
+        const auto h = hash_u32(sequence);
+        const auto candidate = table[h];
+
+        table[h] = static_cast<int32_t>(ip);
+
+        if (candidate < 0 ||
+            ip - static_cast<size_t>(candidate) > LZ_MAX_OFFSET ||
+            read_u32(w + candidate) != sequence)
+        {
+            // Skip faster through data that does not compress
+            ip += 1 + ((ip - anchor) >> 6);
+
+            continue;
+        }
+
+        auto match = static_cast<size_t>(candidate);
+
+        // Extend backwards into the pending literals
+        while (ip > anchor && match > 0 && w[ip - 1] == w[match - 1])
+        {
+            ip--;
+            match--;
+        }
+
+        auto length = LZ_MIN_MATCH;
+
+        while (ip + length < match_limit && w[match + length] == w[ip + length])
+        {
+            length++;
+        }
+
+        write_sequence(out, w + anchor, ip - anchor, ip - match, length);
+
+        ip += length;
+        anchor = ip;
+
+        // Keep the table warm for the bytes the match skipped over
+        if (ip - 2 + LZ_MIN_MATCH <= end)
+        {
+            table[hash_u32(read_u32(w + ip - 2))] = static_cast<int32_t>(ip - 2);
+        }
+    }
+
+    write_sequence(out, w + anchor, end - anchor, 0, 0);
+
+    return out;
+}
+
+/*
+    Decompressor
+*/
+std::optional<std::vector<std::byte>> lz_decompress(const std::byte* data, size_t size, size_t decompressed_size,
+                                                    const LzDictionary& dictionary) {
+    const auto& dictionary_content = dictionary.content();
+
+    // Checked before allocating, a forged size must not cost more memory than the block can fill
+    if (decompressed_size > lz_decompress_bound(size, dictionary_content.size()))
+    {
+        return std::nullopt;
+    }
+
+    std::vector<std::byte> out(decompressed_size);
+
+    const auto* ip = data;
+    const auto* const end = data + size;
+    size_t op = 0;
+
+    while (ip < end)
+    {
+        const auto token = std::to_integer<uint8_t>(*ip++);
+
+        size_t literal_length = token >> 4;
+
+        if (literal_length == 15 && !read_length(ip, end, literal_length))
+        {
+            return std::nullopt;
+        }
+
+        if (literal_length > static_cast<size_t>(end - ip) || literal_length > decompressed_size - op)
+        {
+            return std::nullopt;
+        }
+
+        std::memcpy(out.data() + op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        // The last sequence has no match
+        if (ip == end)
+        {
+            break;
+        }
+
+        if (end - ip < 2)
+        {
+            return std::nullopt;
+        }
+
+        const size_t offset = std::to_integer<size_t>(ip[0]) | (std::to_integer<size_t>(ip[1]) << 8);
+        ip += 2;
+
+        size_t match_length = (token & 0x0F);
+
+        if (match_length == 15 && !read_length(ip, end, match_length))
+        {
+            return std::nullopt;
+        }
+
+        match_length += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > op + dictionary_content.size() || match_length > decompressed_size - op)
+        {
+            return std::nullopt;
+        }
+
+        // Part of the match that still lies in the dictionary
+        if (offset > op)
+        {
+            const auto from = dictionary_content.size() - (offset - op);
+            const auto count = std::min(match_length, offset - op);
+
+            std::memcpy(out.data() + op, dictionary_content.data() + from, count);
+            op += count;
+            match_length -= count;
+        }
+
+        // The whole match came from the dictionary, offset may still point before out
+        if (match_length == 0)
+        {
+            continue;
+        }
+
+        // Overlapping matches repeat the last 'offset' bytes, offset <= op from here on
+        auto* dst = out.data() + op;
+        const auto* src = dst - offset;
+
+        if (offset >= match_length)
+        {
+            std::memcpy(dst, src, match_length);
+        }
+        else
+        {
+            for (size_t i = 0; i < match_length; i++)
+            {
+                dst[i] = src[i];
+            }
+        }
+
+        op += match_length;
+    }
+
+    if (op != decompressed_size)
+    {
+        return std::nullopt;
+    }
+
+    return out;
+}
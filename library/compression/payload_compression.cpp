@@ -0,0 +1,97 @@
+#include <cstring>
+#include <compression/payload_compression.hpp>
+
+namespace {
+    const LzDictionary& dictionary_of(const CompressionOptions& options) {
+        static const LzDictionary empty_dictionary;
+
+        return options.dictionary ? *options.dictionary : empty_dictionary;
+    }
+}
+
+uint32_t compression_dictionary_id(const CompressionOptions& options) {
+    return dictionary_of(options).id();
+}
+
+std::optional<std::vector<std::byte>> compress_payload(const std::vector<std::byte>& payload,
+                                                       const CompressionOptions& options) {
+    if (!options.enabled || payload.size() < options.threshold || payload.size() > MAX_DECOMPRESSED_PAYLOAD_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    const auto& dictionary = dictionary_of(options);
+    const auto block = lz_compress(payload.data(), payload.size(), dictionary);
+
+    std::vector<std::byte> buffer;
+
+    buffer.reserve(5 + sizeof(uint32_t) + block.size());
+
+    auto size = static_cast<uint32_t>(payload.size());
+
+    while (size >= 0x80)
+    {
+        buffer.push_back(static_cast<std::byte>((size & 0x7F) | 0x80));
+        size >>= 7;
+    }
+
+    buffer.push_back(static_cast<std::byte>(size));
+
+    const auto dictionary_id = dictionary.id();
+    const auto id_offset = buffer.size();
+
+    buffer.resize(id_offset + sizeof(dictionary_id));
+    std::memcpy(buffer.data() + id_offset, &dictionary_id, sizeof(dictionary_id));
+
+    if (buffer.size() + block.size() >= payload.size())
+    {
+        return std::nullopt;
+    }
+
+    buffer.insert(buffer.end(), block.begin(), block.end());
+
+    return buffer;
+}
+
+std::optional<std::vector<std::byte>> decompress_payload(const std::vector<std::byte>& payload,
+                                                         const CompressionOptions& options) {
+    size_t offset = 0;
+    uint64_t decompressed_size = 0;
+
+    for (uint32_t shift = 0; ; shift += 7)
+    {
+        if (offset >= payload.size() || shift > 28)
+        {
+            return std::nullopt;
+        }
+
+        const auto byte = std::to_integer<uint8_t>(payload[offset++]);
+
+        decompressed_size |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+
+    uint32_t dictionary_id = 0;
+
+    if (decompressed_size > MAX_DECOMPRESSED_PAYLOAD_SIZE || payload.size() - offset < sizeof(dictionary_id))
+    {
+        return std::nullopt;
+    }
+
+    std::memcpy(&dictionary_id, payload.data() + offset, sizeof(dictionary_id));
+    offset += sizeof(dictionary_id);
+
+    const auto& dictionary = dictionary_of(options);
+
+    if (dictionary_id != dictionary.id())
+    {
+        return std::nullopt;
+    }
+
+    return lz_decompress(payload.data() + offset, payload.size() - offset,
+                         static_cast<size_t>(decompressed_size), dictionary);
+}
@@ -0,0 +1,412 @@
+#include <logger/log_macros.hpp>
+#include <event_loop/io_event_loop.hpp>
+#include <trace/trace.hpp>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <poll.h>
+#endif
+
+namespace {
+    // Only used when the wakeup channel could not be created
+    constexpr int POLL_TIMEOUT_MS = 10;
+
+#ifdef _WIN32
+    using PollFd = WSAPOLLFD;
+
+    int poll_sockets(PollFd* fds, size_t count, int timeout_ms) {
+        return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+    }
+
+    /*
+        WSAPoll() only takes sockets, so the wakeup channel is a UDP socket
+        connected to itself: both ends are the same handle
+    */
+    bool open_wakeup(SOCKET& read_end, SOCKET& write_end) {
+        WinsockManager::initialize();
+
+        SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        if (sock == INVALID_SOCKET)
+        {
+            return false;
+        }
+
+        sockaddr_in addr = {};
+        int addr_size = sizeof(addr);
+        u_long nonblocking = 1;
+
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+
+        const auto opened = bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0
+                         && getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &addr_size) == 0
+                         && connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0
+                         && ioctlsocket(sock, FIONBIO, &nonblocking) == 0;
+
+        if (!opened)
+        {
+            closesocket(sock);
+
+            return false;
+        }
+
+        read_end = sock;
+        write_end = sock;
+
+        return true;
+    }
+
+    void signal_wakeup(SOCKET write_end) {
+        const char byte = 0;
+
+        send(write_end, &byte, 1, 0);
+    }
+
+    void drain_wakeup(SOCKET read_end) {
+        char buffer[64];
+
+        while (recv(read_end, buffer, sizeof(buffer), 0) > 0) {}
+    }
+
+    void close_wakeup(SOCKET read_end, SOCKET) {
+        closesocket(read_end);
+    }
+#else
+    using PollFd = pollfd;
+
+    int poll_sockets(PollFd* fds, size_t count, int timeout_ms) {
+        return poll(fds, static_cast<nfds_t>(count), timeout_ms);
+    }
+
+    // Self-pipe, both ends non-blocking so a full pipe never stalls a waker
+    bool open_wakeup(SOCKET& read_end, SOCKET& write_end) {
+        int ends[2];
+
+        if (pipe(ends) != 0)
+        {
+            return false;
+        }
+
+        for (const auto end : ends)
+        {
+            fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+            fcntl(end, F_SETFD, FD_CLOEXEC);
+        }
+
+        read_end = ends[0];
+        write_end = ends[1];
+
+        return true;
+    }
+
+    void signal_wakeup(SOCKET write_end) {
+        const char byte = 0;
+
+        [[maybe_unused]] const auto written = write(write_end, &byte, 1);
+    }
+
+    void drain_wakeup(SOCKET read_end) {
+        char buffer[64];
+
+        while (read(read_end, buffer, sizeof(buffer)) > 0) {}
+    }
+
+    void close_wakeup(SOCKET read_end, SOCKET write_end) {
+        close(read_end);
+        close(write_end);
+    }
+#endif
+}
+
+IoEventLoop::IoEventLoop(size_t worker_count)
+    : m_worker_count(worker_count > 0 ? worker_count : 1)
+    , m_running(false)
+    , m_next_reader_id(1)
+    , m_wakeup_read(INVALID_SOCKET)
+    , m_wakeup_write(INVALID_SOCKET)
+    , m_wakeup_pending(false)
+{}
+
+IoEventLoop::~IoEventLoop() {
+    stop();
+}
+
+void IoEventLoop::start() {
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+
+    if (!open_wakeup(m_wakeup_read, m_wakeup_write))
+    {
+        LOG_ERROR("[IoEventLoop] Failed to create the wakeup channel, falling back to {} ms polling", POLL_TIMEOUT_MS);
+
+        m_wakeup_read = INVALID_SOCKET;
+        m_wakeup_write = INVALID_SOCKET;
+    }
+
+    m_wakeup_pending = false;
+
+    auto [sender, receiver] = channel<Task>();
+
+    m_task_sender.emplace(std::move(sender));
+    m_task_receiver.emplace(std::move(receiver));
+
+    for (size_t i = 0; i < m_worker_count; i++)
+    {
+        m_worker_threads.emplace_back([this, i]() {
+            trace_set_thread_name("IoEventLoop worker " + std::to_string(i));
+            worker_loop();
+        });
+    }
+
+    m_poll_thread = std::thread([this]() {
+        trace_set_thread_name("IoEventLoop poll");
+        poll_loop();
+    });
+}
+
+void IoEventLoop::stop() {
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+
+    wake_poller();
+
+    if (m_poll_thread.joinable())
+    {
+        m_poll_thread.join();
+    }
+
+    // Closing the channel lets the workers finish the queued tasks and exit
+    m_task_sender->close();
+
+    for (auto& worker : m_worker_threads)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    m_worker_threads.clear();
+
+    // Workers re-arm sockets until they have exited
+    if (m_wakeup_read != INVALID_SOCKET)
+    {
+        close_wakeup(m_wakeup_read, m_wakeup_write);
+
+        m_wakeup_read = INVALID_SOCKET;
+        m_wakeup_write = INVALID_SOCKET;
+    }
+}
+
+bool IoEventLoop::is_running() const {
+    return m_running;
+}
+
+uint64_t IoEventLoop::add_reader(SOCKET sock, ReadableCallback on_readable) {
+    uint64_t reader_id = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_reader_mutex);
+
+        reader_id = m_next_reader_id++;
+
+        m_readers.emplace(reader_id, Reader {
+            sock,
+            std::move(on_readable),
+            false
+        });
+    }
+
+    wake_poller();
+
+    return reader_id;
+}
+
+void IoEventLoop::remove_reader(uint64_t reader_id) {
+    std::unique_lock<std::mutex> lock(m_reader_mutex);
+
+    m_reader_cv.wait(lock, [this, reader_id] {
+        const auto it = m_readers.find(reader_id);
+
+        return it == m_readers.end() || !it->second.in_flight;
+    });
+
+    m_readers.erase(reader_id);
+}
+
+bool IoEventLoop::post(Task task) {
+    if (!m_running || !m_task_sender)
+    {
+        return false;
+    }
+
+    return m_task_sender->send(std::move(task));
+}
+
+size_t IoEventLoop::worker_count() const {
+    return m_worker_count;
+}
+
+// Makes the poller rebuild its descriptor set, a write is skipped while one is already pending
+void IoEventLoop::wake_poller() {
+    if (m_wakeup_write != INVALID_SOCKET && !m_wakeup_pending.exchange(true))
+    {
+        signal_wakeup(m_wakeup_write);
+    }
+}
+
+void IoEventLoop::poll_loop() {
+    std::vector<PollFd>     fds;
+    std::vector<uint64_t>   ids;
+
+    const auto has_wakeup = m_wakeup_read != INVALID_SOCKET;
+
+    // Without the wakeup channel new and re-armed sockets are only noticed on the next timeout
+    const auto timeout_ms = has_wakeup ? -1 : POLL_TIMEOUT_MS;
+
+    while (m_running)
+    {
+        fds.clear();
+        ids.clear();
+
+        if (has_wakeup)
+        {
+            PollFd fd = {};
+            fd.fd       = m_wakeup_read;
+            fd.events   = POLLIN;
+
+            fds.push_back(fd);
+            ids.push_back(0);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_reader_mutex);
+
+            for (const auto& [reader_id, reader] : m_readers)
+            {
+                if (reader.in_flight)
+                {
+                    continue;
+                }
+
+                PollFd fd = {};
+                fd.fd       = reader.sock;
+                fd.events   = POLLIN;
+
+                fds.push_back(fd);
+                ids.push_back(reader_id);
+            }
+        }
+
+        if (fds.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_TIMEOUT_MS));
+
+            continue;
+        }
+
+        const auto ready = poll_sockets(fds.data(), fds.size(), timeout_ms);
+
+        if (ready < 0)
+        {
+            LOG_ERROR("[IoEventLoop] poll failed");
+
+            continue;
+        }
+
+        if (has_wakeup && fds[0].revents != 0)
+        {
+            // Cleared first, a wake_poller() racing with the drain leaves its byte for the next poll
+            m_wakeup_pending = false;
+            drain_wakeup(m_wakeup_read);
+        }
+
+        for (size_t i = 0; i < fds.size() && ready > 0; i++)
+        {
+            // Hang-ups and errors are reported to the callback as a readable socket (recv returns 0 or -1)
+            if (fds[i].revents == 0 || ids[i] == 0)
+            {
+                continue;
+            }
+
+            const auto reader_id = ids[i];
+            std::pair<const uint64_t, Reader>* entry = nullptr;
+
+            {
+                std::lock_guard<std::mutex> lock(m_reader_mutex);
+
+                auto it = m_readers.find(reader_id);
+
+                if (it == m_readers.end())
+                {
+                    continue;
+                }
+
+                it->second.in_flight = true;
+                entry = &*it;
+            }
+
+            /*
+                The entry stays valid, remove_reader() waits for in_flight to clear.
+                Bypass post() so that a concurrent stop() can't drop the task and
+                leave the reader in flight forever. Two pointers fit the inline
+                storage of std::function, so the task does not allocate.
+            */
+            m_task_sender->send([this, entry]() {
+                const auto keep = entry->second.on_readable();
+
+                finish_callback(entry->first, keep);
+            });
+        }
+    }
+}
+
+void IoEventLoop::worker_loop() {
+    while (auto task = m_task_receiver->recv())
+    {
+        TRACE_ZONE("task", "event_loop");
+
+        try
+        {
+            (*task)();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("[IoEventLoop] Task threw an exception: {}", e.what());
+        }
+    }
+}
+
+void IoEventLoop::finish_callback(uint64_t reader_id, bool keep) {
+    {
+        std::lock_guard<std::mutex> lock(m_reader_mutex);
+
+        auto it = m_readers.find(reader_id);
+
+        if (it != m_readers.end())
+        {
+            if (keep)
+            {
+                it->second.in_flight = false;
+            }
+            else
+            {
+                m_readers.erase(it);
+            }
+        }
+    }
+
+    m_reader_cv.notify_all();
+
+    // The socket goes back into the poll set right away
+    if (keep)
+    {
+        wake_poller();
+    }
+}
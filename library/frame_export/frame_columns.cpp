@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <frame_export/frame_columns.hpp>
+#include <frame_export/npy_writer.hpp>
+#include <recorder/replay_reader.hpp>
+#include "frame_entities.hpp"
+
+namespace {
+    // One column: a field read at offset from every entity
+    struct FieldColumn {
+        const char* name;
+        size_t      offset;
+        size_t      size;
+        char        kind;   // NumPy kind, 'u' or 'f'
+    };
+
+    template <typename Field>
+    constexpr char column_kind() {
+        if constexpr (std::is_enum_v<Field>)
+        {
+            return column_kind<std::underlying_type_t<Field>>();
+        }
+        else
+        {
+            return std::is_floating_point_v<Field> ? 'f' : (std::is_signed_v<Field> ? 'i' : 'u');
+        }
+    }
+
+    #define FIELD_COLUMN(type, member, name)                                \
+        FieldColumn {                                                       \
+            name,                                                           \
+            offsetof(type, member),                                         \
+            sizeof(decltype(std::declval<type>().member)),                  \
+            column_kind<decltype(std::declval<type>().member)>()            \
+        }
+
+    // The scalar part of a FrameSnapshot, laid out so it can be read like an entity
+    struct FrameRow {
+        uint32_t        client_id;
+        uint32_t        opponent_id;
+        uint32_t        timestamp;
+        uint32_t        score;
+        GameMode        mode;
+        GameVariant     variant;
+        GameDifficulty  difficulty;
+        GameState       state;
+        StageSnapshot   stage;
+    };
+
+    const std::vector<FieldColumn> FRAME_COLUMNS = {
+        FIELD_COLUMN(FrameRow, client_id,           "client_id"),
+        FIELD_COLUMN(FrameRow, opponent_id,         "opponent_id"),
+        FIELD_COLUMN(FrameRow, timestamp,           "timestamp"),
+        FIELD_COLUMN(FrameRow, score,               "score"),
+        FIELD_COLUMN(FrameRow, mode,                "mode"),
+        FIELD_COLUMN(FrameRow, variant,             "variant"),
+        FIELD_COLUMN(FrameRow, difficulty,          "difficulty"),
+        FIELD_COLUMN(FrameRow, state,               "state"),
+        FIELD_COLUMN(FrameRow, stage.id,            "stage_id"),
+        FIELD_COLUMN(FrameRow, stage.name,          "stage_name"),
+        FIELD_COLUMN(FrameRow, stage.state,         "stage_state"),
+        FIELD_COLUMN(FrameRow, stage.next_stage,    "stage_next_stage"),
+        FIELD_COLUMN(FrameRow, stage.timestamp,     "stage_timestamp")
+    };
+
+    const std::vector<FieldColumn> PLAYER_COLUMNS = {
+        FIELD_COLUMN(PlayerSnapshot, id,                "id"),
+        FIELD_COLUMN(PlayerSnapshot, name,              "name"),
+        FIELD_COLUMN(PlayerSnapshot, state,             "state"),
+        FIELD_COLUMN(PlayerSnapshot, attack_pattern,    "attack_pattern"),
+        FIELD_COLUMN(PlayerSnapshot, pos.x,             "pos_x"),
+        FIELD_COLUMN(PlayerSnapshot, pos.y,             "pos_y"),
+        FIELD_COLUMN(PlayerSnapshot, vel.x,             "vel_x"),
+        FIELD_COLUMN(PlayerSnapshot, vel.y,             "vel_y"),
+        FIELD_COLUMN(PlayerSnapshot, radius,            "radius"),
+        FIELD_COLUMN(PlayerSnapshot, angle,             "angle"),
+        FIELD_COLUMN(PlayerSnapshot, current_spell,     "current_spell"),
+        FIELD_COLUMN(PlayerSnapshot, lives,             "lives"),
+        FIELD_COLUMN(PlayerSnapshot, bombs,             "bombs"),
+        FIELD_COLUMN(PlayerSnapshot, power,             "power")
+    };
+
+    const std::vector<FieldColumn> ENEMY_COLUMNS = {
+        FIELD_COLUMN(EnemySnapshot, id,                 "id"),
+        FIELD_COLUMN(EnemySnapshot, name,               "name"),
+        FIELD_COLUMN(EnemySnapshot, state,              "state"),
+        FIELD_COLUMN(EnemySnapshot, attack_pattern,     "attack_pattern"),
+        FIELD_COLUMN(EnemySnapshot, pos.x,              "pos_x"),
+        FIELD_COLUMN(EnemySnapshot, pos.y,              "pos_y"),
+        FIELD_COLUMN(EnemySnapshot, vel.x,              "vel_x"),
+        FIELD_COLUMN(EnemySnapshot, vel.y,              "vel_y"),
+        FIELD_COLUMN(EnemySnapshot, radius,             "radius"),
+        FIELD_COLUMN(EnemySnapshot, angle,              "angle"),
+        FIELD_COLUMN(EnemySnapshot, health,             "health")
+    };
+
+    const std::vector<FieldColumn> BOSS_COLUMNS = {
+        FIELD_COLUMN(BossSnapshot, id,                  "id"),
+        FIELD_COLUMN(BossSnapshot, name,                "name"),
+        FIELD_COLUMN(BossSnapshot, state,               "state"),
+        FIELD_COLUMN(BossSnapshot, attack_pattern,      "attack_pattern"),
+        FIELD_COLUMN(BossSnapshot, pos.x,               "pos_x"),
+        FIELD_COLUMN(BossSnapshot, pos.y,               "pos_y"),
+        FIELD_COLUMN(BossSnapshot, vel.x,               "vel_x"),
+        FIELD_COLUMN(BossSnapshot, vel.y,               "vel_y"),
+        FIELD_COLUMN(BossSnapshot, radius,              "radius"),
+        FIELD_COLUMN(BossSnapshot, angle,               "angle"),
+        FIELD_COLUMN(BossSnapshot, health,              "health"),
+        FIELD_COLUMN(BossSnapshot, current_spell,       "current_spell"),
+        FIELD_COLUMN(BossSnapshot, phase,               "phase")
+    };
+
+    const std::vector<FieldColumn> BULLET_COLUMNS = {
+        FIELD_COLUMN(BulletSnapshot, id,                "id"),
+        FIELD_COLUMN(BulletSnapshot, name,              "name"),
+        FIELD_COLUMN(BulletSnapshot, state,             "state"),
+        FIELD_COLUMN(BulletSnapshot, flight_pattern,    "flight_pattern"),
+        FIELD_COLUMN(BulletSnapshot, owner,             "owner"),
+        FIELD_COLUMN(BulletSnapshot, pos.x,             "pos_x"),
+        FIELD_COLUMN(BulletSnapshot, pos.y,             "pos_y"),
+        FIELD_COLUMN(BulletSnapshot, vel.x,             "vel_x"),
+        FIELD_COLUMN(BulletSnapshot, vel.y,             "vel_y"),
+        FIELD_COLUMN(BulletSnapshot, radius,            "radius"),
+        FIELD_COLUMN(BulletSnapshot, angle,             "angle"),
+        FIELD_COLUMN(BulletSnapshot, damage,            "damage")
+    };
+
+    const std::vector<FieldColumn> ITEM_COLUMNS = {
+        FIELD_COLUMN(ItemSnapshot, id,                  "id"),
+        FIELD_COLUMN(ItemSnapshot, name,                "name"),
+        FIELD_COLUMN(ItemSnapshot, state,               "state"),
+        FIELD_COLUMN(ItemSnapshot, flight_pattern,      "flight_pattern"),
+        FIELD_COLUMN(ItemSnapshot, pos.x,               "pos_x"),
+        FIELD_COLUMN(ItemSnapshot, pos.y,               "pos_y"),
+        FIELD_COLUMN(ItemSnapshot, vel.x,               "vel_x"),
+        FIELD_COLUMN(ItemSnapshot, vel.y,               "vel_y"),
+        FIELD_COLUMN(ItemSnapshot, radius,              "radius"),
+        FIELD_COLUMN(ItemSnapshot, angle,               "angle"),
+        FIELD_COLUMN(ItemSnapshot, score,               "score")
+    };
+
+    #undef FIELD_COLUMN
+
+    // Copies one field of count entities, stride bytes apart, into the column
+    void gather(const std::byte* entities, size_t stride, size_t count, const FieldColumn& field, NpyWriter& writer) {
+        auto out = writer.prepare(count);
+        auto in = entities + field.offset;
+
+        switch (field.size)
+        {
+            case 1:
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    out[i] = in[i * stride];
+                }
+
+                break;
+            }
+            case 4:
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::memcpy(out + i * 4, in + i * stride, 4);
+                }
+
+                break;
+            }
+            default:
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::memcpy(out + i * field.size, in + i * stride, field.size);
+                }
+
+                break;
+            }
+        }
+
+        writer.commit(count);
+    }
+
+    /*
+        The columns of one entity kind and, for everything but the frame
+        row itself, the frames.<kind>_offsets column locating them
+    */
+    class ColumnSet {
+    public:
+        ColumnSet(const char* prefix, const char* offsets_name, const std::vector<FieldColumn>& fields)
+            : m_prefix(prefix)
+            , m_offsets_name(offsets_name)
+            , m_fields(fields)
+            , m_rows(0)
+        {
+            for (size_t i = 0; i < fields.size(); i++)
+            {
+                m_writers.push_back(std::make_unique<NpyWriter>());
+            }
+        }
+
+        bool open(const std::filesystem::path& directory) {
+            m_rows = 0;
+
+            for (size_t i = 0; i < m_fields.size(); i++)
+            {
+                const auto path = directory / (std::string(m_prefix) + "." + m_fields[i].name + ".npy");
+
+                if (!m_writers[i]->open(path.string(), npy_descr(m_fields[i].kind, m_fields[i].size), m_fields[i].size))
+                {
+                    return false;
+                }
+            }
+
+            if (m_offsets_name != nullptr)
+            {
+                const auto path = directory / (std::string("frames.") + m_offsets_name + ".npy");
+
+                if (!m_offsets.open(path.string(), npy_descr<uint64_t>(), sizeof(uint64_t)))
+                {
+                    return false;
+                }
+
+                m_offsets.append(&m_rows, 1);
+            }
+
+            return true;
+        }
+
+        bool close() {
+            auto closed = true;
+
+            for (auto& writer : m_writers)
+            {
+                closed = writer->close() && closed;
+            }
+
+            if (m_offsets_name != nullptr)
+            {
+                closed = m_offsets.close() && closed;
+            }
+
+            return closed;
+        }
+
+        template <typename Entity>
+        void write(const Entity* entities, size_t count) {
+            static_assert(std::is_standard_layout_v<Entity>, "Columns are read by offset");
+
+            const auto bytes = reinterpret_cast<const std::byte*>(entities);
+
+            for (size_t i = 0; i < m_fields.size(); i++)
+            {
+                gather(bytes, sizeof(Entity), count, m_fields[i], *m_writers[i]);
+            }
+
+            m_rows += count;
+
+            if (m_offsets_name != nullptr)
+            {
+                m_offsets.append(&m_rows, 1);
+            }
+        }
+
+    private:
+        const char*                                 m_prefix;
+        const char*                                 m_offsets_name;
+        const std::vector<FieldColumn>&             m_fields;
+        std::vector<std::unique_ptr<NpyWriter>>     m_writers;
+        NpyWriter                                   m_offsets;
+        uint64_t                                    m_rows;
+    };
+}
+
+struct FrameColumnWriter::Columns {
+    ColumnSet frames    { "frames",     nullptr,            FRAME_COLUMNS   };
+    ColumnSet players   { "players",    "player_offsets",   PLAYER_COLUMNS  };
+    ColumnSet enemies   { "enemies",    "enemy_offsets",    ENEMY_COLUMNS   };
+    ColumnSet bosses    { "bosses",     "boss_offsets",     BOSS_COLUMNS    };
+    ColumnSet bullets   { "bullets",    "bullet_offsets",   BULLET_COLUMNS  };
+    ColumnSet items     { "items",      "item_offsets",     ITEM_COLUMNS    };
+
+    template <typename Function>
+    bool for_each(Function&& function) {
+        auto result = true;
+
+        for (auto set : { &frames, &players, &enemies, &bosses, &bullets, &items })
+        {
+            result = function(*set) && result;
+        }
+
+        return result;
+    }
+};
+
+FrameColumnWriter::FrameColumnWriter()
+    : m_frames_written(0)
+{}
+
+FrameColumnWriter::~FrameColumnWriter() {
+    close();
+}
+
+bool FrameColumnWriter::open(const std::string& directory) {
+    close();
+
+    std::error_code error;
+
+    std::filesystem::create_directories(directory, error);
+
+    if (error)
+    {
+        return false;
+    }
+
+    m_columns = std::make_unique<Columns>();
+    m_frames_written = 0;
+
+    const auto opened = m_columns->for_each([&directory](ColumnSet& set) {
+        return set.open(directory);
+    });
+
+    if (!opened)
+    {
+        close();
+    }
+
+    return opened;
+}
+
+bool FrameColumnWriter::close() {
+    if (!m_columns)
+    {
+        return false;
+    }
+
+    const auto closed = m_columns->for_each([](ColumnSet& set) {
+        return set.close();
+    });
+
+    m_columns.reset();
+
+    return closed;
+}
+
+bool FrameColumnWriter::is_open() const {
+    return m_columns != nullptr;
+}
+
+void FrameColumnWriter::write(const FrameSnapshot& frame) {
+    if (!m_columns)
+    {
+        return;
+    }
+
+    const FrameRow row = {
+        frame.client_id,
+        frame.opponent_id,
+        frame.timestamp,
+        frame.score,
+        frame.mode,
+        frame.variant,
+        frame.difficulty,
+        frame.state,
+        frame.stage
+    };
+
+    m_columns->frames.write(&row, 1);
+    m_columns->players.write(frame.player_vector.data(), entity_count(frame.player_count, frame.player_vector));
+    m_columns->enemies.write(frame.enemy_vector.data(), entity_count(frame.enemy_count, frame.enemy_vector));
+    m_columns->bosses.write(frame.boss_vector.data(), entity_count(frame.boss_count, frame.boss_vector));
+    m_columns->bullets.write(frame.bullet_vector.data(), entity_count(frame.bullet_count, frame.bullet_vector));
+    m_columns->items.write(frame.item_vector.data(), entity_count(frame.item_count, frame.item_vector));
+
+    m_frames_written++;
+}
+
+uint64_t FrameColumnWriter::frames_written() const {
+    return m_frames_written;
+}
+
+/*
+    Recordings
+*/
+FrameColumnExportResult export_recording_columns(const FrameColumnExportJob& job) {
+    FrameColumnExportResult result;
+    ReplayReader reader;
+
+    if (!reader.open(job.recording_path))
+    {
+        result.error = "failed to open " + job.recording_path;
+        return result;
+    }
+
+    // Bundled frames are indexed too, the cursor hands them out as FrameSnapshot records
+    const auto& index = reader.index();
+
+    // The index is sorted by stream, so every stream is one run of entries
+    for (size_t first = 0; first < index.size(); )
+    {
+        const auto stream_id = index[first].stream_id;
+        auto last = first;
+
+        while (last < index.size() && index[last].stream_id == stream_id)
+        {
+            last++;
+        }
+
+        const auto directory = (std::filesystem::path(job.output_directory) / ("stream_" + std::to_string(stream_id))).string();
+
+        FrameColumnWriter writer;
+
+        if (!writer.open(directory))
+        {
+            result.error = "failed to create the columns in " + directory;
+            return result;
+        }
+
+        ReplayFrameCursor cursor(reader, first, last);
+
+        while (auto record = cursor.next())
+        {
+            const auto frame = record->frame();
+
+            if (!frame.has_value())
+            {
+                result.skipped_frames++;
+                continue;
+            }
+
+            writer.write(frame.value());
+        }
+
+        result.frames += writer.frames_written();
+
+        if (!writer.close())
+        {
+            result.error = "failed to write the columns in " + directory;
+            return result;
+        }
+
+        result.streams++;
+        first = last;
+    }
+
+    result.succeeded = true;
+
+    return result;
+}
+
+std::vector<FrameColumnExportResult> export_recordings_columns(const std::vector<FrameColumnExportJob>& jobs, size_t thread_count) {
+    std::vector<FrameColumnExportResult> results(jobs.size());
+    std::atomic<size_t> next_job{0};
+
+    auto worker = [&]() {
+        for (auto i = next_job.fetch_add(1); i < jobs.size(); i = next_job.fetch_add(1))
+        {
+            results[i] = export_recording_columns(jobs[i]);
+        }
+    };
+
+    const auto workers = std::clamp<size_t>(thread_count, 1, std::max<size_t>(jobs.size(), 1));
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < workers; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    return results;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+    Shared by the frame exporters, not part of the public headers
+*/
+
+// An entity may be counted but missing from its vector in a hand-made frame
+template <typename T>
+size_t entity_count(uint32_t count, const std::vector<T>& entities) {
+    return std::min<size_t>(count, entities.size());
+}
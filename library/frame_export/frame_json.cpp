@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <frame_export/frame_json.hpp>
+#include "frame_entities.hpp"
+
+namespace {
+    // Longest to_chars output of a uint32_t or a float, with room to spare
+    constexpr size_t MAX_NUMBER_CHARS = 24;
+
+    // Upper bounds of the frame/stage objects and of one entity object, keys included
+    constexpr size_t FIXED_JSON_SIZE = 1024;
+    constexpr size_t ENTITY_JSON_SIZE = 512;
+
+    /*
+        Writes into a buffer the caller has sized for the whole frame,
+        so no call checks for room
+    */
+    class JsonCursor {
+    public:
+        explicit JsonCursor(char* position)
+            : m_position(position)
+        {}
+
+        template <size_t N>
+        void raw(const char (&text)[N]) {
+            std::memcpy(m_position, text, N - 1);
+            m_position += N - 1;
+        }
+
+        template <typename T>
+        void integer(T value) {
+            if constexpr (std::is_enum_v<T>)
+            {
+                integer(static_cast<std::underlying_type_t<T>>(value));
+            }
+            else
+            {
+                m_position = std::to_chars(m_position, m_position + MAX_NUMBER_CHARS, value).ptr;
+            }
+        }
+
+        void number(float value) {
+            if (!std::isfinite(value))
+            {
+                raw("null");
+                return;
+            }
+
+            m_position = std::to_chars(m_position, m_position + MAX_NUMBER_CHARS, value).ptr;
+        }
+
+        void vector(float x, float y) {
+            raw("{\"x\":");
+            number(x);
+            raw(",\"y\":");
+            number(y);
+            raw("}");
+        }
+
+        char* position() const {
+            return m_position;
+        }
+
+    private:
+        char* m_position;
+    };
+
+    template <typename T, size_t N, typename WriteEntity>
+    void write_array(JsonCursor& cursor, const char (&key)[N], const std::vector<T>& entities, size_t count, WriteEntity&& write_entity) {
+        cursor.raw(key);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i > 0)
+            {
+                cursor.raw(",");
+            }
+
+            write_entity(entities[i]);
+        }
+
+        cursor.raw("]");
+    }
+}
+
+FrameJsonWriter::FrameJsonWriter()
+    : m_capacity(0)
+{}
+
+// Grows the buffer to bytes, what it held is dropped
+char* FrameJsonWriter::reserve(size_t bytes) {
+    if (bytes > m_capacity)
+    {
+        m_capacity = std::max(bytes, m_capacity * 2);
+        m_buffer = std::make_unique<char[]>(m_capacity);
+    }
+
+    return m_buffer.get();
+}
+
+std::string_view FrameJsonWriter::write(const FrameSnapshot& frame) {
+    const auto players  = entity_count(frame.player_count, frame.player_vector);
+    const auto enemies  = entity_count(frame.enemy_count, frame.enemy_vector);
+    const auto bosses   = entity_count(frame.boss_count, frame.boss_vector);
+    const auto bullets  = entity_count(frame.bullet_count, frame.bullet_vector);
+    const auto items    = entity_count(frame.item_count, frame.item_vector);
+
+    const auto start = reserve(FIXED_JSON_SIZE + (players + enemies + bosses + bullets + items) * ENTITY_JSON_SIZE);
+
+    JsonCursor cursor(start);
+
+    /*
+        Frame and stage
+    */
+    cursor.raw("{\"frame\":{\"client_id\":");     cursor.integer(frame.client_id);
+    cursor.raw(",\"opponent_id\":");                cursor.integer(frame.opponent_id);
+    cursor.raw(",\"timestamp\":");                  cursor.integer(frame.timestamp);
+    cursor.raw(",\"score\":");                      cursor.integer(frame.score);
+    cursor.raw(",\"mode\":");                       cursor.integer(frame.mode);
+    cursor.raw(",\"variant\":");                    cursor.integer(frame.variant);
+    cursor.raw(",\"difficulty\":");                 cursor.integer(frame.difficulty);
+    cursor.raw(",\"state\":");                      cursor.integer(frame.state);
+
+    cursor.raw("},\"stage\":{\"id\":");             cursor.integer(frame.stage.id);
+    cursor.raw(",\"name\":");                       cursor.integer(frame.stage.name);
+    cursor.raw(",\"state\":");                      cursor.integer(frame.stage.state);
+    cursor.raw(",\"next_stage\":");                 cursor.integer(frame.stage.next_stage);
+    cursor.raw(",\"timestamp\":");                  cursor.integer(frame.stage.timestamp);
+    cursor.raw("}");
+
+    /*
+        Entities
+    */
+    write_array(cursor, ",\"players\":[", frame.player_vector, players, [&cursor](const PlayerSnapshot& player) {
+        cursor.raw("{\"id\":");                     cursor.integer(player.id);
+        cursor.raw(",\"name\":");                   cursor.integer(player.name);
+        cursor.raw(",\"state\":");                  cursor.integer(player.state);
+        cursor.raw(",\"attack_pattern\":");         cursor.integer(player.attack_pattern);
+        cursor.raw(",\"pos\":");                    cursor.vector(player.pos.x, player.pos.y);
+        cursor.raw(",\"vel\":");                    cursor.vector(player.vel.x, player.vel.y);
+        cursor.raw(",\"radius\":");                 cursor.number(player.radius);
+        cursor.raw(",\"angle\":");                  cursor.number(player.angle);
+        cursor.raw(",\"current_spell\":");          cursor.integer(player.current_spell);
+        cursor.raw(",\"lives\":");                  cursor.integer(player.lives);
+        cursor.raw(",\"bombs\":");                  cursor.integer(player.bombs);
+        cursor.raw(",\"power\":");                  cursor.integer(player.power);
+        cursor.raw("}");
+    });
+
+    write_array(cursor, ",\"enemies\":[", frame.enemy_vector, enemies, [&cursor](const EnemySnapshot& enemy) {
+        cursor.raw("{\"id\":");                     cursor.integer(enemy.id);
+        cursor.raw(",\"name\":");                   cursor.integer(enemy.name);
+        cursor.raw(",\"state\":");                  cursor.integer(enemy.state);
+        cursor.raw(",\"attack_pattern\":");         cursor.integer(enemy.attack_pattern);
+        cursor.raw(",\"pos\":");                    cursor.vector(enemy.pos.x, enemy.pos.y);
+        cursor.raw(",\"vel\":");                    cursor.vector(enemy.vel.x, enemy.vel.y);
+        cursor.raw(",\"radius\":");                 cursor.number(enemy.radius);
+        cursor.raw(",\"angle\":");                  cursor.number(enemy.angle);
+        cursor.raw(",\"health\":");                 cursor.integer(enemy.health);
+        cursor.raw("}");
+    });
+
+    write_array(cursor, ",\"bosses\":[", frame.boss_vector, bosses, [&cursor](const BossSnapshot& boss) {
+        cursor.raw("{\"id\":");                     cursor.integer(boss.id);
+        cursor.raw(",\"name\":");                   cursor.integer(boss.name);
+        cursor.raw(",\"state\":");                  cursor.integer(boss.state);
+        cursor.raw(",\"attack_pattern\":");         cursor.integer(boss.attack_pattern);
+        cursor.raw(",\"pos\":");                    cursor.vector(boss.pos.x, boss.pos.y);
+        cursor.raw(",\"vel\":");                    cursor.vector(boss.vel.x, boss.vel.y);
+        cursor.raw(",\"radius\":");                 cursor.number(boss.radius);
+        cursor.raw(",\"angle\":");                  cursor.number(boss.angle);
+        cursor.raw(",\"health\":");                 cursor.integer(boss.health);
+        cursor.raw(",\"current_spell\":");          cursor.integer(boss.current_spell);
+        cursor.raw(",\"phase\":");                  cursor.integer(boss.phase);
+        cursor.raw("}");
+    });
+
+    write_array(cursor, ",\"bullets\":[", frame.bullet_vector, bullets, [&cursor](const BulletSnapshot& bullet) {
+        cursor.raw("{\"id\":");                     cursor.integer(bullet.id);
+        cursor.raw(",\"name\":");                   cursor.integer(bullet.name);
+        cursor.raw(",\"state\":");                  cursor.integer(bullet.state);
+        cursor.raw(",\"flight_pattern\":");         cursor.integer(bullet.flight_pattern);
+        cursor.raw(",\"owner\":");                  cursor.integer(bullet.owner);
+        cursor.raw(",\"pos\":");                    cursor.vector(bullet.pos.x, bullet.pos.y);
+        cursor.raw(",\"vel\":");                    cursor.vector(bullet.vel.x, bullet.vel.y);
+        cursor.raw(",\"radius\":");                 cursor.number(bullet.radius);
+        cursor.raw(",\"angle\":");                  cursor.number(bullet.angle);
+        cursor.raw(",\"damage\":");                 cursor.integer(bullet.damage);
+        cursor.raw("}");
+    });
+
+    write_array(cursor, ",\"items\":[", frame.item_vector, items, [&cursor](const ItemSnapshot& item) {
+        cursor.raw("{\"id\":");                     cursor.integer(item.id);
+        cursor.raw(",\"name\":");                   cursor.integer(item.name);
+        cursor.raw(",\"state\":");                  cursor.integer(item.state);
+        cursor.raw(",\"flight_pattern\":");         cursor.integer(item.flight_pattern);
+        cursor.raw(",\"pos\":");                    cursor.vector(item.pos.x, item.pos.y);
+        cursor.raw(",\"vel\":");                    cursor.vector(item.vel.x, item.vel.y);
+        cursor.raw(",\"radius\":");                 cursor.number(item.radius);
+        cursor.raw(",\"angle\":");                  cursor.number(item.angle);
+        cursor.raw(",\"score\":");                  cursor.number(item.score);
+        cursor.raw("}");
+    });
+
+    cursor.raw("}");
+
+    return std::string_view(start, static_cast<size_t>(cursor.position() - start));
+}
+
+/*
+    JSON lines
+*/
+bool FrameJsonLinesWriter::open(const std::string& file_path) {
+    close();
+
+    m_file.open(file_path, std::ios::binary | std::ios::trunc);
+    m_frames_written = 0;
+
+    return m_file.is_open();
+}
+
+void FrameJsonLinesWriter::close() {
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+}
+
+bool FrameJsonLinesWriter::is_open() const {
+    return m_file.is_open();
+}
+
+bool FrameJsonLinesWriter::write(const FrameSnapshot& frame) {
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    const auto json = m_writer.write(frame);
+
+    m_file.write(json.data(), static_cast<std::streamsize>(json.size()));
+    m_file.put('\n');
+
+    if (!m_file)
+    {
+        return false;
+    }
+
+    m_frames_written++;
+
+    return true;
+}
+
+bool FrameJsonLinesWriter::flush() {
+    m_file.flush();
+
+    return static_cast<bool>(m_file);
+}
+
+uint64_t FrameJsonLinesWriter::frames_written() const {
+    return m_frames_written;
+}
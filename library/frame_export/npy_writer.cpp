@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstring>
+#include <frame_export/npy_writer.hpp>
+
+namespace {
+    constexpr char NPY_MAGIC[] = "\x93NUMPY";
+    constexpr size_t NPY_MAGIC_SIZE = 6;
+
+    // Magic, version, header length and the padded dictionary; a multiple of 64
+    constexpr size_t NPY_HEADER_SIZE = 128;
+    constexpr size_t NPY_PREAMBLE_SIZE = NPY_MAGIC_SIZE + 2 + 2;
+
+    bool is_little_endian() {
+        const uint16_t probe = 1;
+        uint8_t first = 0;
+
+        std::memcpy(&first, &probe, 1);
+
+        return first == 1;
+    }
+
+    std::string make_header(const std::string& descr, uint64_t length) {
+        auto dictionary = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + std::to_string(length) + ",), }";
+
+        // Spaces up to the fixed size, the last byte is a newline
+        dictionary.resize(NPY_HEADER_SIZE - NPY_PREAMBLE_SIZE - 1, ' ');
+        dictionary += '\n';
+
+        const auto dictionary_size = static_cast<uint16_t>(dictionary.size());
+
+        std::string header(NPY_MAGIC, NPY_MAGIC_SIZE);
+
+        header += static_cast<char>(1);     // Format 1.0
+        header += static_cast<char>(0);
+        header += static_cast<char>(dictionary_size & 0xFF);
+        header += static_cast<char>(dictionary_size >> 8);
+        header += dictionary;
+
+        return header;
+    }
+}
+
+std::string npy_descr(char kind, size_t item_size) {
+    const char order = item_size == 1 ? '|' : (is_little_endian() ? '<' : '>');
+
+    return std::string(1, order) + kind + std::to_string(item_size);
+}
+
+NpyWriter::NpyWriter()
+    : m_item_size(0)
+    , m_length(0)
+    , m_staged(0)
+    , m_failed(false)
+{}
+
+NpyWriter::~NpyWriter() {
+    close();
+}
+
+bool NpyWriter::open(const std::string& file_path, const std::string& descr, size_t item_size) {
+    close();
+
+    m_file.open(file_path, std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    m_descr     = descr;
+    m_item_size = item_size;
+    m_length    = 0;
+    m_staged    = 0;
+    m_failed    = false;
+
+    m_staging.resize(std::max(NPY_WRITER_STAGING_SIZE, item_size));
+
+    return write_header();
+}
+
+bool NpyWriter::close() {
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    flush_staging();
+
+    m_file.seekp(0);
+
+    const auto written = write_header() && !m_failed;
+
+    m_file.close();
+
+    return written && !m_file.fail();
+}
+
+bool NpyWriter::is_open() const {
+    return m_file.is_open();
+}
+
+void NpyWriter::append(const void* items, size_t count) {
+    std::memcpy(prepare(count), items, count * m_item_size);
+    commit(count);
+}
+
+std::byte* NpyWriter::prepare(size_t count) {
+    const auto bytes = count * m_item_size;
+
+    if (m_staged + bytes > m_staging.size())
+    {
+        flush_staging();
+
+        if (bytes > m_staging.size())
+        {
+            m_staging.resize(bytes);
+        }
+    }
+
+    return m_staging.data() + m_staged;
+}
+
+void NpyWriter::commit(size_t count) {
+    m_staged += count * m_item_size;
+    m_length += count;
+}
+
+uint64_t NpyWriter::length() const {
+    return m_length;
+}
+
+bool NpyWriter::write_header() {
+    const auto header = make_header(m_descr, m_length);
+
+    m_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    return static_cast<bool>(m_file);
+}
+
+void NpyWriter::flush_staging() {
+    if (m_staged == 0)
+    {
+        return;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_staging.data()), static_cast<std::streamsize>(m_staged));
+
+    if (!m_file)
+    {
+        m_failed = true;
+    }
+
+    m_staged = 0;
+}
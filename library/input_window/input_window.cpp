@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <input_window/input_window.hpp>
+
+/*
+    InputWindowBuilder
+*/
+InputWindowBuilder::InputWindowBuilder(uint32_t client_id, size_t window_size)
+    : m_window_size(std::clamp<size_t>(window_size, 1, MAX_INPUT_WINDOW_SIZE))
+{
+    m_window.client_id = client_id;
+    m_window.inputs.reserve(m_window_size);
+}
+
+const ClientInputWindow& InputWindowBuilder::push(const ClientInput& input) {
+    auto& inputs = m_window.inputs;
+
+    if (!inputs.empty() && input.frame_timestamp <= inputs.back().frame_timestamp)
+    {
+        return m_window;
+    }
+
+    if (inputs.size() == m_window_size)
+    {
+        inputs.erase(inputs.begin());
+    }
+
+    inputs.push_back(input);
+    inputs.back().client_id = m_window.client_id;
+
+    return m_window;
+}
+
+const ClientInputWindow& InputWindowBuilder::window() const {
+    return m_window;
+}
+
+void InputWindowBuilder::reset() {
+    m_window.inputs.clear();
+}
+
+/*
+    InputTimeline
+*/
+InputTimeline::InputTimeline(size_t capacity)
+    : m_slots(std::max<size_t>(capacity, 1))
+    , m_taken_before(0)
+{}
+
+size_t InputTimeline::merge(const ClientInputWindow& window) {
+    size_t added = 0;
+
+    for (size_t i = 0; i < window.inputs.size(); i++)
+    {
+        if (insert_input(window.inputs[i]) != InsertResult::Added)
+        {
+            continue;
+        }
+
+        added++;
+
+        // Only the newest input is the one the packet was sent for
+        if (i + 1 < window.inputs.size())
+        {
+            m_stats.recovered++;
+        }
+    }
+
+    return added;
+}
+
+bool InputTimeline::insert(const ClientInput& input) {
+    return insert_input(input) == InsertResult::Added;
+}
+
+std::optional<ClientInput> InputTimeline::take(uint32_t frame_timestamp) {
+    if (frame_timestamp < m_taken_before)
+    {
+        return std::nullopt;
+    }
+
+    m_taken_before = frame_timestamp + 1;
+
+    auto& slot = m_slots[frame_timestamp % m_slots.size()];
+
+    if (!slot.occupied || slot.input.frame_timestamp != frame_timestamp)
+    {
+        return std::nullopt;
+    }
+
+    slot.occupied = false;
+
+    return slot.input;
+}
+
+bool InputTimeline::contains(uint32_t frame_timestamp) const {
+    if (is_stale(frame_timestamp))
+    {
+        return false;
+    }
+
+    const auto& slot = m_slots[frame_timestamp % m_slots.size()];
+
+    return slot.occupied && slot.input.frame_timestamp == frame_timestamp;
+}
+
+std::optional<uint32_t> InputTimeline::latest_timestamp() const {
+    return m_latest;
+}
+
+const InputTimelineStats& InputTimeline::stats() const {
+    return m_stats;
+}
+
+InputTimeline::InsertResult InputTimeline::insert_input(const ClientInput& input) {
+    const auto frame_timestamp = input.frame_timestamp;
+
+    if (is_stale(frame_timestamp))
+    {
+        m_stats.stale++;
+
+        return InsertResult::Stale;
+    }
+
+    auto& slot = m_slots[frame_timestamp % m_slots.size()];
+
+    if (slot.occupied && slot.input.frame_timestamp == frame_timestamp)
+    {
+        m_stats.duplicates++;
+
+        return InsertResult::Duplicate;
+    }
+
+    // A different tick in the slot is at least capacity ticks older, it is overwritten
+    slot.occupied = true;
+    slot.input = input;
+
+    if (!m_latest.has_value() || frame_timestamp > m_latest.value())
+    {
+        m_latest = frame_timestamp;
+    }
+
+    m_stats.added++;
+
+    return InsertResult::Added;
+}
+
+bool InputTimeline::is_stale(uint32_t frame_timestamp) const {
+    if (frame_timestamp < m_taken_before)
+    {
+        return true;
+    }
+
+    return m_latest.has_value() &&
+           m_latest.value() > frame_timestamp &&
+           m_latest.value() - frame_timestamp >= m_slots.size();
+}
@@ -0,0 +1,642 @@
+#include <algorithm>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <load_generator/client_swarm.hpp>
+#include <logger/log_macros.hpp>
+#include <packet_stream/packet_stream.hpp>
+
+namespace {
+    // How often a client waiting for a response looks for it
+    constexpr uint64_t RESPONSE_POLL_NS = 1'000'000;
+
+    // Longest a scheduler sleeps, so stop() is noticed quickly
+    constexpr uint64_t MAX_SCHEDULER_SLEEP_NS = 10'000'000;
+
+    uint64_t now_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t to_ns(std::chrono::milliseconds duration) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    enum class ClientState : uint8_t {
+        Idle,               // Connects when due
+        AwaitAccept,
+        AwaitGameResponse,
+        Playing,
+        AwaitReconnect
+    };
+
+    // What the receive side saw, written by the event loop worker
+    enum class Response : uint8_t {
+        None,
+        Accepted,
+        Rejected
+    };
+
+    /*
+        One simulated client. Everything but the response fields belongs to the
+        scheduler thread that owns the client, the stream's handlers only fill in
+        the response and the scheduler picks it up on its next step.
+    */
+    struct SwarmClient {
+        uint32_t                            index               = 0;
+        ClientState                         state               = ClientState::Idle;
+        bool                                reconnecting        = false;
+        std::mt19937                        rng;
+
+        std::shared_ptr<ClientSocket>       socket;
+        std::unique_ptr<PacketStreamClient> stream;
+
+        uint64_t                            request_sent_at     = 0;
+        uint64_t                            session_ends_at     = 0;
+        uint32_t                            client_id           = 0;
+        uint32_t                            session_id          = 0;
+        uint32_t                            frame_timestamp     = 0;
+        GameInput                           input               = {};
+
+        std::atomic<Response>               response            { Response::None };
+        std::atomic<uint64_t>               response_at         { 0 };
+        std::atomic<uint32_t>               response_value      { 0 };
+        std::atomic<bool>                   closed              { false };
+        std::atomic<uint64_t>               frames_received     { 0 };      // Folded into the stats by the scheduler
+    };
+}
+
+const char* swarm_phase_name(SwarmPhase phase) {
+    switch (phase)
+    {
+        case SwarmPhase::Connect:       { return "connect";         }
+        case SwarmPhase::Hello:         { return "hello";           }
+        case SwarmPhase::GameRequest:   { return "game_request";    }
+        case SwarmPhase::Reconnect:     { return "reconnect";       }
+        default:                        { return "unknown";         }
+    }
+}
+
+struct ClientSwarm::Scheduler {
+    std::thread                                 thread;
+    std::vector<std::unique_ptr<SwarmClient>>   clients;
+
+    // (due time, client) min-heap
+    std::priority_queue<std::pair<uint64_t, uint32_t>,
+                        std::vector<std::pair<uint64_t, uint32_t>>,
+                        std::greater<>>         timers;
+
+    mutable std::mutex                          stats_mutex;
+    SwarmStats                                  stats;
+};
+
+namespace {
+    struct StepContext {
+        const SwarmOptions&     options;
+        IoEventLoop&            loop;
+        std::mutex&             stats_mutex;
+        SwarmStats&             stats;
+        std::atomic<uint64_t>&  connected;
+    };
+
+    // Uniform in [base * (1 - jitter), base * (1 + jitter)]
+    uint64_t jittered(std::mt19937& rng, uint64_t base, double jitter) {
+        if (jitter <= 0.0 || base == 0)
+        {
+            return base;
+        }
+
+        std::uniform_real_distribution<double> factor(1.0 - jitter, 1.0 + jitter);
+
+        return static_cast<uint64_t>(static_cast<double>(base) * std::max(0.0, factor(rng)));
+    }
+
+    void bind_handlers(SwarmClient& client) {
+        auto* target = &client;
+
+        client.stream->on<ServerAccept>([target](const PacketHeader&, const ServerAccept& accept) {
+            target->response_value.store(accept.assigned_client_id, std::memory_order_relaxed);
+            target->response_at.store(now_ns(), std::memory_order_relaxed);
+            target->response.store(Response::Accepted, std::memory_order_release);
+        });
+
+        client.stream->on<ServerGameResponse>([target](const PacketHeader&, const ServerGameResponse& response) {
+            target->response_value.store(response.session_id, std::memory_order_relaxed);
+            target->response_at.store(now_ns(), std::memory_order_relaxed);
+            target->response.store(response.accepted == Accepted::Accepted ? Response::Accepted : Response::Rejected,
+                                   std::memory_order_release);
+        });
+
+        client.stream->on<ServerReconnectResponse>([target](const PacketHeader&, const ServerReconnectResponse& response) {
+            target->response_at.store(now_ns(), std::memory_order_relaxed);
+            target->response.store(response.accepted == Accepted::Accepted ? Response::Accepted : Response::Rejected,
+                                   std::memory_order_release);
+        });
+
+        // The server ends the session, handled like a closed connection
+        client.stream->on<ServerGoodbye>([target](const PacketHeader&, const ServerGoodbye&) {
+            target->closed.store(true, std::memory_order_release);
+        });
+
+        // Frames are only counted, nothing would ever poll them off the stream's queue
+        client.stream->on<FrameSnapshot>([target](const PacketHeader&, const FrameSnapshot&) {
+            target->frames_received.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        client.stream->set_receive_callback([target](StreamEvent event) {
+            if (event == StreamEvent::Closed)
+            {
+                target->closed.store(true, std::memory_order_release);
+            }
+        });
+    }
+
+    void disconnect(SwarmClient& client, StepContext& context) {
+        if (client.stream)
+        {
+            client.stream->stop();
+            client.stream.reset();
+            client.socket.reset();
+
+            context.connected.fetch_sub(1, std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+            context.stats.frames_received += client.frames_received.exchange(0, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Payload>
+    bool send_request(SwarmClient& client, const Payload& payload, ClientState next_state, uint64_t now) {
+        client.response.store(Response::None, std::memory_order_relaxed);
+        client.request_sent_at = now;
+        client.state = next_state;
+
+        return client.stream->send_packet(make_packet(payload));
+    }
+
+    void start_playing(SwarmClient& client, const SwarmOptions& options, uint64_t now) {
+        client.state = ClientState::Playing;
+        client.session_ends_at = now + jittered(client.rng, to_ns(options.session_duration), options.jitter);
+    }
+
+    // Tears the connection down, the next connect starts over with a hello unless the caller asks for a reconnect
+    uint64_t end_connection(SwarmClient& client, StepContext& context, uint64_t now) {
+        disconnect(client, context);
+
+        client.state = ClientState::Idle;
+        client.reconnecting = false;
+
+        return now + jittered(client.rng, to_ns(context.options.reconnect_delay), context.options.jitter);
+    }
+
+    // Moves a few buttons now and then, like a player dodging
+    void advance_input(SwarmClient& client) {
+        std::uniform_int_distribution<uint32_t> roll(0, 15);
+
+        if (roll(client.rng) == 0)
+        {
+            client.input.arrows.held = std::bitset<static_cast<size_t>(Arrow::Count)>(roll(client.rng));
+        }
+
+        if (roll(client.rng) == 0)
+        {
+            client.input.held = std::bitset<static_cast<size_t>(GameAction::Count)>(roll(client.rng));
+        }
+    }
+
+    /*
+        Response step shared by the request states: records the outcome in
+        phase and returns true once the request has been answered with an accept
+    */
+    enum class Outcome { Pending, Accepted, Failed };
+
+    Outcome take_response(SwarmClient& client, SwarmPhase phase, StepContext& context, uint64_t now) {
+        const auto response = client.response.load(std::memory_order_acquire);
+        auto& stats = context.stats.phases[static_cast<size_t>(phase)];
+
+        if (response == Response::Accepted)
+        {
+            const auto answered_at = client.response_at.load(std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            stats.succeeded++;
+            stats.latency.record(answered_at - client.request_sent_at);
+
+            return Outcome::Accepted;
+        }
+
+        if (response == Response::Rejected)
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            stats.rejected++;
+
+            return Outcome::Failed;
+        }
+
+        if (client.closed.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            stats.dropped++;
+
+            return Outcome::Failed;
+        }
+
+        if (now - client.request_sent_at >= to_ns(context.options.response_timeout))
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            stats.timed_out++;
+
+            return Outcome::Failed;
+        }
+
+        return Outcome::Pending;
+    }
+
+    uint64_t step_connect(SwarmClient& client, StepContext& context, uint64_t now) {
+        const auto& options = context.options;
+        auto& connect_stats = context.stats.phases[static_cast<size_t>(SwarmPhase::Connect)];
+
+        client.socket = std::make_shared<ClientSocket>(options.server_address, options.server_port);
+
+        const auto connected = client.socket->connect_to_server();
+        const auto connected_at = now_ns();
+
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            connect_stats.attempts++;
+
+            if (connected)
+            {
+                connect_stats.succeeded++;
+                connect_stats.latency.record(connected_at - now);
+            }
+            else
+            {
+                connect_stats.failed++;
+            }
+        }
+
+        if (!connected)
+        {
+            client.socket.reset();
+
+            return connected_at + jittered(client.rng, to_ns(options.reconnect_delay), options.jitter);
+        }
+
+        client.stream = std::make_unique<PacketStreamClient>(client.socket);
+        client.closed.store(false, std::memory_order_relaxed);
+
+        bind_handlers(client);
+        client.stream->start(context.loop);
+        context.connected.fetch_add(1, std::memory_order_relaxed);
+
+        const auto phase = client.reconnecting ? SwarmPhase::Reconnect : SwarmPhase::Hello;
+        bool sent = false;
+
+        if (client.reconnecting)
+        {
+            sent = send_request(client, ClientReconnectRequest { client.client_id, client.session_id },
+                                ClientState::AwaitReconnect, connected_at);
+        }
+        else
+        {
+            ClientHello hello = {};
+            const auto name = "swarm-" + std::to_string(client.index);
+
+            hello.client_name_size = static_cast<uint32_t>(std::min<size_t>(name.size(), MAX_CLIENT_NAME_SIZE));
+            std::copy_n(name.data(), hello.client_name_size, hello.client_name);
+
+            sent = send_request(client, hello, ClientState::AwaitAccept, connected_at);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            auto& stats = context.stats.phases[static_cast<size_t>(phase)];
+
+            stats.attempts++;
+
+            if (!sent)
+            {
+                stats.failed++;
+            }
+        }
+
+        return sent ? connected_at + RESPONSE_POLL_NS : end_connection(client, context, connected_at);
+    }
+
+    uint64_t step_playing(SwarmClient& client, StepContext& context, uint64_t due, uint64_t now) {
+        const auto& options = context.options;
+
+        if (client.closed.load(std::memory_order_acquire))
+        {
+            {
+                std::lock_guard<std::mutex> lock(context.stats_mutex);
+                context.stats.sessions_dropped++;
+            }
+
+            // Lost by the server side, come back to the same session
+            const auto next = end_connection(client, context, now);
+            client.reconnecting = true;
+
+            return next;
+        }
+
+        if (now >= client.session_ends_at)
+        {
+            std::bernoulli_distribution drop(options.reconnect_probability);
+            const auto scripted_drop = drop(client.rng);
+
+            if (!scripted_drop)
+            {
+                client.stream->send_packet(make_packet(ClientGoodbye { GoodByeReasonCode::NormalExit }));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+                if (scripted_drop)
+                {
+                    context.stats.scripted_drops++;
+                }
+                else
+                {
+                    context.stats.sessions_completed++;
+                }
+            }
+
+            const auto next = end_connection(client, context, now);
+            client.reconnecting = scripted_drop;
+
+            return next;
+        }
+
+        advance_input(client);
+
+        ClientInput input = {};
+
+        input.client_id = client.client_id;
+        input.frame_timestamp = client.frame_timestamp++;
+        input.game_input = client.input;
+
+        const auto sent = client.stream->send_packet(make_packet(input));
+
+        {
+            std::lock_guard<std::mutex> lock(context.stats_mutex);
+
+            context.stats.inputs_sent += sent ? 1 : 0;
+            context.stats.frames_received += client.frames_received.exchange(0, std::memory_order_relaxed);
+        }
+
+        // Paced from the due time so a late step does not shift the whole session
+        const auto interval = static_cast<uint64_t>(1e9 / std::max(options.input_rate_hz, 1.0));
+        const auto next = due + jittered(client.rng, interval, options.jitter);
+
+        return std::max(next, now);
+    }
+
+    // Runs the client's state machine once, returns when it wants to run next
+    uint64_t step(SwarmClient& client, StepContext& context, uint64_t due) {
+        const auto now = now_ns();
+
+        switch (client.state)
+        {
+            case ClientState::Idle:
+            {
+                return step_connect(client, context, now);
+            }
+            case ClientState::AwaitAccept:
+            {
+                const auto outcome = take_response(client, SwarmPhase::Hello, context, now);
+
+                if (outcome == Outcome::Pending)
+                {
+                    return now + RESPONSE_POLL_NS;
+                }
+
+                if (outcome == Outcome::Failed)
+                {
+                    return end_connection(client, context, now);
+                }
+
+                client.client_id = client.response_value.load(std::memory_order_relaxed);
+
+                const ClientGameRequest request { GameMode::Single, GameVariant::Default, GameDifficulty::Normal, 0 };
+                const auto sent = send_request(client, request, ClientState::AwaitGameResponse, now);
+
+                std::lock_guard<std::mutex> lock(context.stats_mutex);
+                auto& stats = context.stats.phases[static_cast<size_t>(SwarmPhase::GameRequest)];
+
+                stats.attempts++;
+
+                if (!sent)
+                {
+                    stats.failed++;
+                }
+
+                return sent ? now + RESPONSE_POLL_NS : end_connection(client, context, now);
+            }
+            case ClientState::AwaitGameResponse:
+            {
+                const auto outcome = take_response(client, SwarmPhase::GameRequest, context, now);
+
+                if (outcome == Outcome::Pending)
+                {
+                    return now + RESPONSE_POLL_NS;
+                }
+
+                if (outcome == Outcome::Failed)
+                {
+                    return end_connection(client, context, now);
+                }
+
+                client.session_id = client.response_value.load(std::memory_order_relaxed);
+                client.frame_timestamp = 0;
+                start_playing(client, context.options, now);
+
+                return now;
+            }
+            case ClientState::AwaitReconnect:
+            {
+                const auto outcome = take_response(client, SwarmPhase::Reconnect, context, now);
+
+                if (outcome == Outcome::Pending)
+                {
+                    return now + RESPONSE_POLL_NS;
+                }
+
+                // A refused reconnect starts a new session
+                if (outcome == Outcome::Failed)
+                {
+                    return end_connection(client, context, now);
+                }
+
+                client.reconnecting = false;
+                start_playing(client, context.options, now);
+
+                return now;
+            }
+            case ClientState::Playing:
+            {
+                return step_playing(client, context, due, now);
+            }
+        }
+
+        return now + RESPONSE_POLL_NS;
+    }
+}
+
+ClientSwarm::ClientSwarm(SwarmOptions options)
+    : m_options(std::move(options))
+    , m_running(false)
+    , m_connected(0)
+{}
+
+ClientSwarm::~ClientSwarm() {
+    stop();
+}
+
+void ClientSwarm::start() {
+    if (m_running)
+    {
+        return;
+    }
+
+    const auto scheduler_count = std::max<size_t>(1, m_options.scheduler_threads);
+
+    m_loop = std::make_unique<IoEventLoop>(std::max<size_t>(1, m_options.io_workers));
+    m_loop->start();
+
+    m_schedulers.clear();
+
+    for (size_t i = 0; i < scheduler_count; i++)
+    {
+        m_schedulers.push_back(std::make_unique<Scheduler>());
+    }
+
+    // Client starts are spread evenly over the ramp-up
+    const auto start = now_ns();
+    const auto ramp_up = to_ns(m_options.ramp_up);
+
+    for (size_t i = 0; i < m_options.client_count; i++)
+    {
+        auto& scheduler = *m_schedulers[i % scheduler_count];
+        auto client = std::make_unique<SwarmClient>();
+
+        client->index = static_cast<uint32_t>(i);
+        client->rng.seed(m_options.seed + static_cast<uint32_t>(i) * 7919u);
+
+        const auto due = start + (m_options.client_count > 1 ? ramp_up * i / m_options.client_count : 0);
+
+        scheduler.timers.emplace(due, static_cast<uint32_t>(scheduler.clients.size()));
+        scheduler.clients.push_back(std::move(client));
+    }
+
+    m_running = true;
+
+    for (auto& scheduler : m_schedulers)
+    {
+        scheduler->thread = std::thread(&ClientSwarm::scheduler_loop, this, std::ref(*scheduler));
+    }
+
+    LOG_INFO("[ClientSwarm] Started {} clients on {} scheduler threads", m_options.client_count, scheduler_count);
+}
+
+void ClientSwarm::stop() {
+    if (!m_running)
+    {
+        return;
+    }
+
+    m_running = false;
+
+    for (auto& scheduler : m_schedulers)
+    {
+        if (scheduler->thread.joinable())
+        {
+            scheduler->thread.join();
+        }
+    }
+
+    m_loop->stop();
+}
+
+bool ClientSwarm::is_running() const {
+    return m_running;
+}
+
+SwarmStats ClientSwarm::stats() const {
+    SwarmStats total;
+
+    for (const auto& scheduler : m_schedulers)
+    {
+        std::lock_guard<std::mutex> lock(scheduler->stats_mutex);
+
+        const auto& stats = scheduler->stats;
+
+        for (size_t i = 0; i < SWARM_PHASE_COUNT; i++)
+        {
+            auto& phase = total.phases[i];
+            const auto& other = stats.phases[i];
+
+            phase.attempts  += other.attempts;
+            phase.succeeded += other.succeeded;
+            phase.failed    += other.failed;
+            phase.timed_out += other.timed_out;
+            phase.rejected  += other.rejected;
+            phase.dropped   += other.dropped;
+            phase.latency.merge(other.latency);
+        }
+
+        total.inputs_sent           += stats.inputs_sent;
+        total.frames_received       += stats.frames_received;
+        total.sessions_completed    += stats.sessions_completed;
+        total.sessions_dropped      += stats.sessions_dropped;
+        total.scripted_drops        += stats.scripted_drops;
+    }
+
+    total.connected_clients = m_connected.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+const SwarmOptions& ClientSwarm::options() const {
+    return m_options;
+}
+
+void ClientSwarm::scheduler_loop(Scheduler& scheduler) {
+    StepContext context { m_options, *m_loop, scheduler.stats_mutex, scheduler.stats, m_connected };
+
+    while (m_running && !scheduler.timers.empty())
+    {
+        const auto [due, index] = scheduler.timers.top();
+        const auto now = now_ns();
+
+        if (due > now)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(due - now, MAX_SCHEDULER_SLEEP_NS)));
+            continue;
+        }
+
+        scheduler.timers.pop();
+        scheduler.timers.emplace(step(*scheduler.clients[index], context, due), index);
+    }
+
+    // Leave like a closing game would
+    for (auto& client : scheduler.clients)
+    {
+        if (client->stream && client->state == ClientState::Playing)
+        {
+            client->stream->send_packet(make_packet(ClientGoodbye { GoodByeReasonCode::NormalExit }));
+        }
+
+        disconnect(*client, context);
+    }
+}
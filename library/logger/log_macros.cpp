@@ -0,0 +1,50 @@
+#include <chrono>
+#include <iterator>
+#include <logger/log_macros.hpp>
+
+namespace {
+    uint64_t now_ms() {
+        using namespace std::chrono;
+
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+bool LogRateLimiter::allow(uint64_t& suppressed) {
+    const auto now = now_ms();
+    auto window_start = m_window_start.load(std::memory_order_relaxed);
+
+    // The thread that moves the window forward also resets its budget
+    if (now - window_start >= LOG_RATE_LIMIT_WINDOW_MS &&
+        m_window_start.compare_exchange_strong(window_start, now, std::memory_order_relaxed))
+    {
+        m_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (m_count.fetch_add(1, std::memory_order_relaxed) >= LOG_RATE_LIMIT_BURST)
+    {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+const LogSite& log_suppressed_site(LogLevel level) {
+    static constexpr const char* format = "{} messages from {}:{} were suppressed by the rate limit";
+
+    static constexpr LogSite sites[] = {
+        { LogLevel::Debug,      format, __FILE__, __LINE__ },
+        { LogLevel::Info,       format, __FILE__, __LINE__ },
+        { LogLevel::Warning,    format, __FILE__, __LINE__ },
+        { LogLevel::Error,      format, __FILE__, __LINE__ },
+        { LogLevel::Critical,   format, __FILE__, __LINE__ }
+    };
+
+    const auto index = static_cast<size_t>(level);
+
+    return sites[index < std::size(sites) ? index : std::size(sites) - 1];
+}
@@ -1,50 +1,77 @@
-#include <iomanip>
-#include <sstream> 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <fstream>
-#include <queue>
+#include <iterator>
+#include <memory>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <ctime>
+#include <vector>
 #include <logger/logger.hpp>
 
 namespace {
-    std::ofstream           log_file;
-    std::queue<std::string> log_queue;
-    std::mutex              mutex;
-    std::condition_variable cond_var;
-    std::thread             worker_thread;
-    std::atomic<bool>       running{false};
-
-    std::string get_timestamp() {
-        using namespace std::chrono;
+    // Records the logger thread formats per pass
+    constexpr size_t MAX_RECORDS_PER_PASS = 4096;
 
-        // Acquire the current time
-        auto now = system_clock::now();
-        auto time_t_now = system_clock::to_time_t(now);
-        auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
+    // How long the logger thread sleeps when every ring is empty
+    constexpr auto IDLE_INTERVAL = std::chrono::milliseconds(1);
 
-        std::tm buff;
+    // Written data is flushed at least this often, and whenever the logger goes idle
+    constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(200);
 
-#ifdef _WIN32
-        localtime_s(&buff, &time_t_now);
-#else
-        localtime_r(&time_t_now, &buff);
-#endif
+    struct ThreadBuffer {
+        explicit ThreadBuffer(uint32_t index)
+            : ring(LOG_THREAD_RING_CAPACITY)
+            , thread_index(index)
+            , orphaned(false)
+        {}
 
-        // Formatting
-        std::ostringstream oss;
+        SpscRingQueue<LogRecord>    ring;
+        uint32_t                    thread_index;
+        std::atomic<bool>           orphaned;   // The owning thread has exited
+    };
 
-        oss << std::put_time(&buff, "[%Y-%m-%d %H:%M:%S");
-        oss << '.' << std::setw(3) << std::setfill('0') << ms.count();
-        oss << ']';
+    /*
+        Keeps the thread's ring registered for as long as the thread lives,
+        the logger thread drops it once it is orphaned and drained
+    */
+    struct ThreadBufferHolder {
+        std::shared_ptr<ThreadBuffer> buffer;
 
-        return oss.str();
-    }
+        ~ThreadBufferHolder() {
+            if (buffer)
+            {
+                buffer->orphaned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    // An async_log() message longer than LOG_TEXT_CAPACITY
+    struct OverflowMessage {
+        const LogSite*  site;
+        uint64_t        timestamp;
+        std::string     message;
+    };
 
-    std::string log_level_to_string(LogLevel log_level) {
+    std::ofstream                               log_file;
+    std::thread                                 worker_thread;
+    std::atomic<bool>                           running{false};
+    std::atomic<uint64_t>                       dropped_records{0};
+    std::atomic<uint64_t>                       cut_texts{0};
+    std::atomic<uint32_t>                       next_thread_index{0};
+
+    std::mutex                                  overflow_mutex;
+    std::vector<OverflowMessage>                overflow_messages;
+
+    std::mutex                                  registry_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>>  registry;
+
+    thread_local ThreadBufferHolder             thread_buffer;
+
+    std::string_view log_level_to_string(LogLevel log_level) {
         switch (log_level)
         {
             case LogLevel::Debug:      return "[DEBUG]";
@@ -56,24 +83,270 @@ namespace {
         }
     }
 
+    uint64_t wall_clock_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    /*
+        Converts log_now_ticks() to wall-clock nanoseconds. Every pass pairs
+        the current ticks with the wall clock, records are placed relative
+        to that pair, using the tick rate measured since the logger started.
+    */
+    class TickClock {
+    public:
+        TickClock()
+            : m_start_ticks(log_now_ticks())
+            , m_start_ns(wall_clock_ns())
+            , m_anchor_ticks(m_start_ticks)
+            , m_anchor_ns(m_start_ns)
+            , m_ns_per_tick(1.0)
+        {}
+
+        void resync() {
+            m_anchor_ticks = log_now_ticks();
+            m_anchor_ns = wall_clock_ns();
+
+#ifdef LOGGER_HAS_RDTSC
+            if (m_anchor_ticks > m_start_ticks && m_anchor_ns > m_start_ns)
+            {
+                m_ns_per_tick = static_cast<double>(m_anchor_ns - m_start_ns) / static_cast<double>(m_anchor_ticks - m_start_ticks);
+            }
+#endif
+        }
+
+        uint64_t to_wall_ns(uint64_t ticks) const {
+            const auto delta = static_cast<double>(static_cast<int64_t>(ticks - m_anchor_ticks)) * m_ns_per_tick;
+
+            return static_cast<uint64_t>(static_cast<int64_t>(m_anchor_ns) + static_cast<int64_t>(delta));
+        }
+
+    private:
+        uint64_t    m_start_ticks;
+        uint64_t    m_start_ns;
+        uint64_t    m_anchor_ticks;
+        uint64_t    m_anchor_ns;
+        double      m_ns_per_tick;
+    };
+
+    /*
+        Renders '[YYYY-mm-dd HH:MM:SS.mmm]', the calendar part is
+        only recomputed when the second changes
+    */
+    class TimestampCache {
+    public:
+        void append(std::string& out, uint64_t timestamp_ns) {
+            const auto seconds = static_cast<std::time_t>(timestamp_ns / 1'000'000'000);
+            const auto millis = static_cast<unsigned>((timestamp_ns / 1'000'000) % 1000);
+
+            if (seconds != m_seconds || m_prefix.empty())
+            {
+                std::tm buff;
+
+#ifdef _WIN32
+                localtime_s(&buff, &seconds);
+#else
+                localtime_r(&seconds, &buff);
+#endif
+
+                char text[32];
+                const auto size = std::strftime(text, sizeof(text), "[%Y-%m-%d %H:%M:%S", &buff);
+
+                m_prefix.assign(text, size);
+                m_seconds = seconds;
+            }
+
+            out += m_prefix;
+            out += '.';
+            out += static_cast<char>('0' + millis / 100);
+            out += static_cast<char>('0' + millis / 10 % 10);
+            out += static_cast<char>('0' + millis % 10);
+            out += ']';
+        }
+
+    private:
+        std::time_t m_seconds = 0;
+        std::string m_prefix;
+    };
+
+    template <typename T>
+    void append_number(std::string& out, T value) {
+        char text[32];
+        const auto result = std::to_chars(text, text + sizeof(text), value);
+
+        out.append(text, result.ptr);
+    }
+
+    void append_arg(std::string& out, const LogRecord& record, const LogArg& arg) {
+        switch (arg.type)
+        {
+            case LogArgType::Int:       { append_number(out, arg.i);                        break; }
+            case LogArgType::UInt:      { append_number(out, arg.u);                        break; }
+            case LogArgType::Double:    { append_number(out, arg.d);                        break; }
+            case LogArgType::Bool:      { out += arg.u != 0 ? "true" : "false";             break; }
+            case LogArgType::Char:      { out += static_cast<char>(arg.u);                  break; }
+            case LogArgType::String:    { out += record.text_of(arg);                       break; }
+            case LogArgType::Overflow:  { out += static_cast<const OverflowMessage*>(arg.p)->message; break; }
+            case LogArgType::Pointer:
+            {
+                char text[24];
+                const auto result = std::to_chars(text, text + sizeof(text), reinterpret_cast<uintptr_t>(arg.p), 16);
+
+                out += "0x";
+                out.append(text, result.ptr);
+
+                break;
+            }
+        }
+    }
+
+    void format_record(std::string& out, uint64_t wall_ns, TimestampCache& timestamps, const LogRecord& record) {
+        timestamps.append(out, wall_ns);
+
+        out += ' ';
+        out += log_level_to_string(record.site->level);
+        out += ' ';
+
+        const std::string_view format = record.site->format;
+        size_t next_arg = 0;
+        size_t pos = 0;
+
+        while (pos < format.size())
+        {
+            const auto placeholder = format.find("{}", pos);
+
+            if (placeholder == std::string_view::npos || next_arg >= record.arg_count)
+            {
+                out += format.substr(pos);
+                break;
+            }
+
+            out += format.substr(pos, placeholder - pos);
+            append_arg(out, record, record.args[next_arg++]);
+
+            pos = placeholder + 2;
+        }
+
+        out += '\n';
+    }
+
+    // Takes what every ring and the overflow list hold right now, oldest first
+    size_t collect_records(std::vector<LogRecord>& batch, std::vector<OverflowMessage>& overflow) {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+
+            registry.erase(std::remove_if(registry.begin(), registry.end(), [](const auto& buffer) {
+                return buffer->orphaned.load(std::memory_order_acquire) && buffer->ring.empty();
+            }), registry.end());
+
+            buffers = registry;
+        }
+
+        for (const auto& buffer : buffers)
+        {
+            buffer->ring.drain([&batch](LogRecord&& record) {
+                batch.push_back(record);
+            }, MAX_RECORDS_PER_PASS);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            overflow.swap(overflow_messages);
+        }
+
+        // The records point into overflow, which stays untouched until the next pass
+        for (const auto& message : overflow)
+        {
+            auto& record = batch.emplace_back(*message.site, message.timestamp, 0);
+
+            record.args[0].type = LogArgType::Overflow;
+            record.args[0].p = &message;
+            record.arg_count = 1;
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& lhs, const LogRecord& rhs) {
+            return static_cast<int64_t>(lhs.timestamp - rhs.timestamp) < 0;
+        });
+
+        return batch.size();
+    }
+
     void writing_thread() {
-        while (running || !log_queue.empty())
+        static constexpr LogSite dropped_site { LogLevel::Warning, "{} log records were dropped, the log rings were full", __FILE__, __LINE__ };
+        static constexpr LogSite cut_site { LogLevel::Warning, "{} log string arguments were cut to fit {} bytes", __FILE__, __LINE__ };
+
+        std::vector<LogRecord> batch;
+        std::vector<OverflowMessage> overflow;
+        std::string out;
+        TickClock clock;
+        TimestampCache timestamps;
+
+        auto last_flush = std::chrono::steady_clock::now();
+        bool unflushed = false;
+
+        while (true)
         {
-            std::unique_lock<std::mutex> lock(mutex);
+            // Read before draining so that nothing logged before stop() is missed
+            const auto keep_running = running.load(std::memory_order_acquire);
+
+            batch.clear();
+            overflow.clear();
+            out.clear();
 
-            // Wait until the log queue is not empty or logger is stoped
-            cond_var.wait(lock, [] {
-                return !log_queue.empty() || !running;
-            });
+            if (const auto dropped = dropped_records.exchange(0, std::memory_order_relaxed); dropped > 0)
+            {
+                batch.emplace_back(dropped_site, log_now_ticks(), 0, dropped);
+            }
 
-            while (!log_queue.empty())
+            if (const auto cut = cut_texts.exchange(0, std::memory_order_relaxed); cut > 0)
             {
-                log_file << log_queue.front() << "\n";
-                log_queue.pop();
+                batch.emplace_back(cut_site, log_now_ticks(), 0, cut, LOG_TEXT_CAPACITY);
             }
 
-            log_file.flush();
+            if (collect_records(batch, overflow) == 0)
+            {
+                if (!keep_running)
+                {
+                    break;
+                }
+
+                if (unflushed)
+                {
+                    log_file.flush();
+                    unflushed = false;
+                    last_flush = std::chrono::steady_clock::now();
+                }
+
+                std::this_thread::sleep_for(IDLE_INTERVAL);
+
+                continue;
+            }
+
+            clock.resync();
+
+            for (const auto& record : batch)
+            {
+                format_record(out, clock.to_wall_ns(record.timestamp), timestamps, record);
+            }
+
+            // One write per pass instead of one per message
+            log_file.write(out.data(), static_cast<std::streamsize>(out.size()));
+            unflushed = true;
+
+            const auto now = std::chrono::steady_clock::now();
+
+            if (now - last_flush >= FLUSH_INTERVAL)
+            {
+                log_file.flush();
+                unflushed = false;
+                last_flush = now;
+            }
         }
+
+        log_file.flush();
     }
 }
 
@@ -91,24 +364,34 @@ void start_async_logger(const std::string& log_file_path) {
 }
 
 void async_log(LogLevel log_level, const std::string& message) {
-    if (!running)
+    static constexpr LogSite sites[] = {
+        { LogLevel::Debug,      "{}", __FILE__, __LINE__ },
+        { LogLevel::Info,       "{}", __FILE__, __LINE__ },
+        { LogLevel::Warning,    "{}", __FILE__, __LINE__ },
+        { LogLevel::Error,      "{}", __FILE__, __LINE__ },
+        { LogLevel::Critical,   "{}", __FILE__, __LINE__ }
+    };
+
+    const auto index = static_cast<size_t>(log_level);
+
+    if (index >= std::size(sites))
     {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(mutex);
+    if (message.size() <= LOG_TEXT_CAPACITY)
+    {
+        log_record(sites[index], message);
+        return;
+    }
 
-    // Adding a timestamp
-    std::string full_message = get_timestamp()
-        + " "
-        + log_level_to_string(log_level)
-        + " "
-        + message;
-    
-    log_queue.push(full_message);
+    if (!running.load(std::memory_order_relaxed))
+    {
+        return;
+    }
 
-    // Notify the thread to start writing log messages
-    cond_var.notify_one();
+    std::lock_guard<std::mutex> lock(overflow_mutex);
+    overflow_messages.push_back({ &sites[index], log_now_ticks(), message });
 }
 
 void stop_async_logger() {
@@ -118,12 +401,51 @@ void stop_async_logger() {
         return;
     }
 
-    cond_var.notify_one();
-
     if (worker_thread.joinable())
     {
         worker_thread.join();
     }
 
     log_file.close();
-}
\ No newline at end of file
+}
+
+bool is_async_logger_running() {
+    return running.load(std::memory_order_relaxed);
+}
+
+LogThreadRing log_thread_ring() {
+    if (!running.load(std::memory_order_relaxed))
+    {
+        return { nullptr, 0 };
+    }
+
+    auto& buffer = thread_buffer.buffer;
+
+    if (!buffer)
+    {
+        buffer = std::make_shared<ThreadBuffer>(next_thread_index.fetch_add(1));
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(buffer);
+    }
+
+    return { &buffer->ring, buffer->thread_index };
+}
+
+void log_write_to_stderr(const LogRecord& record) {
+    std::string out;
+    TimestampCache timestamps;
+
+    format_record(out, wall_clock_ns(), timestamps, record);
+
+    // A single call so lines from different threads do not interleave
+    std::fwrite(out.data(), 1, out.size(), stderr);
+}
+
+void log_record_dropped() {
+    dropped_records.fetch_add(1, std::memory_order_relaxed);
+}
+
+void log_text_cut() {
+    cut_texts.fetch_add(1, std::memory_order_relaxed);
+}
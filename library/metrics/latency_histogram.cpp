@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <metrics/latency_histogram.hpp>
+
+namespace {
+    constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << LATENCY_HISTOGRAM_PRECISION_BITS;
+    constexpr uint64_t MAX_TRACKED_VALUE = (uint64_t(1) << LATENCY_HISTOGRAM_RANGE_BITS) - 1;
+
+    // Values below SUB_BUCKET_COUNT get a bucket each, then SUB_BUCKET_COUNT buckets per power of two
+    constexpr size_t BUCKET_COUNT = (LATENCY_HISTOGRAM_RANGE_BITS - LATENCY_HISTOGRAM_PRECISION_BITS + 1) * SUB_BUCKET_COUNT;
+
+    uint32_t floor_log2(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#else
+        uint32_t log = 0;
+
+        while (value >>= 1)
+        {
+            log++;
+        }
+
+        return log;
+#endif
+    }
+
+    size_t bucket_index(uint64_t value) {
+        value = std::min(value, MAX_TRACKED_VALUE);
+
+        if (value < SUB_BUCKET_COUNT)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        const auto shift = floor_log2(value) - LATENCY_HISTOGRAM_PRECISION_BITS;
+
+        return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT));
+    }
+
+    // Highest value that falls into the bucket
+    uint64_t bucket_upper_bound(size_t index) {
+        if (index < SUB_BUCKET_COUNT)
+        {
+            return index;
+        }
+
+        const auto shift = index / SUB_BUCKET_COUNT - 1;
+        const auto sub_bucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_counts(BUCKET_COUNT, 0)
+    , m_total(0)
+    , m_min(std::numeric_limits<uint64_t>::max())
+    , m_max(0)
+    , m_sum(0.0)
+{}
+
+void LatencyHistogram::record(uint64_t value) {
+    record(value, 1);
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    if (count == 0)
+    {
+        return;
+    }
+
+    m_counts[bucket_index(value)] += count;
+    m_total += count;
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_sum += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.m_total == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        m_counts[i] += other.m_counts[i];
+    }
+
+    m_total += other.m_total;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+
+    m_total = 0;
+    m_min = std::numeric_limits<uint64_t>::max();
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return m_total;
+}
+
+uint64_t LatencyHistogram::min() const {
+    return m_total > 0 ? m_min : 0;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return m_max;
+}
+
+double LatencyHistogram::mean() const {
+    return m_total > 0 ? m_sum / static_cast<double>(m_total) : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    if (m_total == 0)
+    {
+        return 0;
+    }
+
+    percent = std::clamp(percent, 0.0, 100.0);
+
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(m_total))));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += m_counts[i];
+
+        if (seen >= rank)
+        {
+            // The exact extremes are known, never report past them
+            return std::clamp(bucket_upper_bound(i), m_min, m_max);
+        }
+    }
+
+    return m_max;
+}
@@ -0,0 +1,524 @@
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <metrics/stream_metrics.hpp>
+
+namespace {
+    constexpr uint32_t FIRST_BUCKET_BITS = 8;
+
+    uint32_t floor_log2(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#else
+        uint32_t log = 0;
+
+        while (value >>= 1)
+        {
+            log++;
+        }
+
+        return log;
+#endif
+    }
+
+    // Out of range types (a corrupted header) are counted as Unknown
+    size_t payload_type_index(PayloadType payload_type) {
+        const auto index = static_cast<size_t>(payload_type);
+
+        return index < PAYLOAD_TYPE_COUNT ? index : 0;
+    }
+
+    const char* payload_type_label(size_t index) {
+        constexpr const char* LABELS[] = {
+            "Unknown",
+            "ClientHello",
+            "ServerAccept",
+            "ClientGoodbye",
+            "ServerGoodbye",
+            "ClientGameRequest",
+            "ServerGameResponse",
+            "ClientReconnectRequest",
+            "ServerReconnectResponse",
+            "ClientInput",
+            "FrameSnapshot",
+            "Bundle",
+            "ClientInputWindow"
+        };
+
+        static_assert(std::size(LABELS) == PAYLOAD_TYPE_COUNT, "A PayloadType has no label");
+
+        return index < PAYLOAD_TYPE_COUNT ? LABELS[index] : "Unknown";
+    }
+
+    const char* timing_metric_name(size_t index) {
+        switch (static_cast<StreamTiming>(index))
+        {
+            case StreamTiming::Serialize:   { return "shared_stream_serialize_seconds";     }
+            case StreamTiming::Deserialize: { return "shared_stream_deserialize_seconds";   }
+            case StreamTiming::SendBlocked: { return "shared_stream_send_blocked_seconds";  }
+            default:                        { return "shared_stream_unknown_seconds";       }
+        }
+    }
+
+    const char* timing_metric_help(size_t index) {
+        switch (static_cast<StreamTiming>(index))
+        {
+            case StreamTiming::Serialize:   { return "Time spent serializing outgoing packets.";                    }
+            case StreamTiming::Deserialize: { return "Time spent decoding and dispatching incoming payloads.";      }
+            case StreamTiming::SendBlocked: { return "Time spent inside the socket send call.";                    }
+            default:                        { return "";                                                            }
+        }
+    }
+
+    void add_relaxed(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /*
+        Text exposition writer
+    */
+    std::string escape_label(const std::string& value) {
+        std::string escaped;
+
+        escaped.reserve(value.size());
+
+        for (const auto c : value)
+        {
+            switch (c)
+            {
+                case '\\':  { escaped += "\\\\";    break; }
+                case '"':   { escaped += "\\\"";    break; }
+                case '\n':  { escaped += "\\n";     break; }
+                default:    { escaped += c;         break; }
+            }
+        }
+
+        return escaped;
+    }
+
+    std::string format_seconds(uint64_t nanoseconds) {
+        char buffer[32];
+
+        std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+
+        return buffer;
+    }
+
+    void write_header(std::string& out, const char* name, const char* type, const char* help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void write_sample(std::string& out, const char* name, const std::string& labels, const std::string& value) {
+        out += name;
+
+        if (!labels.empty())
+        {
+            out += '{';
+            out += labels;
+            out += '}';
+        }
+
+        out += ' ';
+        out += value;
+        out += '\n';
+    }
+
+    std::string stream_label(const StreamMetricsSnapshot& snapshot) {
+        return "stream=\"" + escape_label(snapshot.name) + "\"";
+    }
+
+    // Gauges describe live streams only, the closed aggregate (always last) is left out of them
+    template <typename Field>
+    void write_stream_value(std::string& out, const std::vector<StreamMetricsSnapshot>& snapshots,
+                            const char* name, const char* type, const char* help, Field field) {
+        const auto is_gauge = std::string(type) == "gauge";
+        const auto count = is_gauge ? snapshots.size() - 1 : snapshots.size();
+
+        write_header(out, name, type, help);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            write_sample(out, name, stream_label(snapshots[i]), std::to_string(field(snapshots[i])));
+        }
+    }
+
+    void write_traffic(std::string& out, const std::vector<StreamMetricsSnapshot>& snapshots) {
+        write_header(out, "shared_stream_packets_total", "counter", "Packets sent and received by payload type.");
+
+        for (const auto& snapshot : snapshots)
+        {
+            for (size_t type = 0; type < PAYLOAD_TYPE_COUNT; type++)
+            {
+                const auto labels = stream_label(snapshot) + ",type=\"" + payload_type_label(type) + "\"";
+
+                if (snapshot.packets_in[type] > 0)
+                {
+                    write_sample(out, "shared_stream_packets_total", labels + ",direction=\"in\"", std::to_string(snapshot.packets_in[type]));
+                }
+
+                if (snapshot.packets_out[type] > 0)
+                {
+                    write_sample(out, "shared_stream_packets_total", labels + ",direction=\"out\"", std::to_string(snapshot.packets_out[type]));
+                }
+            }
+        }
+
+        write_header(out, "shared_stream_bytes_total", "counter", "Wire bytes (headers included) sent and received by payload type.");
+
+        for (const auto& snapshot : snapshots)
+        {
+            for (size_t type = 0; type < PAYLOAD_TYPE_COUNT; type++)
+            {
+                const auto labels = stream_label(snapshot) + ",type=\"" + payload_type_label(type) + "\"";
+
+                if (snapshot.packets_in[type] > 0)
+                {
+                    write_sample(out, "shared_stream_bytes_total", labels + ",direction=\"in\"", std::to_string(snapshot.bytes_in[type]));
+                }
+
+                if (snapshot.packets_out[type] > 0)
+                {
+                    write_sample(out, "shared_stream_bytes_total", labels + ",direction=\"out\"", std::to_string(snapshot.bytes_out[type]));
+                }
+            }
+        }
+    }
+
+    void write_timings(std::string& out, const std::vector<StreamMetricsSnapshot>& snapshots) {
+        for (size_t timing = 0; timing < STREAM_TIMING_COUNT; timing++)
+        {
+            const auto name = std::string(timing_metric_name(timing));
+
+            write_header(out, name.c_str(), "histogram", timing_metric_help(timing));
+
+            for (const auto& snapshot : snapshots)
+            {
+                const auto& histogram = snapshot.timings[timing];
+                const auto labels = stream_label(snapshot);
+                uint64_t cumulative = 0;
+
+                for (size_t i = 0; i < ATOMIC_HISTOGRAM_BUCKET_COUNT; i++)
+                {
+                    cumulative += histogram.buckets[i];
+
+                    write_sample(out, (name + "_bucket").c_str(),
+                                 labels + ",le=\"" + format_seconds(AtomicHistogram::bucket_limit(i)) + "\"",
+                                 std::to_string(cumulative));
+                }
+
+                write_sample(out, (name + "_bucket").c_str(), labels + ",le=\"+Inf\"", std::to_string(histogram.count));
+                write_sample(out, (name + "_sum").c_str(), labels, format_seconds(histogram.sum));
+                write_sample(out, (name + "_count").c_str(), labels, std::to_string(histogram.count));
+            }
+        }
+    }
+}
+
+/*
+    Histogram
+*/
+void AtomicHistogramSnapshot::merge(const AtomicHistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        buckets[i] += other.buckets[i];
+    }
+
+    count += other.count;
+    sum += other.sum;
+}
+
+AtomicHistogram::AtomicHistogram()
+    : m_count(0)
+    , m_sum(0)
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void AtomicHistogram::record(uint64_t value) {
+    size_t index = 0;
+
+    if (value >= (uint64_t(1) << FIRST_BUCKET_BITS))
+    {
+        index = std::min<size_t>(floor_log2(value) - FIRST_BUCKET_BITS + 1, ATOMIC_HISTOGRAM_BUCKET_COUNT);
+    }
+
+    add_relaxed(m_buckets[index], 1);
+    add_relaxed(m_count, 1);
+    add_relaxed(m_sum, value);
+}
+
+AtomicHistogramSnapshot AtomicHistogram::snapshot() const {
+    AtomicHistogramSnapshot snapshot;
+
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+
+    // Bucket counts and the total are read at slightly different times, keep them consistent
+    snapshot.count = 0;
+
+    for (const auto bucket : snapshot.buckets)
+    {
+        snapshot.count += bucket;
+    }
+
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+uint64_t AtomicHistogram::bucket_limit(size_t index) {
+    return uint64_t(1) << (index + FIRST_BUCKET_BITS);
+}
+
+/*
+    Stream metrics
+*/
+void StreamMetricsSnapshot::merge(const StreamMetricsSnapshot& other) {
+    for (size_t i = 0; i < PAYLOAD_TYPE_COUNT; i++)
+    {
+        packets_in[i]   += other.packets_in[i];
+        bytes_in[i]     += other.bytes_in[i];
+        packets_out[i]  += other.packets_out[i];
+        bytes_out[i]    += other.bytes_out[i];
+    }
+
+    resync_skipped_bytes    += other.resync_skipped_bytes;
+    discarded_packets       += other.discarded_packets;
+    send_failures           += other.send_failures;
+    dropped_frames          += other.dropped_frames;
+    dropped_packets         += other.dropped_packets;
+
+    for (size_t i = 0; i < STREAM_TIMING_COUNT; i++)
+    {
+        timings[i].merge(other.timings[i]);
+    }
+}
+
+StreamMetrics::DirectionCounters::DirectionCounters() {
+    for (size_t i = 0; i < PAYLOAD_TYPE_COUNT; i++)
+    {
+        packets[i].store(0, std::memory_order_relaxed);
+        bytes[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+StreamMetrics::StreamMetrics(std::string name)
+    : m_name(std::move(name))
+    , m_resync_skipped_bytes(0)
+    , m_discarded_packets(0)
+    , m_send_failures(0)
+    , m_dropped_frames(0)
+    , m_dropped_packets(0)
+    , m_packet_queue_depth(0)
+    , m_frame_queue_depth(0)
+{}
+
+const std::string& StreamMetrics::name() const {
+    return m_name;
+}
+
+void StreamMetrics::on_sent(PayloadType payload_type, size_t wire_bytes) {
+    const auto index = payload_type_index(payload_type);
+
+    add_relaxed(m_out.packets[index], 1);
+    add_relaxed(m_out.bytes[index], wire_bytes);
+}
+
+void StreamMetrics::on_send_failed() {
+    add_relaxed(m_send_failures, 1);
+}
+
+void StreamMetrics::on_received(PayloadType payload_type, size_t wire_bytes) {
+    const auto index = payload_type_index(payload_type);
+
+    add_relaxed(m_in.packets[index], 1);
+    add_relaxed(m_in.bytes[index], wire_bytes);
+}
+
+void StreamMetrics::on_resync_skipped(size_t bytes) {
+    add_relaxed(m_resync_skipped_bytes, bytes);
+}
+
+void StreamMetrics::on_discarded() {
+    add_relaxed(m_discarded_packets, 1);
+}
+
+void StreamMetrics::on_frames_dropped(size_t count) {
+    add_relaxed(m_dropped_frames, count);
+}
+
+void StreamMetrics::on_packet_dropped() {
+    add_relaxed(m_dropped_packets, 1);
+}
+
+void StreamMetrics::set_packet_queue_depth(size_t depth) {
+    m_packet_queue_depth.store(depth, std::memory_order_relaxed);
+}
+
+void StreamMetrics::set_frame_queue_depth(size_t depth) {
+    m_frame_queue_depth.store(depth, std::memory_order_relaxed);
+}
+
+void StreamMetrics::record_timing(StreamTiming timing, uint64_t nanoseconds) {
+    m_timings[static_cast<size_t>(timing)].record(nanoseconds);
+}
+
+StreamMetricsSnapshot StreamMetrics::snapshot() const {
+    StreamMetricsSnapshot snapshot;
+
+    snapshot.name = m_name;
+
+    for (size_t i = 0; i < PAYLOAD_TYPE_COUNT; i++)
+    {
+        snapshot.packets_in[i]  = m_in.packets[i].load(std::memory_order_relaxed);
+        snapshot.bytes_in[i]    = m_in.bytes[i].load(std::memory_order_relaxed);
+        snapshot.packets_out[i] = m_out.packets[i].load(std::memory_order_relaxed);
+        snapshot.bytes_out[i]   = m_out.bytes[i].load(std::memory_order_relaxed);
+    }
+
+    snapshot.resync_skipped_bytes   = m_resync_skipped_bytes.load(std::memory_order_relaxed);
+    snapshot.discarded_packets      = m_discarded_packets.load(std::memory_order_relaxed);
+    snapshot.send_failures          = m_send_failures.load(std::memory_order_relaxed);
+    snapshot.dropped_frames         = m_dropped_frames.load(std::memory_order_relaxed);
+    snapshot.dropped_packets        = m_dropped_packets.load(std::memory_order_relaxed);
+    snapshot.packet_queue_depth     = m_packet_queue_depth.load(std::memory_order_relaxed);
+    snapshot.frame_queue_depth      = m_frame_queue_depth.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < STREAM_TIMING_COUNT; i++)
+    {
+        snapshot.timings[i] = m_timings[i].snapshot();
+    }
+
+    return snapshot;
+}
+
+/*
+    Registry
+*/
+MetricsRegistry::MetricsRegistry()
+    : m_created(0)
+{
+    m_closed.name = "closed";
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+
+    return registry;
+}
+
+std::shared_ptr<StreamMetrics> MetricsRegistry::create_stream(std::string name) {
+    auto metrics = std::make_shared<StreamMetrics>(std::move(name));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    retire_released();
+
+    m_streams.push_back(metrics);
+    m_created++;
+
+    return metrics;
+}
+
+std::vector<StreamMetricsSnapshot> MetricsRegistry::snapshot() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    retire_released();
+
+    std::vector<StreamMetricsSnapshot> snapshots;
+
+    snapshots.reserve(m_streams.size() + 1);
+
+    for (const auto& metrics : m_streams)
+    {
+        snapshots.push_back(metrics->snapshot());
+    }
+
+    snapshots.push_back(m_closed);
+
+    return snapshots;
+}
+
+std::string MetricsRegistry::export_text() {
+    const auto snapshots = snapshot();
+
+    uint64_t created = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        created = m_created;
+    }
+
+    std::string out;
+
+    out.reserve(4096 + snapshots.size() * 8192);
+
+    write_header(out, "shared_streams_open", "gauge", "Streams with metrics attached.");
+    write_sample(out, "shared_streams_open", "", std::to_string(snapshots.size() - 1));
+
+    write_header(out, "shared_streams_created_total", "counter", "Streams created since the process started.");
+    write_sample(out, "shared_streams_created_total", "", std::to_string(created));
+
+    write_traffic(out, snapshots);
+
+    write_stream_value(out, snapshots, "shared_stream_resync_skipped_bytes_total", "counter",
+        "Bytes skipped while looking for the next packet header.",
+        [](const StreamMetricsSnapshot& s) { return s.resync_skipped_bytes; });
+
+    write_stream_value(out, snapshots, "shared_stream_discarded_packets_total", "counter",
+        "Packets dropped as malformed, undecompressable or of an unknown type.",
+        [](const StreamMetricsSnapshot& s) { return s.discarded_packets; });
+
+    write_stream_value(out, snapshots, "shared_stream_send_failures_total", "counter",
+        "Packets the socket failed to send.",
+        [](const StreamMetricsSnapshot& s) { return s.send_failures; });
+
+    write_stream_value(out, snapshots, "shared_stream_dropped_frames_total", "counter",
+        "Frames replaced by a newer one before they were polled.",
+        [](const StreamMetricsSnapshot& s) { return s.dropped_frames; });
+
+    write_stream_value(out, snapshots, "shared_stream_dropped_packets_total", "counter",
+        "Packets dropped because the packet queue was full.",
+        [](const StreamMetricsSnapshot& s) { return s.dropped_packets; });
+
+    write_stream_value(out, snapshots, "shared_stream_packet_queue_depth", "gauge",
+        "Packets waiting for poll_packet().",
+        [](const StreamMetricsSnapshot& s) { return s.packet_queue_depth; });
+
+    write_stream_value(out, snapshots, "shared_stream_frame_queue_depth", "gauge",
+        "Frames waiting for poll_frame().",
+        [](const StreamMetricsSnapshot& s) { return s.frame_queue_depth; });
+
+    write_timings(out, snapshots);
+
+    return out;
+}
+
+// The registry holds the last reference once the stream is gone
+void MetricsRegistry::retire_released() {
+    auto released = [this](const std::shared_ptr<StreamMetrics>& metrics) {
+        if (metrics.use_count() > 1)
+        {
+            return false;
+        }
+
+        m_closed.merge(metrics->snapshot());
+
+        return true;
+    };
+
+    m_streams.erase(std::remove_if(m_streams.begin(), m_streams.end(), released), m_streams.end());
+}
@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <observation/observation_builder.hpp>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define OBSERVATION_HAS_SSE2 1
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define OBSERVATION_HAS_SSE2 1
+#endif
+
+namespace {
+    // Frames a batch worker claims at once
+    constexpr size_t BATCH_CHUNK_FRAMES = 8;
+
+    // World position of the grid's top left corner and cells per world unit
+    struct GridTransform {
+        float origin_x;
+        float origin_y;
+        float scale_x;
+        float scale_y;
+        int   width;
+        int   height;
+    };
+
+    float* channel_plane(float* grid, ObservationChannel channel, size_t plane_size) {
+        return grid + static_cast<size_t>(channel) * plane_size;
+    }
+
+    void add_span(float* row, int x0, int x1, float value) {
+        int x = x0;
+
+#ifdef OBSERVATION_HAS_SSE2
+        const __m128 values = _mm_set1_ps(value);
+
+        for (; x + 3 <= x1; x += 4)
+        {
+            _mm_storeu_ps(row + x, _mm_add_ps(_mm_loadu_ps(row + x), values));
+        }
+#endif
+
+        for (; x <= x1; x++)
+        {
+            row[x] += value;
+        }
+    }
+
+    void fill_span(float* row, int x0, int x1, float value) {
+        std::fill(row + x0, row + x1 + 1, value);
+    }
+
+    /*
+        Cell index of an already rounded value. Clamped to [-1, size] in float
+        first, converting NaN, infinite or huge floats to int is undefined.
+    */
+    int to_cell(float rounded, int size) {
+        // NaN fails the test too and lands left of (or above) the grid
+        if (!(rounded >= -1.0f))
+        {
+            return -1;
+        }
+
+        return static_cast<int>(std::min(rounded, static_cast<float>(size)));
+    }
+
+#ifdef OBSERVATION_HAS_SSE2
+    /*
+        The rows of for_each_span() four at a time, from y up to y1.
+        Returns the first row left for the scalar loop.
+    */
+    template <typename SpanFunction>
+    int span_rows_sse2(float cx, float cy, float rx, float ry, int width, int y, int y1, bool& covered, SpanFunction& span) {
+        // Most bullets cover fewer than four rows
+        if (y + 3 > y1)
+        {
+            return y;
+        }
+
+        const __m128 cx4 = _mm_set1_ps(cx);
+        const __m128 cy4 = _mm_set1_ps(cy);
+        const __m128 rx4 = _mm_set1_ps(rx);
+        const __m128 ry4 = _mm_set1_ps(ry);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 low = _mm_set1_ps(-1.0f);
+        const __m128 high = _mm_set1_ps(static_cast<float>(width));
+
+        for (; y + 3 <= y1; y += 4)
+        {
+            const __m128 row_y = _mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(y, y + 1, y + 2, y + 3)), half);
+            const __m128 dy = _mm_div_ps(_mm_sub_ps(row_y, cy4), ry4);
+            const __m128 extent = _mm_sub_ps(one, _mm_mul_ps(dy, dy));
+            const __m128 half_width = _mm_mul_ps(rx4, _mm_sqrt_ps(_mm_max_ps(extent, zero)));
+
+            // Clamped like to_cell() before converting, max/min return their second operand for NaN
+            const __m128 left = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_sub_ps(cx4, half_width), half), low), high);
+            const __m128 right = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_add_ps(cx4, half_width), half), low), high);
+
+            // ceil and floor from the truncation, exact for the clamped range
+            const __m128i left_cell = _mm_cvttps_epi32(left);
+            const __m128i right_cell = _mm_cvttps_epi32(right);
+
+            alignas(16) int32_t x0s[4];
+            alignas(16) int32_t x1s[4];
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(x0s),
+                _mm_sub_epi32(left_cell, _mm_castps_si128(_mm_cmplt_ps(_mm_cvtepi32_ps(left_cell), left))));
+            _mm_store_si128(reinterpret_cast<__m128i*>(x1s),
+                _mm_add_epi32(right_cell, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(right_cell), right))));
+
+            const int rows = _mm_movemask_ps(_mm_cmpge_ps(extent, zero));
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                const int x0 = std::max(0, x0s[lane]);
+                const int x1 = std::min(width - 1, x1s[lane]);
+
+                if ((rows & (1 << lane)) != 0 && x0 <= x1)
+                {
+                    span(y + lane, x0, x1);
+                    covered = true;
+                }
+            }
+        }
+
+        return y;
+    }
+#endif
+
+    /*
+        Calls span(y, x0, x1) for every grid row the ellipse (cx, cy, rx, ry),
+        in cells, covers. A cell is covered when its center is inside; an
+        ellipse that covers no center still covers the cell it is in.
+        Four rows are measured at once where SSE2 is available.
+    */
+    template <typename SpanFunction>
+    void for_each_span(float cx, float cy, float rx, float ry, int width, int height, SpanFunction&& span) {
+        const float reach_x = std::max(rx, 0.0f);
+        const float reach_y = std::max(ry, 0.0f);
+
+        // Also rejects NaN positions before they are converted to cells
+        if (!(cx + reach_x >= 0.0f && cx - reach_x < static_cast<float>(width)
+            && cy + reach_y >= 0.0f && cy - reach_y < static_cast<float>(height)))
+        {
+            return;
+        }
+
+        bool covered = false;
+
+        if (rx > 0.0f && ry > 0.0f)
+        {
+            const int y0 = std::max(0, to_cell(std::ceil(cy - ry - 0.5f), height));
+            const int y1 = std::min(height - 1, to_cell(std::floor(cy + ry - 0.5f), height));
+
+            int y = y0;
+
+#ifdef OBSERVATION_HAS_SSE2
+            y = span_rows_sse2(cx, cy, rx, ry, width, y, y1, covered, span);
+#endif
+
+            for (; y <= y1; y++)
+            {
+                const float dy = (static_cast<float>(y) + 0.5f - cy) / ry;
+                const float extent = 1.0f - dy * dy;
+
+                if (extent < 0.0f)
+                {
+                    continue;
+                }
+
+                const float half_width = rx * std::sqrt(extent);
+                const int x0 = std::max(0, to_cell(std::ceil(cx - half_width - 0.5f), width));
+                const int x1 = std::min(width - 1, to_cell(std::floor(cx + half_width - 0.5f), width));
+
+                if (x0 <= x1)
+                {
+                    span(y, x0, x1);
+                    covered = true;
+                }
+            }
+        }
+
+        if (!covered && cx >= 0.0f && cy >= 0.0f && cx < static_cast<float>(width) && cy < static_cast<float>(height))
+        {
+            const int x = static_cast<int>(cx);
+
+            span(static_cast<int>(cy), x, x);
+        }
+    }
+
+    template <typename Entity>
+    void splat_entity(const Entity& entity, float* plane, const GridTransform& transform) {
+        const float cx = (entity.pos.x - transform.origin_x) * transform.scale_x;
+        const float cy = (entity.pos.y - transform.origin_y) * transform.scale_y;
+
+        for_each_span(cx, cy, entity.radius * transform.scale_x, entity.radius * transform.scale_y, transform.width, transform.height,
+            [&](int y, int x0, int x1) {
+                fill_span(plane + static_cast<size_t>(y) * transform.width, x0, x1, 1.0f);
+            });
+    }
+
+    template <typename Entity>
+    void splat_entities(const std::vector<Entity>& entities, float* plane, const GridTransform& transform) {
+        for (const auto& entity : entities)
+        {
+            splat_entity(entity, plane, transform);
+        }
+    }
+
+    /*
+        Culls bullets against the grid and measures their squared distance to
+        (player_x, player_y), writing the indices of the visible ones to visible.
+        Returns how many are visible.
+    */
+    size_t cull_bullets(const float* xs, const float* ys, const float* radii, size_t count,
+                        const GridTransform& transform, float player_x, float player_y,
+                        float* distances, uint32_t* visible) {
+        const float right = transform.origin_x + static_cast<float>(transform.width) / transform.scale_x;
+        const float bottom = transform.origin_y + static_cast<float>(transform.height) / transform.scale_y;
+
+        size_t visible_count = 0;
+        size_t i = 0;
+
+#ifdef OBSERVATION_HAS_SSE2
+        const __m128 left4 = _mm_set1_ps(transform.origin_x);
+        const __m128 top4 = _mm_set1_ps(transform.origin_y);
+        const __m128 right4 = _mm_set1_ps(right);
+        const __m128 bottom4 = _mm_set1_ps(bottom);
+        const __m128 player_x4 = _mm_set1_ps(player_x);
+        const __m128 player_y4 = _mm_set1_ps(player_y);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(xs + i);
+            const __m128 y = _mm_loadu_ps(ys + i);
+            const __m128 r = _mm_loadu_ps(radii + i);
+
+            const __m128 dx = _mm_sub_ps(x, player_x4);
+            const __m128 dy = _mm_sub_ps(y, player_y4);
+
+            _mm_storeu_ps(distances + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+
+            // x + r >= left && x - r < right && y + r >= top && y - r < bottom
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(x, r), left4);
+            inside = _mm_and_ps(inside, _mm_cmplt_ps(_mm_sub_ps(x, r), right4));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(y, r), top4));
+            inside = _mm_and_ps(inside, _mm_cmplt_ps(_mm_sub_ps(y, r), bottom4));
+
+            const int mask = _mm_movemask_ps(inside);
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if ((mask & (1 << lane)) != 0)
+                {
+                    visible[visible_count++] = static_cast<uint32_t>(i + lane);
+                }
+            }
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            const float dx = xs[i] - player_x;
+            const float dy = ys[i] - player_y;
+
+            distances[i] = dx * dx + dy * dy;
+
+            if (xs[i] + radii[i] >= transform.origin_x && xs[i] - radii[i] < right
+                && ys[i] + radii[i] >= transform.origin_y && ys[i] - radii[i] < bottom)
+            {
+                visible[visible_count++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        return visible_count;
+    }
+
+    /*
+        Turns the summed bullet velocities into means and the density into
+        occupancy, four cells at a time
+    */
+    void finish_bullet_planes(float* density, float* occupancy, float* velocity_x, float* velocity_y, size_t plane_size) {
+        size_t i = 0;
+
+#ifdef OBSERVATION_HAS_SSE2
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        for (; i + 4 <= plane_size; i += 4)
+        {
+            const __m128 d = _mm_loadu_ps(density + i);
+            const __m128 inverse = _mm_div_ps(one, _mm_max_ps(d, one));
+
+            _mm_storeu_ps(occupancy + i, _mm_min_ps(d, one));
+            _mm_storeu_ps(velocity_x + i, _mm_mul_ps(_mm_loadu_ps(velocity_x + i), inverse));
+            _mm_storeu_ps(velocity_y + i, _mm_mul_ps(_mm_loadu_ps(velocity_y + i), inverse));
+        }
+#endif
+
+        for (; i < plane_size; i++)
+        {
+            const float inverse = 1.0f / std::max(density[i], 1.0f);
+
+            occupancy[i] = std::min(density[i], 1.0f);
+            velocity_x[i] *= inverse;
+            velocity_y[i] *= inverse;
+        }
+    }
+}
+
+ObservationBuilder::ObservationBuilder(ObservationOptions options)
+    : m_options(options)
+{
+    m_options.grid_width = std::max<uint32_t>(m_options.grid_width, 1);
+    m_options.grid_height = std::max<uint32_t>(m_options.grid_height, 1);
+}
+
+const ObservationOptions& ObservationBuilder::options() const {
+    return m_options;
+}
+
+size_t ObservationBuilder::grid_size() const {
+    return OBSERVATION_CHANNEL_COUNT * m_options.grid_width * m_options.grid_height;
+}
+
+size_t ObservationBuilder::feature_size() const {
+    return static_cast<size_t>(m_options.nearest_bullets) * OBSERVATION_BULLET_FEATURE_COUNT;
+}
+
+size_t ObservationBuilder::observation_size() const {
+    return grid_size() + feature_size();
+}
+
+void ObservationBuilder::build(const FrameSnapshot& frame, float* out) {
+    build(frame, out, m_scratch);
+}
+
+void ObservationBuilder::build_batch(const std::vector<FrameSnapshot>& frames, float* out, size_t thread_count) const {
+    const size_t stride = observation_size();
+    const size_t chunks = (frames.size() + BATCH_CHUNK_FRAMES - 1) / BATCH_CHUNK_FRAMES;
+    std::atomic<size_t> next_chunk{0};
+
+    auto worker = [&]() {
+        Scratch scratch;
+
+        for (auto chunk = next_chunk.fetch_add(1); chunk < chunks; chunk = next_chunk.fetch_add(1))
+        {
+            const size_t end = std::min(frames.size(), (chunk + 1) * BATCH_CHUNK_FRAMES);
+
+            for (size_t i = chunk * BATCH_CHUNK_FRAMES; i < end; i++)
+            {
+                build(frames[i], out + i * stride, scratch);
+            }
+        }
+    };
+
+    const auto workers = std::clamp<size_t>(thread_count, 1, std::max<size_t>(chunks, 1));
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < workers; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void ObservationBuilder::build(const FrameSnapshot& frame, float* out, Scratch& scratch) const {
+    const int width = static_cast<int>(m_options.grid_width);
+    const int height = static_cast<int>(m_options.grid_height);
+    const size_t plane_size = static_cast<size_t>(width) * height;
+
+    /* Observed player, the field center stands in when it is missing */
+    const PlayerSnapshot* player = m_options.player_index < frame.player_vector.size() ? &frame.player_vector[m_options.player_index] : nullptr;
+    const float player_x = player != nullptr ? player->pos.x : m_options.field_width * 0.5f;
+    const float player_y = player != nullptr ? player->pos.y : m_options.field_height * 0.5f;
+
+    GridTransform transform;
+
+    if (m_options.player_centered)
+    {
+        transform.origin_x = player_x - m_options.view_width * 0.5f;
+        transform.origin_y = player_y - m_options.view_height * 0.5f;
+        transform.scale_x = static_cast<float>(width) / m_options.view_width;
+        transform.scale_y = static_cast<float>(height) / m_options.view_height;
+    }
+    else
+    {
+        transform.origin_x = 0.0f;
+        transform.origin_y = 0.0f;
+        transform.scale_x = static_cast<float>(width) / m_options.field_width;
+        transform.scale_y = static_cast<float>(height) / m_options.field_height;
+    }
+
+    transform.width = width;
+    transform.height = height;
+
+    std::fill(out, out + observation_size(), 0.0f);
+
+    /* Bullets to structure-of-arrays */
+    const auto& bullets = frame.bullet_vector;
+    const size_t bullet_count = bullets.size();
+
+    scratch.x.resize(bullet_count);
+    scratch.y.resize(bullet_count);
+    scratch.vx.resize(bullet_count);
+    scratch.vy.resize(bullet_count);
+    scratch.radius.resize(bullet_count);
+    scratch.distance.resize(bullet_count);
+    scratch.visible.resize(bullet_count);
+
+    for (size_t i = 0; i < bullet_count; i++)
+    {
+        scratch.x[i] = bullets[i].pos.x;
+        scratch.y[i] = bullets[i].pos.y;
+        scratch.vx[i] = bullets[i].vel.x;
+        scratch.vy[i] = bullets[i].vel.y;
+        scratch.radius[i] = bullets[i].radius;
+    }
+
+    const size_t visible_count = cull_bullets(scratch.x.data(), scratch.y.data(), scratch.radius.data(), bullet_count,
+                                              transform, player_x, player_y, scratch.distance.data(), scratch.visible.data());
+
+    /* Bullet planes */
+    float* density = channel_plane(out, ObservationChannel::BulletDensity, plane_size);
+    float* velocity_x = channel_plane(out, ObservationChannel::BulletVelocityX, plane_size);
+    float* velocity_y = channel_plane(out, ObservationChannel::BulletVelocityY, plane_size);
+
+    for (size_t v = 0; v < visible_count; v++)
+    {
+        const uint32_t i = scratch.visible[v];
+        const float cx = (scratch.x[i] - transform.origin_x) * transform.scale_x;
+        const float cy = (scratch.y[i] - transform.origin_y) * transform.scale_y;
+        const float vx = scratch.vx[i];
+        const float vy = scratch.vy[i];
+
+        for_each_span(cx, cy, scratch.radius[i] * transform.scale_x, scratch.radius[i] * transform.scale_y, width, height,
+            [&](int y, int x0, int x1) {
+                const size_t row = static_cast<size_t>(y) * width;
+
+                add_span(density + row, x0, x1, 1.0f);
+                add_span(velocity_x + row, x0, x1, vx);
+                add_span(velocity_y + row, x0, x1, vy);
+            });
+    }
+
+    finish_bullet_planes(density, channel_plane(out, ObservationChannel::BulletOccupancy, plane_size), velocity_x, velocity_y, plane_size);
+
+    /* Other entities */
+    float* enemies = channel_plane(out, ObservationChannel::Enemies, plane_size);
+
+    splat_entities(frame.enemy_vector, enemies, transform);
+    splat_entities(frame.boss_vector, enemies, transform);
+    splat_entities(frame.item_vector, channel_plane(out, ObservationChannel::Items, plane_size), transform);
+
+    if (player != nullptr)
+    {
+        splat_entity(*player, channel_plane(out, ObservationChannel::Player, plane_size), transform);
+    }
+
+    /* Nearest bullets, closest first */
+    const size_t nearest = std::min<size_t>(m_options.nearest_bullets, bullet_count);
+
+    if (nearest == 0)
+    {
+        return;
+    }
+
+    // Bullets at NaN positions are left out (without a branch), closer() is only a strict weak ordering without them
+    scratch.order.resize(bullet_count);
+
+    size_t candidates = 0;
+
+    for (size_t i = 0; i < bullet_count; i++)
+    {
+        scratch.order[candidates] = static_cast<uint32_t>(i);
+        candidates += std::isnan(scratch.distance[i]) ? 0 : 1;
+    }
+
+    const size_t ranked = std::min(nearest, candidates);
+
+    const auto closer = [&](uint32_t a, uint32_t b) {
+        return scratch.distance[a] < scratch.distance[b] || (scratch.distance[a] == scratch.distance[b] && a < b);
+    };
+
+    std::partial_sort(scratch.order.begin(), scratch.order.begin() + ranked, scratch.order.begin() + candidates, closer);
+
+    float* features = out + grid_size();
+
+    for (size_t k = 0; k < ranked; k++)
+    {
+        const uint32_t i = scratch.order[k];
+        float* feature = features + k * OBSERVATION_BULLET_FEATURE_COUNT;
+
+        feature[0] = scratch.x[i] - player_x;
+        feature[1] = scratch.y[i] - player_y;
+        feature[2] = scratch.vx[i];
+        feature[3] = scratch.vy[i];
+        feature[4] = scratch.radius[i];
+        feature[5] = 1.0f;
+    }
+}
@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <cstring>
+#include <packet_serializer/bundle_serializer.hpp>
+
+/*
+    Serializer
+*/
+bool append_bundle_entry(std::vector<std::byte>& bundle, PayloadType payload_type, const std::vector<std::byte>& payload) {
+    const auto type_value = static_cast<uint32_t>(payload_type);
+
+    if (payload.size() > MAX_BUNDLE_ENTRY_SIZE ||
+        type_value > UINT8_MAX ||
+        payload_type == PayloadType::Unknown ||
+        payload_type == PayloadType::Bundle)
+    {
+        return false;
+    }
+
+    const auto offset = bundle.size();
+    const auto entry_size = static_cast<uint16_t>(payload.size());
+
+    bundle.resize(offset + BUNDLE_ENTRY_HEADER_SIZE + payload.size());
+
+    bundle[offset] = static_cast<std::byte>(type_value);
+    std::memcpy(bundle.data() + offset + 1, &entry_size, sizeof(entry_size));
+
+    if (!payload.empty())
+    {
+        std::memcpy(bundle.data() + offset + BUNDLE_ENTRY_HEADER_SIZE, payload.data(), payload.size());
+    }
+
+    return true;
+}
+
+/*
+    Deserializer
+*/
+std::optional<std::vector<BundleEntry>> deserialize_bundle(const std::vector<std::byte>& bundle) {
+    return deserialize_bundle(bundle.data(), bundle.size());
+}
+
+std::optional<std::vector<BundleEntry>> deserialize_bundle(const std::byte* bundle, size_t size) {
+    std::vector<BundleEntry> entries;
+    size_t offset = 0;
+
+    while (offset < size)
+    {
+        if (size - offset < BUNDLE_ENTRY_HEADER_SIZE)
+        {
+            return std::nullopt;
+        }
+
+        const auto payload_type = static_cast<PayloadType>(std::to_integer<uint8_t>(bundle[offset]));
+        uint16_t entry_size = 0;
+
+        std::memcpy(&entry_size, bundle + offset + 1, sizeof(entry_size));
+        offset += BUNDLE_ENTRY_HEADER_SIZE;
+
+        if (size - offset < entry_size ||
+            payload_type == PayloadType::Unknown ||
+            payload_type == PayloadType::Bundle ||
+            static_cast<size_t>(payload_type) >= PAYLOAD_TYPE_COUNT)
+        {
+            return std::nullopt;
+        }
+
+        entries.push_back(BundleEntry {
+            payload_type,
+            offset,
+            entry_size
+        });
+
+        offset += entry_size;
+    }
+
+    return entries;
+}
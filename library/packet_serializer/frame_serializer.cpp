@@ -1,5 +1,5 @@
-#include <iostream>
 #include <cstring>
+#include <logger/log_macros.hpp>
 #include <packet_serializer/frame_serializer.hpp>
 
 namespace {
@@ -10,6 +10,38 @@ namespace {
 
         return src + sizeof(T);
     }
+
+    /*
+        Reads a u32 count followed by that many T, refuses counts
+        that would run past the end of the buffer
+    */
+    template <typename T>
+    bool copy_objects_to_vector(uint32_t& count, std::vector<T>& dest, const std::byte*& src, const std::byte* end) {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+        if (static_cast<size_t>(end - src) < sizeof(count))
+        {
+            return false;
+        }
+
+        src = copy_bytes_to_t(&count, src);
+
+        if (count > static_cast<size_t>(end - src) / sizeof(T))
+        {
+            return false;
+        }
+
+        dest.resize(count);
+
+        if (count > 0)
+        {
+            memcpy(dest.data(), src, sizeof(T) * count);
+        }
+
+        src += sizeof(T) * count;
+
+        return true;
+    }
 }
 
 /*
@@ -26,8 +58,7 @@ std::optional<std::vector<std::byte>> serialize_frame(const FrameSnapshot& frame
     if (player_count_validation || enemy_count_validation || boss_count_validation ||
         bullet_count_validation || item_count_validation)
     {
-        std::cerr << "[serialize_frame] Failed to serialize frame" << "\n";
-        std::cerr << "[serialize_frame] The number of objects and the size of objects does not match" << "\n";
+        LOG_ERROR("[serialize_frame] Failed to serialize frame, the number of objects and the size of objects does not match");
         
         return std::nullopt;
     }
@@ -158,9 +189,29 @@ std::optional<std::vector<std::byte>> serialize_frame(const FrameSnapshot& frame
 /*
     Deserializer
 */
-std::optional<FrameSnapshot> deserialize_frame(const std::vector<std::byte>& bytes) {
+std::optional<FrameSnapshot> deserialize_frame(const std::byte* data, size_t size) {
     FrameSnapshot frame = {};
-    auto bytes_offset = bytes.data();
+
+    if (!deserialize_frame_into(data, size, frame))
+    {
+        return std::nullopt;
+    }
+
+    return frame;
+}
+
+std::optional<FrameSnapshot> deserialize_frame(const std::vector<std::byte>& bytes) {
+    return deserialize_frame(bytes.data(), bytes.size());
+}
+
+bool deserialize_frame_into(const std::byte* data, size_t size, FrameSnapshot& frame) {
+    if (size < FRAME_SNAPSHOT_FIXED_AREA_SIZE + STAGE_SNAPSHOT_SIZE)
+    {
+        return false;
+    }
+
+    auto bytes_offset = data;
+    const auto bytes_end = data + size;
 
     // Copy the fixed area of the frame object
     bytes_offset = copy_bytes_to_t(&frame.client_id,    bytes_offset);
@@ -175,65 +226,16 @@ std::optional<FrameSnapshot> deserialize_frame(const std::vector<std::byte>& byt
     // Copy the stage object
     bytes_offset = copy_bytes_to_t(&frame.stage, bytes_offset);
 
-    // Acquire the number of players and then copy the player objects
-    bytes_offset = copy_bytes_to_t(&frame.player_count, bytes_offset);
-    frame.player_vector.resize(frame.player_count);
-
-    memcpy(
-        frame.player_vector.data(),
-        bytes_offset,
-        PLAYER_SNAPSHOT_SIZE * frame.player_count
-    );
+    // Acquire the number of objects of every kind and then copy the objects
+    const auto players = copy_objects_to_vector(frame.player_count, frame.player_vector, bytes_offset, bytes_end);
+    const auto enemies = players && copy_objects_to_vector(frame.enemy_count, frame.enemy_vector, bytes_offset, bytes_end);
+    const auto bosses = enemies && copy_objects_to_vector(frame.boss_count, frame.boss_vector, bytes_offset, bytes_end);
+    const auto bullets = bosses && copy_objects_to_vector(frame.bullet_count, frame.bullet_vector, bytes_offset, bytes_end);
+    const auto items = bullets && copy_objects_to_vector(frame.item_count, frame.item_vector, bytes_offset, bytes_end);
 
-    bytes_offset += PLAYER_SNAPSHOT_SIZE * frame.player_count;
-
-    // Acquire the number of enemies and then copy the enemy objects
-    bytes_offset = copy_bytes_to_t(&frame.enemy_count, bytes_offset);
-    frame.enemy_vector.resize(frame.enemy_count);
-
-    memcpy(
-        frame.enemy_vector.data(),
-        bytes_offset,
-        ENEMY_SNAPSHOT_SIZE * frame.enemy_count
-    );
-
-    bytes_offset += ENEMY_SNAPSHOT_SIZE * frame.enemy_count;
-
-    // // Acquire the number of bosses and then copy the boss objects
-    bytes_offset = copy_bytes_to_t(&frame.boss_count, bytes_offset);
-    frame.boss_vector.resize(frame.boss_count);
-
-    memcpy(
-        frame.boss_vector.data(),
-        bytes_offset,
-        BOSS_SNAPSHOT_SIZE * frame.boss_count
-    );
-
-    bytes_offset += BOSS_SNAPSHOT_SIZE * frame.boss_count;
-
-    // // Acquire the number of bullets and then copy the bullet objects
-    bytes_offset = copy_bytes_to_t(&frame.bullet_count, bytes_offset);
-    frame.bullet_vector.resize(frame.bullet_count);
-
-    memcpy(
-        frame.bullet_vector.data(),
-        bytes_offset,
-        BULLET_SNAPSHOT_SIZE * frame.bullet_count
-    );
-
-    bytes_offset += BULLET_SNAPSHOT_SIZE * frame.bullet_count;
-
-    // Acquire the number of items and then copy the item objects
-    bytes_offset = copy_bytes_to_t(&frame.item_count, bytes_offset);
-    frame.item_vector.resize(frame.item_count);
-
-    memcpy(
-        frame.item_vector.data(),
-        bytes_offset,
-        ITEM_SNAPSHOT_SIZE * frame.item_count
-    );
-
-    bytes_offset += ITEM_SNAPSHOT_SIZE * frame.item_count;
+    return items;
+}
 
-    return frame;
-}
\ No newline at end of file
+bool deserialize_frame_into(const std::vector<std::byte>& bytes, FrameSnapshot& frame) {
+    return deserialize_frame_into(bytes.data(), bytes.size(), frame);
+}
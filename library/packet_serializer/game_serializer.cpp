@@ -1,10 +1,31 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstddef>
 #include <cstring>
 #include <vector>
 #include <optional>
 #include <packet_serializer/game_serializer.hpp>
 
 namespace {
+    /*
+        Responses are sent as the struct truncated right after the used part of
+        'reason' (fixed area + reason_size bytes) instead of the full 256 byte
+        buffer. Since the layout of the prefix is unchanged, full-size messages
+        from older peers still decode.
+    */
+    constexpr size_t SERVER_GAME_RESPONSE_FIXED_SIZE = offsetof(ServerGameResponse, reason);
+    constexpr size_t SERVER_RECONNECT_RESPONSE_FIXED_SIZE = offsetof(ServerReconnectResponse, reason);
+
+    template <typename T>
+    void write_at(std::vector<std::byte>& buffer, size_t offset, const T& value) {
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    void read_at(const std::vector<std::byte>& buffer, size_t offset, T& value) {
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+    }
+
     /*
         Helper: serialize trivial POD types
     */
@@ -36,7 +57,18 @@ std::vector<std::byte> serialize_client_game_request(const ClientGameRequest& pa
 }
 
 std::vector<std::byte> serialize_server_game_response(const ServerGameResponse& payload) {
-    return serialize_trivial_struct(payload);
+    const auto reason_size = std::min<uint32_t>(payload.reason_size, MAX_MESSAGE_SIZE);
+
+    // Value-initialized, so the padding never carries stale memory
+    std::vector<std::byte> buffer(SERVER_GAME_RESPONSE_FIXED_SIZE + reason_size);
+
+    write_at(buffer, offsetof(ServerGameResponse, accepted),    payload.accepted);
+    write_at(buffer, offsetof(ServerGameResponse, session_id),  payload.session_id);
+    write_at(buffer, offsetof(ServerGameResponse, reason_size), reason_size);
+
+    std::memcpy(buffer.data() + SERVER_GAME_RESPONSE_FIXED_SIZE, payload.reason, reason_size);
+
+    return buffer;
 }
 
 std::vector<std::byte> serialize_client_reconnect_request(const ClientReconnectRequest& payload) {
@@ -44,7 +76,16 @@ std::vector<std::byte> serialize_client_reconnect_request(const ClientReconnectR
 }
 
 std::vector<std::byte> serialize_server_reconnect_response(const ServerReconnectResponse& payload) {
-    return serialize_trivial_struct(payload);
+    const auto reason_size = std::min<uint32_t>(payload.reason_size, MAX_MESSAGE_SIZE);
+
+    std::vector<std::byte> buffer(SERVER_RECONNECT_RESPONSE_FIXED_SIZE + reason_size);
+
+    write_at(buffer, offsetof(ServerReconnectResponse, accepted),    payload.accepted);
+    write_at(buffer, offsetof(ServerReconnectResponse, reason_size), reason_size);
+
+    std::memcpy(buffer.data() + SERVER_RECONNECT_RESPONSE_FIXED_SIZE, payload.reason, reason_size);
+
+    return buffer;
 }
 
 /*
@@ -55,7 +96,27 @@ std::optional<ClientGameRequest> deserialize_client_game_request(const std::vect
 }
 
 std::optional<ServerGameResponse> deserialize_server_game_response(const std::vector<std::byte>& buffer) {
-    return deserialize_trivial_struct<ServerGameResponse>(buffer);
+    if (buffer.size() < SERVER_GAME_RESPONSE_FIXED_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    ServerGameResponse result = {};
+
+    read_at(buffer, offsetof(ServerGameResponse, accepted),    result.accepted);
+    read_at(buffer, offsetof(ServerGameResponse, session_id),  result.session_id);
+    read_at(buffer, offsetof(ServerGameResponse, reason_size), result.reason_size);
+
+    // The declared reason must fit both the struct and the received bytes
+    if (result.reason_size > MAX_MESSAGE_SIZE ||
+        buffer.size() < SERVER_GAME_RESPONSE_FIXED_SIZE + result.reason_size)
+    {
+        return std::nullopt;
+    }
+
+    std::memcpy(result.reason, buffer.data() + SERVER_GAME_RESPONSE_FIXED_SIZE, result.reason_size);
+
+    return result;
 }
 
 std::optional<ClientReconnectRequest> deserialize_client_reconnect_request(const std::vector<std::byte>& buffer) {
@@ -63,5 +124,24 @@ std::optional<ClientReconnectRequest> deserialize_client_reconnect_request(const
 }
 
 std::optional<ServerReconnectResponse> deserialize_server_reconnect_response(const std::vector<std::byte>& buffer) {
-    return deserialize_trivial_struct<ServerReconnectResponse>(buffer);
+    if (buffer.size() < SERVER_RECONNECT_RESPONSE_FIXED_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    ServerReconnectResponse result = {};
+
+    read_at(buffer, offsetof(ServerReconnectResponse, accepted),    result.accepted);
+    read_at(buffer, offsetof(ServerReconnectResponse, reason_size), result.reason_size);
+
+    // The declared reason must fit both the struct and the received bytes
+    if (result.reason_size > MAX_MESSAGE_SIZE ||
+        buffer.size() < SERVER_RECONNECT_RESPONSE_FIXED_SIZE + result.reason_size)
+    {
+        return std::nullopt;
+    }
+
+    std::memcpy(result.reason, buffer.data() + SERVER_RECONNECT_RESPONSE_FIXED_SIZE, result.reason_size);
+
+    return result;
 }
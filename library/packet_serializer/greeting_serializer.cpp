@@ -1,8 +1,23 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstddef>
 #include <cstring>
 #include <packet_serializer/greeting_serializer.hpp>
 
 namespace {
+    constexpr size_t CLIENT_HELLO_FIXED_SIZE = offsetof(ClientHello, client_name);
+
+    /*
+        Set in client_name_size on the wire when the capabilities and the dictionary id
+        follow the name. Older peers send the full struct with the plain size, which never
+        reaches this bit, so their hellos can not be mistaken for one carrying capabilities.
+    */
+    constexpr uint32_t CLIENT_HELLO_CAPABILITIES_FLAG = 1u << 31;
+    constexpr size_t CLIENT_HELLO_EXTENSION_SIZE = sizeof(ClientHello::capabilities) + sizeof(ClientHello::dictionary_id);
+
+    // ServerAccept from peers without capability negotiation
+    constexpr size_t SERVER_ACCEPT_LEGACY_SIZE = offsetof(ServerAccept, capabilities);
+
     /*
         Helper function that serialize any trivial struct into a std::vector<std::byte>
     */
@@ -33,8 +48,24 @@ namespace {
 /*
     Serializer
 */
+/*
+    ClientHello is sent as client_name_size (with CLIENT_HELLO_CAPABILITIES_FLAG set)
+    followed by the used part of client_name, the capabilities and the dictionary id,
+    so full-size hellos from older peers still decode
+*/
 std::vector<std::byte> serialize_client_hello(const ClientHello& payload) {
-    return serialize_trivial_struct(payload);
+    const auto name_size = std::min<uint32_t>(payload.client_name_size, MAX_CLIENT_NAME_SIZE);
+    const auto wire_name_size = name_size | CLIENT_HELLO_CAPABILITIES_FLAG;
+    const auto extension_offset = CLIENT_HELLO_FIXED_SIZE + name_size;
+
+    std::vector<std::byte> buffer(extension_offset + CLIENT_HELLO_EXTENSION_SIZE);
+
+    std::memcpy(buffer.data(), &wire_name_size, sizeof(wire_name_size));
+    std::memcpy(buffer.data() + CLIENT_HELLO_FIXED_SIZE, payload.client_name, name_size);
+    std::memcpy(buffer.data() + extension_offset, &payload.capabilities, sizeof(payload.capabilities));
+    std::memcpy(buffer.data() + extension_offset + sizeof(payload.capabilities), &payload.dictionary_id, sizeof(payload.dictionary_id));
+
+    return buffer;
 }
 
 std::vector<std::byte> serialize_server_accept(const ServerAccept& payload) {
@@ -53,23 +84,61 @@ std::vector<std::byte> serialize_server_goodbye(const ServerGoodbye& payload) {
     Deserializer
 */
 std::optional<ClientHello> deserialize_client_hello(const std::vector<std::byte>& buffer) {
-    if (buffer.size() < CLIENT_HELLO_SIZE)
+    if (buffer.size() < CLIENT_HELLO_FIXED_SIZE)
     {
         return std::nullopt;
     }
 
-    ClientHello result;
+    ClientHello result = {};
+
+    uint32_t wire_name_size = 0;
+    std::memcpy(&wire_name_size, buffer.data(), sizeof(wire_name_size));
+
+    const auto has_capabilities = (wire_name_size & CLIENT_HELLO_CAPABILITIES_FLAG) != 0;
+
+    result.client_name_size = wire_name_size & ~CLIENT_HELLO_CAPABILITIES_FLAG;
+
+    // The declared name must fit both the struct and the received bytes
+    if (result.client_name_size > MAX_CLIENT_NAME_SIZE ||
+        buffer.size() < CLIENT_HELLO_FIXED_SIZE + result.client_name_size)
+    {
+        return std::nullopt;
+    }
 
-    std::memcpy(&result.client_name_size, buffer.data(), sizeof(result.client_name_size));
     std::memcpy(result.client_name,
-                buffer.data() + sizeof(result.client_name_size),
-                MAX_CLIENT_NAME_SIZE);
+                buffer.data() + CLIENT_HELLO_FIXED_SIZE,
+                result.client_name_size);
+
+    // Hellos from older peers carry no capabilities and negotiate nothing
+    if (!has_capabilities)
+    {
+        return result;
+    }
+
+    const auto extension_offset = CLIENT_HELLO_FIXED_SIZE + result.client_name_size;
+
+    if (buffer.size() != extension_offset + CLIENT_HELLO_EXTENSION_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    std::memcpy(&result.capabilities, buffer.data() + extension_offset, sizeof(result.capabilities));
+    std::memcpy(&result.dictionary_id, buffer.data() + extension_offset + sizeof(result.capabilities), sizeof(result.dictionary_id));
 
     return result;
 }
 
 std::optional<ServerAccept> deserialize_server_accept(const std::vector<std::byte>& buffer) {
-    return deserialize_trivial_struct<ServerAccept>(buffer);
+    if (buffer.size() < SERVER_ACCEPT_LEGACY_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    ServerAccept result = {};
+
+    std::memcpy(&result, buffer.data(), std::min(buffer.size(), sizeof(ServerAccept)));
+
+    return result;
 }
 
 std::optional<ClientGoodbye> deserialize_client_goodbye(const std::vector<std::byte>& buffer) {
@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <cstring>
+#include <limits>
 #include <packet_serializer/header_serializer.hpp>
 
 namespace {
@@ -29,6 +30,14 @@ namespace {
 
         return result;
     }
+
+    // Picks the 32-bit sequence whose low 16 bits are 'low' and which is closest to last + 1
+    uint32_t extend_sequence(uint32_t last_sequence, uint16_t low) {
+        const uint32_t expected = last_sequence + 1;
+        const auto delta = static_cast<int16_t>(static_cast<uint16_t>(low - static_cast<uint16_t>(expected)));
+
+        return expected + static_cast<int32_t>(delta);
+    }
 }
 
 /*
@@ -51,3 +60,135 @@ std::optional<PacketHeader> deserialize_packet_header(const std::vector<std::byt
 
     return header_opt;
 }
+
+/*
+    Serialize compact header
+*/
+std::vector<std::byte> serialize_compact_header(const PacketHeader& header, bool with_sequence) {
+    std::vector<std::byte> buffer(COMPACT_HEADER_MAX_SIZE);
+
+    buffer.resize(encode_compact_header(header, with_sequence, buffer.data()));
+
+    return buffer;
+}
+
+size_t encode_compact_header(const PacketHeader& header, bool with_sequence, std::byte* out) {
+    size_t size = 0;
+
+    auto first = static_cast<uint8_t>(static_cast<uint32_t>(header.payload_type) & COMPACT_HEADER_TYPE_MASK);
+
+    if (with_sequence)
+    {
+        first |= COMPACT_HEADER_SEQUENCE_FLAG;
+    }
+
+    if (is_payload_compressed(header))
+    {
+        first |= COMPACT_HEADER_COMPRESSED_FLAG;
+    }
+
+    out[size++] = static_cast<std::byte>(first);
+
+    // LEB128 payload size
+    auto payload_size = header.payload_size;
+
+    while (payload_size >= 0x80)
+    {
+        out[size++] = static_cast<std::byte>((payload_size & 0x7F) | 0x80);
+        payload_size >>= 7;
+    }
+
+    out[size++] = static_cast<std::byte>(payload_size);
+
+    if (with_sequence)
+    {
+        const auto sequence = static_cast<uint16_t>(header.sequence_number);
+
+        out[size++] = static_cast<std::byte>(sequence & 0xFF);
+        out[size++] = static_cast<std::byte>(sequence >> 8);
+    }
+
+    return size;
+}
+
+/*
+    Deserialize compact header
+*/
+CompactHeaderStatus deserialize_compact_header(const std::byte* data, size_t size, uint32_t last_sequence,
+                                               PacketHeader& header, size_t& header_size) {
+    if (size == 0)
+    {
+        return CompactHeaderStatus::Incomplete;
+    }
+
+    const auto first = std::to_integer<uint8_t>(data[0]);
+    const auto type = static_cast<size_t>(first & COMPACT_HEADER_TYPE_MASK);
+
+    if ((first & 0x80) != 0 || type == 0 || type >= PAYLOAD_TYPE_COUNT)
+    {
+        return CompactHeaderStatus::Invalid;
+    }
+
+    size_t offset = 1;
+    uint64_t payload_size = 0;
+
+    for (uint32_t shift = 0; ; shift += 7)
+    {
+        if (offset >= size)
+        {
+            return CompactHeaderStatus::Incomplete;
+        }
+
+        // A u32 needs at most 5 varint bytes
+        if (shift > 28)
+        {
+            return CompactHeaderStatus::Invalid;
+        }
+
+        const auto byte = std::to_integer<uint8_t>(data[offset++]);
+
+        payload_size |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+
+    if (payload_size > std::numeric_limits<uint32_t>::max())
+    {
+        return CompactHeaderStatus::Invalid;
+    }
+
+    uint32_t sequence = last_sequence + 1;
+
+    if ((first & COMPACT_HEADER_SEQUENCE_FLAG) != 0)
+    {
+        if (size - offset < sizeof(uint16_t))
+        {
+            return CompactHeaderStatus::Incomplete;
+        }
+
+        const auto low = static_cast<uint16_t>(
+            std::to_integer<uint16_t>(data[offset]) |
+            (std::to_integer<uint16_t>(data[offset + 1]) << 8)
+        );
+
+        sequence = extend_sequence(last_sequence, low);
+        offset += sizeof(uint16_t);
+    }
+
+    header.magic_number     = PACKET_MAGIC_NUMBER;
+    header.sequence_number  = sequence;
+    header.payload_size     = static_cast<uint32_t>(payload_size);
+    header.payload_type     = static_cast<PayloadType>(type);
+
+    if ((first & COMPACT_HEADER_COMPRESSED_FLAG) != 0)
+    {
+        header.payload_type = static_cast<PayloadType>(type | PAYLOAD_COMPRESSED_FLAG);
+    }
+
+    header_size = offset;
+
+    return CompactHeaderStatus::Complete;
+}
@@ -3,126 +3,201 @@
 #include <packet_serializer/input_serializer.hpp>
 
 namespace {
-    template <size_t N>
-    void serialize_bitset(const std::bitset<N>& bits, std::vector<std::byte>& out) {
-        constexpr size_t byte_size = (N + 7) / 8;
+    constexpr size_t GAME_ACTION_COUNT = static_cast<size_t>(GameAction::Count);
+    constexpr size_t ARROW_COUNT = static_cast<size_t>(Arrow::Count);
 
-        for (size_t i = 0; i < byte_size; i++)
-        {
-            uint8_t byte = 0;
+    /*
+        Bit layout of the packed input word (LSB first)
+        [game held][game pressed][game released][arrow held][arrow pressed][arrow released]
+    */
+    constexpr uint32_t GAME_HELD_SHIFT      = 0;
+    constexpr uint32_t GAME_PRESSED_SHIFT   = GAME_HELD_SHIFT + GAME_ACTION_COUNT;
+    constexpr uint32_t GAME_RELEASED_SHIFT  = GAME_PRESSED_SHIFT + GAME_ACTION_COUNT;
+    constexpr uint32_t ARROW_HELD_SHIFT     = GAME_RELEASED_SHIFT + GAME_ACTION_COUNT;
+    constexpr uint32_t ARROW_PRESSED_SHIFT  = ARROW_HELD_SHIFT + ARROW_COUNT;
+    constexpr uint32_t ARROW_RELEASED_SHIFT = ARROW_PRESSED_SHIFT + ARROW_COUNT;
+    constexpr uint32_t INPUT_BITS_USED      = ARROW_RELEASED_SHIFT + ARROW_COUNT;
 
-            for (size_t b = 0; b < 8; b++)
-            {
-                size_t bit_index = i * 8 + b;
+    static_assert(INPUT_BITS_USED <= 32, "The packed input no longer fits in one word");
 
-                if (bit_index < N && bits[bit_index])
-                {
-                    byte |= (1 << b);
-                }
-            }
+    constexpr uint32_t GAME_ACTION_MASK = (1u << GAME_ACTION_COUNT) - 1;
+    constexpr uint32_t ARROW_MASK = (1u << ARROW_COUNT) - 1;
 
-            out.push_back(static_cast<std::byte>(byte));
-        }
+    void write_u32(std::byte* out, uint32_t value) {
+        out[0] = static_cast<std::byte>(value & 0xFF);
+        out[1] = static_cast<std::byte>((value >> 8) & 0xFF);
+        out[2] = static_cast<std::byte>((value >> 16) & 0xFF);
+        out[3] = static_cast<std::byte>((value >> 24) & 0xFF);
+    }
+
+    uint32_t read_u32(const std::byte* in) {
+        return static_cast<uint32_t>(std::to_integer<uint8_t>(in[0]))
+             | static_cast<uint32_t>(std::to_integer<uint8_t>(in[1])) << 8
+             | static_cast<uint32_t>(std::to_integer<uint8_t>(in[2])) << 16
+             | static_cast<uint32_t>(std::to_integer<uint8_t>(in[3])) << 24;
     }
 
     template <size_t N>
-    std::bitset<N> deserialize_bitset(const std::vector<std::byte>& in, size_t& offset) {
-        constexpr size_t byte_size = (N + 7) / 8;
-        std::bitset<N> bits;
+    uint32_t pack_bits(const std::bitset<N>& bits, uint32_t shift) {
+        return static_cast<uint32_t>(bits.to_ulong()) << shift;
+    }
+
+    template <size_t N>
+    std::bitset<N> unpack_bits(uint32_t word, uint32_t shift, uint32_t mask) {
+        return std::bitset<N>((word >> shift) & mask);
+    }
 
-        for (size_t i = 0; i < byte_size; i++)
+    void write_varint(std::vector<std::byte>& out, uint32_t value) {
+        while (value >= 0x80)
         {
-            uint8_t byte = std::to_integer<uint8_t>(in[offset++]);
+            out.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<std::byte>(value));
+    }
+
+    bool read_varint(const std::vector<std::byte>& in, size_t& offset, uint32_t& value) {
+        uint64_t result = 0;
 
-            for (size_t b = 0; b < 8; b++)
+        for (uint32_t shift = 0; shift <= 28; shift += 7)
+        {
+            if (offset >= in.size())
             {
-                size_t bit_index = i * 8 + b;
+                return false;
+            }
+
+            const auto byte = std::to_integer<uint8_t>(in[offset++]);
+
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
 
-                if (bit_index < N)
+            if ((byte & 0x80) == 0)
+            {
+                if (result > UINT32_MAX)
                 {
-                    bits[bit_index] = (byte >> b) & 1;
+                    return false;
                 }
+
+                value = static_cast<uint32_t>(result);
+
+                return true;
             }
         }
 
-        return bits;
+        return false;
     }
 
     /*
-        Arrow state
+        Legacy layout: client_id, frame_timestamp and one byte per bitset
+        (game held/pressed/released, arrow held/pressed/released)
     */
-    void serialize_arrow_state(const ArrowState& arrows, std::vector<std::byte>& out) {
-        serialize_bitset(arrows.held,       out);
-        serialize_bitset(arrows.pressed,    out);
-        serialize_bitset(arrows.released,   out);
-    }
+    ClientInput decode_legacy_client_input(const std::byte* data) {
+        const auto byte_at = [data](size_t index) {
+            return static_cast<uint32_t>(std::to_integer<uint8_t>(data[index]));
+        };
 
-    ArrowState deserialize_arrow_state(const std::vector<std::byte>& buffer, size_t& offset) {
-        constexpr size_t ARROW_COUNT = static_cast<size_t>(Arrow::Count);
+        const uint32_t word = ((byte_at(8)  & GAME_ACTION_MASK) << GAME_HELD_SHIFT)
+                            | ((byte_at(9)  & GAME_ACTION_MASK) << GAME_PRESSED_SHIFT)
+                            | ((byte_at(10) & GAME_ACTION_MASK) << GAME_RELEASED_SHIFT)
+                            | ((byte_at(11) & ARROW_MASK)       << ARROW_HELD_SHIFT)
+                            | ((byte_at(12) & ARROW_MASK)       << ARROW_PRESSED_SHIFT)
+                            | ((byte_at(13) & ARROW_MASK)       << ARROW_RELEASED_SHIFT);
 
-        return ArrowState {
-            deserialize_bitset<ARROW_COUNT>(buffer, offset),  // held
-            deserialize_bitset<ARROW_COUNT>(buffer, offset),  // pressed
-            deserialize_bitset<ARROW_COUNT>(buffer, offset)   // released
+        return ClientInput {
+            read_u32(data),         // client_id
+            read_u32(data + 4),     // frame_timestamp
+            unpack_game_input(word) // state
         };
     }
+}
 
-    /*
-        Game input
-    */
-    void serialize_game_input(const GameInput& input, std::vector<std::byte>& out) {
-        serialize_bitset(input.held,        out);
-        serialize_bitset(input.pressed,     out);
-        serialize_bitset(input.released,    out);
+/*
+    Packed game input
+*/
+uint32_t pack_game_input(const GameInput& input) {
+    return pack_bits(input.held,                GAME_HELD_SHIFT)
+         | pack_bits(input.pressed,             GAME_PRESSED_SHIFT)
+         | pack_bits(input.released,            GAME_RELEASED_SHIFT)
+         | pack_bits(input.arrows.held,         ARROW_HELD_SHIFT)
+         | pack_bits(input.arrows.pressed,      ARROW_PRESSED_SHIFT)
+         | pack_bits(input.arrows.released,     ARROW_RELEASED_SHIFT);
+}
 
-        serialize_arrow_state(input.arrows, out);
-    }
+GameInput unpack_game_input(uint32_t word) {
+    return GameInput {
+        unpack_bits<GAME_ACTION_COUNT>(word, GAME_HELD_SHIFT,       GAME_ACTION_MASK),  // held
+        unpack_bits<GAME_ACTION_COUNT>(word, GAME_PRESSED_SHIFT,    GAME_ACTION_MASK),  // pressed
+        unpack_bits<GAME_ACTION_COUNT>(word, GAME_RELEASED_SHIFT,   GAME_ACTION_MASK),  // released
 
-    GameInput deserialize_game_input(const std::vector<std::byte>& buffer, size_t& offset) {
-        constexpr size_t GAME_ACTION_COUNT = static_cast<size_t>(GameAction::Count);
+        ArrowState {
+            unpack_bits<ARROW_COUNT>(word, ARROW_HELD_SHIFT,        ARROW_MASK),        // held
+            unpack_bits<ARROW_COUNT>(word, ARROW_PRESSED_SHIFT,     ARROW_MASK),        // pressed
+            unpack_bits<ARROW_COUNT>(word, ARROW_RELEASED_SHIFT,    ARROW_MASK)         // released
+        }
+    };
+}
 
-        return {
-            deserialize_bitset<GAME_ACTION_COUNT>(buffer, offset), // held
-            deserialize_bitset<GAME_ACTION_COUNT>(buffer, offset), // pressed
-            deserialize_bitset<GAME_ACTION_COUNT>(buffer, offset), // released
+/*
+    Serializer
+*/
+std::vector<std::byte> serialize_client_input(const ClientInput& payload) {
+    const auto packed = encode_client_input(payload);
 
-            deserialize_arrow_state(buffer, offset) // arrows
-        };
-    }
+    return std::vector<std::byte>(packed.begin(), packed.end());
+}
 
-    /*
-        uint32_t
-    */
-    void serialize_uint32_t(uint32_t value, std::vector<std::byte>& out) {
-        for (size_t i = 0; i < sizeof(uint32_t); i++)
-        {
-            out.push_back(static_cast<std::byte>((value >> (i * 8)) & 0xFF));
-        }
+ClientInputBytes encode_client_input(const ClientInput& payload) {
+    ClientInputBytes bytes;
+
+    write_u32(bytes.data(),     payload.client_id);
+    write_u32(bytes.data() + 4, payload.frame_timestamp);
+    write_u32(bytes.data() + 8, pack_game_input(payload.game_input));
+
+    return bytes;
+}
+
+std::optional<std::vector<std::byte>> serialize_client_input_window(const ClientInputWindow& payload) {
+    if (payload.inputs.size() > MAX_INPUT_WINDOW_SIZE)
+    {
+        return std::nullopt;
     }
 
-    uint32_t deserialize_uint32_t(const std::vector<std::byte>& buffer, size_t& offset) {
-        uint32_t value = 0;
+    std::vector<std::byte> buffer(CLIENT_INPUT_WINDOW_FIXED_SIZE);
 
-        for (size_t i = 0; i < sizeof(uint32_t); i++)
-        {
-            value |= static_cast<uint32_t>(std::to_integer<uint8_t>(buffer[offset++])) << (i * 8);
-        }
+    write_u32(buffer.data(), payload.client_id);
+    buffer[sizeof(uint32_t)] = static_cast<std::byte>(payload.inputs.size());
 
-        return value;
+    if (payload.inputs.empty())
+    {
+        return buffer;
     }
-}
 
-/*
-    Serializer
-*/
-std::vector<std::byte> serialize_client_input(const ClientInput& payload) {
-    std::vector<std::byte> buffer;
+    buffer.reserve(CLIENT_INPUT_WINDOW_FIXED_SIZE + 8 + payload.inputs.size() * 2);
+
+    const auto& oldest = payload.inputs.front();
+    auto previous_timestamp = oldest.frame_timestamp;
+    auto previous_word = pack_game_input(oldest.game_input);
 
-    buffer.reserve(32); // Optimization
+    buffer.resize(CLIENT_INPUT_WINDOW_FIXED_SIZE + 8);
+    write_u32(buffer.data() + CLIENT_INPUT_WINDOW_FIXED_SIZE,     previous_timestamp);
+    write_u32(buffer.data() + CLIENT_INPUT_WINDOW_FIXED_SIZE + 4, previous_word);
 
-    serialize_uint32_t(payload.client_id,       buffer);
-    serialize_uint32_t(payload.frame_timestamp, buffer);
-    serialize_game_input(payload.game_input,    buffer);
+    for (size_t i = 1; i < payload.inputs.size(); i++)
+    {
+        const auto& input = payload.inputs[i];
+        const auto word = pack_game_input(input.game_input);
+
+        if (input.frame_timestamp <= previous_timestamp)
+        {
+            return std::nullopt;
+        }
+
+        write_varint(buffer, input.frame_timestamp - previous_timestamp);
+        write_varint(buffer, word ^ previous_word);
+
+        previous_timestamp = input.frame_timestamp;
+        previous_word = word;
+    }
 
     return buffer;
 }
@@ -131,16 +206,103 @@ std::vector<std::byte> serialize_client_input(const ClientInput& payload) {
     Deserializer
 */
 std::optional<ClientInput> deserialize_client_input(const std::vector<std::byte>& buffer) {
-    if (buffer.size() > CLIENT_INPUT_SIZE)
+    return decode_client_input(buffer.data(), buffer.size());
+}
+
+std::optional<ClientInput> decode_client_input(const std::byte* data, size_t size) {
+    if (size == CLIENT_INPUT_LEGACY_WIRE_SIZE)
+    {
+        return decode_legacy_client_input(data);
+    }
+
+    if (size != CLIENT_INPUT_WIRE_SIZE)
     {
         return std::nullopt;
     }
 
-    size_t offset = 0;
+    const auto word = read_u32(data + 8);
+
+    // Bits past the known actions are reserved
+    if ((word >> INPUT_BITS_USED) != 0)
+    {
+        return std::nullopt;
+    }
 
     return ClientInput {
-        deserialize_uint32_t(buffer,    offset),    // client_id
-        deserialize_uint32_t(buffer,    offset),    // frame_timestamp
-        deserialize_game_input(buffer,  offset)     // state
+        read_u32(data),         // client_id
+        read_u32(data + 4),     // frame_timestamp
+        unpack_game_input(word) // state
     };
 }
+
+std::optional<ClientInputWindow> deserialize_client_input_window(const std::vector<std::byte>& buffer) {
+    if (buffer.size() < CLIENT_INPUT_WINDOW_FIXED_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    ClientInputWindow window = {};
+
+    window.client_id = read_u32(buffer.data());
+
+    const auto count = std::to_integer<size_t>(buffer[sizeof(uint32_t)]);
+
+    if (count > MAX_INPUT_WINDOW_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    if (count == 0)
+    {
+        return buffer.size() == CLIENT_INPUT_WINDOW_FIXED_SIZE ? std::optional(window) : std::nullopt;
+    }
+
+    if (buffer.size() < CLIENT_INPUT_WINDOW_FIXED_SIZE + 8)
+    {
+        return std::nullopt;
+    }
+
+    auto timestamp = read_u32(buffer.data() + CLIENT_INPUT_WINDOW_FIXED_SIZE);
+    auto word = read_u32(buffer.data() + CLIENT_INPUT_WINDOW_FIXED_SIZE + 4);
+
+    size_t offset = CLIENT_INPUT_WINDOW_FIXED_SIZE + 8;
+
+    window.inputs.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            uint32_t delta = 0;
+            uint32_t flipped = 0;
+
+            if (!read_varint(buffer, offset, delta) || !read_varint(buffer, offset, flipped) ||
+                delta == 0 || timestamp > UINT32_MAX - delta)
+            {
+                return std::nullopt;
+            }
+
+            timestamp += delta;
+            word ^= flipped;
+        }
+
+        if ((word >> INPUT_BITS_USED) != 0)
+        {
+            return std::nullopt;
+        }
+
+        window.inputs.push_back(ClientInput {
+            window.client_id,
+            timestamp,
+            unpack_game_input(word)
+        });
+    }
+
+    // Trailing bytes mean the window was not encoded by this format
+    if (offset != buffer.size())
+    {
+        return std::nullopt;
+    }
+
+    return window;
+}
@@ -0,0 +1,24 @@
+#include <logger/log_macros.hpp>
+#include <packet_stream/packet_dispatcher.hpp>
+
+bool PacketDispatcher::has_handler(PayloadType type) const {
+    const auto index = slot_index(type);
+
+    return index < m_handlers.size() && m_handlers[index].thunk != nullptr;
+}
+
+bool PacketDispatcher::dispatch(const PacketHeader& header, const std::vector<std::byte>& bytes) {
+    if (!has_handler(header.payload_type))
+    {
+        return false;
+    }
+
+    const auto& slot = m_handlers[slot_index(header.payload_type)];
+
+    if (!slot.thunk(slot.context.get(), header, bytes))
+    {
+        LOG_ERROR("[PacketDispatcher] Failed to decode payload type: {}", header.payload_type);
+    }
+
+    return true;
+}
@@ -1,10 +1,296 @@
-#include <iostream>
+#include <array>
 #include <cstring>
+#include <logger/log_macros.hpp>
 #include <packet_stream/packet_stream.hpp>
 #include <packet_serializer/packet_serializer.hpp>
+#include <trace/trace.hpp>
 
 namespace {
     constexpr size_t TEMP_BUFFER_SIZE = 4096;
+
+    // Bounds the time one stream can hold an event loop worker
+    constexpr size_t MAX_READS_PER_PUMP = 16;
+
+    // Inputs can be dropped under load, losing anything else would stall the session
+    bool is_control_payload(PayloadType payload_type) {
+        return payload_type != PayloadType::ClientInput && payload_type != PayloadType::ClientInputWindow;
+    }
+
+    /*
+        Pushes the packet into the queue, or into the overflow when the queue
+        is full or the overflow already holds packets. The receive side never
+        waits for the consumer: a stream on an event loop would hold the
+        worker the consumer may need, and a dedicated thread would stop
+        reading the socket. Returns false when an input has been dropped.
+    */
+    bool push_packet(SpscRingQueue<Packet>& queue, PacketOverflow& overflow, Packet&& packet) {
+        if (!overflow.pending.load(std::memory_order_acquire) && queue.try_push(std::move(packet)))
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(overflow.mutex);
+
+        if (overflow.packets.size() >= PACKET_QUEUE_CAPACITY && !is_control_payload(static_cast<PayloadType>(packet.header.payload_type)))
+        {
+            return false;
+        }
+
+        overflow.packets.push_back(std::move(packet));
+        overflow.pending.store(true, std::memory_order_release);
+
+        return true;
+    }
+
+    // Packets of the overflow are newer than those of the ring, so it is only read once the ring is empty
+    std::optional<Packet> pop_packet(SpscRingQueue<Packet>& queue, PacketOverflow& overflow) {
+        auto packet = queue.try_pop();
+
+        if (packet.has_value() || !overflow.pending.load(std::memory_order_acquire))
+        {
+            return packet;
+        }
+
+        std::lock_guard<std::mutex> lock(overflow.mutex);
+
+        if (overflow.packets.empty())
+        {
+            return std::nullopt;
+        }
+
+        packet = std::move(overflow.packets.front());
+        overflow.packets.pop_front();
+        overflow.pending.store(!overflow.packets.empty(), std::memory_order_release);
+
+        return packet;
+    }
+
+    size_t drain_packets(SpscRingQueue<Packet>& queue, PacketOverflow& overflow, std::vector<Packet>& out, size_t max_count) {
+        auto count = queue.drain([&out](Packet&& packet) {
+            out.push_back(std::move(packet));
+        }, max_count);
+
+        if (count == max_count || !overflow.pending.load(std::memory_order_acquire))
+        {
+            return count;
+        }
+
+        std::lock_guard<std::mutex> lock(overflow.mutex);
+
+        while (count < max_count && !overflow.packets.empty())
+        {
+            out.push_back(std::move(overflow.packets.front()));
+            overflow.packets.pop_front();
+            count++;
+        }
+
+        overflow.pending.store(!overflow.packets.empty(), std::memory_order_release);
+
+        return count;
+    }
+
+    /*
+        Reads the header at offset. Compact headers are only taken once they have
+        been negotiated and the stream is in sync, otherwise the full header with
+        its magic number is required.
+    */
+    CompactHeaderStatus read_wire_header(const std::vector<std::byte>& buffer, size_t offset, bool compact,
+                                         uint32_t last_sequence, PacketHeader& header, size_t& header_size) {
+        const auto remaining = buffer.size() - offset;
+
+        if (compact && (std::to_integer<uint8_t>(buffer[offset]) & 0x80) == 0)
+        {
+            return deserialize_compact_header(buffer.data() + offset, remaining, last_sequence, header, header_size);
+        }
+
+        if (remaining < PACKET_HEADER_SIZE)
+        {
+            return CompactHeaderStatus::Incomplete;
+        }
+
+        memcpy(&header, buffer.data() + offset, PACKET_HEADER_SIZE);
+
+        if (header.magic_number != PACKET_MAGIC_NUMBER)
+        {
+            return CompactHeaderStatus::Invalid;
+        }
+
+        header_size = PACKET_HEADER_SIZE;
+
+        return CompactHeaderStatus::Complete;
+    }
+
+    // Restores a payload sent with PAYLOAD_COMPRESSED_FLAG and clears the flag
+    bool inflate_payload(PacketHeader& header, std::vector<std::byte>& payload, const CompressionOptions& options) {
+        TRACE_ZONE("inflate_payload", "decode");
+
+        auto decompressed = decompress_payload(payload, options);
+
+        if (!decompressed.has_value())
+        {
+            return false;
+        }
+
+        payload = std::move(decompressed.value());
+
+        header.payload_type = static_cast<PayloadType>(static_cast<uint32_t>(header.payload_type) & ~PAYLOAD_COMPRESSED_FLAG);
+        header.payload_size = static_cast<uint32_t>(payload.size());
+
+        return true;
+    }
+
+    /*
+        Every COMPACT_SYNC_INTERVAL-th packet keeps the full header as a sync point.
+        Writes into out, which holds at least PACKET_HEADER_SIZE bytes, returns the bytes written.
+    */
+    size_t write_wire_header(const PacketHeader& header, bool compact, std::byte* out) {
+        if (compact && header.sequence_number % COMPACT_SYNC_INTERVAL != 0)
+        {
+            return encode_compact_header(header, true, out);
+        }
+
+        memcpy(out, &header, PACKET_HEADER_SIZE);
+
+        return PACKET_HEADER_SIZE;
+    }
+
+    // write_wire_header() into a vector of its own
+    std::vector<std::byte> make_wire_header(const PacketHeader& header, bool compact) {
+        static_assert(COMPACT_HEADER_MAX_SIZE <= PACKET_HEADER_SIZE);
+
+        std::array<std::byte, PACKET_HEADER_SIZE> buffer;
+
+        const auto size = write_wire_header(header, compact, buffer.data());
+
+        return std::vector<std::byte>(buffer.begin(), buffer.begin() + size);
+    }
+
+    /*
+        Bundling helpers shared by the client and the server.
+        send_payload is the stream's bool(PayloadType, std::vector<std::byte>&&),
+        it takes ownership of the payload it is given.
+    */
+    /*
+        Compression is only agreed on when both sides use the same dictionary,
+        the peer would reject every payload compressed with another one
+    */
+    uint32_t agree_capabilities(uint32_t shared_capabilities, uint32_t peer_dictionary_id, uint32_t dictionary_id) {
+        if (peer_dictionary_id != dictionary_id)
+        {
+            return shared_capabilities & ~static_cast<uint32_t>(WireCapability::Compression);
+        }
+
+        return shared_capabilities;
+    }
+
+    /*
+        Payloads that close a sender's tick: the client sends one input (or input
+        window) per tick and the server one frame, so queue_packet() flushes the
+        pending bundle as soon as one of them is queued
+    */
+    bool ends_tick(PayloadType payload_type) {
+        switch (payload_type)
+        {
+            case PayloadType::ClientInput:
+            case PayloadType::ClientInputWindow:
+            case PayloadType::FrameSnapshot:
+            {
+                return true;
+            }
+            default:
+            {
+                return false;
+            }
+        }
+    }
+
+    template <typename SendPayload>
+    bool flush_bundle(std::vector<std::byte>& bundle, size_t& entry_count, SendPayload&& send_payload) {
+        if (entry_count == 0)
+        {
+            return true;
+        }
+
+        bool result = false;
+
+        if (entry_count == 1)
+        {
+            // A lone entry goes out as a regular packet, there is nothing to save
+            const auto payload_type = static_cast<PayloadType>(std::to_integer<uint8_t>(bundle[0]));
+            std::vector<std::byte> payload(bundle.begin() + BUNDLE_ENTRY_HEADER_SIZE, bundle.end());
+
+            result = send_payload(payload_type, std::move(payload));
+        }
+        else
+        {
+            result = send_payload(PayloadType::Bundle, std::move(bundle));
+        }
+
+        bundle.clear();
+        entry_count = 0;
+
+        return result;
+    }
+
+    template <typename SendPayload>
+    bool queue_into_bundle(std::vector<std::byte>& bundle, size_t& entry_count, PayloadType payload_type,
+                           std::vector<std::byte>&& payload, SendPayload&& send_payload) {
+        // Too large for a bundle entry, flush first so the send order is kept
+        if (payload.size() > MAX_BUNDLE_ENTRY_SIZE)
+        {
+            const auto flushed = flush_bundle(bundle, entry_count, send_payload);
+
+            return send_payload(payload_type, std::move(payload)) && flushed;
+        }
+
+        if (bundle.size() + BUNDLE_ENTRY_HEADER_SIZE + payload.size() > MAX_BUNDLE_SIZE &&
+            !flush_bundle(bundle, entry_count, send_payload))
+        {
+            return false;
+        }
+
+        if (!append_bundle_entry(bundle, payload_type, payload))
+        {
+            return false;
+        }
+
+        entry_count++;
+
+        return true;
+    }
+
+    /*
+        Validates the bundle once, then hands every entry to handle_payload
+        with a header carrying the entry's type and size. The entries are
+        copied into payload, a buffer the stream keeps for that.
+    */
+    template <typename HandlePayload>
+    bool unpack_bundle(const PacketHeader& header, const std::vector<std::byte>& bundle, std::vector<std::byte>& payload,
+                       HandlePayload&& handle_payload) {
+        const auto entries = deserialize_bundle(bundle);
+
+        if (!entries.has_value())
+        {
+            return false;
+        }
+
+        for (const auto& entry : entries.value())
+        {
+            PacketHeader entry_header = header;
+
+            entry_header.payload_type = entry.payload_type;
+            entry_header.payload_size = static_cast<uint32_t>(entry.size);
+
+            payload.assign(
+                bundle.begin() + entry.offset,
+                bundle.begin() + entry.offset + entry.size
+            );
+
+            handle_payload(entry_header, payload);
+        }
+
+        return true;
+    }
 }
 
 /*
@@ -13,7 +299,22 @@ namespace {
 PacketStreamClient::PacketStreamClient(std::shared_ptr<ClientSocket> socket)
     : m_socket(std::move(socket))
     , m_running(false)
+    , m_loop(nullptr)
+    , m_reader_id(0)
+    , m_packet_queue(PACKET_QUEUE_CAPACITY)
+    , m_pushed_frames(0)
+    , m_pushed_packets(0)
+    , m_polled_packets(0)
     , m_send_sequence(0)
+    , m_bundle_count(0)
+    , m_capabilities(DEFAULT_WIRE_CAPABILITIES)
+    , m_wire_capabilities(0)
+    , m_compact_send(false)
+    , m_compress_send(false)
+    , m_compact_receive(false)
+    , m_wire_synced(true)
+    , m_recv_sequence(0)
+    , m_recorder_stream_id(0)
     , m_recv_thread_exception(nullptr)
 {}
 
@@ -35,15 +336,49 @@ void PacketStreamClient::start() {
             {
                 m_recv_thread_exception = std::current_exception();
 
-                std::cerr << "[PacketStreamClient] ERROR: Receive thread threw an exception: " << e.what() << "\n";
+                LOG_ERROR("[PacketStreamClient] Receive thread threw an exception: {}", e.what());
             }
+
+            notify(StreamEvent::Closed);
         });
 
-        std::cout << "[PacketStreamClient] DEBUG: Receive thread has been created" << "\n";
+        LOG_DEBUG("[PacketStreamClient] Receive thread has been created");
+    }
+}
+
+void PacketStreamClient::start(IoEventLoop& loop) {
+    if (!m_running)
+    {
+        m_running = true;
+        m_loop = &loop;
+
+        m_reader_id = loop.add_reader(m_socket->native_handle(), [this]() {
+            return pump();
+        });
     }
 }
 
 void PacketStreamClient::stop() {
+    /*
+        In event loop mode pump() clears m_running itself once the connection
+        is gone, the reader still has to be removed (it may still be finishing)
+    */
+    if (m_loop != nullptr)
+    {
+        const auto was_running = m_running.exchange(false);
+
+        m_socket->abort();
+        m_loop->remove_reader(m_reader_id);
+        m_loop = nullptr;
+
+        if (was_running)
+        {
+            notify(StreamEvent::Closed);
+        }
+
+        return;
+    }
+
     if (m_running)
     {
         m_running = false;
@@ -52,11 +387,11 @@ void PacketStreamClient::stop() {
         if (m_recv_thread.joinable())
         {
             m_recv_thread.join();
-            std::cout << "[PacketStreamClient] DEBUG: Receive thread has been joined" << "\n";
+            LOG_DEBUG("[PacketStreamClient] Receive thread has been joined");
 
             if (get_recv_exception())
             {
-                std::cerr << "[PacketStreamClient] ERROR: Detected stream exception" << "\n";
+                LOG_ERROR("[PacketStreamClient] Detected stream exception");
             }
         }
     }
@@ -66,8 +401,13 @@ bool PacketStreamClient::is_running() const {
     return m_running;
 }
 
+void PacketStreamClient::set_receive_callback(StreamReceiveCallback callback) {
+    m_receive_callback = std::move(callback);
+}
+
 std::optional<FrameSnapshot> PacketStreamClient::poll_frame() {
-    std::lock_guard<std::mutex> lock(m_frame_mutex);
+    TRACE_ZONE("poll_frame", "queue");
+    TRACE_UNIQUE_LOCK(lock, m_frame_mutex, "frame lock");
 
     if (!is_running() || m_frame_queue.empty())
     {
@@ -77,31 +417,177 @@ std::optional<FrameSnapshot> PacketStreamClient::poll_frame() {
     /*
         Gets the latest frame
     */
+    TRACE_FLOW_END("frame queue", "queue", trace_flow_id(&m_frame_queue, m_pushed_frames));
+
     const auto frame = std::move(m_frame_queue.back());
 
     /*
         And discards the rest of frames
     */
+    if (m_metrics)
+    {
+        m_metrics->on_frames_dropped(m_frame_queue.size() - 1);
+        m_metrics->set_frame_queue_depth(0);
+    }
+
     m_frame_queue.clear();
 
     return frame;
 }
 
 std::optional<Packet> PacketStreamClient::poll_packet() {
-    std::lock_guard<std::mutex> lock(m_packet_mutex);
+    TRACE_ZONE("poll_packet", "queue");
 
-    if (!m_running || m_packet_queue.empty())
+    if (!m_running)
     {
         return std::nullopt;
     }
 
-    const auto message = std::move(m_packet_queue.front());
-    m_packet_queue.pop();
+    auto packet = pop_packet(m_packet_queue, m_packet_overflow);
 
-    return message;
+    if (packet.has_value())
+    {
+        m_polled_packets++;
+        TRACE_FLOW_END("packet queue", "queue", trace_flow_id(&m_packet_queue, m_polled_packets));
+    }
+
+    if (m_metrics)
+    {
+        m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+    }
+
+    return packet;
+}
+
+size_t PacketStreamClient::poll_packets(std::vector<Packet>& out, size_t max_count) {
+    TRACE_ZONE("poll_packets", "queue");
+
+    if (!m_running)
+    {
+        return 0;
+    }
+
+    const auto count = drain_packets(m_packet_queue, m_packet_overflow, out, max_count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        m_polled_packets++;
+        TRACE_FLOW_END("packet queue", "queue", trace_flow_id(&m_packet_queue, m_polled_packets));
+    }
+
+    if (m_metrics)
+    {
+        m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+    }
+
+    return count;
 }
 
 bool PacketStreamClient::send_packet(const Packet& packet) {
+    auto payload_bytes = serialize_payload(packet);
+
+    if (!payload_bytes.has_value())
+    {
+        return false;
+    }
+
+    return send_payload(packet.header.payload_type, std::move(payload_bytes.value()));
+}
+
+bool PacketStreamClient::send_input(const ClientInput& input) {
+    TRACE_ZONE("send_input", "send");
+
+    // Compression needs buffers of its own
+    if (m_compress_send.load(std::memory_order_relaxed) && CLIENT_INPUT_WIRE_SIZE >= m_compression.threshold)
+    {
+        return send_packet(make_packet(input));
+    }
+
+    std::array<std::byte, PACKET_HEADER_SIZE + CLIENT_INPUT_WIRE_SIZE> buffer;
+
+    PacketHeader header = {};
+
+    header.magic_number     = PACKET_MAGIC_NUMBER;
+    header.sequence_number  = m_send_sequence.fetch_add(1);
+    header.payload_size     = static_cast<uint32_t>(CLIENT_INPUT_WIRE_SIZE);
+    header.payload_type     = PayloadType::ClientInput;
+
+    size_t size = 0;
+    ClientInputBytes payload;
+
+    {
+        StreamMetricsTimer timer(m_metrics.get(), StreamTiming::Serialize);
+
+        payload = encode_client_input(input);
+
+        size = write_wire_header(header, m_compact_send.load(std::memory_order_relaxed), buffer.data());
+        memcpy(buffer.data() + size, payload.data(), payload.size());
+        size += payload.size();
+    }
+
+    bool sent = false;
+
+    {
+        TRACE_ZONE("send_data", "socket");
+        StreamMetricsTimer timer(m_metrics.get(), StreamTiming::SendBlocked);
+
+        sent = m_socket->send_data(buffer.data(), size) > 0;
+    }
+
+    if (m_metrics && sent)
+    {
+        m_metrics->on_sent(PayloadType::ClientInput, size);
+    }
+    else if (m_metrics)
+    {
+        m_metrics->on_send_failed();
+    }
+
+    if (sent && m_recorder)
+    {
+        m_recorder->record(m_recorder_stream_id, RecordDirection::Sent, header, payload.data(), payload.size());
+    }
+
+    return sent;
+}
+
+bool PacketStreamClient::queue_packet(const Packet& packet) {
+    auto payload_bytes = serialize_payload(packet);
+
+    if (!payload_bytes.has_value())
+    {
+        return false;
+    }
+
+    const auto send = [this](PayloadType payload_type, std::vector<std::byte>&& bytes) {
+        return send_payload(payload_type, std::move(bytes));
+    };
+
+    TRACE_UNIQUE_LOCK(lock, m_bundle_mutex, "bundle lock");
+
+    if (!queue_into_bundle(m_bundle, m_bundle_count, packet.header.payload_type, std::move(payload_bytes.value()), send))
+    {
+        return false;
+    }
+
+    // The tick is over, send what it queued
+    return !ends_tick(packet.header.payload_type) || flush_bundle(m_bundle, m_bundle_count, send);
+}
+
+bool PacketStreamClient::flush() {
+    TRACE_ZONE("flush", "send");
+    TRACE_UNIQUE_LOCK(lock, m_bundle_mutex, "bundle lock");
+
+    return flush_bundle(m_bundle, m_bundle_count,
+        [this](PayloadType payload_type, std::vector<std::byte>&& bytes) {
+            return send_payload(payload_type, std::move(bytes));
+        });
+}
+
+std::optional<std::vector<std::byte>> PacketStreamClient::serialize_payload(const Packet& packet) {
+    TRACE_ZONE("serialize_payload", "send");
+    StreamMetricsTimer timer(m_metrics.get(), StreamTiming::Serialize);
+
     const auto actual_type = get_payload_type(packet.payload);
 
     const auto expr1 = packet.header.payload_type != actual_type;
@@ -111,49 +597,142 @@ bool PacketStreamClient::send_packet(const Packet& packet) {
     // Packet validation
     if (expr1 || expr2 || expr3)
     {
-        std::cerr << "[PacketStreamClient] ERROR: Invalid payload, abort sending. "
-                  << "header_type=" << static_cast<int>(packet.header.payload_type)
-                  << ", actual_type=" << static_cast<int>(actual_type) << "\n";
+        LOG_ERROR("[PacketStreamClient] Invalid payload, abort sending. header_type={}, actual_type={}",
+                  packet.header.payload_type, actual_type);
 
 
-        return false;
+        return std::nullopt;
     }
 
     // Serialize the payload into bytes
-    std::vector<std::byte> payload_bytes;
-
     switch (packet.header.payload_type)
     {
-        case PayloadType::ClientHello:              { payload_bytes = serialize_client_hello(std::get<ClientHello>(packet.payload));                        break; }
-        case PayloadType::ClientGoodbye:            { payload_bytes = serialize_client_goodbye(std::get<ClientGoodbye>(packet.payload));                    break; }
-        case PayloadType::ClientGameRequest:        { payload_bytes = serialize_client_game_request(std::get<ClientGameRequest>(packet.payload));           break; }
-        case PayloadType::ClientReconnectRequest:   { payload_bytes = serialize_client_reconnect_request(std::get<ClientReconnectRequest>(packet.payload)); break; }
-        case PayloadType::ClientInput:              { payload_bytes = serialize_client_input(std::get<ClientInput>(packet.payload));                        break; }
+        case PayloadType::ClientHello:
+        {
+            auto hello = std::get<ClientHello>(packet.payload);
+
+            hello.capabilities = m_capabilities;
+            hello.dictionary_id = compression_dictionary_id(m_compression);
+
+            return serialize_client_hello(hello);
+        }
+        case PayloadType::ClientGoodbye:            { return serialize_client_goodbye(std::get<ClientGoodbye>(packet.payload));                     }
+        case PayloadType::ClientGameRequest:        { return serialize_client_game_request(std::get<ClientGameRequest>(packet.payload));            }
+        case PayloadType::ClientReconnectRequest:   { return serialize_client_reconnect_request(std::get<ClientReconnectRequest>(packet.payload));  }
+        case PayloadType::ClientInput:              { return serialize_client_input(std::get<ClientInput>(packet.payload));                         }
+        case PayloadType::ClientInputWindow:        { return serialize_client_input_window(std::get<ClientInputWindow>(packet.payload));            }
         default:
         {
-            std::cerr << "[PacketStreamClient] Invalid PayloadType: "
-                      << static_cast<uint32_t>(packet.header.payload_type) << "\n"
-                      << "[PacketStreamClient] the packet can not be sent" << "\n";
-            return false;
+            LOG_ERROR("[PacketStreamClient] Invalid PayloadType: {}, the packet can not be sent", packet.header.payload_type);
+            return std::nullopt;
         }
     }
+}
+
+bool PacketStreamClient::send_payload(PayloadType payload_type, std::vector<std::byte>&& payload_bytes) {
+    TRACE_ZONE("send_payload", "send");
 
     // Create header
-    PacketHeader header = packet.header;
+    PacketHeader header = {};
     
     header.magic_number     = PACKET_MAGIC_NUMBER;
     header.sequence_number  = m_send_sequence.fetch_add(1);
     header.payload_size     = static_cast<uint32_t>(payload_bytes.size());
-    header.payload_type     = get_payload_type(packet.payload);
+    header.payload_type     = payload_type;
+
+    std::optional<std::vector<std::byte>> compressed;
+
+    if (m_compress_send.load(std::memory_order_relaxed))
+    {
+        compressed = compress_payload(payload_bytes, m_compression);
+    }
+
+    if (compressed.has_value())
+    {
+        header.payload_size = static_cast<uint32_t>(compressed->size());
+        header.payload_type = static_cast<PayloadType>(static_cast<uint32_t>(payload_type) | PAYLOAD_COMPRESSED_FLAG);
+    }
+
+    const auto& body = compressed.has_value() ? compressed.value() : payload_bytes;
     
-    auto header_bytes = serialize_packet_header(header);
+    auto header_bytes = make_wire_header(header, m_compact_send.load(std::memory_order_relaxed));
 
     std::vector<std::byte> buffer;
 
+    buffer.reserve(header_bytes.size() + body.size());
     buffer.insert(buffer.end(), header_bytes.begin(), header_bytes.end());
-    buffer.insert(buffer.end(), payload_bytes.begin(), payload_bytes.end());
+    buffer.insert(buffer.end(), body.begin(), body.end());
+
+    bool sent = false;
+
+    {
+        TRACE_ZONE("send_data", "socket");
+        StreamMetricsTimer timer(m_metrics.get(), StreamTiming::SendBlocked);
+
+        sent = m_socket->send_data(buffer) > 0;
+    }
+
+    if (m_metrics && sent)
+    {
+        m_metrics->on_sent(payload_type, buffer.size());
+    }
+    else if (m_metrics)
+    {
+        m_metrics->on_send_failed();
+    }
+
+    if (sent && m_recorder)
+    {
+        header.payload_size = static_cast<uint32_t>(payload_bytes.size());
+        header.payload_type = payload_type;
+
+        m_recorder->record(m_recorder_stream_id, RecordDirection::Sent, header, payload_bytes.data(), payload_bytes.size());
+    }
+
+    return sent;
+}
 
-    return m_socket->send_data(buffer);
+void PacketStreamClient::set_wire_capabilities(uint32_t capabilities) {
+    m_capabilities = capabilities;
+}
+
+void PacketStreamClient::set_compression(CompressionOptions options) {
+    m_compression = std::move(options);
+}
+
+void PacketStreamClient::set_recorder(std::shared_ptr<SessionRecorder> recorder, uint32_t stream_id) {
+    m_recorder = std::move(recorder);
+    m_recorder_stream_id = stream_id;
+}
+
+void PacketStreamClient::set_metrics(std::shared_ptr<StreamMetrics> metrics) {
+    m_metrics = std::move(metrics);
+}
+
+uint32_t PacketStreamClient::wire_capabilities() const {
+    return m_wire_capabilities.load();
+}
+
+/*
+    The server confirms the features both sides support in ServerAccept,
+    everything the server sends after it may already use them
+*/
+void PacketStreamClient::negotiate(const std::vector<std::byte>& accept_bytes) {
+    const auto accept = deserialize_server_accept(accept_bytes);
+
+    if (!accept.has_value())
+    {
+        return;
+    }
+
+    const auto capabilities = agree_capabilities(accept->capabilities & m_capabilities,
+                                                 accept->dictionary_id, compression_dictionary_id(m_compression));
+    const auto compact = has_wire_capability(capabilities, WireCapability::CompactHeader);
+
+    m_wire_capabilities.store(capabilities);
+    m_compact_receive = compact;
+    m_compact_send.store(compact);
+    m_compress_send.store(m_compression.enabled && has_wire_capability(capabilities, WireCapability::Compression));
 }
 
 std::exception_ptr PacketStreamClient::get_recv_exception() const {
@@ -161,6 +740,8 @@ std::exception_ptr PacketStreamClient::get_recv_exception() const {
 }
 
 void PacketStreamClient::receive_loop() {
+    trace_set_thread_name("PacketStreamClient receive");
+
     std::byte temp_buffer[TEMP_BUFFER_SIZE];
 
     while (m_running)
@@ -171,106 +752,278 @@ void PacketStreamClient::receive_loop() {
         {
             continue;
         }
-        else if (bytes_read == 0)
+
+        if (!consume_received(temp_buffer, bytes_read))
         {
-            std::cerr << "[PacketStreamClient] DEBUG: Server disconnected (EOF)" << "\n";
+            break;
+        }
+    }
+}
 
+/*
+    Event loop mode: drains what the socket has right now,
+    returns false to unregister the stream from the loop
+*/
+bool PacketStreamClient::pump() {
+    std::byte temp_buffer[TEMP_BUFFER_SIZE];
+
+    for (size_t i = 0; i < MAX_READS_PER_PUMP && m_running; i++)
+    {
+        ssize_t bytes_read = m_socket->recv_data_nowait(temp_buffer, TEMP_BUFFER_SIZE);
+
+        if (bytes_read == SOCKET_RECV_TIMEOUT)
+        {
             break;
         }
-        else if (bytes_read < 0)
+
+        if (!consume_received(temp_buffer, bytes_read))
         {
-            std::cerr << "[PacketStreamClient] ERROR: Recv failed: " << strerror(errno)
-                      << " (errno=" << errno << ")" << "\n";
+            // is_running() turns false as after stop(), whichever of the two gets here first reports Closed
+            if (m_running.exchange(false))
+            {
+                notify(StreamEvent::Closed);
+            }
 
-            break;
+            return false;
         }
-        
-        m_buffer.insert(
-            m_buffer.end(),
-            temp_buffer,
-            temp_buffer + bytes_read
-        );
+    }
+
+    return m_running;
+}
+
+// Returns false when the connection is gone
+bool PacketStreamClient::consume_received(const std::byte* data, ssize_t bytes_read) {
+    if (bytes_read == 0)
+    {
+        LOG_DEBUG("[PacketStreamClient] Server disconnected (EOF)");
 
-        process_buffer();
+        return false;
+    }
+    else if (bytes_read < 0)
+    {
+        LOG_ERROR("[PacketStreamClient] Recv failed: {} (errno={})", strerror(errno), errno);
+
+        return false;
+    }
+
+    m_buffer.insert(
+        m_buffer.end(),
+        data,
+        data + bytes_read
+    );
+
+    process_buffer();
+
+    return true;
+}
+
+void PacketStreamClient::notify(StreamEvent event) {
+    if (m_receive_callback)
+    {
+        m_receive_callback(event);
     }
 }
 
 void PacketStreamClient::process_buffer() {
+    TRACE_ZONE("process_buffer", "receive");
+
     size_t offset = 0;
+    size_t skipped = 0;
 
-    while (m_buffer.size() - offset >= PACKET_HEADER_SIZE)
+    while (offset < m_buffer.size())
     {
         PacketHeader header = {};
+        size_t header_size = 0;
 
-        memcpy(&header, m_buffer.data() + offset, PACKET_HEADER_SIZE);
+        const auto status = read_wire_header(m_buffer, offset, m_compact_receive && m_wire_synced,
+                                             m_recv_sequence, header, header_size);
 
-        if (header.magic_number != PACKET_MAGIC_NUMBER)
+        if (status == CompactHeaderStatus::Incomplete)
         {
+            break;
+        }
+
+        // Skip bytes until the next full header
+        if (status == CompactHeaderStatus::Invalid)
+        {
+            m_wire_synced = false;
             offset++;
+            skipped++;
 
             continue;
         }
 
-        if (m_buffer.size() - offset < PACKET_HEADER_SIZE + header.payload_size)
+        if (m_buffer.size() - offset < header_size + header.payload_size)
         {
             break;
         }
 
-        auto payload_start = m_buffer.begin() + offset + PACKET_HEADER_SIZE;
-        auto payload_end = payload_start + header.payload_size;
+        m_wire_synced = true;
+        m_recv_sequence = header.sequence_number;
 
-        const auto payload_type = static_cast<PayloadType>(header.payload_type);
-        std::vector<std::byte> payload(payload_start, payload_end);
-        std::optional<PacketPayload> message;
+        const auto packet_size = header_size + header.payload_size;
 
-        switch (payload_type)
+        if (m_metrics)
         {
-            case PayloadType::ServerAccept:             { message = deserialize_server_accept(payload);             break; }
-            case PayloadType::ServerGoodbye:            { message = deserialize_server_goodbye(payload);            break; }
-            case PayloadType::ServerGameResponse:       { message = deserialize_server_game_response(payload);      break; }
-            case PayloadType::ServerReconnectResponse:  { message = deserialize_server_reconnect_response(payload); break; }
-            case PayloadType::FrameSnapshot:
+            const auto base_type = static_cast<uint32_t>(header.payload_type) & ~PAYLOAD_COMPRESSED_FLAG;
+
+            m_metrics->on_received(static_cast<PayloadType>(base_type), packet_size);
+        }
+
+        auto payload_start = m_buffer.begin() + offset + header_size;
+        auto payload_end   = payload_start + header.payload_size;
+
+        // Reuses the capacity of the previous payload, no allocation once it has seen the largest one
+        auto& payload = m_payload;
+
+        payload.assign(payload_start, payload_end);
+
+        if (is_payload_compressed(header) && !inflate_payload(header, payload, m_compression))
+        {
+            LOG_ERROR("[PacketStreamClient] Failed to decompress a payload, the packet has been discarded");
+
+            if (m_metrics)
             {
-                const auto frame_opt = deserialize_frame(payload);
+                m_metrics->on_discarded();
+            }
+
+            offset += packet_size;
 
-                // or frame_opt if you want to use the frame via PacketStreamClient::poll_message
-                message = std::nullopt;
+            continue;
+        }
 
-                if (frame_opt.has_value())
+        if (header.payload_type == PayloadType::Bundle)
+        {
+            const auto unpacked = unpack_bundle(header, payload, m_entry_payload, [this](const PacketHeader& entry_header, const std::vector<std::byte>& entry_payload) {
+                handle_payload(entry_header, entry_payload);
+            });
+
+            if (!unpacked)
+            {
+                LOG_ERROR("[PacketStreamClient] Malformed bundle has been discarded");
+
+                if (m_metrics)
+                {
+                    m_metrics->on_discarded();
+                }
+            }
+        }
+        else
+        {
+            handle_payload(header, payload);
+        }
+
+        if (m_recorder)
+        {
+            m_recorder->record(m_recorder_stream_id, RecordDirection::Received, header, payload.data(), payload.size());
+        }
+
+        offset += packet_size;
+    }
+
+    if (m_metrics && skipped > 0)
+    {
+        m_metrics->on_resync_skipped(skipped);
+    }
+
+    if (offset > 0)
+    {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + offset);
+    }
+}
+
+void PacketStreamClient::handle_payload(const PacketHeader& header, const std::vector<std::byte>& payload) {
+    TRACE_ZONE("handle_payload", "decode");
+    StreamMetricsTimer timer(m_metrics.get(), StreamTiming::Deserialize);
+
+    if (header.payload_type == PayloadType::ServerAccept)
+    {
+        negotiate(payload);
+    }
+
+    // Typed handlers take the payload before it is wrapped into a Packet
+    if (m_dispatcher.dispatch(header, payload))
+    {
+        return;
+    }
+
+    const auto payload_type = static_cast<PayloadType>(header.payload_type);
+    std::optional<PacketPayload> message;
+
+    switch (payload_type)
+    {
+        case PayloadType::ServerAccept:             { message = deserialize_server_accept(payload);             break; }
+        case PayloadType::ServerGoodbye:            { message = deserialize_server_goodbye(payload);            break; }
+        case PayloadType::ServerGameResponse:       { message = deserialize_server_game_response(payload);      break; }
+        case PayloadType::ServerReconnectResponse:  { message = deserialize_server_reconnect_response(payload); break; }
+        case PayloadType::FrameSnapshot:
+        {
+            const auto frame_opt = deserialize_frame(payload);
+
+            // or frame_opt if you want to use the frame via PacketStreamClient::poll_message
+            message = std::nullopt;
+
+            if (frame_opt.has_value())
+            {
                 {
-                    std::lock_guard<std::mutex> lock(m_frame_mutex);
+                    TRACE_UNIQUE_LOCK(lock, m_frame_mutex, "frame lock");
                     m_frame_queue.push_back(frame_opt.value());
+
+                    m_pushed_frames++;
+                    TRACE_FLOW_BEGIN("frame queue", "queue", trace_flow_id(&m_frame_queue, m_pushed_frames));
+
+                    if (m_metrics)
+                    {
+                        m_metrics->set_frame_queue_depth(m_frame_queue.size());
+                    }
                 }
 
-                break;
+                notify(StreamEvent::Frame);
             }
-            default:
-            {
-                std::cerr << "[PacketStreamClient] Invalid payload type: " 
-                          << static_cast<uint32_t>(payload_type) << "\n"
-                          << "[PacketStreamClient] Failed to process the buffer" << "\n";
 
-                break;
+            break;
+        }
+        default:
+        {
+            LOG_ERROR("[PacketStreamClient] Invalid payload type: {}, failed to process the buffer", payload_type);
+
+            if (m_metrics)
+            {
+                m_metrics->on_discarded();
             }
+
+            break;
         }
+    }
+
+    if (message.has_value())
+    {
+        auto packet = Packet {
+            header,
+            std::move(message.value())
+        };
 
-        if (message.has_value())
+        if (!push_packet(m_packet_queue, m_packet_overflow, std::move(packet)))
         {
-            const auto packet = Packet {
-                header,
-                message.value()
-            };
+            LOG_WARNING("[PacketStreamClient] Packet queue is full, a {} packet has been dropped", payload_type);
+
+            if (m_metrics)
+            {
+                m_metrics->on_packet_dropped();
+            }
 
-            std::lock_guard<std::mutex> lock(m_packet_mutex);
-            m_packet_queue.push(packet);
+            return;
         }
 
-        offset += PACKET_HEADER_SIZE + header.payload_size;
-    }
+        m_pushed_packets++;
+        TRACE_FLOW_BEGIN("packet queue", "queue", trace_flow_id(&m_packet_queue, m_pushed_packets));
 
-    if (offset > 0)
-    {
-        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + offset);
+        if (m_metrics)
+        {
+            m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+        }
+
+        notify(StreamEvent::Packet);
     }
 }
 
@@ -280,7 +1033,21 @@ void PacketStreamClient::process_buffer() {
 PacketStreamServer::PacketStreamServer(std::shared_ptr<ClientConnection> connection)
     : m_connection(std::move(connection))
     , m_running(false)
+    , m_loop(nullptr)
+    , m_reader_id(0)
+    , m_packet_queue(PACKET_QUEUE_CAPACITY)
+    , m_pushed_packets(0)
+    , m_polled_packets(0)
     , m_send_sequence(0)
+    , m_bundle_count(0)
+    , m_capabilities(DEFAULT_WIRE_CAPABILITIES)
+    , m_wire_capabilities(0)
+    , m_compact_send(false)
+    , m_compress_send(false)
+    , m_compact_receive(false)
+    , m_wire_synced(true)
+    , m_recv_sequence(0)
+    , m_recorder_stream_id(0)
     , m_recv_thread_exception(nullptr)
 {}
 
@@ -303,15 +1070,50 @@ void PacketStreamServer::start() {
             {
                 m_recv_thread_exception = std::current_exception();
                 
-                std::cerr << "[PacketStreamServer] ERROR: Receive thread threw an exception: " << e.what() << "\n";
+                LOG_ERROR("[PacketStreamServer] Receive thread threw an exception: {}", e.what());
             }
+
+            notify(StreamEvent::Closed);
         });
 
-        std::cout << "[PacketStreamServer] DEBUG: Receive thread started" << "\n";
+        LOG_DEBUG("[PacketStreamServer] Receive thread started");
+    }
+}
+
+void PacketStreamServer::start(IoEventLoop& loop) {
+    if (!m_running)
+    {
+        m_running = true;
+        m_recv_thread_exception = nullptr;
+        m_loop = &loop;
+
+        m_reader_id = loop.add_reader(m_connection->native_handle(), [this]() {
+            return pump();
+        });
     }
 }
 
 void PacketStreamServer::stop() {
+    /*
+        In event loop mode pump() clears m_running itself once the connection
+        is gone, the reader still has to be removed (it may still be finishing)
+    */
+    if (m_loop != nullptr)
+    {
+        const auto was_running = m_running.exchange(false);
+
+        m_connection->abort();
+        m_loop->remove_reader(m_reader_id);
+        m_loop = nullptr;
+
+        if (was_running)
+        {
+            notify(StreamEvent::Closed);
+        }
+
+        return;
+    }
+
     if (m_running)
     {
         m_running = false;
@@ -321,11 +1123,11 @@ void PacketStreamServer::stop() {
         {
             m_recv_thread.join();
             
-            std::cout << "[PacketStreamServer] DEBUG: Receive thread has been joined" << "\n";
+            LOG_DEBUG("[PacketStreamServer] Receive thread has been joined");
 
             if (get_recv_exception())
             {
-                std::cerr << "[PacketStreamServer] ERROR: Detected stream exception" << "\n";
+                LOG_ERROR("[PacketStreamServer] Detected stream exception");
             }
         }
     }
@@ -335,7 +1137,58 @@ bool PacketStreamServer::is_running() const {
     return m_running;
 }
 
+void PacketStreamServer::set_receive_callback(StreamReceiveCallback callback) {
+    m_receive_callback = std::move(callback);
+}
+
 bool PacketStreamServer::send_packet(const Packet& packet) {
+    auto payload_bytes = serialize_payload(packet);
+
+    if (!payload_bytes.has_value())
+    {
+        return false;
+    }
+
+    return send_payload(packet.header.payload_type, std::move(payload_bytes.value()));
+}
+
+bool PacketStreamServer::queue_packet(const Packet& packet) {
+    auto payload_bytes = serialize_payload(packet);
+
+    if (!payload_bytes.has_value())
+    {
+        return false;
+    }
+
+    const auto send = [this](PayloadType payload_type, std::vector<std::byte>&& bytes) {
+        return send_payload(payload_type, std::move(bytes));
+    };
+
+    TRACE_UNIQUE_LOCK(lock, m_bundle_mutex, "bundle lock");
+
+    if (!queue_into_bundle(m_bundle, m_bundle_count, packet.header.payload_type, std::move(payload_bytes.value()), send))
+    {
+        return false;
+    }
+
+    // The tick is over, send what it queued
+    return !ends_tick(packet.header.payload_type) || flush_bundle(m_bundle, m_bundle_count, send);
+}
+
+bool PacketStreamServer::flush() {
+    TRACE_ZONE("flush", "send");
+    TRACE_UNIQUE_LOCK(lock, m_bundle_mutex, "bundle lock");
+
+    return flush_bundle(m_bundle, m_bundle_count,
+        [this](PayloadType payload_type, std::vector<std::byte>&& bytes) {
+            return send_payload(payload_type, std::move(bytes));
+        });
+}
+
+std::optional<std::vector<std::byte>> PacketStreamServer::serialize_payload(const Packet& packet) {
+    TRACE_ZONE("serialize_payload", "send");
+    StreamMetricsTimer timer(m_metrics.get(), StreamTiming::Serialize);
+
     const auto actual_type = get_payload_type(packet.payload);
 
     const auto expr1 = packet.header.payload_type != actual_type;
@@ -345,82 +1198,214 @@ bool PacketStreamServer::send_packet(const Packet& packet) {
     // Packet validation
     if (expr1 || expr2 || expr3)
     {
-        std::cerr << "[PacketStreamServer] ERROR: Invalid payload, abort sending. "
-                  << "header_type=" << static_cast<int>(packet.header.payload_type)
-                  << ", actual_type=" << static_cast<int>(actual_type) << "\n";
+        LOG_ERROR("[PacketStreamServer] Invalid payload, abort sending. header_type={}, actual_type={}",
+                  packet.header.payload_type, actual_type);
 
-        return false;
+        return std::nullopt;
     }
 
     // Serialize the payload into bytes
-    std::vector<std::byte> payload_bytes;
-
     switch (packet.header.payload_type)
     {
-        case PayloadType::ServerAccept:             { payload_bytes = serialize_server_accept(std::get<ServerAccept>(packet.payload));                          break; }
-        case PayloadType::ServerGoodbye:            { payload_bytes = serialize_server_goodbye(std::get<ServerGoodbye>(packet.payload));                        break; }
-        case PayloadType::ServerGameResponse:       { payload_bytes = serialize_server_game_response(std::get<ServerGameResponse>(packet.payload));             break; }
-        case PayloadType::ServerReconnectResponse:  { payload_bytes = serialize_server_reconnect_response(std::get<ServerReconnectResponse>(packet.payload));   break; }
+        case PayloadType::ServerAccept:
+        {
+            auto accept = std::get<ServerAccept>(packet.payload);
+
+            accept.capabilities = m_wire_capabilities.load();
+            accept.dictionary_id = compression_dictionary_id(m_compression);
+
+            return serialize_server_accept(accept);
+        }
+        case PayloadType::ServerGoodbye:            { return serialize_server_goodbye(std::get<ServerGoodbye>(packet.payload));                         }
+        case PayloadType::ServerGameResponse:       { return serialize_server_game_response(std::get<ServerGameResponse>(packet.payload));              }
+        case PayloadType::ServerReconnectResponse:  { return serialize_server_reconnect_response(std::get<ServerReconnectResponse>(packet.payload));    }
         case PayloadType::FrameSnapshot:
         {
             auto frame_bytes_opt = serialize_frame(std::get<FrameSnapshot>(packet.payload));
 
             if (!frame_bytes_opt.has_value())
             {
-                std::cerr << "[PacketStreamServer] ERROR: Failed to serialize frame" << "\n"
-                          << "[PacketStreamServer] ERROR: The data can not be sent" << "\n";
-
-                return false;
+                LOG_ERROR("[PacketStreamServer] Failed to serialize frame, the data can not be sent");
             }
-            payload_bytes = frame_bytes_opt.value();
-            break;
+
+            return frame_bytes_opt;
         }
         default:
         {
-            std::cerr << "[PacketStreamServer] ERROR: Invalid PayloadType" << "\n"
-                      << "[PacketStreamServer] ERROR: The data can not be sent" << "\n";
+            LOG_ERROR("[PacketStreamServer] Invalid PayloadType, the data can not be sent");
 
-            return false;
+            return std::nullopt;
         }
     }
+}
+
+bool PacketStreamServer::send_payload(PayloadType payload_type, std::vector<std::byte>&& payload_bytes) {
+    TRACE_ZONE("send_payload", "send");
 
     // Create header
-    PacketHeader header = packet.header;
+    PacketHeader header = {};
 
     header.magic_number     = PACKET_MAGIC_NUMBER;
     header.sequence_number  = m_send_sequence.fetch_add(1);
     header.payload_size     = static_cast<uint32_t>(payload_bytes.size());
-    header.payload_type     = get_payload_type(packet.payload);
+    header.payload_type     = payload_type;
+
+    std::optional<std::vector<std::byte>> compressed;
+
+    if (m_compress_send.load(std::memory_order_relaxed))
+    {
+        compressed = compress_payload(payload_bytes, m_compression);
+    }
+
+    if (compressed.has_value())
+    {
+        header.payload_size = static_cast<uint32_t>(compressed->size());
+        header.payload_type = static_cast<PayloadType>(static_cast<uint32_t>(payload_type) | PAYLOAD_COMPRESSED_FLAG);
+    }
 
-    auto header_bytes = serialize_packet_header(header);
+    const auto& body = compressed.has_value() ? compressed.value() : payload_bytes;
+
+    auto header_bytes = make_wire_header(header, m_compact_send.load(std::memory_order_relaxed));
 
     std::vector<std::byte> buffer;
 
+    buffer.reserve(header_bytes.size() + body.size());
     buffer.insert(buffer.end(), header_bytes.begin(), header_bytes.end());
-    buffer.insert(buffer.end(), payload_bytes.begin(), payload_bytes.end());
+    buffer.insert(buffer.end(), body.begin(), body.end());
+
+    bool sent = false;
+
+    {
+        TRACE_ZONE("send_data", "socket");
+        StreamMetricsTimer timer(m_metrics.get(), StreamTiming::SendBlocked);
+
+        sent = m_connection->send_data(buffer) > 0;
+    }
+
+    if (m_metrics && sent)
+    {
+        m_metrics->on_sent(payload_type, buffer.size());
+    }
+    else if (m_metrics)
+    {
+        m_metrics->on_send_failed();
+    }
+
+    if (sent && m_recorder)
+    {
+        header.payload_size = static_cast<uint32_t>(payload_bytes.size());
+        header.payload_type = payload_type;
+
+        m_recorder->record(m_recorder_stream_id, RecordDirection::Sent, header, payload_bytes.data(), payload_bytes.size());
+    }
+
+    // Everything after the accept may use the negotiated format
+    if (sent && payload_type == PayloadType::ServerAccept)
+    {
+        const auto capabilities = m_wire_capabilities.load();
+
+        m_compact_send.store(has_wire_capability(capabilities, WireCapability::CompactHeader));
+        m_compress_send.store(m_compression.enabled && has_wire_capability(capabilities, WireCapability::Compression));
+    }
 
-    return m_connection->send_data(buffer) > 0;
+    return sent;
 }
 
 std::optional<Packet> PacketStreamServer::poll_packet() {
-    std::lock_guard<std::mutex> lock(m_packet_mutex);
+    TRACE_ZONE("poll_packet", "queue");
 
-    if (!m_running || m_packet_queue.empty())
+    if (!m_running)
     {
         return std::nullopt;
     }
 
-    Packet packet = std::move(m_packet_queue.front());
-    m_packet_queue.pop();
+    auto packet = pop_packet(m_packet_queue, m_packet_overflow);
+
+    if (packet.has_value())
+    {
+        m_polled_packets++;
+        TRACE_FLOW_END("packet queue", "queue", trace_flow_id(&m_packet_queue, m_polled_packets));
+    }
+
+    if (m_metrics)
+    {
+        m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+    }
 
     return packet;
 }
 
+size_t PacketStreamServer::poll_packets(std::vector<Packet>& out, size_t max_count) {
+    TRACE_ZONE("poll_packets", "queue");
+
+    if (!m_running)
+    {
+        return 0;
+    }
+
+    const auto count = drain_packets(m_packet_queue, m_packet_overflow, out, max_count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        m_polled_packets++;
+        TRACE_FLOW_END("packet queue", "queue", trace_flow_id(&m_packet_queue, m_polled_packets));
+    }
+
+    if (m_metrics)
+    {
+        m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+    }
+
+    return count;
+}
+
+void PacketStreamServer::set_wire_capabilities(uint32_t capabilities) {
+    m_capabilities = capabilities;
+}
+
+void PacketStreamServer::set_compression(CompressionOptions options) {
+    m_compression = std::move(options);
+}
+
+void PacketStreamServer::set_recorder(std::shared_ptr<SessionRecorder> recorder, uint32_t stream_id) {
+    m_recorder = std::move(recorder);
+    m_recorder_stream_id = stream_id;
+}
+
+void PacketStreamServer::set_metrics(std::shared_ptr<StreamMetrics> metrics) {
+    m_metrics = std::move(metrics);
+}
+
+uint32_t PacketStreamServer::wire_capabilities() const {
+    return m_wire_capabilities.load();
+}
+
+/*
+    Picks the features both sides support from ClientHello. They are sent back in
+    ServerAccept and used for sending once the accept is out.
+*/
+void PacketStreamServer::negotiate(const std::vector<std::byte>& hello_bytes) {
+    const auto hello = deserialize_client_hello(hello_bytes);
+
+    if (!hello.has_value())
+    {
+        return;
+    }
+
+    const auto capabilities = agree_capabilities(hello->capabilities & m_capabilities,
+                                                 hello->dictionary_id, compression_dictionary_id(m_compression));
+
+    m_wire_capabilities.store(capabilities);
+    m_compact_receive = has_wire_capability(capabilities, WireCapability::CompactHeader);
+}
+
 std::exception_ptr PacketStreamServer::get_recv_exception() const {
     return m_recv_thread_exception;
 }
 
 void PacketStreamServer::receive_loop() {
+    trace_set_thread_name("PacketStreamServer receive");
+
     std::byte temp_buffer[TEMP_BUFFER_SIZE];
 
     while (m_running)
@@ -431,83 +1416,187 @@ void PacketStreamServer::receive_loop() {
         {
             continue;
         }
-        else if (bytes_read == 0)
-        {
-            throw std::runtime_error("[PacketStreamServer] client disconnected");
-        }
-        else if (bytes_read < 0)
+
+        consume_received(temp_buffer, bytes_read);
+    }
+}
+
+/*
+    Event loop mode: drains what the socket has right now,
+    returns false to unregister the stream from the loop
+*/
+bool PacketStreamServer::pump() {
+    std::byte temp_buffer[TEMP_BUFFER_SIZE];
+
+    try
+    {
+        for (size_t i = 0; i < MAX_READS_PER_PUMP && m_running; i++)
         {
-            /*
-                ECONNRESET:     The pair crashed without calling close()
-                EPIPE:          The pair has already used close()
-            */
-            if (errno == ECONNRESET || errno == EPIPE)
+            ssize_t bytes_read = m_connection->recv_data_nowait(temp_buffer, TEMP_BUFFER_SIZE);
+
+            if (bytes_read == SOCKET_RECV_TIMEOUT)
+            {
+                break;
+            }
+
+            // poll() keeps reporting a failed socket as readable, so any error is final here
+            if (bytes_read < 0 && errno != ECONNRESET && errno != EPIPE)
             {
-                throw std::runtime_error("[PacketStreamServer] client connection reset");
+                throw std::runtime_error("[PacketStreamServer] recv failed");
             }
+
+            consume_received(temp_buffer, bytes_read);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_recv_thread_exception = std::current_exception();
+
+        LOG_ERROR("[PacketStreamServer] Receive pump threw an exception: {}", e.what());
+
+        // is_running() turns false as after stop(), whichever of the two gets here first reports Closed
+        if (m_running.exchange(false))
+        {
+            notify(StreamEvent::Closed);
+        }
+
+        return false;
+    }
+
+    return m_running;
+}
+
+void PacketStreamServer::consume_received(const std::byte* data, ssize_t bytes_read) {
+    if (bytes_read == 0)
+    {
+        throw std::runtime_error("[PacketStreamServer] client disconnected");
+    }
+    else if (bytes_read < 0)
+    {
+        /*
+            ECONNRESET:     The pair crashed without calling close()
+            EPIPE:          The pair has already used close()
+        */
+        if (errno == ECONNRESET || errno == EPIPE)
+        {
+            throw std::runtime_error("[PacketStreamServer] client connection reset");
         }
 
-        m_buffer.insert(m_buffer.end(), temp_buffer, temp_buffer + bytes_read);
+        return;
+    }
+
+    m_buffer.insert(m_buffer.end(), data, data + bytes_read);
+
+    process_buffer();
+}
 
-        process_buffer();
+void PacketStreamServer::notify(StreamEvent event) {
+    if (m_receive_callback)
+    {
+        m_receive_callback(event);
     }
 }
 
 void PacketStreamServer::process_buffer() {
+    TRACE_ZONE("process_buffer", "receive");
+
     size_t offset = 0;
+    size_t skipped = 0;
 
-    while (m_buffer.size() - offset >= PACKET_HEADER_SIZE)
+    while (offset < m_buffer.size())
     {
-        PacketHeader header;
-        memcpy(&header, m_buffer.data() + offset, PACKET_HEADER_SIZE);
+        PacketHeader header = {};
+        size_t header_size = 0;
 
-        if (header.magic_number != PACKET_MAGIC_NUMBER)
+        const auto status = read_wire_header(m_buffer, offset, m_compact_receive && m_wire_synced,
+                                             m_recv_sequence, header, header_size);
+
+        if (status == CompactHeaderStatus::Incomplete)
+        {
+            break;
+        }
+
+        // Skip bytes until the next full header
+        if (status == CompactHeaderStatus::Invalid)
         {
+            m_wire_synced = false;
             offset++;
-            
+            skipped++;
+
             continue;
         }
 
-        if (m_buffer.size() - offset < PACKET_HEADER_SIZE + header.payload_size)
+        if (m_buffer.size() - offset < header_size + header.payload_size)
         {
             break;
         }
 
-        auto payload_start = m_buffer.begin() + offset + PACKET_HEADER_SIZE;
+        m_wire_synced = true;
+        m_recv_sequence = header.sequence_number;
+
+        const auto packet_size = header_size + header.payload_size;
+
+        if (m_metrics)
+        {
+            const auto base_type = static_cast<uint32_t>(header.payload_type) & ~PAYLOAD_COMPRESSED_FLAG;
+
+            m_metrics->on_received(static_cast<PayloadType>(base_type), packet_size);
+        }
+
+        auto payload_start = m_buffer.begin() + offset + header_size;
         auto payload_end   = payload_start + header.payload_size;
 
-        const auto payload_type = static_cast<PayloadType>(header.payload_type);
-        std::vector<std::byte> payload(payload_start, payload_end);
-        std::optional<PacketPayload> message;
+        // Reuses the capacity of the previous payload, no allocation once it has seen the largest one
+        auto& payload = m_payload;
 
-        switch (payload_type)
+        payload.assign(payload_start, payload_end);
+
+        if (is_payload_compressed(header) && !inflate_payload(header, payload, m_compression))
         {
-            case PayloadType::ClientHello:              { message = deserialize_client_hello(payload);              break; }
-            case PayloadType::ClientGoodbye:            { message = deserialize_client_goodbye(payload);            break; }
-            case PayloadType::ClientGameRequest:        { message = deserialize_client_game_request(payload);       break; }
-            case PayloadType::ClientReconnectRequest:   { message = deserialize_client_reconnect_request(payload);  break; }
-            case PayloadType::ClientInput:              { message = deserialize_client_input(payload);              break; }
-            default:
+            LOG_ERROR("[PacketStreamServer] Failed to decompress a payload, the packet has been discarded");
+
+            if (m_metrics)
             {
-                std::cerr << "[PacketStreamServer] ERROR: Invalid payload type: " 
-                          << static_cast<uint32_t>(payload_type) << "\n"
-                          << "[PacketStreamServer] ERROR: Failed to process the buffer" << "\n";
-                break;
+                m_metrics->on_discarded();
             }
+
+            offset += packet_size;
+
+            continue;
         }
 
-        if (message.has_value())
+        if (header.payload_type == PayloadType::Bundle)
         {
-            const auto packet = Packet {
-                header,
-                message.value()
-            };
+            const auto unpacked = unpack_bundle(header, payload, m_entry_payload, [this](const PacketHeader& entry_header, const std::vector<std::byte>& entry_payload) {
+                handle_payload(entry_header, entry_payload);
+            });
 
-            std::lock_guard<std::mutex> lock(m_packet_mutex);
-            m_packet_queue.push(std::move(packet));
+            if (!unpacked)
+            {
+                LOG_ERROR("[PacketStreamServer] Malformed bundle has been discarded");
+
+                if (m_metrics)
+                {
+                    m_metrics->on_discarded();
+                }
+            }
+        }
+        else
+        {
+            handle_payload(header, payload);
+        }
+
+        if (m_recorder)
+        {
+            m_recorder->record(m_recorder_stream_id, RecordDirection::Received, header, payload.data(), payload.size());
         }
 
-        offset += PACKET_HEADER_SIZE + header.payload_size;
+        offset += packet_size;
+    }
+
+    if (m_metrics && skipped > 0)
+    {
+        m_metrics->on_resync_skipped(skipped);
     }
 
     if (offset > 0)
@@ -515,3 +1604,73 @@ void PacketStreamServer::process_buffer() {
         m_buffer.erase(m_buffer.begin(), m_buffer.begin() + offset);
     }
 }
+
+void PacketStreamServer::handle_payload(const PacketHeader& header, const std::vector<std::byte>& payload) {
+    TRACE_ZONE("handle_payload", "decode");
+    StreamMetricsTimer timer(m_metrics.get(), StreamTiming::Deserialize);
+
+    if (header.payload_type == PayloadType::ClientHello)
+    {
+        negotiate(payload);
+    }
+
+    // Typed handlers take the payload before it is wrapped into a Packet
+    if (m_dispatcher.dispatch(header, payload))
+    {
+        return;
+    }
+
+    const auto payload_type = static_cast<PayloadType>(header.payload_type);
+    std::optional<PacketPayload> message;
+
+    switch (payload_type)
+    {
+        case PayloadType::ClientHello:              { message = deserialize_client_hello(payload);              break; }
+        case PayloadType::ClientGoodbye:            { message = deserialize_client_goodbye(payload);            break; }
+        case PayloadType::ClientGameRequest:        { message = deserialize_client_game_request(payload);       break; }
+        case PayloadType::ClientReconnectRequest:   { message = deserialize_client_reconnect_request(payload);  break; }
+        case PayloadType::ClientInput:              { message = deserialize_client_input(payload);              break; }
+        case PayloadType::ClientInputWindow:        { message = deserialize_client_input_window(payload);       break; }
+        default:
+        {
+            LOG_ERROR("[PacketStreamServer] Invalid payload type: {}, failed to process the buffer", payload_type);
+
+            if (m_metrics)
+            {
+                m_metrics->on_discarded();
+            }
+
+            break;
+        }
+    }
+
+    if (message.has_value())
+    {
+        auto packet = Packet {
+            header,
+            std::move(message.value())
+        };
+
+        if (!push_packet(m_packet_queue, m_packet_overflow, std::move(packet)))
+        {
+            LOG_WARNING("[PacketStreamServer] Packet queue is full, a {} packet has been dropped", payload_type);
+
+            if (m_metrics)
+            {
+                m_metrics->on_packet_dropped();
+            }
+
+            return;
+        }
+
+        m_pushed_packets++;
+        TRACE_FLOW_BEGIN("packet queue", "queue", trace_flow_id(&m_packet_queue, m_pushed_packets));
+
+        if (m_metrics)
+        {
+            m_metrics->set_packet_queue_depth(m_packet_queue.size_approx());
+        }
+
+        notify(StreamEvent::Packet);
+    }
+}
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cstring>
+#include <packet_serializer/frame_serializer.hpp>
+#include <recorder/replay_reader.hpp>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    template <typename T>
+    T read_trivial(const std::byte* data) {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+
+        return value;
+    }
+}
+
+/*
+    Record
+*/
+std::optional<FrameSnapshot> ReplayRecord::frame() const {
+    if (header.header.payload_type != PayloadType::FrameSnapshot)
+    {
+        return std::nullopt;
+    }
+
+    return deserialize_frame(payload, payload_size());
+}
+
+/*
+    Cursors
+*/
+ReplayCursor::ReplayCursor(const ReplayReader& reader, uint64_t offset)
+    : m_reader(&reader)
+    , m_offset(offset)
+{}
+
+std::optional<ReplayRecord> ReplayCursor::next() {
+    auto record = m_reader->record_at(m_offset);
+
+    if (record.has_value())
+    {
+        m_offset += SESSION_RECORD_HEADER_SIZE + record->payload_size();
+    }
+
+    return record;
+}
+
+uint64_t ReplayCursor::offset() const {
+    return m_offset;
+}
+
+ReplayFrameCursor::ReplayFrameCursor(const ReplayReader& reader, size_t first, size_t last)
+    : m_reader(&reader)
+    , m_next(first)
+    , m_last(last)
+{}
+
+std::optional<ReplayRecord> ReplayFrameCursor::next() {
+    const auto& index = m_reader->index();
+
+    while (m_next < m_last)
+    {
+        auto record = m_reader->frame_at(index[m_next++]);
+
+        if (record.has_value())
+        {
+            return record;
+        }
+    }
+
+    return std::nullopt;
+}
+
+size_t ReplayFrameCursor::remaining() const {
+    return m_last - m_next;
+}
+
+/*
+    Reader
+*/
+ReplayReader::ReplayReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_records_end(0)
+    , m_file_header{}
+    , m_footer_index(false)
+#ifdef _WIN32
+    , m_file_handle(nullptr)
+    , m_mapping_handle(nullptr)
+#else
+    , m_fd(-1)
+#endif
+{}
+
+ReplayReader::~ReplayReader() {
+    close();
+}
+
+bool ReplayReader::open(const std::string& file_path) {
+    close();
+
+#ifdef _WIN32
+    const auto file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(SESSION_FILE_HEADER_SIZE))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    const auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    const auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+    m_data = static_cast<const std::byte*>(view);
+    m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+    const auto fd = ::open(file_path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(SESSION_FILE_HEADER_SIZE))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const auto view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_data = static_cast<const std::byte*>(view);
+    m_size = static_cast<uint64_t>(file_stat.st_size);
+#endif
+
+    m_file_header = read_trivial<SessionFileHeader>(m_data);
+
+    if (m_file_header.magic_number != SESSION_FILE_MAGIC || m_file_header.version != SESSION_FILE_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    m_footer_index = load_footer_index();
+
+    if (!m_footer_index)
+    {
+        rebuild_index();
+    }
+
+    return true;
+}
+
+void ReplayReader::close() {
+    if (m_data != nullptr)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<std::byte*>(m_data), static_cast<size_t>(m_size));
+#endif
+    }
+
+#ifdef _WIN32
+    if (m_mapping_handle != nullptr)
+    {
+        CloseHandle(m_mapping_handle);
+        m_mapping_handle = nullptr;
+    }
+
+    if (m_file_handle != nullptr)
+    {
+        CloseHandle(m_file_handle);
+        m_file_handle = nullptr;
+    }
+#else
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_records_end = 0;
+    m_file_header = {};
+    m_index.clear();
+    m_footer_index = false;
+}
+
+bool ReplayReader::is_open() const {
+    return m_data != nullptr;
+}
+
+const SessionFileHeader& ReplayReader::file_header() const {
+    return m_file_header;
+}
+
+bool ReplayReader::has_footer_index() const {
+    return m_footer_index;
+}
+
+const std::vector<SessionIndexEntry>& ReplayReader::index() const {
+    return m_index;
+}
+
+std::optional<SessionIndexEntry> ReplayReader::seek_frame(uint32_t stream_id, uint32_t frame_timestamp) const {
+    const SessionIndexEntry key { stream_id, frame_timestamp, 0, 0, 0 };
+    const auto it = std::lower_bound(m_index.begin(), m_index.end(), key, session_index_less);
+
+    if (it == m_index.end() || it->stream_id != stream_id)
+    {
+        return std::nullopt;
+    }
+
+    return *it;
+}
+
+std::optional<ReplayRecord> ReplayReader::record_at(uint64_t offset) const {
+    if (offset < SESSION_FILE_HEADER_SIZE || offset > m_records_end ||
+        m_records_end - offset < SESSION_RECORD_HEADER_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    ReplayRecord record;
+
+    record.offset = offset;
+    record.header = read_trivial<SessionRecordHeader>(m_data + offset);
+    record.payload = m_data + offset + SESSION_RECORD_HEADER_SIZE;
+
+    if (record.header.header.magic_number != PACKET_MAGIC_NUMBER ||
+        m_records_end - offset - SESSION_RECORD_HEADER_SIZE < record.payload_size())
+    {
+        return std::nullopt;
+    }
+
+    return record;
+}
+
+std::optional<ReplayRecord> ReplayReader::frame_at(const SessionIndexEntry& index_entry) const {
+    auto record = record_at(index_entry.offset);
+
+    if (!record.has_value() || index_entry.payload_offset > record->payload_size() ||
+        record->payload_size() - index_entry.payload_offset < index_entry.payload_size)
+    {
+        return std::nullopt;
+    }
+
+    auto& header = record->header.header;
+
+    if (header.payload_type == PayloadType::Bundle)
+    {
+        header.payload_type = PayloadType::FrameSnapshot;
+        header.payload_size = index_entry.payload_size;
+        record->payload += index_entry.payload_offset;
+    }
+    else if (header.payload_type != PayloadType::FrameSnapshot)
+    {
+        return std::nullopt;
+    }
+
+    return record;
+}
+
+ReplayCursor ReplayReader::records() const {
+    return ReplayCursor(*this, SESSION_FILE_HEADER_SIZE);
+}
+
+ReplayFrameCursor ReplayReader::frames(uint32_t stream_id, uint32_t from_timestamp) const {
+    const SessionIndexEntry first_key { stream_id, from_timestamp, 0, 0, 0 };
+
+    const auto first = std::lower_bound(m_index.begin(), m_index.end(), first_key, session_index_less);
+    const auto last = std::partition_point(first, m_index.end(), [stream_id](const SessionIndexEntry& entry) {
+        return entry.stream_id == stream_id;
+    });
+
+    return ReplayFrameCursor(*this, first - m_index.begin(), last - m_index.begin());
+}
+
+uint64_t ReplayReader::records_end() const {
+    return m_records_end;
+}
+
+uint64_t ReplayReader::file_size() const {
+    return m_size;
+}
+
+bool ReplayReader::load_footer_index() {
+    if (m_size < SESSION_FILE_HEADER_SIZE + SESSION_FILE_FOOTER_SIZE)
+    {
+        return false;
+    }
+
+    const auto footer = read_trivial<SessionFileFooter>(m_data + m_size - SESSION_FILE_FOOTER_SIZE);
+    const auto index_space = m_size - SESSION_FILE_FOOTER_SIZE;
+
+    if (footer.magic_number != SESSION_INDEX_MAGIC || footer.version != SESSION_FILE_VERSION ||
+        footer.index_offset < SESSION_FILE_HEADER_SIZE || footer.index_offset > index_space ||
+        footer.entry_count != (index_space - footer.index_offset) / SESSION_INDEX_ENTRY_SIZE ||
+        (index_space - footer.index_offset) % SESSION_INDEX_ENTRY_SIZE != 0)
+    {
+        return false;
+    }
+
+    m_records_end = footer.index_offset;
+    m_index.resize(footer.entry_count);
+
+    if (footer.entry_count > 0)
+    {
+        std::memcpy(m_index.data(), m_data + footer.index_offset, footer.entry_count * SESSION_INDEX_ENTRY_SIZE);
+    }
+
+    // Entries have to be in order for the binary searches
+    if (!std::is_sorted(m_index.begin(), m_index.end(), session_index_less))
+    {
+        m_index.clear();
+        m_records_end = 0;
+
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    No usable footer: every whole record up to the first damaged
+    or truncated one is kept, frames are indexed on the way
+*/
+void ReplayReader::rebuild_index() {
+    m_records_end = m_size;
+    m_index.clear();
+
+    auto cursor = records();
+
+    while (const auto record = cursor.next())
+    {
+        index_session_record(record->header, record->offset, record->payload, m_index);
+    }
+
+    m_records_end = cursor.offset();
+
+    std::sort(m_index.begin(), m_index.end(), session_index_less);
+}
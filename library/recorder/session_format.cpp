@@ -0,0 +1,51 @@
+#include <cstring>
+#include <packet_serializer/bundle_serializer.hpp>
+#include <packet_serializer/frame_serializer.hpp>
+#include <recorder/session_format.hpp>
+
+namespace {
+    void index_frame(uint32_t stream_id, uint64_t offset, const std::byte* payload, size_t payload_offset, size_t payload_size,
+                     std::vector<SessionIndexEntry>& index) {
+        if (payload_size < FRAME_SNAPSHOT_TIMESTAMP_OFFSET + sizeof(uint32_t))
+        {
+            return;
+        }
+
+        SessionIndexEntry index_entry = {};
+
+        index_entry.stream_id       = stream_id;
+        index_entry.offset          = offset;
+        index_entry.payload_offset  = static_cast<uint32_t>(payload_offset);
+        index_entry.payload_size    = static_cast<uint32_t>(payload_size);
+        std::memcpy(&index_entry.frame_timestamp, payload + payload_offset + FRAME_SNAPSHOT_TIMESTAMP_OFFSET, sizeof(uint32_t));
+
+        index.push_back(index_entry);
+    }
+}
+
+void index_session_record(const SessionRecordHeader& record_header, uint64_t offset, const std::byte* payload,
+                          std::vector<SessionIndexEntry>& index) {
+    const auto& header = record_header.header;
+
+    if (header.payload_type == PayloadType::FrameSnapshot)
+    {
+        index_frame(record_header.stream_id, offset, payload, 0, header.payload_size, index);
+    }
+    else if (header.payload_type == PayloadType::Bundle)
+    {
+        const auto entries = deserialize_bundle(payload, header.payload_size);
+
+        if (!entries.has_value())
+        {
+            return;
+        }
+
+        for (const auto& entry : entries.value())
+        {
+            if (entry.payload_type == PayloadType::FrameSnapshot)
+            {
+                index_frame(record_header.stream_id, offset, payload, entry.offset, entry.size, index);
+            }
+        }
+    }
+}
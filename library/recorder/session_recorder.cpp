@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <recorder/session_recorder.hpp>
+
+namespace {
+    // How long the writer thread sleeps when the queue is empty
+    constexpr auto IDLE_INTERVAL = std::chrono::milliseconds(1);
+
+    // A partial batch is written at least this often
+    constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(100);
+
+    uint64_t steady_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t wall_clock_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    // Commit word of the chunks left unused before the end of the ring, or'ed with their count
+    constexpr uint32_t PADDING_COMMIT = 0x80000000u;
+
+    size_t chunks_of(size_t bytes) {
+        return (bytes + SESSION_RECORDER_CHUNK_SIZE - 1) / SESSION_RECORDER_CHUNK_SIZE;
+    }
+
+    template <typename T>
+    void append_trivial(std::vector<std::byte>& out, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+        const auto offset = out.size();
+
+        out.resize(offset + sizeof(T));
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+}
+
+SessionRecorder::SessionRecorder(size_t ring_size)
+    : m_ring_size(std::max<size_t>(chunks_of(std::min<size_t>(ring_size, PADDING_COMMIT - 1)), 1) * SESSION_RECORDER_CHUNK_SIZE)
+    , m_ring(new std::byte[m_ring_size])
+    , m_commits(new std::atomic<uint32_t>[m_ring_size / SESSION_RECORDER_CHUNK_SIZE])
+    , m_head(0)
+    , m_tail(0)
+    , m_running(false)
+    , m_recording(0)
+    , m_writing(false)
+    , m_start_ns(0)
+    , m_file_size(0)
+    , m_recorded(0)
+    , m_dropped(0)
+    , m_bytes_written(0)
+{
+    // Touched up front so that record() does not take the page faults
+    std::memset(m_ring.get(), 0, m_ring_size);
+
+    for (size_t i = 0; i < m_ring_size / SESSION_RECORDER_CHUNK_SIZE; i++)
+    {
+        m_commits[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+SessionRecorder::~SessionRecorder() {
+    stop();
+}
+
+bool SessionRecorder::start(const std::string& file_path) {
+    if (m_running)
+    {
+        return false;
+    }
+
+    m_file.open(file_path, std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    SessionFileHeader file_header = {};
+
+    file_header.magic_number    = SESSION_FILE_MAGIC;
+    file_header.version         = SESSION_FILE_VERSION;
+    file_header.start_time_ns   = wall_clock_ns();
+
+    m_batch.clear();
+    m_batch.reserve(SESSION_RECORDER_BATCH_SIZE + SESSION_RECORD_HEADER_SIZE);
+    append_trivial(m_batch, file_header);
+
+    m_index.clear();
+    m_file_size = 0;
+    m_recorded = 0;
+    m_dropped = 0;
+    m_bytes_written = 0;
+    m_start_ns = steady_ns();
+    m_writing = true;
+
+    m_writer_thread = std::thread(&SessionRecorder::writer_loop, this);
+
+    // Publishes m_start_ns to record()
+    m_running.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void SessionRecorder::stop() {
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+
+    // A record() call that saw m_running set commits before the writer thread is told to finish
+    while (m_recording.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    m_writing.store(false, std::memory_order_release);
+
+    if (m_writer_thread.joinable())
+    {
+        m_writer_thread.join();
+    }
+
+    m_file.close();
+}
+
+bool SessionRecorder::is_running() const {
+    return m_running;
+}
+
+bool SessionRecorder::record(uint32_t stream_id, RecordDirection direction, const PacketHeader& header,
+                             const std::byte* payload, size_t size) {
+    /*
+        Counted before m_running is read, both sequentially consistent, so
+        stop() either sees the call in progress or the call sees the stop.
+        The load also acquires m_start_ns from start().
+    */
+    m_recording.fetch_add(1);
+
+    if (!m_running.load())
+    {
+        m_recording.fetch_sub(1, std::memory_order_release);
+
+        return false;
+    }
+
+    const auto timestamp = steady_ns() - m_start_ns;
+    const auto bytes = SESSION_RECORD_HEADER_SIZE + size;
+    const auto count = chunks_of(bytes);
+    const auto chunk_count = m_ring_size / SESSION_RECORDER_CHUNK_SIZE;
+
+    bool reserved = false;
+    uint64_t first = 0;
+
+    if (count <= chunk_count)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            const auto offset = tail % chunk_count;
+            const auto padding = offset + count > chunk_count ? chunk_count - offset : 0;
+
+            if (tail + padding + count - m_head.load(std::memory_order_acquire) > chunk_count)
+            {
+                break;
+            }
+
+            if (m_tail.compare_exchange_weak(tail, tail + padding + count, std::memory_order_relaxed))
+            {
+                if (padding > 0)
+                {
+                    m_commits[offset].store(PADDING_COMMIT | static_cast<uint32_t>(padding), std::memory_order_release);
+                }
+
+                first = (tail + padding) % chunk_count;
+                reserved = true;
+
+                break;
+            }
+        }
+    }
+
+    if (reserved)
+    {
+        SessionRecordHeader record_header = {};
+
+        record_header.timestamp_ns          = timestamp;
+        record_header.stream_id             = stream_id;
+        record_header.direction             = direction;
+        record_header.header                = header;
+        record_header.header.payload_size   = static_cast<uint32_t>(size);
+
+        auto* out = m_ring.get() + first * SESSION_RECORDER_CHUNK_SIZE;
+
+        std::memcpy(out, &record_header, SESSION_RECORD_HEADER_SIZE);
+
+        if (size > 0)
+        {
+            std::memcpy(out + SESSION_RECORD_HEADER_SIZE, payload, size);
+        }
+
+        m_commits[first].store(static_cast<uint32_t>(bytes), std::memory_order_release);
+        m_recorded.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_recording.fetch_sub(1, std::memory_order_release);
+
+    return reserved;
+}
+
+SessionRecorderStats SessionRecorder::stats() const {
+    SessionRecorderStats stats;
+
+    stats.recorded      = m_recorded.load(std::memory_order_relaxed);
+    stats.dropped       = m_dropped.load(std::memory_order_relaxed);
+    stats.bytes_written = m_bytes_written.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void SessionRecorder::writer_loop() {
+    auto last_write = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        // Read before draining so that nothing committed before stop() is missed
+        const auto keep_running = m_writing.load(std::memory_order_acquire);
+
+        const auto drained = drain_ring();
+        const auto now = std::chrono::steady_clock::now();
+
+        if (drained == 0)
+        {
+            if (!keep_running)
+            {
+                break;
+            }
+
+            if (!m_batch.empty() && now - last_write >= WRITE_INTERVAL)
+            {
+                write_batch();
+                last_write = now;
+            }
+
+            std::this_thread::sleep_for(IDLE_INTERVAL);
+        }
+    }
+
+    write_batch();
+    write_index();
+}
+
+// Consumes the committed records at the head of the ring, returns the records and paddings consumed
+size_t SessionRecorder::drain_ring() {
+    const auto chunk_count = m_ring_size / SESSION_RECORDER_CHUNK_SIZE;
+
+    auto head = m_head.load(std::memory_order_relaxed);
+    size_t drained = 0;
+
+    while (true)
+    {
+        auto& commit = m_commits[head % chunk_count];
+        const auto word = commit.load(std::memory_order_acquire);
+
+        if (word == 0)
+        {
+            break;
+        }
+
+        size_t count = word & ~PADDING_COMMIT;
+
+        if ((word & PADDING_COMMIT) == 0)
+        {
+            const auto* record = m_ring.get() + (head % chunk_count) * SESSION_RECORDER_CHUNK_SIZE;
+
+            SessionRecordHeader record_header;
+            std::memcpy(&record_header, record, SESSION_RECORD_HEADER_SIZE);
+
+            append_entry(record_header, record + SESSION_RECORD_HEADER_SIZE);
+
+            if (m_batch.size() >= SESSION_RECORDER_BATCH_SIZE)
+            {
+                write_batch();
+            }
+
+            count = chunks_of(word);
+        }
+
+        // Hand the chunks back, the producers only reuse them once m_head has moved past
+        commit.store(0, std::memory_order_relaxed);
+        head += count;
+        m_head.store(head, std::memory_order_release);
+
+        drained++;
+    }
+
+    return drained;
+}
+
+void SessionRecorder::append_entry(const SessionRecordHeader& record_header, const std::byte* payload) {
+    index_session_record(record_header, m_file_size + m_batch.size(), payload, m_index);
+
+    append_trivial(m_batch, record_header);
+    m_batch.insert(m_batch.end(), payload, payload + record_header.header.payload_size);
+}
+
+void SessionRecorder::write_batch() {
+    if (m_batch.empty())
+    {
+        return;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_batch.data()), static_cast<std::streamsize>(m_batch.size()));
+    m_file.flush();
+
+    m_file_size += m_batch.size();
+    m_bytes_written.store(m_file_size, std::memory_order_relaxed);
+    m_batch.clear();
+}
+
+void SessionRecorder::write_index() {
+    std::sort(m_index.begin(), m_index.end(), session_index_less);
+
+    SessionFileFooter footer = {};
+
+    footer.index_offset = m_file_size;
+    footer.entry_count  = m_index.size();
+    footer.magic_number = SESSION_INDEX_MAGIC;
+    footer.version      = SESSION_FILE_VERSION;
+
+    for (const auto& index_entry : m_index)
+    {
+        append_trivial(m_batch, index_entry);
+
+        if (m_batch.size() >= SESSION_RECORDER_BATCH_SIZE)
+        {
+            write_batch();
+        }
+    }
+
+    append_trivial(m_batch, footer);
+    write_batch();
+}
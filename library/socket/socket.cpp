@@ -1,12 +1,17 @@
-#include <iostream>
 #include <array>
 #include <limits>
+#include <logger/log_macros.hpp>
 #include <socket/socket.hpp>
 
+#ifndef _WIN32
+    #include <poll.h>
+#endif
+
 namespace {
     constexpr size_t TEMP_BUFFER_SIZE = 4096;
 
     ssize_t wait_for_read_ready(SOCKET sock, long sec, long usec) {
+#ifdef _WIN32
         fd_set readfds;
         FD_ZERO(&readfds);
         FD_SET(sock, &readfds);
@@ -16,20 +21,32 @@ namespace {
         timeout.tv_usec = usec;
 
         return select(sock + 1, &readfds, nullptr, nullptr, &timeout);
+#else
+        /*
+            poll() rather than select(): an fd_set can't hold descriptors past
+            FD_SETSIZE (1024), which a process with a few thousand connections has
+        */
+        pollfd descriptor = {};
+
+        descriptor.fd = sock;
+        descriptor.events = POLLIN;
+
+        return poll(&descriptor, 1, static_cast<int>(sec * 1000 + (usec + 999) / 1000));
+#endif
     }
 
-    ssize_t socket_send(SOCKET sock, const std::vector<std::byte>& bytes) {
+    ssize_t socket_send(SOCKET sock, const std::byte* data, size_t size) {
         // Check for overflow
 #ifdef _WIN32
-        if (bytes.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+        if (size > static_cast<size_t>(std::numeric_limits<int>::max()))
         {
             return SOCKET_ERROR;
         }
 
-        int safe_size = static_cast<int>(bytes.size());
+        int safe_size = static_cast<int>(size);
         int frags = 0;
 #else
-        size_t safe_size = bytes.size();
+        size_t safe_size = size;
         int frags = MSG_NOSIGNAL;
 #endif
         return send(
@@ -37,13 +54,17 @@ namespace {
             /*
                 Convert std::byte* into const char*
             */
-            reinterpret_cast<const char*>(bytes.data()),
+            reinterpret_cast<const char*>(data),
             safe_size,
             frags
         );
     }
 
-    ssize_t socket_recv(SOCKET sock, std::byte* buffer, size_t size) {
+    ssize_t socket_send(SOCKET sock, const std::vector<std::byte>& bytes) {
+        return socket_send(sock, bytes.data(), bytes.size());
+    }
+
+    ssize_t socket_recv(SOCKET sock, std::byte* buffer, size_t size, long sec = 1, long usec = 0) {
         // Check for overflow
 #ifdef _WIN32
         if (size > static_cast<size_t>(std::numeric_limits<int>::max()))
@@ -56,7 +77,7 @@ namespace {
         size_t safe_size = size;
 #endif
         
-        auto result = wait_for_read_ready(sock, 1, 0);
+        auto result = wait_for_read_ready(sock, sec, usec);
 
         if (result > 0)
         {
@@ -237,6 +258,10 @@ bool ClientSocket::connect_to_server() {
     return true;
 }
 
+SOCKET ClientSocket::native_handle() const {
+    return m_server_sock;
+}
+
 void ClientSocket::abort() {
     if (m_server_connected.exchange(false))
     {
@@ -266,6 +291,15 @@ ssize_t ClientSocket::send_data(const std::vector<std::byte>& data) {
     return socket_send(m_server_sock, data);
 }
 
+ssize_t ClientSocket::send_data(const std::byte* data, size_t size) {
+    if (!m_server_connected)
+    {
+        return SOCKET_ERROR;
+    }
+
+    return socket_send(m_server_sock, data, size);
+}
+
 ssize_t ClientSocket::recv_data(std::byte* buffer, size_t size) {
     if (!m_server_connected)
     {
@@ -275,6 +309,15 @@ ssize_t ClientSocket::recv_data(std::byte* buffer, size_t size) {
     return socket_recv(m_server_sock, buffer, size);
 }
 
+ssize_t ClientSocket::recv_data_nowait(std::byte* buffer, size_t size) {
+    if (!m_server_connected)
+    {
+        return SOCKET_ERROR;
+    }
+
+    return socket_recv(m_server_sock, buffer, size, 0, 0);
+}
+
 std::optional<std::vector<std::byte>> ClientSocket::recv_exact(size_t size) {
     if (!m_server_connected)
     {
@@ -323,6 +366,10 @@ ClientConnection& ClientConnection::operator=(ClientConnection&& other) noexcept
     return *this;
 }
 
+SOCKET ClientConnection::native_handle() const {
+    return m_client_sock;
+}
+
 void ClientConnection::abort() {
     if (m_client_connected.exchange(false))
     {
@@ -352,6 +399,15 @@ ssize_t ClientConnection::send_data(const std::vector<std::byte>& data) {
     return socket_send(m_client_sock, data);
 }
 
+ssize_t ClientConnection::send_data(const std::byte* data, size_t size) {
+    if (!m_client_connected)
+    {
+        return SOCKET_ERROR;
+    }
+
+    return socket_send(m_client_sock, data, size);
+}
+
 ssize_t ClientConnection::recv_data(std::byte* buffer, size_t size) {
     if (!m_client_connected)
     {
@@ -361,6 +417,15 @@ ssize_t ClientConnection::recv_data(std::byte* buffer, size_t size) {
     return socket_recv(m_client_sock, buffer, size);
 }
 
+ssize_t ClientConnection::recv_data_nowait(std::byte* buffer, size_t size) {
+    if (!m_client_connected)
+    {
+        return SOCKET_ERROR;
+    }
+
+    return socket_recv(m_client_sock, buffer, size, 0, 0);
+}
+
 std::optional<std::vector<std::byte>> ClientConnection::recv_exact(size_t size) {
     if (!m_client_connected)
     {
@@ -408,7 +473,7 @@ bool ServerSocket::initialize() {
 
     if (bind_result == SOCKET_ERROR)
     {
-        std::cerr << "[ServerSocket] ERROR: Failed to bind address to the listen socket" << "\n";
+        LOG_ERROR("[ServerSocket] Failed to bind address to the listen socket");
 
         close_socket(m_listen_sock);
         return false;
@@ -422,7 +487,7 @@ bool ServerSocket::initialize() {
 
     if (listen_result == SOCKET_ERROR)
     {
-        std::cerr << "[ServerSocket] ERROR: Failed to start listening on socket" << "\n";
+        LOG_ERROR("[ServerSocket] Failed to start listening on socket");
 
         close_socket(m_listen_sock);
         return false;
@@ -456,7 +521,7 @@ void ServerSocket::disconnect() {
 std::optional<ClientConnection> ServerSocket::accept_client() {
     if (!m_initialized)
     {
-        std::cerr << "[ServerSocket] ERROR: accept called without initialization" << "\n";
+        LOG_ERROR("[ServerSocket] accept called without initialization");
 
         return std::nullopt;
     }
@@ -479,7 +544,7 @@ std::optional<ClientConnection> ServerSocket::accept_client() {
     if (client_socket == INVALID_SOCKET)
     {
 #ifdef _WIN32
-        std::cerr << "[ServerSocket] ERROR: Accept failed with error code: " << WSAGetLastError() << "\n"; 
+        LOG_ERROR("[ServerSocket] Accept failed with error code: {}", WSAGetLastError());
 #endif
         return std::nullopt;
     }
@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <cmath>
+#include <spatial_index/bullet_grid.hpp>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define BULLET_GRID_HAS_SSE2 1
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#include <emmintrin.h>
+#define BULLET_GRID_HAS_SSE2 1
+#endif
+
+namespace {
+    // Cells per side, keeps row * columns + column exact in a float for build()
+    constexpr float MAX_GRID_SIDE = 4096.0f;
+
+    // Set bits of a 4 lane comparison mask
+    constexpr uint32_t LANE_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    bool closer(const BulletNeighbor& a, const BulletNeighbor& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.bullet < b.bullet);
+    }
+
+    /*
+        Calls lane(i, squared center distance) for every bullet of [begin, end)
+        whose center is within its radius plus extra of (x, y), testing four
+        bullets at a time.
+    */
+    template <typename Lane>
+    void scan_span(const float* xs, const float* ys, const float* radii, size_t begin, size_t end,
+                   float x, float y, float extra, Lane&& lane) {
+        size_t i = begin;
+
+#ifdef BULLET_GRID_HAS_SSE2
+        const __m128 x4 = _mm_set1_ps(x);
+        const __m128 y4 = _mm_set1_ps(y);
+        const __m128 extra4 = _mm_set1_ps(extra);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), x4);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), y4);
+            const __m128 reach = _mm_add_ps(_mm_loadu_ps(radii + i), extra4);
+            const __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            const int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(reach, reach)));
+
+            if (mask == 0)
+            {
+                continue;
+            }
+
+            alignas(16) float distances[4];
+            _mm_store_ps(distances, distance);
+
+            for (int l = 0; l < 4; l++)
+            {
+                if ((mask & (1 << l)) != 0)
+                {
+                    lane(i + l, distances[l]);
+                }
+            }
+        }
+#endif
+
+        for (; i < end; i++)
+        {
+            const float dx = xs[i] - x;
+            const float dy = ys[i] - y;
+            const float reach = radii[i] + extra;
+            const float distance = dx * dx + dy * dy;
+
+            if (distance <= reach * reach)
+            {
+                lane(i, distance);
+            }
+        }
+    }
+
+    // Counts the bullets of [begin, end) overlapping the circle, stops at the first one when first_only
+    uint32_t count_hits(const float* xs, const float* ys, const float* radii, size_t begin, size_t end,
+                        float x, float y, float radius, bool first_only) {
+        uint32_t hits = 0;
+        size_t i = begin;
+
+#ifdef BULLET_GRID_HAS_SSE2
+        const __m128 x4 = _mm_set1_ps(x);
+        const __m128 y4 = _mm_set1_ps(y);
+        const __m128 radius4 = _mm_set1_ps(radius);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), x4);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), y4);
+            const __m128 reach = _mm_add_ps(_mm_loadu_ps(radii + i), radius4);
+            const __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            hits += LANE_COUNT[_mm_movemask_ps(_mm_cmple_ps(distance, _mm_mul_ps(reach, reach)))];
+
+            if (first_only && hits > 0)
+            {
+                return hits;
+            }
+        }
+#endif
+
+        for (; i < end; i++)
+        {
+            const float dx = xs[i] - x;
+            const float dy = ys[i] - y;
+            const float reach = radii[i] + radius;
+
+            if (dx * dx + dy * dy <= reach * reach)
+            {
+                hits++;
+
+                if (first_only)
+                {
+                    return hits;
+                }
+            }
+        }
+
+        return hits;
+    }
+}
+
+BulletGrid::BulletGrid(BulletGridOptions options)
+    : m_options(options)
+    , m_max_radius(0.0f)
+{
+    m_options.cell_size = m_options.cell_size > 0.0f ? m_options.cell_size : 16.0f;
+    m_inverse_cell_size = 1.0f / m_options.cell_size;
+    m_columns = std::max(1, static_cast<int>(std::min(MAX_GRID_SIDE, std::ceil(m_options.width * m_inverse_cell_size))));
+    m_rows = std::max(1, static_cast<int>(std::min(MAX_GRID_SIDE, std::ceil(m_options.height * m_inverse_cell_size))));
+
+    m_cell_start.assign(static_cast<size_t>(m_columns) * m_rows + 1, 0);
+    m_cursor.resize(static_cast<size_t>(m_columns) * m_rows);
+}
+
+const BulletGridOptions& BulletGrid::options() const {
+    return m_options;
+}
+
+int BulletGrid::cell_column(float x) const {
+    // std::max first so NaN lands in the first column
+    const float column = std::max(0.0f, (x - m_options.origin_x) * m_inverse_cell_size);
+
+    return static_cast<int>(std::min(column, static_cast<float>(m_columns - 1)));
+}
+
+int BulletGrid::cell_row(float y) const {
+    const float row = std::max(0.0f, (y - m_options.origin_y) * m_inverse_cell_size);
+
+    return static_cast<int>(std::min(row, static_cast<float>(m_rows - 1)));
+}
+
+void BulletGrid::build(const std::vector<BulletSnapshot>& bullets) {
+    const size_t count = bullets.size();
+
+    m_x.resize(count);
+    m_y.resize(count);
+    m_radius.resize(count);
+    m_index.resize(count);
+    m_bullet_cell.resize(count);
+
+    std::fill(m_cell_start.begin(), m_cell_start.end(), 0);
+
+    /* Count the bullets of every cell */
+    size_t i = 0;
+
+#ifdef BULLET_GRID_HAS_SSE2
+    {
+        // Same clamping as cell_column() and cell_row(), NaN goes to 0 as the first operand of _mm_max_ps
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 origin_x = _mm_set1_ps(m_options.origin_x);
+        const __m128 origin_y = _mm_set1_ps(m_options.origin_y);
+        const __m128 inverse = _mm_set1_ps(m_inverse_cell_size);
+        const __m128 last_column = _mm_set1_ps(static_cast<float>(m_columns - 1));
+        const __m128 last_row = _mm_set1_ps(static_cast<float>(m_rows - 1));
+        const __m128 columns = _mm_set1_ps(static_cast<float>(m_columns));
+
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto* bullet = bullets.data() + i;
+
+            // Two positions per register, then x and y split out of the pairs
+            const __m128 xy01 = _mm_loadh_pi(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(&bullet[0].pos)),
+                                             reinterpret_cast<const __m64*>(&bullet[1].pos));
+            const __m128 xy23 = _mm_loadh_pi(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(&bullet[2].pos)),
+                                             reinterpret_cast<const __m64*>(&bullet[3].pos));
+
+            const __m128 x = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 y = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1));
+
+            const __m128 column = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(x, origin_x), inverse), zero), last_column);
+            const __m128 row = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(y, origin_y), inverse), zero), last_row);
+
+            const __m128 row_start = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(row)), columns);
+            const __m128i cell = _mm_add_epi32(_mm_cvttps_epi32(row_start), _mm_cvttps_epi32(column));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(m_bullet_cell.data() + i), cell);
+
+            m_cell_start[m_bullet_cell[i] + 1]++;
+            m_cell_start[m_bullet_cell[i + 1] + 1]++;
+            m_cell_start[m_bullet_cell[i + 2] + 1]++;
+            m_cell_start[m_bullet_cell[i + 3] + 1]++;
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const auto& bullet = bullets[i];
+        const auto cell = static_cast<uint32_t>(cell_row(bullet.pos.y) * m_columns + cell_column(bullet.pos.x));
+
+        m_bullet_cell[i] = cell;
+        m_cell_start[cell + 1]++;
+    }
+
+    for (size_t cell = 1; cell < m_cell_start.size(); cell++)
+    {
+        m_cell_start[cell] += m_cell_start[cell - 1];
+    }
+
+    /*
+        Scatter the indices in cell order, bullets of a cell keep their order,
+        then gather the positions sequentially. Scattering the four arrays at
+        once measures 30 to 40% slower from 10k bullets on, its writes keep
+        four lines open per cell and no longer fit in L1.
+    */
+    std::copy(m_cell_start.begin(), m_cell_start.end() - 1, m_cursor.begin());
+
+    for (i = 0; i < count; i++)
+    {
+        m_index[m_cursor[m_bullet_cell[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    float max_radius = 0.0f;
+
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        const auto& bullet = bullets[m_index[slot]];
+
+        m_x[slot] = bullet.pos.x;
+        m_y[slot] = bullet.pos.y;
+        m_radius[slot] = bullet.radius;
+
+        // NaN radii are dropped, std::max() keeps its first operand
+        max_radius = std::max(max_radius, bullet.radius);
+    }
+
+    m_max_radius = max_radius;
+}
+
+size_t BulletGrid::size() const {
+    return m_index.size();
+}
+
+template <typename SpanFunction>
+void BulletGrid::for_each_span(float x0, float y0, float x1, float y1, SpanFunction&& span) const {
+    if (m_index.empty())
+    {
+        return;
+    }
+
+    const int column_begin = cell_column(x0);
+    const int column_end = cell_column(x1);
+    const int row_begin = cell_row(y0);
+    const int row_end = cell_row(y1);
+
+    for (int row = row_begin; row <= row_end; row++)
+    {
+        const size_t first_cell = static_cast<size_t>(row) * m_columns;
+
+        span(m_cell_start[first_cell + column_begin], m_cell_start[first_cell + column_end + 1]);
+    }
+}
+
+CircleQueryResult BulletGrid::query_circle(float x, float y, float radius, float graze_range) const {
+    CircleQueryResult result;
+
+    const float reach = radius + graze_range + m_max_radius;
+    const float extra = radius + graze_range;
+
+    for_each_span(x - reach, y - reach, x + reach, y + reach, [&](size_t begin, size_t end) {
+        scan_span(m_x.data(), m_y.data(), m_radius.data(), begin, end, x, y, extra, [&](size_t i, float distance) {
+            const float gap = std::sqrt(distance) - (m_radius[i] + radius);
+
+            if (gap <= 0.0f)
+            {
+                result.hits++;
+            }
+            else
+            {
+                result.grazes++;
+            }
+
+            if (gap < result.gap || (gap == result.gap && m_index[i] < result.closest))
+            {
+                result.gap = gap;
+                result.closest = m_index[i];
+            }
+        });
+    });
+
+    return result;
+}
+
+bool BulletGrid::any_hit(float x, float y, float radius) const {
+    const float reach = radius + m_max_radius;
+    bool hit = false;
+
+    for_each_span(x - reach, y - reach, x + reach, y + reach, [&](size_t begin, size_t end) {
+        hit = hit || count_hits(m_x.data(), m_y.data(), m_radius.data(), begin, end, x, y, radius, true) > 0;
+    });
+
+    return hit;
+}
+
+size_t BulletGrid::collect_hits(float x, float y, float radius, uint32_t target, std::vector<BulletHitPair>& out) const {
+    const float reach = radius + m_max_radius;
+    const size_t before = out.size();
+
+    for_each_span(x - reach, y - reach, x + reach, y + reach, [&](size_t begin, size_t end) {
+        scan_span(m_x.data(), m_y.data(), m_radius.data(), begin, end, x, y, radius, [&](size_t i, float) {
+            out.push_back({ target, m_index[i] });
+        });
+    });
+
+    return out.size() - before;
+}
+
+size_t BulletGrid::nearest(float x, float y, size_t k, float max_distance, BulletNeighbor* out) const {
+    if (k == 0 || m_index.empty() || !(max_distance >= 0.0f))
+    {
+        return 0;
+    }
+
+    /*
+        out[0, found) is a max-heap on the squared distance while searching.
+        Rings of cells around the query's cell are scanned outwards until
+        the next ring can not hold anything closer than the heap's top.
+    */
+    const float limit = max_distance * max_distance;
+    size_t found = 0;
+
+    const auto threshold = [&]() {
+        return found < k ? limit : out[0].distance;
+    };
+
+    const auto scan = [&](size_t begin, size_t end) {
+        size_t i = begin;
+
+#ifdef BULLET_GRID_HAS_SSE2
+        const __m128 x4 = _mm_set1_ps(x);
+        const __m128 y4 = _mm_set1_ps(y);
+
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(m_x.data() + i), x4);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(m_y.data() + i), y4);
+            const __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            const int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(threshold())));
+
+            if (mask == 0)
+            {
+                continue;
+            }
+
+            alignas(16) float distances[4];
+            _mm_store_ps(distances, distance);
+
+            for (int l = 0; l < 4; l++)
+            {
+                if ((mask & (1 << l)) == 0)
+                {
+                    continue;
+                }
+
+                const BulletNeighbor candidate { m_index[i + l], distances[l] };
+
+                if (found < k)
+                {
+                    out[found++] = candidate;
+                    std::push_heap(out, out + found, closer);
+                }
+                else if (closer(candidate, out[0]))
+                {
+                    std::pop_heap(out, out + found, closer);
+                    out[found - 1] = candidate;
+                    std::push_heap(out, out + found, closer);
+                }
+            }
+        }
+#endif
+
+        for (; i < end; i++)
+        {
+            const float dx = m_x[i] - x;
+            const float dy = m_y[i] - y;
+            const BulletNeighbor candidate { m_index[i], dx * dx + dy * dy };
+
+            // Written so bullets at NaN are skipped, like _mm_cmple_ps does
+            if (!(candidate.distance <= threshold()))
+            {
+                continue;
+            }
+
+            if (found < k)
+            {
+                out[found++] = candidate;
+                std::push_heap(out, out + found, closer);
+            }
+            else if (closer(candidate, out[0]))
+            {
+                std::pop_heap(out, out + found, closer);
+                out[found - 1] = candidate;
+                std::push_heap(out, out + found, closer);
+            }
+        }
+    };
+
+    const int center_column = cell_column(x);
+    const int center_row = cell_row(y);
+
+    const auto scan_cells = [&](int row, int column_begin, int column_end) {
+        if (row < 0 || row >= m_rows)
+        {
+            return;
+        }
+
+        column_begin = std::max(column_begin, 0);
+        column_end = std::min(column_end, m_columns - 1);
+
+        if (column_begin > column_end)
+        {
+            return;
+        }
+
+        const size_t first_cell = static_cast<size_t>(row) * m_columns;
+
+        scan(m_cell_start[first_cell + column_begin], m_cell_start[first_cell + column_end + 1]);
+    };
+
+    for (int ring = 0; ; ring++)
+    {
+        scan_cells(center_row - ring, center_column - ring, center_column + ring);
+
+        if (ring > 0)
+        {
+            scan_cells(center_row + ring, center_column - ring, center_column + ring);
+
+            for (int row = center_row - ring + 1; row < center_row + ring; row++)
+            {
+                scan_cells(row, center_column - ring, center_column - ring);
+                scan_cells(row, center_column + ring, center_column + ring);
+            }
+        }
+
+        const bool covers_grid = center_column - ring <= 0 && center_row - ring <= 0
+                              && center_column + ring >= m_columns - 1 && center_row + ring >= m_rows - 1;
+
+        // Anything in the next ring is at least ring cells away
+        const float next_ring = static_cast<float>(ring) * m_options.cell_size;
+
+        if (covers_grid || next_ring * next_ring > threshold())
+        {
+            break;
+        }
+    }
+
+    std::sort_heap(out, out + found, closer);
+
+    for (size_t i = 0; i < found; i++)
+    {
+        out[i].distance = std::sqrt(out[i].distance);
+    }
+
+    return found;
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <trace/trace.hpp>
+
+std::atomic<bool> trace_recording{false};
+
+namespace {
+    struct ThreadBuffer {
+        ThreadBuffer(size_t capacity, uint32_t session, uint32_t thread_id, std::string name)
+            : events(std::make_unique<TraceEvent[]>(capacity))
+            , capacity(capacity)
+            , count(0)
+            , session(session)
+            , thread_id(thread_id)
+            , name(std::move(name))
+        {}
+
+        std::unique_ptr<TraceEvent[]>   events;
+        size_t                          capacity;
+        std::atomic<size_t>             count;      // Written by the owning thread only
+        uint32_t                        session;
+        uint32_t                        thread_id;
+        std::string                     name;       // Guarded by registry_mutex
+    };
+
+    /*
+        The thread's name and id outlive sessions, its buffer belongs to one
+        session and is shared with the registry so the export can read it
+        after the thread has exited
+    */
+    struct ThreadState {
+        std::shared_ptr<ThreadBuffer>   buffer;
+        std::string                     name;
+        uint32_t                        thread_id = 0;
+    };
+
+    std::mutex                                  registry_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>>  registry;
+    std::atomic<uint32_t>                       current_session{0};
+    size_t                                      session_capacity = TRACE_DEFAULT_EVENTS_PER_THREAD;
+    uint64_t                                    session_start_ns = 0;
+    std::atomic<uint64_t>                       dropped_events{0};
+    std::atomic<uint32_t>                       next_thread_id{1};
+
+    thread_local ThreadState                    thread_state;
+
+    uint32_t thread_id() {
+        if (thread_state.thread_id == 0)
+        {
+            thread_state.thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return thread_state.thread_id;
+    }
+
+    ThreadBuffer* thread_buffer() {
+        const auto session = current_session.load(std::memory_order_acquire);
+
+        if (thread_state.buffer && thread_state.buffer->session == session)
+        {
+            return thread_state.buffer.get();
+        }
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+
+        // trace_start() may have begun another session meanwhile, join that one
+        thread_state.buffer = std::make_shared<ThreadBuffer>(session_capacity, current_session.load(std::memory_order_relaxed),
+                                                             thread_id(), thread_state.name);
+
+        registry.push_back(thread_state.buffer);
+
+        return thread_state.buffer.get();
+    }
+
+    void append_escaped(std::string& out, const char* text) {
+        for (auto c = text; *c != '\0'; c++)
+        {
+            switch (*c)
+            {
+                case '\\':  { out += "\\\\";    break; }
+                case '"':   { out += "\\\"";    break; }
+                case '\n':  { out += "\\n";     break; }
+                case '\t':  { out += "\\t";     break; }
+                default:
+                {
+                    if (static_cast<unsigned char>(*c) < 0x20)
+                    {
+                        char buffer[8];
+
+                        std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(*c));
+                        out += buffer;
+                    }
+                    else
+                    {
+                        out += *c;
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    // Trace-event timestamps are microseconds, fractions keep the nanoseconds
+    void append_microseconds(std::string& out, uint64_t nanoseconds) {
+        char buffer[32];
+
+        std::snprintf(buffer, sizeof(buffer), "%llu.%03llu",
+                      static_cast<unsigned long long>(nanoseconds / 1000),
+                      static_cast<unsigned long long>(nanoseconds % 1000));
+
+        out += buffer;
+    }
+
+    // Hex strings, JSON numbers lose precision above 2^53
+    void append_id(std::string& out, uint64_t id) {
+        char buffer[24];
+
+        std::snprintf(buffer, sizeof(buffer), "\"0x%llx\"", static_cast<unsigned long long>(id));
+
+        out += buffer;
+    }
+
+    void append_event(std::string& out, const TraceEvent& event, uint32_t tid, uint64_t start_ns) {
+        const auto timestamp = event.start_ns >= start_ns ? event.start_ns - start_ns : 0;
+
+        out += "{\"name\":\"";
+        append_escaped(out, event.site->name);
+        out += "\",\"cat\":\"";
+        append_escaped(out, event.site->category);
+        out += "\",\"pid\":1,\"tid\":";
+        out += std::to_string(tid);
+        out += ",\"ts\":";
+        append_microseconds(out, timestamp);
+
+        switch (event.type)
+        {
+            case TraceEventType::Zone:
+            {
+                out += ",\"ph\":\"X\",\"dur\":";
+                append_microseconds(out, event.duration_ns);
+                break;
+            }
+            case TraceEventType::Instant:
+            {
+                out += ",\"ph\":\"i\",\"s\":\"t\"";
+                break;
+            }
+            case TraceEventType::FlowBegin:
+            {
+                out += ",\"ph\":\"s\",\"id\":";
+                append_id(out, event.id);
+                break;
+            }
+            case TraceEventType::FlowEnd:
+            {
+                // Binds to the zone around the end rather than the next one to start
+                out += ",\"ph\":\"f\",\"bp\":\"e\",\"id\":";
+                append_id(out, event.id);
+                break;
+            }
+        }
+
+        out += "}";
+    }
+}
+
+void trace_start(size_t events_per_thread) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    // Threads still holding a buffer of the old session keep it alive until they move on
+    registry.clear();
+
+    session_capacity = std::max<size_t>(1, events_per_thread);
+    session_start_ns = trace_now_ns();
+    dropped_events.store(0, std::memory_order_relaxed);
+
+    current_session.fetch_add(1, std::memory_order_release);
+    trace_recording.store(true, std::memory_order_release);
+}
+
+void trace_stop() {
+    trace_recording.store(false, std::memory_order_release);
+}
+
+void trace_set_thread_name(const std::string& name) {
+    thread_state.name = name;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    if (thread_state.buffer)
+    {
+        thread_state.buffer->name = name;
+    }
+}
+
+uint64_t trace_dropped_events() {
+    return dropped_events.load(std::memory_order_relaxed);
+}
+
+void trace_record(const TraceSite& site, TraceEventType type, uint64_t start_ns, uint64_t duration_ns, uint64_t id) {
+    auto buffer = thread_buffer();
+    const auto index = buffer->count.load(std::memory_order_relaxed);
+
+    if (index >= buffer->capacity)
+    {
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[index] = TraceEvent { &site, start_ns, duration_ns, id, type };
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+std::string trace_export_chrome_json() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    auto separate = [&out, &first]() {
+        if (!first)
+        {
+            out += ",\n";
+        }
+        else
+        {
+            out += "\n";
+        }
+
+        first = false;
+    };
+
+    for (const auto& buffer : registry)
+    {
+        const auto name = buffer->name.empty() ? "thread " + std::to_string(buffer->thread_id) : buffer->name;
+
+        separate();
+
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+        out += std::to_string(buffer->thread_id);
+        out += ",\"args\":{\"name\":\"";
+        append_escaped(out, name.c_str());
+        out += "\"}}";
+
+        const auto count = buffer->count.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            separate();
+            append_event(out, buffer->events[i], buffer->thread_id, session_start_ns);
+        }
+    }
+
+    out += "\n]}\n";
+
+    return out;
+}
+
+bool trace_write_chrome_json(const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    file << trace_export_chrome_json();
+
+    return static_cast<bool>(file);
+}
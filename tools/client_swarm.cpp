@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <load_generator/client_swarm.hpp>
+#include <packet_stream/packet_stream.hpp>
+
+/*
+    client_swarm [options]
+
+    Runs a ClientSwarm against a server and prints per-phase latency and
+    failure counts every second and at the end. With --serve an in-process
+    server that accepts every request is started on the port first, which
+    measures the swarm and the stream layer on their own.
+*/
+namespace {
+    constexpr uint16_t DEFAULT_PORT = 47300;
+
+    struct Options {
+        SwarmOptions    swarm;
+        double          duration    = 10.0;
+        bool            serve       = false;
+        bool            json        = false;
+    };
+
+    void print_usage() {
+        std::fprintf(stderr,
+            "usage: client_swarm [options]\n"
+            "  --address <ip>                server address (default: 127.0.0.1)\n"
+            "  --port <port>                 server port (default: %u)\n"
+            "  --clients <n>                 simulated clients (default: 100)\n"
+            "  --schedulers <n>              threads driving the clients (default: 2)\n"
+            "  --io-workers <n>              event loop workers receiving for the clients (default: 2)\n"
+            "  --rate <hz>                   inputs per second per client (default: 60)\n"
+            "  --jitter <fraction>           timer jitter (default: 0.1)\n"
+            "  --ramp-up <ms>                client starts are spread over this (default: 1000)\n"
+            "  --session <ms>                playing time per session (default: 10000)\n"
+            "  --reconnect-probability <p>   sessions ending in a drop and reconnect (default: 0.25)\n"
+            "  --duration <s>                run time (default: 10)\n"
+            "  --serve                       start an accept-everything server on the port\n"
+            "  --json                        print the final report as JSON\n",
+            DEFAULT_PORT);
+    }
+
+    std::optional<Options> parse_options(int argc, char** argv) {
+        Options options;
+
+        options.swarm.server_port = DEFAULT_PORT;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--serve")                                   { options.serve = true;                                                         }
+            else if (arg == "--json")                               { options.json = true;                                                          }
+            else if (arg == "--address" && has_value)               { options.swarm.server_address = argv[++i];                                     }
+            else if (arg == "--port" && has_value)                  { options.swarm.server_port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));  }
+            else if (arg == "--clients" && has_value)               { options.swarm.client_count = std::strtoul(argv[++i], nullptr, 10);            }
+            else if (arg == "--schedulers" && has_value)            { options.swarm.scheduler_threads = std::strtoul(argv[++i], nullptr, 10);       }
+            else if (arg == "--io-workers" && has_value)            { options.swarm.io_workers = std::strtoul(argv[++i], nullptr, 10);              }
+            else if (arg == "--rate" && has_value)                  { options.swarm.input_rate_hz = std::strtod(argv[++i], nullptr);                }
+            else if (arg == "--jitter" && has_value)                { options.swarm.jitter = std::strtod(argv[++i], nullptr);                       }
+            else if (arg == "--ramp-up" && has_value)               { options.swarm.ramp_up = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));          }
+            else if (arg == "--session" && has_value)               { options.swarm.session_duration = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10)); }
+            else if (arg == "--reconnect-probability" && has_value) { options.swarm.reconnect_probability = std::strtod(argv[++i], nullptr);        }
+            else if (arg == "--duration" && has_value)              { options.duration = std::strtod(argv[++i], nullptr);                           }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+
+        return options;
+    }
+
+    /*
+        Accepts every connection and answers every request positively,
+        its streams share one event loop like a real server's would
+    */
+    class AcceptAllServer {
+    public:
+        AcceptAllServer(uint16_t port, size_t worker_count)
+            : m_listener(port)
+            , m_loop(worker_count)
+            , m_running(false)
+            , m_next_client_id(1)
+            , m_next_session_id(1)
+            , m_inputs(0)
+        {}
+
+        ~AcceptAllServer() {
+            stop();
+        }
+
+        bool start() {
+            if (!m_listener.initialize())
+            {
+                return false;
+            }
+
+            m_running = true;
+            m_loop.start();
+            m_accept_thread = std::thread(&AcceptAllServer::accept_loop, this);
+
+            return true;
+        }
+
+        void stop() {
+            if (!m_running.exchange(false))
+            {
+                return;
+            }
+
+            m_listener.abort();
+            m_accept_thread.join();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (auto& connection : m_connections)
+            {
+                connection->stream->stop();
+            }
+
+            m_connections.clear();
+            m_loop.stop();
+        }
+
+        uint64_t inputs() const {
+            return m_inputs.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Connection {
+            std::unique_ptr<PacketStreamServer> stream;
+            std::atomic<bool>                   closed{false};
+        };
+
+        void accept_loop() {
+            while (m_running)
+            {
+                auto accepted = m_listener.accept_client();
+
+                if (!accepted.has_value())
+                {
+                    continue;
+                }
+
+                auto connection = std::make_unique<Connection>();
+                auto* target = connection.get();
+
+                connection->stream = std::make_unique<PacketStreamServer>(std::make_shared<ClientConnection>(std::move(accepted.value())));
+
+                connection->stream->on<ClientHello>([this, target](const PacketHeader&, const ClientHello&) {
+                    target->stream->send_packet(make_packet(ServerAccept { m_next_client_id.fetch_add(1), 0, 0 }));
+                });
+
+                connection->stream->on<ClientGameRequest>([this, target](const PacketHeader&, const ClientGameRequest&) {
+                    ServerGameResponse response = {};
+
+                    response.accepted = Accepted::Accepted;
+                    response.session_id = m_next_session_id.fetch_add(1);
+
+                    target->stream->send_packet(make_packet(response));
+                });
+
+                connection->stream->on<ClientReconnectRequest>([target](const PacketHeader&, const ClientReconnectRequest&) {
+                    ServerReconnectResponse response = {};
+
+                    response.accepted = Accepted::Accepted;
+
+                    target->stream->send_packet(make_packet(response));
+                });
+
+                connection->stream->on<ClientInput>([this](const PacketHeader&, const ClientInput&) {
+                    m_inputs.fetch_add(1, std::memory_order_relaxed);
+                });
+
+                connection->stream->set_receive_callback([target](StreamEvent event) {
+                    if (event == StreamEvent::Closed)
+                    {
+                        target->closed.store(true, std::memory_order_release);
+                    }
+                });
+
+                connection->stream->start(m_loop);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                // Streams of departed clients are released here, never from their own callbacks
+                for (auto& existing : m_connections)
+                {
+                    if (existing->closed.load(std::memory_order_acquire))
+                    {
+                        existing->stream->stop();
+                        existing.reset();
+                    }
+                }
+
+                m_connections.erase(std::remove(m_connections.begin(), m_connections.end(), nullptr), m_connections.end());
+                m_connections.push_back(std::move(connection));
+            }
+        }
+
+        ServerSocket                                m_listener;
+        IoEventLoop                                 m_loop;
+        std::atomic<bool>                           m_running;
+        std::thread                                 m_accept_thread;
+
+        std::mutex                                  m_mutex;
+        std::vector<std::unique_ptr<Connection>>    m_connections;
+
+        std::atomic<uint32_t>                       m_next_client_id;
+        std::atomic<uint32_t>                       m_next_session_id;
+        std::atomic<uint64_t>                       m_inputs;
+    };
+
+    double to_ms(uint64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    }
+
+    void print_progress(double elapsed, const SwarmStats& stats) {
+        const auto& hello = stats.phases[static_cast<size_t>(SwarmPhase::Hello)].latency;
+
+        std::printf("[client_swarm] %6.1fs  connected=%llu  inputs=%llu  sessions=%llu  hello p99=%.2fms\n",
+                    elapsed,
+                    static_cast<unsigned long long>(stats.connected_clients),
+                    static_cast<unsigned long long>(stats.inputs_sent),
+                    static_cast<unsigned long long>(stats.sessions_completed),
+                    to_ms(hello.percentile(99.0)));
+        std::fflush(stdout);
+    }
+
+    void print_report(const Options& options, double elapsed, const SwarmStats& stats, std::optional<uint64_t> served_inputs) {
+        const auto inputs_per_second = elapsed > 0.0 ? static_cast<double>(stats.inputs_sent) / elapsed : 0.0;
+
+        if (options.json)
+        {
+            std::printf("{\"clients\":%zu,\"elapsed_s\":%.3f,\"inputs_sent\":%llu,\"inputs_per_s\":%.1f,\"frames_received\":%llu,"
+                        "\"sessions_completed\":%llu,\"sessions_dropped\":%llu,\"scripted_drops\":%llu,\"phases\":{",
+                        options.swarm.client_count, elapsed,
+                        static_cast<unsigned long long>(stats.inputs_sent), inputs_per_second,
+                        static_cast<unsigned long long>(stats.frames_received),
+                        static_cast<unsigned long long>(stats.sessions_completed),
+                        static_cast<unsigned long long>(stats.sessions_dropped),
+                        static_cast<unsigned long long>(stats.scripted_drops));
+
+            for (size_t i = 0; i < SWARM_PHASE_COUNT; i++)
+            {
+                const auto& phase = stats.phases[i];
+
+                std::printf("%s\"%s\":{\"attempts\":%llu,\"succeeded\":%llu,\"failed\":%llu,\"timed_out\":%llu,"
+                            "\"rejected\":%llu,\"dropped\":%llu,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f}",
+                            i > 0 ? "," : "", swarm_phase_name(static_cast<SwarmPhase>(i)),
+                            static_cast<unsigned long long>(phase.attempts),
+                            static_cast<unsigned long long>(phase.succeeded),
+                            static_cast<unsigned long long>(phase.failed),
+                            static_cast<unsigned long long>(phase.timed_out),
+                            static_cast<unsigned long long>(phase.rejected),
+                            static_cast<unsigned long long>(phase.dropped),
+                            to_ms(phase.latency.percentile(50.0)), to_ms(phase.latency.percentile(99.0)),
+                            to_ms(phase.latency.percentile(99.9)), to_ms(phase.latency.max()));
+            }
+
+            std::printf("}");
+
+            if (served_inputs.has_value())
+            {
+                std::printf(",\"inputs_received\":%llu", static_cast<unsigned long long>(served_inputs.value()));
+            }
+
+            std::printf("}\n");
+
+            return;
+        }
+
+        std::printf("[client_swarm] %zu clients, %.1fs\n", options.swarm.client_count, elapsed);
+        std::printf("  inputs sent=%llu (%.0f/s)  frames received=%llu  sessions completed=%llu  dropped=%llu  scripted drops=%llu\n",
+                    static_cast<unsigned long long>(stats.inputs_sent), inputs_per_second,
+                    static_cast<unsigned long long>(stats.frames_received),
+                    static_cast<unsigned long long>(stats.sessions_completed),
+                    static_cast<unsigned long long>(stats.sessions_dropped),
+                    static_cast<unsigned long long>(stats.scripted_drops));
+
+        if (served_inputs.has_value())
+        {
+            std::printf("  inputs received by --serve=%llu\n", static_cast<unsigned long long>(served_inputs.value()));
+        }
+
+        std::printf("  %-13s %9s %9s %7s %9s %8s %8s %9s %9s %9s %9s\n",
+                    "phase", "attempts", "ok", "failed", "timed_out", "rejected", "dropped",
+                    "p50_ms", "p99_ms", "p99.9_ms", "max_ms");
+
+        for (size_t i = 0; i < SWARM_PHASE_COUNT; i++)
+        {
+            const auto& phase = stats.phases[i];
+
+            std::printf("  %-13s %9llu %9llu %7llu %9llu %8llu %8llu %9.3f %9.3f %9.3f %9.3f\n",
+                        swarm_phase_name(static_cast<SwarmPhase>(i)),
+                        static_cast<unsigned long long>(phase.attempts),
+                        static_cast<unsigned long long>(phase.succeeded),
+                        static_cast<unsigned long long>(phase.failed),
+                        static_cast<unsigned long long>(phase.timed_out),
+                        static_cast<unsigned long long>(phase.rejected),
+                        static_cast<unsigned long long>(phase.dropped),
+                        to_ms(phase.latency.percentile(50.0)), to_ms(phase.latency.percentile(99.0)),
+                        to_ms(phase.latency.percentile(99.9)), to_ms(phase.latency.max()));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    if (!options.has_value())
+    {
+        print_usage();
+        return 2;
+    }
+
+    std::unique_ptr<AcceptAllServer> server;
+
+    if (options->serve)
+    {
+        server = std::make_unique<AcceptAllServer>(options->swarm.server_port, std::max<size_t>(1, std::thread::hardware_concurrency() / 2));
+
+        if (!server->start())
+        {
+            std::fprintf(stderr, "[client_swarm] Failed to listen on port %u\n", options->swarm.server_port);
+            return 1;
+        }
+    }
+
+    ClientSwarm swarm(options->swarm);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options->duration));
+    auto next_progress = start + std::chrono::seconds(1);
+
+    swarm.start();
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+        std::this_thread::sleep_until(std::min(end, next_progress));
+
+        if (!options->json && std::chrono::steady_clock::now() >= next_progress)
+        {
+            print_progress(std::chrono::duration<double>(next_progress - start).count(), swarm.stats());
+            next_progress += std::chrono::seconds(1);
+        }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    swarm.stop();
+
+    const auto stats = swarm.stats();
+
+    std::optional<uint64_t> served_inputs;
+
+    if (server)
+    {
+        served_inputs = server->inputs();
+        server->stop();
+    }
+
+    print_report(options.value(), elapsed, stats, served_inputs);
+
+    return 0;
+}
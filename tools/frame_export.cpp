@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <frame_export/frame_columns.hpp>
+
+/*
+    frame_export --out <directory> <recording.bhr>... [options]
+
+    Converts the frames of SessionRecorder files into NumPy columns, one
+    directory per recording and stream:
+
+        <out>/<recording name>/stream_<id>/frames.timestamp.npy
+        <out>/<recording name>/stream_<id>/bullets.pos_x.npy
+        ...
+
+    See FrameColumnWriter for the layout. Recordings are converted in
+    parallel, one per thread.
+
+        import numpy as np
+        offsets = np.load("stream_1/frames.bullet_offsets.npy", mmap_mode="r")
+        xs = np.load("stream_1/bullets.pos_x.npy", mmap_mode="r")
+        frame_xs = xs[offsets[i]:offsets[i + 1]]
+*/
+namespace {
+    struct Options {
+        std::vector<std::string>    recordings;
+        std::string                 output;
+        size_t                      threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    };
+
+    void print_usage() {
+        std::fprintf(stderr,
+            "usage: frame_export --out <directory> <recording>... [options]\n"
+            "  --out <directory>  where the columns are written\n"
+            "  --threads <n>      recordings converted at once (default: hardware threads)\n");
+    }
+
+    std::optional<Options> parse_options(int argc, char** argv) {
+        Options options;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--out" && has_value)
+            {
+                options.output = argv[++i];
+            }
+            else if (arg == "--threads" && has_value)
+            {
+                options.threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg.rfind("--", 0) == 0)
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                options.recordings.push_back(arg);
+            }
+        }
+
+        if (options.output.empty() || options.recordings.empty())
+        {
+            return std::nullopt;
+        }
+
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    if (!options.has_value())
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<FrameColumnExportJob> jobs;
+
+    for (const auto& recording : options->recordings)
+    {
+        const auto name = std::filesystem::path(recording).stem().string();
+
+        jobs.push_back({ recording, (std::filesystem::path(options->output) / name).string() });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto results = export_recordings_columns(jobs, options->threads);
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t frames = 0;
+    int exit_code = 0;
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const auto& result = results[i];
+
+        if (!result.succeeded)
+        {
+            std::fprintf(stderr, "frame_export: %s: %s\n", jobs[i].recording_path.c_str(), result.error.c_str());
+            exit_code = 1;
+
+            continue;
+        }
+
+        std::printf("%s: %llu streams, %llu frames (%llu undecodable) -> %s\n",
+                    jobs[i].recording_path.c_str(),
+                    static_cast<unsigned long long>(result.streams),
+                    static_cast<unsigned long long>(result.frames),
+                    static_cast<unsigned long long>(result.skipped_frames),
+                    jobs[i].output_directory.c_str());
+
+        frames += result.frames;
+    }
+
+    std::printf("%llu frames in %.2f s (%.0f frames/s)\n",
+                static_cast<unsigned long long>(frames), seconds, seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0);
+
+    return exit_code;
+}
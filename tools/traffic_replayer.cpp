@@ -0,0 +1,636 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <event_loop/io_event_loop.hpp>
+#include <metrics/latency_histogram.hpp>
+#include <packet_serializer/packet_serializer.hpp>
+#include <packet_stream/packet_stream.hpp>
+#include <recorder/replay_reader.hpp>
+
+/*
+    traffic_replayer <recording.bhr> [options]
+
+    Replays the client to server traffic (greetings, requests, inputs) of a
+    SessionRecorder file into in-process PacketStreamServers over loopback,
+    one TCP connection per virtual client, and reports what the servers saw:
+    throughput and the send-to-dispatch latency of every packet.
+
+    Virtual clients are assigned the recorded streams round-robin, so a
+    recording of 4 clients can drive 1000 connections.
+
+    Only the records a stream sent are replayed by default, which is the
+    client traffic of a recorder attached to clients. --direction received
+    replays what a recorder attached to a server stream received.
+*/
+namespace {
+    constexpr uint16_t DEFAULT_PORT = 47100;
+
+    /*
+        Packets a virtual client may have in flight, the sender waits for the server
+        before sending more so no send time is overwritten while it is still needed.
+        TCP keeps the order and a stream dispatches in order, so the n-th packet the
+        server stream receives is the n-th one the client sent.
+    */
+    constexpr size_t SEND_TIME_SLOTS = 4096;
+
+    // How long to wait for the servers to receive what is in flight (full send time slots, after the last send)
+    constexpr auto DRAIN_TIMEOUT = std::chrono::seconds(5);
+
+    struct Options {
+        std::string recording;
+        double      speed           = 0.0;  // 0 = as fast as possible, 1 = original timing, N = N times faster
+        size_t      clients         = 0;    // 0 = one per recorded stream
+        size_t      senders         = 1;
+        size_t      server_threads  = std::max<size_t>(1, std::thread::hardware_concurrency());
+        size_t      repeat          = 1;
+        uint16_t    port            = DEFAULT_PORT;
+        bool        json            = false;
+
+        std::optional<RecordDirection> direction = RecordDirection::Sent;   // std::nullopt replays both
+    };
+
+    void print_usage() {
+        std::fprintf(stderr,
+            "usage: traffic_replayer <recording> [options]\n"
+            "  --speed <x>           0 = as fast as possible (default), 1 = original timing, N = N times faster\n"
+            "  --clients <n>         virtual clients (default: one per recorded stream)\n"
+            "  --senders <n>         sending threads (default: 1)\n"
+            "  --server-threads <n>  event loop workers of the servers (default: hardware threads)\n"
+            "  --repeat <n>          play the recording n times (default: 1)\n"
+            "  --direction <d>       records to replay: sent (default), received or all\n"
+            "  --port <port>         loopback port (default: %u)\n"
+            "  --json                print the report as JSON\n",
+            DEFAULT_PORT);
+    }
+
+    std::optional<Options> parse_options(int argc, char** argv) {
+        if (argc < 2)
+        {
+            return std::nullopt;
+        }
+
+        Options options;
+
+        options.recording = argv[1];
+
+        for (int i = 2; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "--json")
+            {
+                options.json = true;
+            }
+            else if (arg == "--speed" && has_value)
+            {
+                options.speed = std::strtod(argv[++i], nullptr);
+            }
+            else if (arg == "--clients" && has_value)
+            {
+                options.clients = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--senders" && has_value)
+            {
+                options.senders = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--server-threads" && has_value)
+            {
+                options.server_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--repeat" && has_value)
+            {
+                options.repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--port" && has_value)
+            {
+                options.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--direction" && has_value)
+            {
+                const std::string direction = argv[++i];
+
+                if (direction == "sent")            { options.direction = RecordDirection::Sent;        }
+                else if (direction == "received")   { options.direction = RecordDirection::Received;    }
+                else if (direction == "all")        { options.direction = std::nullopt;                 }
+                else                                { return std::nullopt;                              }
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+
+        return options;
+    }
+
+    uint64_t now_ns() {
+        using namespace std::chrono;
+
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool is_client_payload(PayloadType type) {
+        switch (type)
+        {
+            case PayloadType::ClientHello:
+            case PayloadType::ClientGoodbye:
+            case PayloadType::ClientGameRequest:
+            case PayloadType::ClientReconnectRequest:
+            case PayloadType::ClientInput:
+            case PayloadType::ClientInputWindow:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::optional<PacketPayload> decode_client_payload(PayloadType type, const std::vector<std::byte>& bytes) {
+        switch (type)
+        {
+            case PayloadType::ClientHello:              { return deserialize_client_hello(bytes);               }
+            case PayloadType::ClientGoodbye:            { return deserialize_client_goodbye(bytes);             }
+            case PayloadType::ClientGameRequest:        { return deserialize_client_game_request(bytes);        }
+            case PayloadType::ClientReconnectRequest:   { return deserialize_client_reconnect_request(bytes);   }
+            case PayloadType::ClientInput:              { return deserialize_client_input(bytes);               }
+            case PayloadType::ClientInputWindow:        { return deserialize_client_input_window(bytes);        }
+            default:                                    { return std::nullopt;                                  }
+        }
+    }
+
+    bool replays_direction(const ReplayRecord& record, const Options& options) {
+        return !options.direction.has_value() || record.header.direction == options.direction.value();
+    }
+
+    // Packets of one recorded record, a bundle holds several
+    struct ReplayPackets {
+        std::vector<Packet> packets;
+        bool                bundled = false;
+    };
+
+    bool decode_record(const ReplayRecord& record, std::vector<std::byte>& scratch, ReplayPackets& out) {
+        out.packets.clear();
+        out.bundled = false;
+
+        const auto type = record.header.header.payload_type;
+
+        scratch.assign(record.payload, record.payload + record.payload_size());
+
+        if (type == PayloadType::Bundle)
+        {
+            const auto entries = deserialize_bundle(scratch);
+
+            if (!entries.has_value())
+            {
+                return false;
+            }
+
+            std::vector<std::byte> entry_bytes;
+
+            for (const auto& entry : entries.value())
+            {
+                if (!is_client_payload(entry.payload_type))
+                {
+                    return false;
+                }
+
+                entry_bytes.assign(scratch.begin() + entry.offset, scratch.begin() + entry.offset + entry.size);
+
+                auto payload = decode_client_payload(entry.payload_type, entry_bytes);
+
+                if (payload.has_value())
+                {
+                    out.packets.push_back(Packet { PacketHeader { PACKET_MAGIC_NUMBER, 0, 0, entry.payload_type }, std::move(payload.value()) });
+                }
+            }
+
+            out.bundled = true;
+
+            return !out.packets.empty();
+        }
+
+        if (!is_client_payload(type))
+        {
+            return false;
+        }
+
+        auto payload = decode_client_payload(type, scratch);
+
+        if (!payload.has_value())
+        {
+            return false;
+        }
+
+        out.packets.push_back(Packet { PacketHeader { PACKET_MAGIC_NUMBER, 0, 0, type }, std::move(payload.value()) });
+
+        return true;
+    }
+
+    /*
+        One connection: the replaying client and the server stream it feeds.
+        The sender thread writes send_times, the server stream's worker reads them.
+    */
+    struct VirtualClient {
+        uint32_t                                    recorded_stream = 0;
+
+        std::shared_ptr<ClientSocket>               client_socket;
+        std::unique_ptr<PacketStreamClient>         client;
+        uint64_t                                    sent = 0;               // Sender thread only, packets sent successfully
+        uint64_t                                    failed = 0;             // Sender thread only, packets that could not be sent
+
+        std::shared_ptr<ClientConnection>           connection;
+        std::unique_ptr<PacketStreamServer>         server;
+        std::unique_ptr<std::atomic<uint64_t>[]>    send_times;
+        std::atomic<uint64_t>                       received{0};
+        LatencyHistogram                            latency;                // Server worker only
+    };
+
+    // Runs on the server stream's worker, the only writer of received and latency
+    void record_arrival(VirtualClient& client) {
+        const auto index = client.received.load(std::memory_order_relaxed);
+        const auto sent_at = client.send_times[index % SEND_TIME_SLOTS].load(std::memory_order_acquire);
+
+        client.latency.record(now_ns() - sent_at);
+        client.received.store(index + 1, std::memory_order_release);
+    }
+
+    template <typename... Ts, typename Stream, typename Handler>
+    void bind_handlers(Stream& stream, Handler handler) {
+        (stream.template on<Ts>(handler), ...);
+    }
+
+    bool connect_clients(ServerSocket& listener, uint16_t port, std::vector<std::unique_ptr<VirtualClient>>& clients) {
+        for (auto& client : clients)
+        {
+            client->client_socket = std::make_shared<ClientSocket>("127.0.0.1", port);
+
+            if (!client->client_socket->connect_to_server())
+            {
+                return false;
+            }
+
+            auto connection = listener.accept_client();
+
+            if (!connection.has_value())
+            {
+                return false;
+            }
+
+            client->connection = std::make_shared<ClientConnection>(std::move(connection.value()));
+            client->send_times = std::make_unique<std::atomic<uint64_t>[]>(SEND_TIME_SLOTS);
+        }
+
+        return true;
+    }
+
+    void start_streams(std::vector<std::unique_ptr<VirtualClient>>& clients, IoEventLoop& server_loop, IoEventLoop& client_loop) {
+        for (auto& client_ptr : clients)
+        {
+            auto* client = client_ptr.get();
+
+            client->server = std::make_unique<PacketStreamServer>(client->connection);
+
+            bind_handlers<ClientGoodbye, ClientGameRequest, ClientReconnectRequest, ClientInput, ClientInputWindow>(
+                *client->server, [client](const PacketHeader&, const auto&) {
+                    record_arrival(*client);
+                });
+
+            // A hello gets the accept a real server would send
+            client->server->on<ClientHello>([client](const PacketHeader&, const ClientHello&) {
+                record_arrival(*client);
+                client->server->send_packet(make_packet(ServerAccept { client->recorded_stream, 0, 0 }));
+            });
+
+            client->server->start(server_loop);
+
+            // Nothing reads what the servers answer, handlers keep it out of the client's queues
+            client->client = std::make_unique<PacketStreamClient>(client->client_socket);
+
+            bind_handlers<ServerAccept, ServerGoodbye, ServerGameResponse, ServerReconnectResponse, FrameSnapshot>(
+                *client->client, [](const PacketHeader&, const auto&) {});
+
+            client->client->start(client_loop);
+        }
+    }
+
+    /*
+        Stamps the send time of every packet before it can arrive. Only packets that
+        were sent count in sent and take a send time slot, the slot of a failed one
+        is stamped again by the next packet, so arrivals stay matched to their sends.
+    */
+    void send_record(VirtualClient& client, const ReplayPackets& packets) {
+        const auto count = packets.packets.size();
+
+        // Backpressure: wait until the server has freed enough send time slots, give up on a stalled server
+        const auto deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+
+        while (client.sent + count - client.received.load(std::memory_order_acquire) > SEND_TIME_SLOTS)
+        {
+            if (!client.server->is_running() || std::chrono::steady_clock::now() >= deadline)
+            {
+                client.failed += count;
+                return;
+            }
+
+            std::this_thread::yield();
+        }
+
+        const auto sent_at = now_ns();
+
+        if (!packets.bundled)
+        {
+            client.send_times[client.sent % SEND_TIME_SLOTS].store(sent_at, std::memory_order_release);
+
+            if (client.client->send_packet(packets.packets.front()))
+            {
+                client.sent++;
+            }
+            else
+            {
+                client.failed++;
+            }
+
+            return;
+        }
+
+        size_t queued = 0;
+
+        for (const auto& packet : packets.packets)
+        {
+            client.send_times[(client.sent + queued) % SEND_TIME_SLOTS].store(sent_at, std::memory_order_release);
+
+            if (client.client->queue_packet(packet))
+            {
+                queued++;
+            }
+        }
+
+        // A failed flush loses the whole bundle
+        if (!client.client->flush())
+        {
+            queued = 0;
+        }
+
+        client.sent += queued;
+        client.failed += count - queued;
+    }
+
+    // Walks the recording once per repeat and plays the records of the clients this sender owns
+    void run_sender(const ReplayReader& reader, const Options& options,
+                    const std::unordered_map<uint32_t, std::vector<VirtualClient*>>& clients_by_stream) {
+        std::vector<std::byte> scratch;
+        ReplayPackets packets;
+
+        for (size_t round = 0; round < options.repeat; round++)
+        {
+            auto cursor = reader.records();
+
+            const auto start = now_ns();
+            std::optional<uint64_t> first_timestamp;
+
+            while (const auto record = cursor.next())
+            {
+                const auto it = clients_by_stream.find(record->header.stream_id);
+
+                if (it == clients_by_stream.end() || !replays_direction(*record, options) ||
+                    !decode_record(*record, scratch, packets))
+                {
+                    continue;
+                }
+
+                if (options.speed > 0.0)
+                {
+                    if (!first_timestamp.has_value())
+                    {
+                        first_timestamp = record->header.timestamp_ns;
+                    }
+
+                    const auto offset = static_cast<double>(record->header.timestamp_ns - first_timestamp.value()) / options.speed;
+                    const auto due = start + static_cast<uint64_t>(offset);
+                    const auto now = now_ns();
+
+                    if (due > now)
+                    {
+                        std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                    }
+                }
+
+                for (auto* client : it->second)
+                {
+                    send_record(*client, packets);
+                }
+            }
+        }
+    }
+
+    void print_report(const Options& options, const std::vector<std::unique_ptr<VirtualClient>>& clients,
+                      uint64_t elapsed_ns, uint64_t sent, uint64_t failed, uint64_t received, const LatencyHistogram& latency) {
+        const auto seconds = static_cast<double>(elapsed_ns) / 1e9;
+        const auto throughput = seconds > 0.0 ? static_cast<double>(received) / seconds : 0.0;
+
+        if (options.json)
+        {
+            std::printf("{\"recording\":\"%s\",\"speed\":%g,\"clients\":%zu,\"senders\":%zu,\"server_threads\":%zu,"
+                        "\"elapsed_s\":%.6f,\"sent\":%llu,\"send_failures\":%llu,\"received\":%llu,\"packets_per_s\":%.1f,"
+                        "\"latency_ns\":{\"min\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}\n",
+                        options.recording.c_str(), options.speed, clients.size(), options.senders, options.server_threads,
+                        seconds, static_cast<unsigned long long>(sent), static_cast<unsigned long long>(failed),
+                        static_cast<unsigned long long>(received), throughput,
+                        static_cast<unsigned long long>(latency.min()), latency.mean(),
+                        static_cast<unsigned long long>(latency.percentile(50.0)),
+                        static_cast<unsigned long long>(latency.percentile(90.0)),
+                        static_cast<unsigned long long>(latency.percentile(99.0)),
+                        static_cast<unsigned long long>(latency.percentile(99.9)),
+                        static_cast<unsigned long long>(latency.max()));
+
+            return;
+        }
+
+        std::printf("[traffic_replayer] %s\n", options.recording.c_str());
+
+        if (options.speed > 0.0)
+        {
+            std::printf("  clients=%zu  senders=%zu  server_threads=%zu  speed=%gx\n",
+                        clients.size(), options.senders, options.server_threads, options.speed);
+        }
+        else
+        {
+            std::printf("  clients=%zu  senders=%zu  server_threads=%zu  speed=max\n",
+                        clients.size(), options.senders, options.server_threads);
+        }
+
+        std::printf("  elapsed=%.3fs  sent=%llu  send_failures=%llu  received=%llu  packets/s=%.0f\n",
+                    seconds, static_cast<unsigned long long>(sent), static_cast<unsigned long long>(failed),
+                    static_cast<unsigned long long>(received), throughput);
+        std::printf("  latency us: min=%.1f  mean=%.1f  p50=%.1f  p90=%.1f  p99=%.1f  p99.9=%.1f  max=%.1f\n",
+                    latency.min() / 1e3, latency.mean() / 1e3,
+                    latency.percentile(50.0) / 1e3, latency.percentile(90.0) / 1e3,
+                    latency.percentile(99.0) / 1e3, latency.percentile(99.9) / 1e3, latency.max() / 1e3);
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_options(argc, argv);
+
+    if (!options.has_value())
+    {
+        print_usage();
+        return 2;
+    }
+
+    ReplayReader reader;
+
+    if (!reader.open(options->recording))
+    {
+        std::fprintf(stderr, "[traffic_replayer] Failed to open %s\n", options->recording.c_str());
+        return 1;
+    }
+
+    // Recorded streams that carry client traffic
+    std::vector<uint32_t> streams;
+
+    {
+        std::vector<std::byte> scratch;
+        ReplayPackets packets;
+        auto cursor = reader.records();
+
+        while (const auto record = cursor.next())
+        {
+            const auto stream_id = record->header.stream_id;
+
+            if (std::find(streams.begin(), streams.end(), stream_id) == streams.end() &&
+                replays_direction(*record, options.value()) && decode_record(*record, scratch, packets))
+            {
+                streams.push_back(stream_id);
+            }
+        }
+    }
+
+    if (streams.empty())
+    {
+        std::fprintf(stderr, "[traffic_replayer] The recording has no client traffic in the replayed direction\n");
+        return 1;
+    }
+
+    std::sort(streams.begin(), streams.end());
+
+    const auto client_count = options->clients > 0 ? options->clients : streams.size();
+    std::vector<std::unique_ptr<VirtualClient>> clients;
+
+    for (size_t i = 0; i < client_count; i++)
+    {
+        clients.push_back(std::make_unique<VirtualClient>());
+        clients.back()->recorded_stream = streams[i % streams.size()];
+    }
+
+    ServerSocket listener(options->port);
+
+    if (!listener.initialize() || !connect_clients(listener, options->port, clients))
+    {
+        std::fprintf(stderr, "[traffic_replayer] Failed to open %zu loopback connections on port %u\n",
+                     client_count, options->port);
+        return 1;
+    }
+
+    IoEventLoop server_loop(options->server_threads);
+    IoEventLoop client_loop(1);
+
+    server_loop.start();
+    client_loop.start();
+    start_streams(clients, server_loop, client_loop);
+
+    // Every sender owns a share of the clients, grouped by the stream they replay
+    std::vector<std::unordered_map<uint32_t, std::vector<VirtualClient*>>> assignments(options->senders);
+
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        assignments[i % options->senders][clients[i]->recorded_stream].push_back(clients[i].get());
+    }
+
+    const auto start = now_ns();
+
+    std::vector<std::thread> senders;
+
+    for (size_t i = 0; i < options->senders; i++)
+    {
+        senders.emplace_back(run_sender, std::cref(reader), std::cref(options.value()), std::cref(assignments[i]));
+    }
+
+    for (auto& sender : senders)
+    {
+        sender.join();
+    }
+
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+
+    for (const auto& client : clients)
+    {
+        sent += client->sent;
+        failed += client->failed;
+    }
+
+    // Wait for the servers to catch up
+    const auto deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+    uint64_t received = 0;
+    uint64_t last_received_at = now_ns();
+
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        uint64_t total = 0;
+
+        for (const auto& client : clients)
+        {
+            total += client->received.load(std::memory_order_acquire);
+        }
+
+        if (total != received)
+        {
+            received = total;
+            last_received_at = now_ns();
+        }
+
+        if (received >= sent)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto elapsed = last_received_at - start;
+
+    // Servers first, so none of them sees its client hang up
+    for (auto& client : clients)
+    {
+        client->server->stop();
+    }
+
+    for (auto& client : clients)
+    {
+        client->client->stop();
+    }
+
+    client_loop.stop();
+    server_loop.stop();
+
+    LatencyHistogram latency;
+
+    for (const auto& client : clients)
+    {
+        latency.merge(client->latency);
+    }
+
+    print_report(options.value(), clients, elapsed, sent, failed, received, latency);
+
+    return received >= sent && failed == 0 ? 0 : 1;
+}